@@ -41,6 +41,10 @@ public class MainActivity extends VRActivity {
 
     // For sd storage writing
     public native void setExportPath(String path);
+    // Age of the patient for the normative isopters, e.g.
+    // adb shell am start -n .../.MainActivity --ef patient_age 54
+    public native void setPatientAge(float years);
+    private static final String EXTRA_PATIENT_AGE = "patient_age";
     private static final String TAG = "wvr_hellovr";
 
     private static final String ACTION_SWITCH_DEBUG = "com.htc.vr.samples.wvr_hellovr.ACTION_SWITCH_DEBUG";
@@ -124,6 +128,10 @@ public class MainActivity extends VRActivity {
 
         // Send this path to C++
         setExportPath(sdCardPath);
+        float patientAge = getIntent().getFloatExtra(EXTRA_PATIENT_AGE, 0.0f);
+        if (patientAge > 0.0f) {
+            setPatientAge(patientAge);
+        }
 
 
         super.onCreate(icicle);
@@ -35,6 +35,7 @@ COMMON_INCLUDES := \
     $(VR_SDK_ROOT)/include \
     $(LOCAL_PATH)/object \
     $(LOCAL_PATH)/scene \
+    $(LOCAL_PATH)/core \
     $(LOCAL_PATH)/shared \
     $(LOCAL_PATH)
     
@@ -52,9 +53,27 @@ COMMON_FILES := \
     object/Object.cpp \
     object/Mesh.cpp \
     Settings.cpp\
+    core/DicomExport.cpp \
+    core/ExamStateMachine.cpp \
+    core/FileUtil.cpp \
+    core/GazeRecorder.cpp \
+    core/GoldmannSheet.cpp \
+    core/GoldmannSizes.cpp \
+    core/IoWorker.cpp \
+    core/Isopter.cpp \
+    core/IsopterArea.cpp \
+    core/JournalWriter.cpp \
+    core/NormativeModel.cpp \
+    core/PerimetryEngine.cpp \
+    core/ResumeJournal.cpp \
+    core/SessionFile.cpp \
+    core/SessionRecorder.cpp \
+    core/SessionUploader.cpp \
+    core/SheetExport.cpp \
+    core/TrajectoryTable.cpp \
+    core/UploadProtocol.cpp \
     scene/Stars.cpp \
     scene/Sky.cpp \
-    scene/GoldmannSizes.cpp \
     scene/Meteoroid.cpp \
     scene/Terrain.cpp \
     scene/SkySphere.cpp \
@@ -5,8 +5,10 @@
 
 #include <Vectors.h>
 #include <map>
+#include <vector>
 #include <glm/glm.hpp>
 #include "GoldmannSizes.h"
+#include "GoldmannStimulus.h"
 
 // Stary Sky
 // -----------
@@ -31,11 +33,11 @@ constexpr float FOCUS_POINT_DISTANCE = 20.0f;
 
 
 // Meteroid
+// Expected isopters come from the normative model (core/NormativeModel.h)
+// for the age of the patient.
 struct PerimetryVector {
     int angle_deg;
-    std::vector<double> normative_val_right;
-    std::vector<double> normative_val_left;
-    std::string luminance;
+    StimulusCode luminance;
     MeteoroidSizeID size;
 };
 constexpr float METEOROID_DISTANCE = 50.0f;
@@ -43,12 +45,12 @@ constexpr bool METEOROID_RANDOM = true;
 constexpr float METEOROID_SPEED = 5.0f; // deg/sec
 constexpr int NUMBER_ITERATIONS_PER_SIZE = 2;
 constexpr float REACTION_TIME = 0.5; // seconds
+constexpr double DEFAULT_PATIENT_AGE_YEARS = 31.0; // Normative isopters until the age is known
 
 // extern const std::string TARGET_LUMINANCE_DB = "3e";
-extern const std::map<MeteoroidSizeID, std::vector<std::string>> LUMINANCE_TO_USE;
+extern const std::map<MeteoroidSizeID, std::vector<StimulusCode>> LUMINANCE_TO_USE;
 
 extern const std::map<MeteoroidSizeID, bool> METEOROID_SIZES;
-extern const std::map<MeteoroidSizeID, AnyMeteoroidSize> m_size_map;
 extern const std::vector<PerimetryVector> METEOROID_LONGITUDES_DEG;
 extern const Vector3 METEOROID_COLOR; //
 extern const glm::vec3 GENERAL_THALES_POINT;
@@ -61,6 +63,13 @@ constexpr float MAX_HEADSET_LUMINANCE_NITS = 150.0f;
 
 // Goldmann Standard Background: 31.5 asb ~= 10 cd/m² (nits)
 constexpr float BACKGROUND_LUMINANCE_NITS = 10.0f;
+
+// Goldmann stimuli (nits, colour, attenuation) for this headset, built at compile time
+constexpr auto GOLDMANN_STIMULI = make_stimulus_table(BACKGROUND_LUMINANCE_NITS, MAX_HEADSET_LUMINANCE_NITS);
+constexpr const StimulusInfo& stimulus_info(StimulusCode code) { return GOLDMANN_STIMULI[code.index]; }
+// Exam flow
+constexpr double PAUSE_RESUME_DELAY_S = 5.0; // Pause menu closed -> stimuli move again
+
 // Angle for eye tracker
 const float MAX_ACCEPTANCE_ANGLE_DEG = 6.0f;
 
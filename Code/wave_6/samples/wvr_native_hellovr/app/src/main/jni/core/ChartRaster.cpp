@@ -0,0 +1,540 @@
+// ChartRaster.cpp
+#include "ChartRaster.h"
+#include "FileUtil.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+// 5x7 glyphs of ASCII 32..126, then °. One byte per row, bit 4 is the left
+// column.
+constexpr int GLYPH_FIRST = 32;
+constexpr int GLYPH_DEGREE = 95;
+constexpr std::uint8_t FONT[96][7] = {
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, {0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04}, // space !
+        {0x0A, 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00}, {0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A}, // " #
+        {0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04}, {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}, // $ %
+        {0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D}, {0x0C, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00}, // & '
+        {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02}, {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08}, // ( )
+        {0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00}, {0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00}, // * +
+        {0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08}, {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}, // , -
+        {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}, {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}, // . /
+        {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}, {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}, // 0 1
+        {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}, {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}, // 2 3
+        {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}, {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}, // 4 5
+        {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}, {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}, // 6 7
+        {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}, {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}, // 8 9
+        {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}, {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08}, // : ;
+        {0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02}, {0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00}, // < =
+        {0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08}, {0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04}, // > ?
+        {0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E}, {0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11}, // @ A
+        {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}, {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}, // B C
+        {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}, {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}, // D E
+        {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}, {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}, // F G
+        {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}, {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}, // H I
+        {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}, {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}, // J K
+        {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}, {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}, // L M
+        {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}, {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // N O
+        {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}, {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}, // P Q
+        {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}, {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}, // R S
+        {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // T U
+        {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}, {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}, // V W
+        {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}, {0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04}, // X Y
+        {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}, {0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E}, // Z [
+        {0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00}, {0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E}, // \ ]
+        {0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F}, // ^ _
+        {0x08, 0x04, 0x02, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x0E, 0x01, 0x0F, 0x11, 0x0F}, // ` a
+        {0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x1E}, {0x00, 0x00, 0x0E, 0x10, 0x10, 0x11, 0x0E}, // b c
+        {0x01, 0x01, 0x0D, 0x13, 0x11, 0x11, 0x0F}, {0x00, 0x00, 0x0E, 0x11, 0x1F, 0x10, 0x0E}, // d e
+        {0x06, 0x09, 0x08, 0x1C, 0x08, 0x08, 0x08}, {0x00, 0x0F, 0x11, 0x11, 0x0F, 0x01, 0x0E}, // f g
+        {0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x11}, {0x04, 0x00, 0x0C, 0x04, 0x04, 0x04, 0x0E}, // h i
+        {0x02, 0x00, 0x06, 0x02, 0x02, 0x12, 0x0C}, {0x10, 0x10, 0x12, 0x14, 0x18, 0x14, 0x12}, // j k
+        {0x0C, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}, {0x00, 0x00, 0x1A, 0x15, 0x15, 0x11, 0x11}, // l m
+        {0x00, 0x00, 0x16, 0x19, 0x11, 0x11, 0x11}, {0x00, 0x00, 0x0E, 0x11, 0x11, 0x11, 0x0E}, // n o
+        {0x00, 0x00, 0x1E, 0x11, 0x1E, 0x10, 0x10}, {0x00, 0x00, 0x0D, 0x13, 0x0F, 0x01, 0x01}, // p q
+        {0x00, 0x00, 0x16, 0x19, 0x10, 0x10, 0x10}, {0x00, 0x00, 0x0E, 0x10, 0x0E, 0x01, 0x1E}, // r s
+        {0x08, 0x08, 0x1C, 0x08, 0x08, 0x09, 0x06}, {0x00, 0x00, 0x11, 0x11, 0x11, 0x13, 0x0D}, // t u
+        {0x00, 0x00, 0x11, 0x11, 0x11, 0x0A, 0x04}, {0x00, 0x00, 0x11, 0x11, 0x15, 0x15, 0x0A}, // v w
+        {0x00, 0x00, 0x11, 0x0A, 0x04, 0x0A, 0x11}, {0x00, 0x00, 0x11, 0x11, 0x0F, 0x01, 0x0E}, // x y
+        {0x00, 0x00, 0x1F, 0x02, 0x04, 0x08, 0x1F}, {0x02, 0x04, 0x04, 0x08, 0x04, 0x04, 0x02}, // z {
+        {0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, {0x08, 0x04, 0x04, 0x02, 0x04, 0x04, 0x08}, // | }
+        {0x00, 0x00, 0x08, 0x15, 0x02, 0x00, 0x00}, {0x0C, 0x12, 0x12, 0x0C, 0x00, 0x00, 0x00}, // ~ °
+};
+
+// Glyph indices of UTF-8 text, '?' for anything but ASCII and °
+void glyphs_of(const std::string& text, std::vector<int>& out) {
+    out.clear();
+    for (std::size_t i = 0; i < text.size(); i++) {
+        auto c = static_cast<unsigned char>(text[i]);
+        if (c >= GLYPH_FIRST && c < GLYPH_FIRST + GLYPH_DEGREE) {
+            out.push_back(c - GLYPH_FIRST);
+        } else if (c == 0xC2 && i + 1 < text.size() && static_cast<unsigned char>(text[i + 1]) == 0xB0) {
+            out.push_back(GLYPH_DEGREE);
+            i++;
+        } else if (c < 0x80 || c >= 0xC0) {
+            out.push_back('?' - GLYPH_FIRST);
+        }
+    }
+}
+
+inline float clamp01(float v) { return std::min(std::max(v, 0.0f), 1.0f); }
+
+// Fixed Huffman literal/length codes of RFC 1951, 3.2.6, bit reversed:
+// codes go out most significant bit first, everything else least
+// significant bit first
+struct HuffmanCode {
+    std::uint16_t reversed;
+    std::uint8_t length;
+};
+
+struct FixedCodes {
+    std::array<HuffmanCode, 288> codes{};
+    constexpr FixedCodes() {
+        for (int value = 0; value < 288; value++) {
+            std::uint32_t code = 0;
+            int length = 0;
+            if (value < 144) {
+                code = 0x30 + value;
+                length = 8;
+            } else if (value < 256) {
+                code = 0x190 + (value - 144);
+                length = 9;
+            } else if (value < 280) {
+                code = value - 256;
+                length = 7;
+            } else {
+                code = 0xc0 + (value - 280);
+                length = 8;
+            }
+            std::uint32_t reversed = 0;
+            for (int i = 0; i < length; i++) reversed |= ((code >> i) & 1u) << (length - 1 - i);
+            codes[value] = {static_cast<std::uint16_t>(reversed), static_cast<std::uint8_t>(length)};
+        }
+    }
+    constexpr const HuffmanCode& operator[](int value) const { return codes[value]; }
+};
+
+constexpr FixedCodes FIXED_CODES;
+
+class DeflateWriter {
+public:
+    explicit DeflateWriter(std::string& out) : m_out(out) {}
+
+    void bits(std::uint32_t value, int count) {
+        m_bits |= value << m_count;
+        m_count += count;
+        while (m_count >= 8) {
+            m_out += static_cast<char>(m_bits & 0xffu);
+            m_bits >>= 8;
+            m_count -= 8;
+        }
+    }
+    void code(std::uint32_t value, int length) {
+        std::uint32_t reversed = 0;
+        for (int i = 0; i < length; i++) reversed |= ((value >> i) & 1u) << (length - 1 - i);
+        bits(reversed, length);
+    }
+    void symbol(int value) {
+        const HuffmanCode& c = FIXED_CODES[value];
+        bits(c.reversed, c.length);
+    }
+    // Repeat of the previous byte, length 3..258
+    void run(int length) {
+        static constexpr int BASE[28] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23,
+                                         27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227};
+        static constexpr int EXTRA[28] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2,
+                                          2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5};
+        if (length == 258) {
+            symbol(285);
+        } else {
+            int i = static_cast<int>(std::upper_bound(BASE, BASE + 28, length) - BASE) - 1;
+            symbol(257 + i);
+            bits(static_cast<std::uint32_t>(length - BASE[i]), EXTRA[i]);
+        }
+        code(0, 5);     // Distance 1
+    }
+    void flush() {
+        if (m_count > 0) m_out += static_cast<char>(m_bits & 0xffu);
+        m_bits = 0;
+        m_count = 0;
+    }
+
+private:
+    std::string& m_out;
+    std::uint32_t m_bits = 0;
+    int m_count = 0;
+};
+
+// The filtered image data as literals and runs of the previous byte, with
+// its Adler-32. Unchanged pixels filter to zeros, which zeros() takes in
+// bulk.
+class RunEncoder {
+public:
+    explicit RunEncoder(DeflateWriter& deflate) : m_deflate(deflate) {}
+
+    void byte(std::uint8_t value) {
+        m_a += value;
+        m_b += m_a;
+        // Reduced every 5552 bytes like adler32(), b stays below 2^32
+        if (++m_unreduced == 5552) reduce();
+        if (value == m_last) {
+            m_pending++;
+            return;
+        }
+        flush();
+        m_deflate.symbol(value);
+        m_last = value;
+    }
+    void zeros(std::size_t count) {
+        if (count == 0) return;
+        if (m_last != 0) {
+            byte(0);
+            count--;
+        }
+        // Adding zeros leaves a and adds count * a to b
+        reduce();
+        m_b = static_cast<std::uint32_t>((m_b + static_cast<std::uint64_t>(m_a) * count) % ADLER_BASE);
+        m_pending += count;
+    }
+    // Bytes row[i] - reference[i] of [from, to); 8 at a time where they
+    // are all zero
+    void filtered(const std::uint8_t* row, const std::uint8_t* reference, std::size_t from, std::size_t to) {
+        std::size_t i = from;
+        for (; i + 8 <= to; i += 8) {
+            if (std::memcmp(row + i, reference + i, 8) == 0) {
+                zeros(8);
+                continue;
+            }
+            for (std::size_t j = i; j < i + 8; j++) byte(static_cast<std::uint8_t>(row[j] - reference[j]));
+        }
+        for (; i < to; i++) byte(static_cast<std::uint8_t>(row[i] - reference[i]));
+    }
+    void flush() {
+        while (m_pending >= 3) {
+            std::size_t length = std::min<std::size_t>(m_pending, 258);
+            m_deflate.run(static_cast<int>(length));
+            m_pending -= length;
+        }
+        for (; m_pending > 0; m_pending--) m_deflate.symbol(m_last);
+    }
+    std::uint32_t adler() {
+        reduce();
+        return (m_b << 16) | m_a;
+    }
+
+private:
+    void reduce() {
+        m_a %= ADLER_BASE;
+        m_b %= ADLER_BASE;
+        m_unreduced = 0;
+    }
+
+    static constexpr std::uint32_t ADLER_BASE = 65521;
+
+    DeflateWriter& m_deflate;
+    int m_last = -1;            // Previous byte, -1 at the start
+    std::size_t m_pending = 0;  // Repeats of m_last not yet written
+    std::uint32_t m_a = 1;
+    std::uint32_t m_b = 0;
+    std::size_t m_unreduced = 0;
+};
+
+// 8 byte words that differ between row and reference in [from, to), the
+// cost of a filter
+std::size_t changed_words(const std::uint8_t* row, const std::uint8_t* reference, std::size_t from, std::size_t to) {
+    std::size_t changed = 0;
+    for (std::size_t i = from; i + 8 <= to; i += 8) changed += std::memcmp(row + i, reference + i, 8) != 0;
+    return changed;
+}
+
+void put_u32_be(std::string& out, std::uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) out += static_cast<char>((value >> shift) & 0xffu);
+}
+
+void put_chunk(std::string& out, const char* type, const std::string& data) {
+    put_u32_be(out, static_cast<std::uint32_t>(data.size()));
+    std::string body = std::string(type, 4) + data;
+    out += body;
+    put_u32_be(out, crc32(body.data(), body.size()));
+}
+}
+
+std::uint32_t adler32(const void* data, std::size_t size, std::uint32_t adler) {
+    const auto* bytes = static_cast<const std::uint8_t*>(data);
+    std::uint32_t a = adler & 0xffffu;
+    std::uint32_t b = adler >> 16;
+    while (size > 0) {
+        // 5552 bytes keep b below 2^32 between the reductions
+        std::size_t block = std::min<std::size_t>(size, 5552);
+        size -= block;
+        for (std::size_t i = 0; i < block; i++) {
+            a += *bytes++;
+            b += a;
+        }
+        a %= 65521u;
+        b %= 65521u;
+    }
+    return (b << 16) | a;
+}
+
+void ChartRasterizer::composite(ChartColor color, float opacity) {
+    const int width = m_image->width;
+    const float src[3] = {static_cast<float>(color.r), static_cast<float>(color.g), static_cast<float>(color.b)};
+    for (const Span& span : m_spans) {
+        float* coverage = m_coverage.data() + static_cast<std::size_t>(span.y) * width;
+        std::uint8_t* pixel = m_image->rgb.data() + static_cast<std::size_t>(span.y) * width * 3;
+        for (int x = span.x0; x <= span.x1; x++) {
+            float a = coverage[x] * opacity;
+            if (a <= 0.0f) continue;
+            coverage[x] = 0.0f;
+            for (int c = 0; c < 3; c++) {
+                float dst = pixel[x * 3 + c];
+                pixel[x * 3 + c] = static_cast<std::uint8_t>(dst + (src[c] - dst) * a + 0.5f);
+            }
+        }
+    }
+    m_spans.clear();
+}
+
+void ChartRasterizer::stroke_segment(float ax, float ay, float bx, float by, float half_width) {
+    const float reach = half_width + 1.0f;
+    int y0 = std::max(0, static_cast<int>(std::floor(std::min(ay, by) - reach)));
+    int y1 = std::min(m_image->height - 1, static_cast<int>(std::ceil(std::max(ay, by) + reach)));
+    int x0 = std::max(0, static_cast<int>(std::floor(std::min(ax, bx) - reach)));
+    int x1 = std::min(m_image->width - 1, static_cast<int>(std::ceil(std::max(ax, bx) + reach)));
+    if (x0 > x1 || y0 > y1) return;
+
+    const float dx = bx - ax;
+    const float dy = by - ay;
+    const float length2 = dx * dx + dy * dy;
+    const float length = std::sqrt(length2);
+    for (int y = y0; y <= y1; y++) {
+        const float py = y + 0.5f;
+        // Pixels of this row within reach of the line, on steep segments
+        // far fewer than the bounding box
+        int from = x0;
+        int to = x1;
+        if (std::fabs(dy) > 1e-3f) {
+            float along = ax + (py - ay) * dx / dy;
+            float span = reach * length / std::fabs(dy) + 1.0f;
+            from = std::max(x0, static_cast<int>(std::floor(along - span)));
+            to = std::min(x1, static_cast<int>(std::ceil(along + span)));
+        }
+        if (from > to) continue;
+        touch(y, from, to);
+        float* coverage = m_coverage.data() + static_cast<std::size_t>(y) * m_image->width;
+        for (int x = from; x <= to; x++) {
+            const float px = x + 0.5f - ax;
+            const float qy = py - ay;
+            float t = length2 > 0.0f ? clamp01((px * dx + qy * dy) / length2) : 0.0f;
+            float ex = px - t * dx;
+            float ey = qy - t * dy;
+            float c = clamp01(half_width + 0.5f - std::sqrt(ex * ex + ey * ey));
+            if (c > coverage[x]) coverage[x] = c;
+        }
+    }
+}
+
+void ChartRasterizer::stroke_path(const ChartPath& path) {
+    std::size_t points = path.xy.size() / 2;
+    if (points < 2) return;
+    // Strokes thinner than a pixel are drawn one pixel wide and fainter
+    float width = std::max(path.stroke.width, 1.0f);
+    float opacity = path.stroke.opacity * std::min(path.stroke.width, 1.0f);
+    float half_width = 0.5f * width;
+    float dash = CHART_DASH_WIDTHS * width;
+    float phase = 0.0f;     // Arc length within the current dash period
+
+    std::size_t segments = path.closed ? points : points - 1;
+    for (std::size_t i = 0; i < segments; i++) {
+        std::size_t j = (i + 1) % points;
+        float ax = path.xy[2 * i], ay = path.xy[2 * i + 1];
+        float bx = path.xy[2 * j], by = path.xy[2 * j + 1];
+        if (!path.stroke.dashed) {
+            stroke_segment(ax, ay, bx, by, half_width);
+            continue;
+        }
+        // Split the segment at the dash boundaries, draw the dashes
+        float length = std::hypot(bx - ax, by - ay);
+        float at = 0.0f;
+        while (at < length) {
+            bool on = phase < dash;
+            float step = std::min(length - at, (on ? dash : 2.0f * dash) - phase);
+            if (on && length > 0.0f) {
+                float t0 = at / length;
+                float t1 = (at + step) / length;
+                stroke_segment(ax + (bx - ax) * t0, ay + (by - ay) * t0, ax + (bx - ax) * t1, ay + (by - ay) * t1,
+                               half_width);
+            }
+            at += step;
+            phase += step;
+            if (phase >= 2.0f * dash) phase -= 2.0f * dash;
+        }
+    }
+    composite(path.stroke.color, opacity);
+}
+
+void ChartRasterizer::stroke_circle(const ChartCircle& circle, float half_width) {
+    const float outer = circle.r + half_width + 1.0f;
+    const float inner = std::max(0.0f, circle.r - half_width - 1.0f);
+    int y0 = std::max(0, static_cast<int>(std::floor(circle.cy - outer)));
+    int y1 = std::min(m_image->height - 1, static_cast<int>(std::ceil(circle.cy + outer)));
+    for (int y = y0; y <= y1; y++) {
+        const float dy = y + 0.5f - circle.cy;
+        if (std::fabs(dy) > outer) continue;
+        // The ring covers |dx| in [inside, outside] of this row
+        float outside = std::sqrt(outer * outer - dy * dy);
+        float inside = std::fabs(dy) < inner ? std::sqrt(inner * inner - dy * dy) : 0.0f;
+        float* coverage = m_coverage.data() + static_cast<std::size_t>(y) * m_image->width;
+        for (float sign : {-1.0f, 1.0f}) {
+            float a = circle.cx + sign * inside;
+            float b = circle.cx + sign * outside;
+            int from = std::max(0, static_cast<int>(std::floor(std::min(a, b))) - 1);
+            int to = std::min(m_image->width - 1, static_cast<int>(std::ceil(std::max(a, b))));
+            if (from > to) continue;
+            touch(y, from, to);
+            for (int x = from; x <= to; x++) {
+                float d = std::fabs(std::hypot(x + 0.5f - circle.cx, dy) - circle.r);
+                float c = clamp01(half_width + 0.5f - d);
+                if (c > coverage[x]) coverage[x] = c;
+            }
+        }
+    }
+}
+
+void ChartRasterizer::fill_dot(const ChartDot& dot) {
+    const float reach = dot.r + 1.0f;
+    int x0 = std::max(0, static_cast<int>(std::floor(dot.x - reach)));
+    int x1 = std::min(m_image->width - 1, static_cast<int>(std::ceil(dot.x + reach)));
+    int y0 = std::max(0, static_cast<int>(std::floor(dot.y - reach)));
+    int y1 = std::min(m_image->height - 1, static_cast<int>(std::ceil(dot.y + reach)));
+    if (x0 > x1 || y0 > y1) return;
+    for (int y = y0; y <= y1; y++) {
+        touch(y, x0, x1);
+        float* coverage = m_coverage.data() + static_cast<std::size_t>(y) * m_image->width;
+        for (int x = x0; x <= x1; x++) {
+            float c = clamp01(dot.r + 0.5f - std::hypot(x + 0.5f - dot.x, y + 0.5f - dot.y));
+            if (c > coverage[x]) coverage[x] = c;
+        }
+    }
+    composite(dot.color, 1.0f);
+}
+
+void ChartRasterizer::draw_text(const ChartText& text) {
+    std::vector<int> glyphs;
+    glyphs_of(text.text, glyphs);
+    if (glyphs.empty()) return;
+    // Capitals are 7 font pixels high, about 0.8 of the font size
+    const int scale = std::max(1, static_cast<int>(std::lround(text.size / 8.0f)));
+    const int advance = 6 * scale;
+    const int width = static_cast<int>(glyphs.size()) * advance - scale;
+    int left = static_cast<int>(std::lround(text.x));
+    if (text.anchor == ChartAnchor::Middle) left -= width / 2;
+    if (text.anchor == ChartAnchor::End) left -= width;
+    const int top = static_cast<int>(std::lround(text.y - 3.5f * scale));
+    const int bold = text.bold ? std::max(1, scale / 2) : 0;
+
+    for (std::size_t g = 0; g < glyphs.size(); g++) {
+        const std::uint8_t* rows = FONT[glyphs[g]];
+        for (int row = 0; row < 7; row++) {
+            for (int column = 0; column < 5; column++) {
+                if (!(rows[row] & (0x10 >> column))) continue;
+                int x0 = left + static_cast<int>(g) * advance + column * scale;
+                int y0 = top + row * scale;
+                int xs = std::max(0, x0);
+                int xe = std::min(m_image->width - 1, x0 + scale - 1 + bold);
+                int ys = std::max(0, y0);
+                int ye = std::min(m_image->height - 1, y0 + scale - 1);
+                if (xs > xe || ys > ye) continue;
+                for (int y = ys; y <= ye; y++) {
+                    touch(y, xs, xe);
+                    float* coverage = m_coverage.data() + static_cast<std::size_t>(y) * m_image->width;
+                    std::fill(coverage + xs, coverage + xe + 1, 1.0f);
+                }
+            }
+        }
+    }
+    composite(text.color, 1.0f);
+}
+
+void ChartRasterizer::render(const ChartScene& scene, RgbImage& out) {
+    out.width = std::max(scene.width, 0);
+    out.height = std::max(scene.height, 0);
+    const std::size_t stride = static_cast<std::size_t>(out.width) * 3;
+    out.rgb.resize(stride * out.height);
+    if (out.rgb.empty()) return;
+    // The background row once, then copies of it
+    for (std::size_t i = 0; i < stride; i += 3) {
+        out.rgb[i] = scene.background.r;
+        out.rgb[i + 1] = scene.background.g;
+        out.rgb[i + 2] = scene.background.b;
+    }
+    for (int y = 1; y < out.height; y++) std::memcpy(out.rgb.data() + y * stride, out.rgb.data(), stride);
+    m_image = &out;
+    // composite() leaves the coverage at zero; only a new size clears it
+    std::size_t pixels = static_cast<std::size_t>(out.width) * out.height;
+    if (m_coverage.size() != pixels) m_coverage.assign(pixels, 0.0f);
+    m_spans.clear();
+
+    for (const ChartCircle& circle : scene.circles) {
+        stroke_circle(circle, 0.5f * std::max(circle.stroke.width, 1.0f));
+        composite(circle.stroke.color, circle.stroke.opacity * std::min(circle.stroke.width, 1.0f));
+    }
+    for (const ChartPath& path : scene.paths) stroke_path(path);
+    for (const ChartDot& dot : scene.dots) fill_dot(dot);
+    for (const ChartText& text : scene.texts) draw_text(text);
+    m_image = nullptr;
+}
+
+std::string encode_png(const RgbImage& image) {
+    const std::size_t stride = static_cast<std::size_t>(image.width) * 3;
+    // zlib stream: header, one final fixed-Huffman block, Adler-32
+    std::string data;
+    data.reserve(stride * image.height / 8 + 64);
+    data += static_cast<char>(0x78);
+    data += static_cast<char>(0x01);
+    DeflateWriter deflate(data);
+    deflate.bits(1, 1);     // BFINAL
+    deflate.bits(1, 2);     // BTYPE fixed Huffman
+    RunEncoder encoder(deflate);
+
+    // Each row takes Sub (1, against the pixel to the left) or Up (2,
+    // against the pixel above), whichever changes fewer words. Background
+    // and long strokes filter to zeros, which are never looked at byte by
+    // byte.
+    static const std::uint8_t NONE[3] = {0, 0, 0};
+    const std::size_t first = std::min<std::size_t>(3, stride);     // Bytes without a left pixel
+    for (int y = 0; y < image.height; y++) {
+        const std::uint8_t* row = image.rgb.data() + y * stride;
+        const std::uint8_t* above = y > 0 ? row - stride : nullptr;
+        // Sub compares row + 3 with row
+        std::size_t sub_cost = changed_words(row + first, row, 0, stride - first);
+        if (above && changed_words(row, above, 0, stride) <= sub_cost) {
+            encoder.byte(2);
+            encoder.filtered(row, above, 0, stride);
+        } else {
+            encoder.byte(1);
+            encoder.filtered(row, NONE, 0, first);
+            encoder.filtered(row + first, row, 0, stride - first);
+        }
+    }
+    encoder.flush();
+    deflate.symbol(256);
+    deflate.flush();
+    put_u32_be(data, encoder.adler());
+
+    std::string png("\x89PNG\r\n\x1a\n", 8);
+    std::string header;
+    put_u32_be(header, static_cast<std::uint32_t>(image.width));
+    put_u32_be(header, static_cast<std::uint32_t>(image.height));
+    header += static_cast<char>(8);     // Bit depth
+    header += static_cast<char>(2);     // RGB
+    header += std::string(3, '\0');     // Deflate, adaptive filters, no interlace
+    put_chunk(png, "IHDR", header);
+    put_chunk(png, "IDAT", data);
+    put_chunk(png, "IEND", std::string());
+    return png;
+}
@@ -0,0 +1,60 @@
+// ChartRaster.h
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FieldChart.h"
+
+// 8 bit RGB, rows top to bottom.
+struct RgbImage {
+    int width = 0;
+    int height = 0;
+    std::vector<std::uint8_t> rgb;
+
+    const std::uint8_t* pixel(int x, int y) const { return rgb.data() + (static_cast<std::size_t>(y) * width + x) * 3; }
+};
+
+// Software rasterizer for ChartScene. Strokes and dots are anti-aliased by
+// the distance of each pixel centre to the primitive; a polyline is
+// composited once, with the largest coverage of its segments per pixel,
+// so its joins and translucent strokes show no seams. Text uses a built-in
+// 5x7 bitmap font scaled to the font size (ASCII and °).
+//
+// The coverage buffer is kept between charts: one rasterizer per thread.
+class ChartRasterizer {
+public:
+    void render(const ChartScene& scene, RgbImage& out);
+
+private:
+    // Pixels x0..x1 of row y with coverage, possibly overlapping
+    struct Span {
+        int y, x0, x1;
+    };
+
+    void stroke_segment(float ax, float ay, float bx, float by, float half_width);
+    void stroke_path(const ChartPath& path);
+    void stroke_circle(const ChartCircle& circle, float half_width);
+    void fill_dot(const ChartDot& dot);
+    void draw_text(const ChartText& text);
+    void touch(int y, int x0, int x1) { m_spans.push_back({y, x0, x1}); }
+    // Blends color over the spans by coverage * opacity and clears the
+    // coverage, so a primitive costs its own pixels, not its bounding box.
+    void composite(ChartColor color, float opacity);
+
+    RgbImage* m_image = nullptr;
+    std::vector<float> m_coverage;
+    std::vector<Span> m_spans;
+};
+
+// PNG file of an image: RGB, each row filtered against its left or upper
+// neighbours, one fixed-Huffman deflate block whose matches are byte runs
+// (distance 1).
+// No zlib; the unchanged background compresses to almost nothing, which
+// is most of a chart.
+std::string encode_png(const RgbImage& image);
+
+// zlib's Adler-32 of the PNG data stream, continued from adler for data
+// that comes in pieces.
+std::uint32_t adler32(const void* data, std::size_t size, std::uint32_t adler = 1);
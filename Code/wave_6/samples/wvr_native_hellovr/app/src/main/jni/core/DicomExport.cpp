@@ -0,0 +1,330 @@
+// DicomExport.cpp
+#include "DicomExport.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <random>
+
+namespace {
+constexpr std::uint32_t UNDEFINED_LENGTH = 0xFFFFFFFFu;
+constexpr std::size_t MAX_TEXT = 64;            // Longest text value, LO, PN, UI
+constexpr std::size_t FIXED_BYTES = 2048;       // Preamble, meta and dataset without points
+constexpr std::size_t ITEM_BYTES = 160;         // One test point item
+
+// Maximum value length of a text VR (PS3.5 6.2), 0 for the unbounded ones.
+// PN counts as a whole, not per component group.
+std::size_t max_text_length(const char* vr) {
+    static const struct {
+        const char* vr;
+        std::size_t length;
+    } LIMITS[] = {{"CS", 16}, {"DA", 8}, {"IS", 12}, {"LO", 64}, {"PN", 64}, {"SH", 16}, {"TM", 14}, {"UI", 64}};
+    for (const auto& limit : LIMITS) {
+        if (std::strcmp(vr, limit.vr) == 0) return limit.length;
+    }
+    return 0;
+}
+
+// Element writer; every call appends, ok() is false once something did not
+// fit or a value was too long for its VR (error() tells which)
+class ElementWriter {
+public:
+    explicit ElementWriter(FormatBuffer& out) : m_out(out) {}
+
+    bool ok() const { return m_ok; }
+    const std::string& error() const { return m_error; }
+
+    void text(std::uint16_t group, std::uint16_t element, const char* vr, const char* value, std::size_t length) {
+        std::size_t max_length = max_text_length(vr);
+        if (max_length != 0 && length > max_length) {
+            // Not cut: a truncated UID or patient id names something else
+            if (m_error.empty()) {
+                char message[96];
+                std::snprintf(message, sizeof(message), "(%04X,%04X) %s value has %zu characters, at most %zu",
+                              group, element, vr, length, max_length);
+                m_error = message;
+            }
+            m_ok = false;
+            return;
+        }
+        std::size_t padded = length + (length & 1);
+        header(group, element, vr, static_cast<std::uint32_t>(padded));
+        put(m_out.put(value, length));
+        // UIDs are padded with NUL, everything else with a space
+        if (padded != length) put(m_out.put(std::strcmp(vr, "UI") == 0 ? '\0' : ' '));
+    }
+    void text(std::uint16_t group, std::uint16_t element, const char* vr, const char* value) {
+        text(group, element, vr, value, std::strlen(value));
+    }
+    void text(std::uint16_t group, std::uint16_t element, const char* vr, const std::string& value) {
+        text(group, element, vr, value.data(), value.size());
+    }
+
+    template <typename T>
+    void binary(std::uint16_t group, std::uint16_t element, const char* vr, T value) {
+        header(group, element, vr, sizeof(T));
+        put(m_out.put_binary(value));
+    }
+
+    void begin_sequence(std::uint16_t group, std::uint16_t element) {
+        header(group, element, "SQ", UNDEFINED_LENGTH);
+    }
+    void end_sequence() { delimiter(0xE0DD, 0); }
+    void begin_item() { delimiter(0xE000, UNDEFINED_LENGTH); }
+    void end_item() { delimiter(0xE00D, 0); }
+
+private:
+    static bool long_form(const char* vr) {
+        static const char* const LONG_VRS[] = {"OB", "OD", "OF", "OL", "OW", "SQ", "UC", "UN", "UR", "UT"};
+        for (const char* long_vr : LONG_VRS) {
+            if (std::strcmp(vr, long_vr) == 0) return true;
+        }
+        return false;
+    }
+
+    void header(std::uint16_t group, std::uint16_t element, const char* vr, std::uint32_t length) {
+        put(m_out.put_binary(group) && m_out.put_binary(element) && m_out.put(vr, 2));
+        if (long_form(vr)) {
+            put(m_out.put_binary(std::uint16_t{0}) && m_out.put_binary(length));
+        } else {
+            put(m_out.put_binary(static_cast<std::uint16_t>(length)));
+        }
+    }
+
+    // Item tags carry no VR
+    void delimiter(std::uint16_t element, std::uint32_t length) {
+        put(m_out.put_binary(std::uint16_t{0xFFFE}) && m_out.put_binary(element) && m_out.put_binary(length));
+    }
+
+    void put(bool ok) { m_ok = m_ok && ok; }
+
+    FormatBuffer& m_out;
+    bool m_ok = true;
+    std::string m_error;
+};
+
+// Sheet columns of one eye, rows in export order
+struct EyeSheet {
+    ColumnView<std::uint8_t> eyes;
+    ColumnView<std::int16_t> longitudes;
+    ColumnView<std::uint8_t> sizes;
+    ColumnView<std::uint8_t> luminances;
+    ColumnView<float> normalized;
+    ColumnView<std::uint8_t> point_counts;
+    ColumnView<float> phis;
+    ColumnView<float> thetas;
+    std::size_t rows = 0;
+    std::size_t points = 0;
+
+    explicit EyeSheet(const SessionFileView& file)
+            : eyes(file.column<std::uint8_t>(SessionColumn::SheetEye)),
+              longitudes(file.column<std::int16_t>(SessionColumn::SheetLongitude)),
+              sizes(file.column<std::uint8_t>(SessionColumn::SheetSize)),
+              luminances(file.column<std::uint8_t>(SessionColumn::SheetLuminance)),
+              normalized(file.column<float>(SessionColumn::SheetNormalizedAngle)),
+              point_counts(file.column<std::uint8_t>(SessionColumn::SheetPointCount)),
+              phis(file.column<float>(SessionColumn::SheetPointPhi)),
+              thetas(file.column<float>(SessionColumn::SheetPointTheta)) {
+        rows = std::min({eyes.size(), longitudes.size(), sizes.size(), luminances.size(), normalized.size(),
+                         point_counts.size()});
+        points = std::min(phis.size(), thetas.size());
+    }
+
+    bool valid(std::size_t row) const {
+        return sizes[row] < GOLDMANN_SIZE_COUNT && luminances[row] < GOLDMANN_STIMULUS_COUNT;
+    }
+
+    // f(row, first point, point count) for the valid rows of eye
+    template <typename F>
+    void for_each_row(int eye, F&& f) const {
+        std::size_t point = 0;
+        for (std::size_t row = 0; row < rows; row++) {
+            std::size_t first = point;
+            point += point_counts[row];
+            if (eyes[row] != eye || !valid(row)) continue;
+            std::size_t count = first < points ? std::min<std::size_t>(point_counts[row], points - first) : 0;
+            f(row, first, count);
+        }
+    }
+};
+
+// DA and TM of the session start, in UTC (the timezone offset says so)
+void format_date_time(std::int64_t unix_ms, char (&date)[9], char (&time)[7]) {
+    std::time_t seconds = static_cast<std::time_t>(unix_ms / 1000);
+    std::tm utc{};
+    gmtime_r(&seconds, &utc);
+    std::strftime(date, sizeof(date), "%Y%m%d", &utc);
+    std::strftime(time, sizeof(time), "%H%M%S", &utc);
+}
+
+void write_point(ElementWriter& w, const EyeSheet& sheet, std::size_t row, const float* phi, const float* theta) {
+    MeteoroidSizeID size = static_cast<MeteoroidSizeID>(sheet.sizes[row]);
+    StimulusCode stimulus{sheet.luminances[row]};
+
+    w.begin_item();
+    if (phi) {
+        w.binary(0x0024, 0x0090, "FL", *phi);
+        w.binary(0x0024, 0x0091, "FL", *theta);
+    }
+    w.text(0x0024, 0x0093, "CS", phi ? "SEEN" : "NOT SEEN");
+    w.text(0x0041, 0x0010, "LO", dicom::PRIVATE_CREATOR);
+    w.binary(0x0041, 0x1010, "SS", sheet.longitudes[row]);
+    w.text(0x0041, 0x1011, "CS", size_info(size).name + 5); // Without "Size_"
+    w.text(0x0041, 0x1012, "CS", stimulus_info(stimulus).name, 2);
+    w.binary(0x0041, 0x1013, "FL", sheet.normalized[row]);
+    if (phi) w.binary(0x0041, 0x1014, "FL", std::hypot(*phi, *theta));
+    w.end_item();
+}
+}
+
+std::string make_dicom_uid(std::uint64_t high, std::uint64_t low) {
+    unsigned __int128 value = (static_cast<unsigned __int128>(high) << 64) | low;
+    char digits[40];
+    std::size_t count = 0;
+    do {
+        digits[count++] = static_cast<char>('0' + static_cast<int>(value % 10));
+        value /= 10;
+    } while (value != 0);
+    std::string uid = "2.25.";
+    while (count > 0) uid += digits[--count];
+    return uid;
+}
+
+std::string generate_dicom_uid() {
+    std::random_device device;
+    auto next = [&device]() { return (static_cast<std::uint64_t>(device()) << 32) | device(); };
+    std::uint64_t high = next();
+    std::uint64_t low = next();
+    // Version 4 UUID bits
+    high = (high & ~0xF000ull) | 0x4000ull;
+    low = (low & 0x3FFFFFFFFFFFFFFFull) | 0x8000000000000000ull;
+    return make_dicom_uid(high, low);
+}
+
+DicomStudyInfo default_dicom_study_info(const SessionFileHeader& header) {
+    DicomStudyInfo info;
+    info.patient_id = "PERIMETRY-" + std::to_string(header.patient_index);
+    info.study_uid = generate_dicom_uid();
+    info.series_uid = generate_dicom_uid();
+    return info;
+}
+
+std::size_t dicom_capacity(const SessionFileView& file, int eye) {
+    EyeSheet sheet(file);
+    std::size_t items = 0;
+    sheet.for_each_row(eye, [&items](std::size_t, std::size_t, std::size_t count) {
+        items += std::max<std::size_t>(count, 1);
+    });
+    // Text elements are at most MAX_TEXT long, so the metadata fits into FIXED_BYTES
+    return FIXED_BYTES + items * ITEM_BYTES;
+}
+
+bool write_session_dicom(const SessionFileView& file, int eye, const DicomStudyInfo& info, FormatBuffer& out,
+                         std::string* error) {
+    if (!file.is_open() || (eye != 1 && eye != 2)) {
+        if (error) *error = "no session or eye";
+        return false;
+    }
+    EyeSheet sheet(file);
+    std::size_t rows = 0;
+    sheet.for_each_row(eye, [&rows](std::size_t, std::size_t, std::size_t) { rows++; });
+    if (rows == 0) {
+        if (error) *error = "no final sheet of eye " + std::to_string(eye);
+        return false;
+    }
+
+    const SessionFileHeader& header = file.header();
+    std::string instance_uid = info.series_uid + "." + std::to_string(eye);
+    char date[9];
+    char time[7];
+    format_date_time(header.created_unix_ms, date, time);
+
+    // Responses and duration of this eye
+    std::uint32_t responses = 0;
+    for (std::uint8_t response_eye : file.column<std::uint8_t>(SessionColumn::ResponseEye)) {
+        responses += response_eye == eye ? 1 : 0;
+    }
+    auto stimulus_times = file.column<std::int64_t>(SessionColumn::StimulusTime);
+    auto stimulus_eyes = file.column<std::uint8_t>(SessionColumn::StimulusEye);
+    std::int64_t first_ns = -1;
+    std::int64_t last_ns = -1;
+    for (std::size_t i = 0; i < std::min(stimulus_times.size(), stimulus_eyes.size()); i++) {
+        if (stimulus_eyes[i] != eye) continue;
+        if (first_ns < 0) first_ns = stimulus_times[i];
+        last_ns = stimulus_times[i];
+    }
+    float duration_s = first_ns < 0 ? 0.0f : static_cast<float>(last_ns - first_ns) * 1e-9f;
+
+    std::size_t start = out.mark();
+    ElementWriter w(out);
+
+    char preamble[dicom::PREAMBLE_BYTES] = {};
+    bool ok = out.put(preamble, sizeof(preamble)) && out.put("DICM", 4);
+
+    // File meta information, group length filled in at the end of the group
+    w.binary(0x0002, 0x0000, "UL", std::uint32_t{0});
+    std::size_t meta_start = out.mark();
+    const char version[2] = {0, 1};
+    w.text(0x0002, 0x0001, "OB", version, sizeof(version));
+    w.text(0x0002, 0x0002, "UI", dicom::OPV_SOP_CLASS);
+    w.text(0x0002, 0x0003, "UI", instance_uid);
+    w.text(0x0002, 0x0010, "UI", dicom::EXPLICIT_VR_LITTLE_ENDIAN);
+    w.text(0x0002, 0x0012, "UI", dicom::IMPLEMENTATION_CLASS_UID);
+    w.text(0x0002, 0x0013, "SH", dicom::IMPLEMENTATION_VERSION);
+    std::uint32_t meta_length = static_cast<std::uint32_t>(out.mark() - meta_start);
+    out.overwrite(meta_start - sizeof(meta_length), &meta_length, sizeof(meta_length));
+
+    // Dataset, ascending tags
+    w.text(0x0008, 0x0005, "CS", "ISO_IR 192");
+    w.text(0x0008, 0x0016, "UI", dicom::OPV_SOP_CLASS);
+    w.text(0x0008, 0x0018, "UI", instance_uid);
+    w.text(0x0008, 0x0020, "DA", date);
+    w.text(0x0008, 0x0023, "DA", date);
+    w.text(0x0008, 0x0030, "TM", time);
+    w.text(0x0008, 0x0033, "TM", time);
+    w.text(0x0008, 0x0050, "SH", "");
+    w.text(0x0008, 0x0060, "CS", "OPV");
+    w.text(0x0008, 0x0070, "LO", "");
+    w.text(0x0008, 0x0080, "LO", info.institution);
+    w.text(0x0008, 0x0090, "PN", "");
+    w.text(0x0008, 0x0201, "SH", "+0000");
+    w.text(0x0008, 0x103E, "LO", "Kinetic perimetry (Goldmann)");
+    w.text(0x0010, 0x0010, "PN", info.patient_name);
+    w.text(0x0010, 0x0020, "LO", info.patient_id);
+    w.text(0x0010, 0x0030, "DA", info.patient_birth_date);
+    w.text(0x0010, 0x0040, "CS", info.patient_sex);
+    w.text(0x0018, 0x1020, "LO", dicom::IMPLEMENTATION_VERSION);
+    w.text(0x0020, 0x000D, "UI", info.study_uid);
+    w.text(0x0020, 0x000E, "UI", info.series_uid);
+    w.text(0x0020, 0x0010, "SH", std::to_string(header.patient_index));
+    w.text(0x0020, 0x0011, "IS", "1");
+    w.text(0x0020, 0x0013, "IS", eye == 1 ? "1" : "2");
+    w.text(0x0020, 0x0060, "CS", eye == 1 ? "R" : "L");
+
+    w.begin_sequence(0x0024, 0x0089);
+    sheet.for_each_row(eye, [&w, &sheet](std::size_t row, std::size_t first, std::size_t count) {
+        if (count == 0) write_point(w, sheet, row, nullptr, nullptr);
+        for (std::size_t i = first; i < first + count; i++) {
+            write_point(w, sheet, row, &sheet.phis[i], &sheet.thetas[i]);
+        }
+    });
+    w.end_sequence();
+
+    w.text(0x0041, 0x0010, "LO", dicom::PRIVATE_CREATOR);
+    w.binary(0x0041, 0x1001, "UL", responses);
+    w.binary(0x0041, 0x1002, "FL", duration_s);
+
+    if (ok && w.ok()) return true;
+    if (error) *error = w.error().empty() ? "output buffer too small" : w.error();
+    out.rollback(start);
+    return false;
+}
+
+std::string format_session_dicom(const SessionFileView& file, int eye, const DicomStudyInfo& info,
+                                 std::string* error) {
+    FormatBuffer out(dicom_capacity(file, eye));
+    if (!write_session_dicom(file, eye, info, out, error)) return std::string();
+    return out.str();
+}
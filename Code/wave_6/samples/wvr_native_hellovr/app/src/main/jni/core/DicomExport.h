@@ -0,0 +1,72 @@
+// DicomExport.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "RecordSchema.h"
+#include "SessionFile.h"
+
+// DICOM Part 10 file of one eye of a session, explicit VR little endian,
+// written in a single pass from the session file columns into a
+// preallocated FormatBuffer.
+//
+// SOP class is Ophthalmic Visual Field Static Perimetry Measurements
+// (modality OPV), the closest standard IOD; there is none for kinetic
+// perimetry. Every isopter point of the final sheet is one item of the
+// Visual Field Test Point Sequence (0024,0089), in sheet order, so the
+// items of one meridian are adjacent:
+//
+//   (0024,0090/0091)  FL  X/Y in degrees, the (PHI|THETA) of the sheet point
+//   (0024,0093)       CS  SEEN, NOT SEEN for planned entries without a point
+//   (0041,xx10)       SS  meridian (longitude of the vector, deg)
+//   (0041,xx11)       CS  Goldmann size (I .. V)
+//   (0041,xx12)       CS  stimulus (1a .. 4e)
+//   (0041,xx13)       FL  normed value of the entry
+//   (0041,xx14)       FL  eccentricity (deg), length of (PHI|THETA)
+//
+// The private block is reserved by PRIVATE_CREATOR in the dataset and in
+// every item. Sequences and items have undefined length, only the group
+// length of the file meta information is filled in afterwards.
+namespace dicom {
+constexpr const char* OPV_SOP_CLASS = "1.2.840.10008.5.1.4.1.1.80.1";
+constexpr const char* EXPLICIT_VR_LITTLE_ENDIAN = "1.2.840.10008.1.2.1";
+constexpr const char* IMPLEMENTATION_CLASS_UID = "2.25.43736765372139368390365052174213024560";
+constexpr const char* IMPLEMENTATION_VERSION = "GOLDMANN_VR_1";
+constexpr const char* PRIVATE_CREATOR = "GOLDMANN KINETIC 1";
+constexpr std::size_t PREAMBLE_BYTES = 128;
+}
+
+// Patient and study metadata; the session file itself only knows the
+// patient index. Empty strings are written as empty (type 2) elements;
+// values longer than their VR allows (64 characters for LO, PN and UI)
+// fail the export instead of being cut.
+struct DicomStudyInfo {
+    std::string patient_name;           // PN, "Family^Given"
+    std::string patient_id;
+    std::string patient_birth_date;     // YYYYMMDD
+    std::string patient_sex;            // M, F or O
+    std::string study_uid;
+    std::string series_uid;             // Instances are series_uid.<eye>
+    std::string institution;
+};
+
+// "2.25." followed by the 128 bit value in decimal (UUID derived UID)
+std::string make_dicom_uid(std::uint64_t high, std::uint64_t low);
+std::string generate_dicom_uid();
+
+// Patient id PERIMETRY-<patient index>, new study and series UIDs.
+DicomStudyInfo default_dicom_study_info(const SessionFileHeader& header);
+
+// Upper bound of the file size of one eye, for sizing a FormatBuffer.
+std::size_t dicom_capacity(const SessionFileView& file, int eye);
+
+// False if the session has no final sheet for eye, a value of info is too
+// long, or out is too small; out is left unchanged then.
+bool write_session_dicom(const SessionFileView& file, int eye, const DicomStudyInfo& info, FormatBuffer& out,
+                         std::string* error = nullptr);
+
+// Whole file, empty on failure.
+std::string format_session_dicom(const SessionFileView& file, int eye, const DicomStudyInfo& info,
+                                 std::string* error = nullptr);
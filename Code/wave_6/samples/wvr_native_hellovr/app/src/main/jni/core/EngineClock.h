@@ -0,0 +1,44 @@
+// EngineClock.h
+#pragma once
+
+#include <chrono>
+
+// Time source of the PerimetryEngine. The headset uses the monotonic
+// SteadyEngineClock, tests and the SessionSimulator drive a ManualClock so a
+// whole protocol can run without waiting for wall-clock time.
+class EngineClock {
+public:
+    using time_point = std::chrono::steady_clock::time_point;
+    using duration = std::chrono::steady_clock::duration;
+
+    virtual ~EngineClock() = default;
+    virtual time_point now() const = 0;
+};
+
+class SteadyEngineClock : public EngineClock {
+public:
+    time_point now() const override { return std::chrono::steady_clock::now(); }
+
+    // Shared instance used when no clock is passed to the engine
+    static const SteadyEngineClock& instance() {
+        static const SteadyEngineClock clock;
+        return clock;
+    }
+};
+
+// Simulated time, only moves when advance() is called.
+class ManualClock : public EngineClock {
+public:
+    time_point now() const override { return m_now; }
+
+    void advance(duration step) { m_now += step; }
+    void advance_seconds(double seconds) {
+        m_now += std::chrono::duration_cast<duration>(std::chrono::duration<double>(seconds));
+    }
+    double elapsed_seconds() const {
+        return std::chrono::duration<double>(m_now.time_since_epoch()).count();
+    }
+
+private:
+    time_point m_now{};
+};
@@ -0,0 +1,203 @@
+// ExamStateMachine.cpp
+#include "ExamStateMachine.h"
+#include "PerimetryLog.h"
+
+#include <utility>
+
+namespace {
+using S = ExamState;
+using E = ExamEventType;
+using M = ExamStateMachine;
+}
+
+// First matching row wins, events without a row are ignored in that state.
+const ExamStateMachine::Transition ExamStateMachine::TRANSITIONS[] = {
+    {S::StartMenu,    E::PauseButton,  &M::has_resume_offer,   S::EyeMenu,      &M::accept_resume},
+    {S::StartMenu,    E::Trigger,      &M::has_resume_offer,   S::EyeMenu,      &M::decline_resume},
+    {S::StartMenu,    E::Trigger,      nullptr,                S::EyeMenu,      &M::select_first_eye},
+    {S::EyeMenu,      E::Trigger,      nullptr,                S::Testing,      &M::start_eye},
+
+    {S::Testing,      E::Trigger,      nullptr,                S::Testing,      &M::respond},
+    {S::Testing,      E::GazeLost,     nullptr,                S::FixationLost, &M::pause_engine},
+    {S::FixationLost, E::GazeOnTarget, nullptr,                S::Testing,      &M::resume_engine},
+
+    {S::Testing,      E::PauseButton,  nullptr,                S::Paused,       &M::pause_engine},
+    {S::FixationLost, E::PauseButton,  nullptr,                S::Paused,       nullptr},     // Already paused
+    {S::Paused,       E::PauseButton,  nullptr,                S::Resuming,     &M::start_resume_timer},
+    {S::Resuming,     E::ResumeTimer,  nullptr,                S::Testing,      &M::resume_engine},
+
+    {S::Testing,      E::EyeFinished,  &M::second_eye_pending, S::EyeMenu,      &M::switch_eye},
+    {S::FixationLost, E::EyeFinished,  &M::second_eye_pending, S::EyeMenu,      &M::switch_eye},
+    {S::Testing,      E::EyeFinished,  &M::last_eye,           S::EndMenu,      &M::finish_eye},
+    {S::FixationLost, E::EyeFinished,  &M::last_eye,           S::EndMenu,      &M::finish_eye},
+
+    {S::EndMenu,      E::Trigger,      nullptr,                S::Closed,       &M::close},
+    {S::EndMenu,      E::PauseButton,  nullptr,                S::StartMenu,    &M::next_patient},
+    {S::EndMenu,      E::NextPatient,  nullptr,                S::StartMenu,    &M::next_patient},
+};
+
+const char* exam_state_name(ExamState state) {
+    switch (state) {
+        case ExamState::StartMenu: return "StartMenu";
+        case ExamState::EyeMenu: return "EyeMenu";
+        case ExamState::Testing: return "Testing";
+        case ExamState::FixationLost: return "FixationLost";
+        case ExamState::Paused: return "Paused";
+        case ExamState::Resuming: return "Resuming";
+        case ExamState::EndMenu: return "EndMenu";
+        case ExamState::Closed: return "Closed";
+    }
+    return "Unknown";
+}
+
+ExamStateMachine::ExamStateMachine(PerimetryEngine& engine, int first_eye, ExamHooks hooks)
+        : m_engine(engine),
+          m_hooks(std::move(hooks)),
+          m_first_eye(first_eye) {
+}
+
+void ExamStateMachine::update(EngineClock::time_point now) {
+    m_now = now;
+
+    // Timer and engine driven events
+    if (m_state == ExamState::Resuming && now >= m_resume_at) {
+        post(ExamEventType::ResumeTimer, now);
+    }
+    if (exam_running() && m_engine.m_perimetry_status == PerimetryStatus::Done) {
+        post(ExamEventType::EyeFinished, now);
+    }
+
+    while (!m_events.empty()) {
+        ExamEvent event = m_events.front();
+        m_events.pop_front();
+        dispatch(event);
+    }
+}
+
+void ExamStateMachine::offer_resume(const ExamResumePoint& resume) {
+    if (m_state != ExamState::StartMenu) return;
+    m_resume = resume;
+    m_resume_offered = true;
+    LOGI("Exam: interrupted exam found, eye %d from vector %zu", resume.active_eye, resume.next_vector);
+}
+
+bool ExamStateMachine::dispatch(const ExamEvent& event) {
+    for (const Transition& t : TRANSITIONS) {
+        if (t.from != m_state || t.event != event.type) continue;
+        if (t.guard && !(this->*t.guard)()) continue;
+
+        if (t.to != m_state) {
+            LOGI("Exam: %s -> %s", exam_state_name(m_state), exam_state_name(t.to));
+        }
+        m_state = t.to;
+        if (t.action) (this->*t.action)(event);
+        return true;
+    }
+    return false;
+}
+
+// --- Guards ---
+
+bool ExamStateMachine::second_eye_pending() const {
+    return m_active_eye == m_first_eye;
+}
+
+bool ExamStateMachine::last_eye() const {
+    return m_active_eye != m_first_eye;
+}
+
+// --- Actions ---
+
+void ExamStateMachine::select_first_eye(const ExamEvent&) {
+    m_active_eye = m_first_eye;
+}
+
+void ExamStateMachine::accept_resume(const ExamEvent&) {
+    m_resume_offered = false;
+    m_resume_pending = m_resume.has_order;
+    m_first_eye = m_resume.first_eye;
+    m_active_eye = m_resume.active_eye;
+    m_engine.mActiveEye = m_active_eye;
+    if (m_hooks.on_resume_choice) m_hooks.on_resume_choice(true);
+}
+
+void ExamStateMachine::decline_resume(const ExamEvent& event) {
+    m_resume_offered = false;
+    if (m_hooks.on_resume_choice) m_hooks.on_resume_choice(false);
+    select_first_eye(event);
+}
+
+void ExamStateMachine::start_eye(const ExamEvent&) {
+    m_engine.mActiveEye = m_active_eye;
+    if (m_resume_pending) {
+        m_engine.start_animation(m_resume.order_seed, m_resume.next_vector);
+        m_resume_pending = false;
+    } else {
+        m_engine.start_animation();
+    }
+    if (m_hooks.on_eye_started) m_hooks.on_eye_started(m_active_eye);
+}
+
+void ExamStateMachine::respond(const ExamEvent& event) {
+    if (m_engine.m_perimetry_status != PerimetryStatus::Running) return;
+
+    bool stamped = event.time != EngineClock::time_point{};
+    DetectedPoint point = stamped
+            ? m_engine.point_detected(event.time)
+            : m_engine.point_detected(); // No device timestamp
+    if (std::get<3>(point) != 0 && m_hooks.on_point_detected) {
+        m_hooks.on_point_detected(point, stamped ? event.time : m_now);
+    }
+}
+
+void ExamStateMachine::pause_engine(const ExamEvent&) {
+    m_engine.pause_animation(false);
+    set_engine_paused(true);
+}
+
+void ExamStateMachine::resume_engine(const ExamEvent&) {
+    m_engine.resume_animation();
+    set_engine_paused(false);
+}
+
+void ExamStateMachine::set_engine_paused(bool paused) {
+    if (paused == m_engine_paused) return;
+    m_engine_paused = paused;
+    if (m_hooks.on_pause_changed) m_hooks.on_pause_changed(paused, m_state, m_now);
+}
+
+void ExamStateMachine::start_resume_timer(const ExamEvent&) {
+    m_resume_at = m_now + std::chrono::duration_cast<EngineClock::duration>(
+            std::chrono::duration<double>(PAUSE_RESUME_DELAY_S));
+}
+
+void ExamStateMachine::finish_eye(const ExamEvent&) {
+    // An eye can end while fixation is lost, that pause ends with it
+    set_engine_paused(false);
+    if (m_hooks.on_eye_finished) m_hooks.on_eye_finished(m_active_eye);
+}
+
+void ExamStateMachine::switch_eye(const ExamEvent& event) {
+    finish_eye(event);
+    m_engine.reset_animation();
+    m_active_eye = (m_first_eye == 1) ? 2 : 1;
+    m_engine.mActiveEye = m_active_eye;
+}
+
+void ExamStateMachine::close(const ExamEvent&) {
+    m_active_eye = 0;
+    m_engine.mActiveEye = 0;
+    if (m_hooks.on_close) m_hooks.on_close();
+}
+
+void ExamStateMachine::next_patient(const ExamEvent&) {
+    m_engine.reset_session();
+    m_engine_paused = false;
+    m_active_eye = 0;
+    m_resume_at = {};
+    m_resume_offered = false;
+    m_resume_pending = false;
+    m_patient_index++;
+    if (m_hooks.on_next_patient) m_first_eye = m_hooks.on_next_patient();
+    LOGI("Exam: patient %d, first eye %d", m_patient_index, m_first_eye);
+}
@@ -0,0 +1,138 @@
+// ExamStateMachine.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+#include "EngineClock.h"
+#include "PerimetryEngine.h"
+
+// Flow of a two-eye exam, from the start menu to the end menu.
+enum class ExamState : std::uint8_t {
+    StartMenu,      // Instructions, waiting for the first trigger
+    EyeMenu,        // "Cover the other eye" panel for active_eye()
+    Testing,        // Stimuli are running, trigger = response
+    FixationLost,   // Gaze left the fixation target, engine paused
+    Paused,         // Pause menu shown (A/X)
+    Resuming,       // Pause menu closed, waiting PAUSE_RESUME_DELAY_S
+    EndMenu,        // Both eyes saved, trigger closes, A/X starts the next patient
+    Closed,
+};
+
+enum class ExamEventType : std::uint8_t {
+    Trigger,        // Trigger, bumper or touchpad
+    PauseButton,    // A or X
+    GazeOnTarget,
+    GazeLost,
+    ResumeTimer,    // Posted by update() when the resume delay is over
+    EyeFinished,    // Posted by update() when the engine reports Done
+    NextPatient,    // Operator starts the next patient from the end menu
+};
+
+struct ExamEvent {
+    ExamEventType type;
+    EngineClock::time_point time{}; // Device timestamp, used for responses
+};
+
+// Called on transitions. They run from update(), never from the draw path.
+struct ExamHooks {
+    std::function<void(int eye)> on_eye_finished;   // Save the sheet of this eye
+    std::function<void()> on_close;
+    // New session in the same process; returns the first eye of the next patient
+    std::function<int()> on_next_patient;
+    // Every recorded response, for the running journal. Must not block.
+    std::function<void(const DetectedPoint& point, EngineClock::time_point time)> on_point_detected;
+    // Engine paused (fixation lost or pause menu) and resumed, for the session file
+    std::function<void(bool paused, ExamState state, EngineClock::time_point time)> on_pause_changed;
+    // The engine started (or continued) the protocol of this eye, see
+    // PerimetryEngine::order_seed and vector_index
+    std::function<void(int eye)> on_eye_started;
+    // Operator answer to offer_resume(). Accepted: restore the sheets of the
+    // interrupted exam before the eye menu is shown. Declined: start fresh.
+    std::function<void(bool accepted)> on_resume_choice;
+};
+
+// Where an interrupted exam continues, read back from the ResumeJournal.
+struct ExamResumePoint {
+    int first_eye = 0;
+    int active_eye = 0;
+    bool has_order = false;         // The active eye had started, continue its order
+    std::uint32_t order_seed = 0;
+    std::size_t next_vector = 0;
+};
+
+const char* exam_state_name(ExamState state);
+
+// Table driven state machine on top of the PerimetryEngine. Input, gaze and
+// timers only post events; update() runs once per frame before the engine
+// tick, drains the queue and performs the transitions.
+class ExamStateMachine {
+public:
+    ExamStateMachine(PerimetryEngine& engine, int first_eye, ExamHooks hooks = {});
+
+    void post(ExamEventType type, EngineClock::time_point time = {}) { m_events.push_back({type, time}); }
+    void update(EngineClock::time_point now);
+
+    // Offers to continue an interrupted exam from the start menu: A/X continues
+    // at resume.next_vector of resume.active_eye, the trigger starts over.
+    void offer_resume(const ExamResumePoint& resume);
+    bool resume_offered() const { return m_resume_offered; }
+
+    ExamState state() const { return m_state; }
+    int active_eye() const { return m_active_eye; }
+    int first_eye() const { return m_first_eye; }
+    int patient_index() const { return m_patient_index; }
+
+    // The scene (sky, stimulus, fixation target) is hidden behind the pause menu
+    bool scene_visible() const { return m_state != ExamState::Paused; }
+    bool exam_running() const { return m_state == ExamState::Testing || m_state == ExamState::FixationLost; }
+
+private:
+    struct Transition {
+        ExamState from;
+        ExamEventType event;
+        bool (ExamStateMachine::*guard)() const;    // nullptr = always
+        ExamState to;
+        void (ExamStateMachine::*action)(const ExamEvent&);
+    };
+    static const Transition TRANSITIONS[];
+
+    bool dispatch(const ExamEvent& event);
+
+    // Guards
+    bool second_eye_pending() const;
+    bool last_eye() const;
+    bool has_resume_offer() const { return m_resume_offered; }
+
+    // Actions
+    void select_first_eye(const ExamEvent& event);
+    void accept_resume(const ExamEvent& event);
+    void decline_resume(const ExamEvent& event);
+    void start_eye(const ExamEvent& event);
+    void respond(const ExamEvent& event);
+    void pause_engine(const ExamEvent& event);
+    void resume_engine(const ExamEvent& event);
+    void start_resume_timer(const ExamEvent& event);
+    void finish_eye(const ExamEvent& event);
+    void switch_eye(const ExamEvent& event);
+    void close(const ExamEvent& event);
+    void next_patient(const ExamEvent& event);
+    // Calls on_pause_changed only when the engine's paused state changes
+    void set_engine_paused(bool paused);
+
+    PerimetryEngine& m_engine;
+    ExamHooks m_hooks;
+    ExamState m_state = ExamState::StartMenu;
+    int m_first_eye;
+    int m_patient_index = 0;    // Patients since start, 0 = first
+    int m_active_eye = 0;   // 0 none, 1 right, 2 left
+    std::deque<ExamEvent> m_events;
+    EngineClock::time_point m_now{};        // Time of the running update()
+    EngineClock::time_point m_resume_at{};
+    ExamResumePoint m_resume;
+    bool m_resume_offered = false;
+    bool m_resume_pending = false;  // Next start_eye continues m_resume
+    bool m_engine_paused = false;   // Last state reported to on_pause_changed
+};
@@ -0,0 +1,272 @@
+// FieldChart.cpp
+#include "FieldChart.h"
+#include "IsopterArea.h"
+#include "NormativeModel.h"
+#include "Settings.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+
+namespace {
+constexpr double DEG_TO_RAD = M_PI / 180.0;
+
+// matplotlib's tab10, the colours of the vis2.py plots
+constexpr std::array<ChartColor, 10> PALETTE = {{
+        {31, 119, 180}, {255, 127, 14}, {44, 160, 44}, {214, 39, 40}, {148, 103, 189},
+        {140, 86, 75}, {227, 119, 194}, {127, 127, 127}, {188, 189, 34}, {23, 190, 207}}};
+
+constexpr ChartColor GRID_LIGHT{214, 214, 214};
+constexpr ChartColor GRID_DARK{120, 120, 120};
+constexpr ChartColor TEXT_COLOR{40, 40, 40};
+
+std::vector<int> planned_stimulus_keys() {
+    std::vector<int> keys;
+    for (const auto& size : LUMINANCE_TO_USE) {
+        for (StimulusCode luminance : size.second) {
+            keys.push_back(static_cast<int>(size.first) * GOLDMANN_STIMULUS_COUNT + luminance.index);
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    return keys;
+}
+
+std::string stimulus_label(const Isopter& isopter) {
+    return std::string(size_info(isopter.size).name + 5) + stimulus_info(isopter.luminance).name; // Without "Size_"
+}
+
+// Maps (eccentricity, longitude) in deg onto the plot
+struct ChartFrame {
+    float cx;
+    float cy;
+    float radius;       // px of 90°
+
+    void point(double eccentricity_deg, double longitude_deg, std::vector<float>& xy) const {
+        double r = eccentricity_deg / 90.0 * radius;
+        xy.push_back(static_cast<float>(cx + r * std::cos(longitude_deg * DEG_TO_RAD)));
+        xy.push_back(static_cast<float>(cy - r * std::sin(longitude_deg * DEG_TO_RAD)));
+    }
+};
+
+ChartText make_text(float x, float y, float size, std::string text, ChartColor color,
+                    ChartAnchor anchor = ChartAnchor::Start, bool bold = false) {
+    ChartText t;
+    t.x = x;
+    t.y = y;
+    t.size = size;
+    t.text = std::move(text);
+    t.color = color;
+    t.anchor = anchor;
+    t.bold = bold;
+    return t;
+}
+
+void append_format(std::string& out, const char* format, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int n = std::vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (n > 0) out.append(buffer, std::min<std::size_t>(static_cast<std::size_t>(n), sizeof(buffer) - 1));
+}
+
+void append_stroke(std::string& out, const ChartStroke& stroke) {
+    append_format(out, " fill=\"none\" stroke=\"#%02x%02x%02x\" stroke-width=\"%.2f\"", stroke.color.r,
+                  stroke.color.g, stroke.color.b, stroke.width);
+    if (stroke.opacity < 1.0f) append_format(out, " stroke-opacity=\"%.2f\"", stroke.opacity);
+    if (stroke.dashed) {
+        float dash = CHART_DASH_WIDTHS * stroke.width;
+        append_format(out, " stroke-dasharray=\"%.2f %.2f\"", dash, dash);
+    }
+}
+
+void append_escaped(std::string& out, const std::string& text) {
+    for (char c : text) {
+        switch (c) {
+            case '&': out += "&amp;"; break;
+            case '<': out += "&lt;"; break;
+            case '>': out += "&gt;"; break;
+            case '"': out += "&quot;"; break;
+            default: out += c;
+        }
+    }
+}
+}
+
+ChartColor stimulus_chart_color(MeteoroidSizeID size, StimulusCode luminance) {
+    static const std::vector<int> planned = planned_stimulus_keys();
+    int key = static_cast<int>(size) * GOLDMANN_STIMULUS_COUNT + luminance.index;
+    auto it = std::lower_bound(planned.begin(), planned.end(), key);
+    if (it != planned.end() && *it == key) return PALETTE[(it - planned.begin()) % PALETTE.size()];
+    std::size_t first = std::min(planned.size(), PALETTE.size() - 1);
+    return PALETTE[first + static_cast<std::size_t>(key) % (PALETTE.size() - first)];
+}
+
+ChartScene build_field_chart(const std::vector<Isopter>& isopters, int eye, long subject, double age_years,
+                             const FieldChartOptions& options) {
+    ChartScene scene;
+    const float s = static_cast<float>(std::max(options.size, 64));
+    scene.width = scene.height = static_cast<int>(s);
+    const ChartFrame frame{0.5f * s, 0.53f * s, 0.40f * s};
+
+    // Grid: rings, meridians and their labels
+    for (int eccentricity = 10; eccentricity <= 90; eccentricity += 10) {
+        ChartCircle ring;
+        ring.cx = frame.cx;
+        ring.cy = frame.cy;
+        ring.r = eccentricity / 90.0f * frame.radius;
+        bool major = eccentricity % 30 == 0;
+        ring.stroke.color = major ? GRID_DARK : GRID_LIGHT;
+        ring.stroke.width = major ? std::max(1.0f, 0.0018f * s) : 0.001f * s;
+        scene.circles.push_back(ring);
+        if (major) {
+            char label[8];
+            std::snprintf(label, sizeof(label), "%d°", eccentricity);
+            scene.texts.push_back(make_text(frame.cx + 0.006f * s, frame.cy + ring.r - 0.014f * s, 0.017f * s,
+                                            label, GRID_DARK));
+        }
+    }
+    for (int longitude = 0; longitude < 360; longitude += 15) {
+        ChartPath meridian;
+        meridian.xy = {frame.cx, frame.cy};
+        frame.point(90.0, longitude, meridian.xy);
+        bool labelled = longitude % 30 == 0;
+        meridian.stroke.color = labelled ? GRID_DARK : GRID_LIGHT;
+        meridian.stroke.width = 0.001f * s;
+        scene.paths.push_back(std::move(meridian));
+        if (labelled) {
+            std::vector<float> at;
+            frame.point(90.0 * (1.0 + 0.04f * s / frame.radius), longitude, at);
+            char label[8];
+            std::snprintf(label, sizeof(label), "%d°", longitude);
+            scene.texts.push_back(make_text(at[0], at[1], 0.02f * s, label, TEXT_COLOR, ChartAnchor::Middle));
+        }
+    }
+
+    // Measured isopters over the normative ones, then the knots
+    const double age = age_years > 0.0 ? age_years : DEFAULT_PATIENT_AGE_YEARS;
+    const bool normative = options.normative && (eye == 1 || eye == 2);
+    std::vector<float> longitudes(360);
+    for (int k = 0; k < 360; k++) longitudes[k] = static_cast<float>(k);
+    std::vector<float> expected(longitudes.size());
+    bool any_normative = false;
+    std::vector<ChartPath> measured;
+    const float legend_x = 0.025f * s;
+    float legend_y = 0.09f * s;
+    const float legend_line = 0.045f * s;
+    const float legend_step = 0.03f * s;
+    for (const Isopter& isopter : isopters) {
+        ChartColor color = stimulus_chart_color(isopter.size, isopter.luminance);
+        int row = normative_stimulus_row(isopter.size, isopter.luminance);
+        if (normative && row >= 0) {
+            evaluate_normative_contour(age, eye, row, longitudes.data(), longitudes.size(), expected.data());
+            ChartPath path;
+            path.closed = true;
+            path.stroke.color = color;
+            path.stroke.width = std::max(1.0f, 0.002f * s);
+            path.stroke.opacity = 0.85f;
+            path.stroke.dashed = true;
+            for (std::size_t k = 0; k < longitudes.size(); k++) frame.point(expected[k], longitudes[k], path.xy);
+            scene.paths.push_back(std::move(path));
+            any_normative = true;
+        }
+        if (isopter.has_contour()) {
+            ChartPath path;
+            path.closed = true;
+            path.stroke.color = color;
+            path.stroke.width = std::max(1.0f, 0.003f * s);
+            for (std::size_t k = 0; k < isopter.radius.size(); k++) {
+                frame.point(visual_eccentricity_deg(isopter.radius[k]), isopter.angle[k], path.xy);
+            }
+            measured.push_back(std::move(path));
+        }
+        if (options.knots) {
+            for (std::size_t i = 0; i < isopter.knot_longitude.size(); i++) {
+                std::vector<float> at;
+                frame.point(visual_eccentricity_deg(isopter.knot_radius[i]), isopter.knot_longitude[i], at);
+                ChartDot dot;
+                dot.x = at[0];
+                dot.y = at[1];
+                dot.r = std::max(1.5f, 0.005f * s);
+                dot.color = color;
+                scene.dots.push_back(dot);
+            }
+        }
+
+        ChartPath sample;
+        sample.xy = {legend_x, legend_y, legend_x + legend_line, legend_y};
+        sample.stroke.color = color;
+        sample.stroke.width = std::max(1.0f, 0.003f * s);
+        measured.push_back(std::move(sample));
+        scene.texts.push_back(make_text(legend_x + legend_line + 0.012f * s, legend_y, 0.02f * s,
+                                        stimulus_label(isopter), TEXT_COLOR));
+        legend_y += legend_step;
+    }
+    for (ChartPath& path : measured) scene.paths.push_back(std::move(path));
+
+    if (any_normative) {
+        ChartPath sample;
+        sample.xy = {legend_x, legend_y, legend_x + legend_line, legend_y};
+        sample.stroke.color = GRID_DARK;
+        sample.stroke.width = std::max(1.0f, 0.002f * s);
+        sample.stroke.dashed = true;
+        scene.paths.push_back(std::move(sample));
+        char label[32];
+        std::snprintf(label, sizeof(label), "normal, %.0f y", age);
+        scene.texts.push_back(make_text(legend_x + legend_line + 0.012f * s, legend_y, 0.02f * s, label, TEXT_COLOR));
+    }
+
+    std::string title = eye == 1 ? "Right eye (OD)" : (eye == 2 ? "Left eye (OS)" : "Eye unknown");
+    if (subject >= 0) title += ", Subject " + std::to_string(subject);
+    if (age_years > 0.0) {
+        char label[32];
+        std::snprintf(label, sizeof(label), ", %.0f y", age_years);
+        title += label;
+    }
+    scene.texts.push_back(make_text(0.5f * s, 0.04f * s, 0.028f * s, title, TEXT_COLOR, ChartAnchor::Middle, true));
+    return scene;
+}
+
+std::string format_chart_svg(const ChartScene& scene) {
+    std::string out;
+    out.reserve(64 * 1024);
+    append_format(out,
+                  "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                  "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" height=\"%d\" viewBox=\"0 0 %d %d\">\n",
+                  scene.width, scene.height, scene.width, scene.height);
+    append_format(out, "<rect width=\"100%%\" height=\"100%%\" fill=\"#%02x%02x%02x\"/>\n", scene.background.r,
+                  scene.background.g, scene.background.b);
+    for (const ChartCircle& circle : scene.circles) {
+        append_format(out, "<circle cx=\"%.2f\" cy=\"%.2f\" r=\"%.2f\"", circle.cx, circle.cy, circle.r);
+        append_stroke(out, circle.stroke);
+        out += "/>\n";
+    }
+    for (const ChartPath& path : scene.paths) {
+        out += path.closed ? "<polygon points=\"" : "<polyline points=\"";
+        for (std::size_t i = 0; i + 1 < path.xy.size(); i += 2) {
+            append_format(out, i == 0 ? "%.2f,%.2f" : " %.2f,%.2f", path.xy[i], path.xy[i + 1]);
+        }
+        out += '"';
+        append_stroke(out, path.stroke);
+        out += " stroke-linejoin=\"round\"/>\n";
+    }
+    for (const ChartDot& dot : scene.dots) {
+        append_format(out, "<circle cx=\"%.2f\" cy=\"%.2f\" r=\"%.2f\" fill=\"#%02x%02x%02x\"/>\n", dot.x, dot.y,
+                      dot.r, dot.color.r, dot.color.g, dot.color.b);
+    }
+    for (const ChartText& text : scene.texts) {
+        const char* anchor = text.anchor == ChartAnchor::Middle ? "middle"
+                                                                : (text.anchor == ChartAnchor::End ? "end" : "start");
+        append_format(out,
+                      "<text x=\"%.2f\" y=\"%.2f\" font-family=\"monospace\" font-size=\"%.1f\" "
+                      "text-anchor=\"%s\" dominant-baseline=\"central\" fill=\"#%02x%02x%02x\"%s>",
+                      text.x, text.y, text.size, anchor, text.color.r, text.color.g, text.color.b,
+                      text.bold ? " font-weight=\"bold\"" : "");
+        append_escaped(out, text.text);
+        out += "</text>\n";
+    }
+    out += "</svg>\n";
+    return out;
+}
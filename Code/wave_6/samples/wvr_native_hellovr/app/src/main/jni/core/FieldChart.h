@@ -0,0 +1,105 @@
+// FieldChart.h
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Isopter.h"
+
+// Visual field charts of one eye on the Goldmann form, without matplotlib:
+// eccentricity rings every 10° (30°, 60° and 90° bold), meridians every 15°
+// (labelled every 30°), one colour per stimulus with its knots, and the
+// normative isopter of the patient's age dashed in the same colour.
+//
+// The chart is first built as a scene of primitives in pixel coordinates
+// (y down). format_chart_svg() writes it as SVG, rasterize_chart()
+// (ChartRaster.h) into an RGB image for PNG, so both show the same chart.
+//
+// Isopter radii are projected positions (90 sin e, see IsopterArea.h);
+// the chart plots the true eccentricity e linearly like the paper form.
+// Longitude 0 is on the right and 90 at the top for both eyes, so the
+// temporal field of the right eye is on the right and of the left eye on
+// the left, as seen by the patient.
+
+struct ChartColor {
+    std::uint8_t r = 0;
+    std::uint8_t g = 0;
+    std::uint8_t b = 0;
+};
+
+struct ChartStroke {
+    ChartColor color;
+    float width = 1.0f;         // px
+    float opacity = 1.0f;
+    bool dashed = false;        // Dashes and gaps of CHART_DASH_WIDTHS widths
+};
+
+constexpr float CHART_DASH_WIDTHS = 3.0f;
+
+// Polyline, x0 y0 x1 y1 ...
+struct ChartPath {
+    std::vector<float> xy;
+    bool closed = false;
+    ChartStroke stroke;
+};
+
+// Outline of a circle (the eccentricity rings).
+struct ChartCircle {
+    float cx = 0.0f;
+    float cy = 0.0f;
+    float r = 0.0f;
+    ChartStroke stroke;
+};
+
+// Filled circle (the knots).
+struct ChartDot {
+    float x = 0.0f;
+    float y = 0.0f;
+    float r = 0.0f;
+    ChartColor color;
+};
+
+enum class ChartAnchor : std::uint8_t { Start, Middle, End };
+
+// One line of UTF-8 text (ASCII and °), y is its vertical middle.
+struct ChartText {
+    float x = 0.0f;
+    float y = 0.0f;
+    float size = 12.0f;         // Font size, px
+    std::string text;
+    ChartColor color;
+    ChartAnchor anchor = ChartAnchor::Start;
+    bool bold = false;
+};
+
+// Drawn in member order: circles, paths, dots, texts.
+struct ChartScene {
+    int width = 0;
+    int height = 0;
+    ChartColor background{255, 255, 255};
+    std::vector<ChartCircle> circles;
+    std::vector<ChartPath> paths;
+    std::vector<ChartDot> dots;
+    std::vector<ChartText> texts;
+};
+
+struct FieldChartOptions {
+    int size = 800;             // Width and height, px
+    bool normative = true;      // Dashed normative isopters
+    bool knots = true;          // Mean points of the meridians
+};
+
+// Colour of a stimulus: the planned stimuli (LUMINANCE_TO_USE) take the
+// first colours of the palette in (size, luminance) order, I2e blue, I3e
+// orange, V4e green, whatever a chart contains; others follow.
+ChartColor stimulus_chart_color(MeteoroidSizeID size, StimulusCode luminance);
+
+// Chart of the isopters of one eye (1 right, 2 left, 0 unknown). subject
+// < 0 leaves it out of the title; ages <= 0 draw the normative isopters of
+// DEFAULT_PATIENT_AGE_YEARS. Isopters without a contour only show knots.
+ChartScene build_field_chart(const std::vector<Isopter>& isopters, int eye, long subject, double age_years,
+                             const FieldChartOptions& options = FieldChartOptions());
+
+// Standalone SVG document of a scene.
+std::string format_chart_svg(const ChartScene& scene);
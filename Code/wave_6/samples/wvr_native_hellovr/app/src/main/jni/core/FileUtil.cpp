@@ -0,0 +1,81 @@
+// FileUtil.cpp
+#include "FileUtil.h"
+#include "PerimetryLog.h"
+
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+bool write_all(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool write_file_atomic(const std::string& path, const std::string& content) {
+    std::string tmp_path = path + ".tmp";
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOGE("Cannot open %s: %s", tmp_path.c_str(), std::strerror(errno));
+        return false;
+    }
+    bool ok = write_all(fd, content.data(), content.size()) && ::fsync(fd) == 0;
+    if (!ok) LOGE("Cannot write %s: %s", tmp_path.c_str(), std::strerror(errno));
+    ::close(fd);
+
+    if (ok && std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        LOGE("Cannot rename %s: %s", tmp_path.c_str(), std::strerror(errno));
+        ok = false;
+    }
+    if (!ok) {
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+
+    // Make the rename itself durable
+    std::string::size_type slash = path.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        ::fsync(dir_fd);
+        ::close(dir_fd);
+    }
+    return true;
+}
+
+namespace {
+// One table lookup per byte instead of eight shifts
+constexpr std::array<std::uint32_t, 256> make_crc_table() {
+    std::array<std::uint32_t, 256> table{};
+    for (std::uint32_t i = 0; i < 256; i++) {
+        std::uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xedb88320u & (0 - (crc & 1)));
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+constexpr std::array<std::uint32_t, 256> CRC_TABLE = make_crc_table();
+}
+
+std::uint32_t crc32(const void* data, std::size_t size) {
+    const auto* bytes = static_cast<const std::uint8_t*>(data);
+    std::uint32_t crc = 0xffffffffu;
+    for (std::size_t i = 0; i < size; i++) {
+        crc = (crc >> 8) ^ CRC_TABLE[(crc ^ bytes[i]) & 0xffu];
+    }
+    return ~crc;
+}
@@ -0,0 +1,16 @@
+// FileUtil.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Writes all of data to fd, retrying short writes and EINTR.
+bool write_all(int fd, const char* data, std::size_t size);
+
+// Writes content to path + ".tmp", fsyncs it and renames it over path, so
+// readers only ever see the old file or the complete new one.
+bool write_file_atomic(const std::string& path, const std::string& content);
+
+// CRC-32 (IEEE, as zlib), for the record checksums of the binary files.
+std::uint32_t crc32(const void* data, std::size_t size);
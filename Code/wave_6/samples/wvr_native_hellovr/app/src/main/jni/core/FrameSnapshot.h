@@ -0,0 +1,19 @@
+// FrameSnapshot.h
+#pragma once
+
+#include <cstdint>
+
+#include "EngineClock.h"
+#include "GoldmannSheet.h"
+#include "StimulusToDraw.h"
+
+// Immutable result of one PerimetryEngine::tick. Both eyes draw from the
+// same snapshot, so they always see the stimulus at the same position.
+struct FrameSnapshot {
+    std::uint64_t frame_index = 0;
+    EngineClock::time_point frame_time{};
+    int active_eye = 0;
+    StimulusToDraw stimulus;
+    PolarPoint point{0.0f, 0.0f};       // Perimetry coordinates of the stimulus
+    double eccentricity_deg = 90.0;
+};
@@ -0,0 +1,296 @@
+// GazeRecorder.cpp
+#include "GazeRecorder.h"
+#include "FileUtil.h"
+#include "IoWorker.h"
+#include "PerimetryLog.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+constexpr double SCALE_DIRECTION = 1e4;
+constexpr double SCALE_ORIGIN = 1e4;
+constexpr double SCALE_OPENNESS = 1e3;
+constexpr double SCALE_PUPIL_MM = 1e3;
+constexpr double SCALE_PUPIL_POSITION = 1e4;
+constexpr double SCALE_ANGLE = 1e3;
+
+using Fields = std::array<std::int64_t, GazeChunkEncoder::FIELD_COUNT>;
+
+std::int64_t quantize(float value, double scale) {
+    return std::isfinite(value) ? std::llround(value * scale) : 0;
+}
+
+float dequantize(std::int64_t value, double scale) {
+    return static_cast<float>(static_cast<double>(value) / scale);
+}
+
+std::size_t put_eye(const GazeEyeSample& eye, std::int64_t* f) {
+    f[0] = static_cast<std::int64_t>(eye.valid_mask);
+    for (int i = 0; i < 3; i++) f[1 + i] = quantize(eye.origin[i], SCALE_ORIGIN);
+    for (int i = 0; i < 3; i++) f[4 + i] = quantize(eye.direction[i], SCALE_DIRECTION);
+    f[7] = quantize(eye.openness, SCALE_OPENNESS);
+    f[8] = quantize(eye.pupil_diameter_mm, SCALE_PUPIL_MM);
+    f[9] = quantize(eye.pupil_position[0], SCALE_PUPIL_POSITION);
+    f[10] = quantize(eye.pupil_position[1], SCALE_PUPIL_POSITION);
+    return 11;
+}
+
+std::size_t get_eye(const std::int64_t* f, GazeEyeSample& eye) {
+    eye.valid_mask = static_cast<std::uint64_t>(f[0]);
+    for (int i = 0; i < 3; i++) eye.origin[i] = dequantize(f[1 + i], SCALE_ORIGIN);
+    for (int i = 0; i < 3; i++) eye.direction[i] = dequantize(f[4 + i], SCALE_DIRECTION);
+    eye.openness = dequantize(f[7], SCALE_OPENNESS);
+    eye.pupil_diameter_mm = dequantize(f[8], SCALE_PUPIL_MM);
+    eye.pupil_position[0] = dequantize(f[9], SCALE_PUPIL_POSITION);
+    eye.pupil_position[1] = dequantize(f[10], SCALE_PUPIL_POSITION);
+    return 11;
+}
+
+void to_fields(const GazeSample& s, Fields& f) {
+    f[0] = s.time_ns;
+    f[1] = s.flags;
+    f[2] = s.exam_state;
+    f[3] = s.track_id;
+    f[4] = quantize(s.eccentricity_deg, SCALE_ANGLE);
+    f[5] = quantize(s.fixation_angle_deg, SCALE_ANGLE);
+    std::size_t next = 6;
+    next += put_eye(s.left, &f[next]);
+    put_eye(s.right, &f[next]);
+}
+
+void from_fields(const Fields& f, GazeSample& s) {
+    s.time_ns = f[0];
+    s.flags = static_cast<std::uint8_t>(f[1]);
+    s.exam_state = static_cast<std::uint8_t>(f[2]);
+    s.track_id = static_cast<std::uint32_t>(f[3]);
+    s.eccentricity_deg = dequantize(f[4], SCALE_ANGLE);
+    s.fixation_angle_deg = dequantize(f[5], SCALE_ANGLE);
+    std::size_t next = 6;
+    next += get_eye(&f[next], s.left);
+    get_eye(&f[next], s.right);
+}
+
+// Deltas are taken in unsigned arithmetic, wrap-around is intended
+inline std::uint8_t* put_delta(std::uint8_t* out, std::int64_t current, std::int64_t previous) {
+    std::uint64_t delta = static_cast<std::uint64_t>(current) - static_cast<std::uint64_t>(previous);
+    std::uint64_t zigzag = (delta << 1) ^ (0 - (delta >> 63));
+    while (zigzag >= 0x80) {
+        *out++ = static_cast<std::uint8_t>(zigzag | 0x80);
+        zigzag >>= 7;
+    }
+    *out++ = static_cast<std::uint8_t>(zigzag);
+    return out;
+}
+
+inline bool get_delta(const std::uint8_t*& in, const std::uint8_t* end, std::int64_t& value) {
+    std::uint64_t zigzag = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (in == end) return false;
+        std::uint8_t byte = *in++;
+        zigzag |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            std::uint64_t delta = (zigzag >> 1) ^ (0 - (zigzag & 1));
+            value = static_cast<std::int64_t>(static_cast<std::uint64_t>(value) + delta);
+            return true;
+        }
+    }
+    return false;
+}
+
+void put_u32(std::uint8_t* out, std::uint32_t value) {
+    for (int i = 0; i < 4; i++) out[i] = static_cast<std::uint8_t>(value >> (8 * i));
+}
+
+std::uint32_t get_u32(const std::uint8_t* in) {
+    std::uint32_t value = 0;
+    for (int i = 0; i < 4; i++) value |= static_cast<std::uint32_t>(in[i]) << (8 * i);
+    return value;
+}
+}
+
+// --- GazeChunkEncoder ---
+
+GazeChunkEncoder::GazeChunkEncoder(std::size_t capacity_bytes)
+        : m_capacity(capacity_bytes < MAX_SAMPLE_BYTES ? MAX_SAMPLE_BYTES : capacity_bytes) {
+    m_bytes.reserve(m_capacity);
+}
+
+bool GazeChunkEncoder::add(const GazeSample& sample) {
+    std::size_t used = m_bytes.size();
+    if (m_capacity - used < MAX_SAMPLE_BYTES) return false;
+
+    Fields fields;
+    to_fields(sample, fields);
+
+    // Capacity is reserved, this resize never reallocates
+    m_bytes.resize(used + MAX_SAMPLE_BYTES);
+    std::uint8_t* out = m_bytes.data() + used;
+    for (std::size_t i = 0; i < FIELD_COUNT; i++) {
+        out = put_delta(out, fields[i], m_previous[i]);
+    }
+    m_bytes.resize(static_cast<std::size_t>(out - m_bytes.data()));
+    m_previous = fields;
+    m_sample_count++;
+    return true;
+}
+
+std::vector<std::uint8_t> GazeChunkEncoder::take() {
+    std::vector<std::uint8_t> payload;
+    payload.reserve(m_capacity);
+    payload.swap(m_bytes);
+    m_previous.fill(0);
+    m_sample_count = 0;
+    return payload;
+}
+
+bool decode_gaze_chunk(const std::uint8_t* data, std::size_t size, std::uint32_t sample_count,
+                       std::vector<GazeSample>& out) {
+    const std::uint8_t* in = data;
+    const std::uint8_t* end = data + size;
+    Fields fields{};
+    for (std::uint32_t n = 0; n < sample_count; n++) {
+        for (std::int64_t& field : fields) {
+            if (!get_delta(in, end, field)) return false;
+        }
+        GazeSample sample;
+        from_fields(fields, sample);
+        out.push_back(sample);
+    }
+    return in == end;
+}
+
+bool read_gaze_file(const std::string& path, std::vector<GazeSample>& out, std::string* error) {
+    auto fail = [error](const std::string& message) {
+        if (error) *error = message;
+        return false;
+    };
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return fail("cannot open " + path);
+    std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    if (bytes.size() < gaze_file::HEADER_BYTES || std::memcmp(bytes.data(), gaze_file::MAGIC, 4) != 0) {
+        return fail(path + ": not a gaze file");
+    }
+    std::uint16_t version = static_cast<std::uint16_t>(bytes[4] | (bytes[5] << 8));
+    std::uint16_t field_count = static_cast<std::uint16_t>(bytes[6] | (bytes[7] << 8));
+    if (version != gaze_file::VERSION || field_count != GazeChunkEncoder::FIELD_COUNT) {
+        return fail(path + ": unsupported gaze file version " + std::to_string(version));
+    }
+
+    std::size_t offset = gaze_file::HEADER_BYTES;
+    while (offset < bytes.size()) {
+        if (bytes.size() - offset < gaze_file::CHUNK_HEADER_BYTES) return fail(path + ": truncated chunk header");
+        std::uint32_t payload_bytes = get_u32(&bytes[offset]);
+        std::uint32_t sample_count = get_u32(&bytes[offset + 4]);
+        offset += gaze_file::CHUNK_HEADER_BYTES;
+        if (bytes.size() - offset < payload_bytes) return fail(path + ": truncated chunk");
+        if (!decode_gaze_chunk(&bytes[offset], payload_bytes, sample_count, out)) {
+            return fail(path + ": damaged chunk");
+        }
+        offset += payload_bytes;
+    }
+    return true;
+}
+
+// --- GazeRecorder ---
+
+struct GazeRecorder::File {
+    std::string path;
+    int fd = -1;
+};
+
+GazeRecorder::GazeRecorder(IoWorker* worker, std::size_t chunk_bytes)
+        : m_worker(worker),
+          m_encoder(chunk_bytes) {
+}
+
+GazeRecorder::~GazeRecorder() {
+    close();
+}
+
+void GazeRecorder::post(std::function<void()> job) {
+    if (m_worker) {
+        m_worker->post(std::move(job));
+    } else {
+        job();
+    }
+}
+
+void GazeRecorder::open(const std::string& path) {
+    close();
+    m_file = std::make_shared<File>();
+    m_file->path = path;
+    m_has_last = false;
+
+    std::shared_ptr<File> file = m_file;
+    post([file]() {
+        file->fd = ::open(file->path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (file->fd < 0) {
+            LOGE("Gaze: cannot open %s: %s", file->path.c_str(), std::strerror(errno));
+            return;
+        }
+        std::uint8_t header[gaze_file::HEADER_BYTES] = {};
+        std::memcpy(header, gaze_file::MAGIC, 4);
+        header[4] = static_cast<std::uint8_t>(gaze_file::VERSION);
+        header[5] = static_cast<std::uint8_t>(gaze_file::VERSION >> 8);
+        header[6] = static_cast<std::uint8_t>(GazeChunkEncoder::FIELD_COUNT);
+        write_all(file->fd, reinterpret_cast<const char*>(header), sizeof(header));
+    });
+}
+
+void GazeRecorder::close() {
+    if (!m_file) return;
+    flush();
+    std::shared_ptr<File> file = std::move(m_file);
+    post([file]() {
+        if (file->fd < 0) return;
+        ::fsync(file->fd);
+        ::close(file->fd);
+        file->fd = -1;
+    });
+}
+
+void GazeRecorder::add(const GazeSample& sample) {
+    if (!m_file) return;
+    if (m_has_last && sample.time_ns == m_last_time_ns) return;
+    m_last_time_ns = sample.time_ns;
+    m_has_last = true;
+
+    if (!m_encoder.add(sample)) {
+        flush();
+        m_encoder.add(sample);
+    }
+    m_samples++;
+}
+
+void GazeRecorder::flush() {
+    if (!m_file || m_encoder.empty()) return;
+    std::uint32_t count = m_encoder.sample_count();
+    submit(m_encoder.take(), count);
+}
+
+void GazeRecorder::submit(std::vector<std::uint8_t> payload, std::uint32_t sample_count) {
+    m_encoded_bytes += payload.size();
+    auto chunk = std::make_shared<std::vector<std::uint8_t>>(std::move(payload));
+    std::shared_ptr<File> file = m_file;
+    post([file, chunk, sample_count]() {
+        if (file->fd < 0) return;
+        std::uint8_t header[gaze_file::CHUNK_HEADER_BYTES];
+        put_u32(header, static_cast<std::uint32_t>(chunk->size()));
+        put_u32(header + 4, sample_count);
+        // One write per chunk keeps the header and payload together
+        std::vector<std::uint8_t> record(header, header + sizeof(header));
+        record.insert(record.end(), chunk->begin(), chunk->end());
+        if (!write_all(file->fd, reinterpret_cast<const char*>(record.data()), record.size())) {
+            LOGE("Gaze: write to %s failed: %s", file->path.c_str(), std::strerror(errno));
+        }
+    });
+}
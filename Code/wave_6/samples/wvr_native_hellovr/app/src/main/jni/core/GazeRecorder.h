@@ -0,0 +1,161 @@
+// GazeRecorder.h
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "RecordSchema.h"
+
+class IoWorker;
+
+// One eye of WVR_EyeTracking_t, without the WVR types so the encoder can be
+// built on the host.
+struct GazeEyeSample {
+    std::uint64_t valid_mask = 0;           // eyeTrackingValidBitMask
+    std::array<float, 3> origin{};          // m
+    std::array<float, 3> direction{};       // Normalized
+    float openness = 0.0f;
+    float pupil_diameter_mm = 0.0f;
+    std::array<float, 2> pupil_position{};  // Normalized sensor position
+};
+
+// Every eye tracking sample together with the state of the exam.
+struct GazeSample {
+    enum Flags : std::uint8_t {
+        ON_TARGET        = 1 << 0,  // Fixation check passed
+        ANGLE_VALID      = 1 << 1,  // fixation_angle_deg was computed
+        STIMULUS_VISIBLE = 1 << 2,
+        ENGINE_PAUSED    = 1 << 3,
+    };
+
+    std::int64_t time_ns = 0;               // Device timestamp
+    GazeEyeSample left;
+    GazeEyeSample right;
+    float fixation_angle_deg = 0.0f;
+    std::uint8_t flags = 0;
+    std::uint8_t exam_state = 0;            // ExamState
+    std::uint32_t track_id = 0;             // Stimulus vector, see PerimetryEngine::track_id
+    float eccentricity_deg = 0.0f;
+};
+
+// CSV: left_origin_0 .. right_pupil_position_1, one column per component
+template <>
+struct RecordSchema<GazeEyeSample> {
+    static constexpr auto fields = std::make_tuple(
+            field("valid_mask", &GazeEyeSample::valid_mask),
+            field("origin", &GazeEyeSample::origin),
+            field("direction", &GazeEyeSample::direction),
+            field("openness", &GazeEyeSample::openness),
+            field("pupil_diameter_mm", &GazeEyeSample::pupil_diameter_mm),
+            field("pupil_position", &GazeEyeSample::pupil_position));
+};
+
+template <>
+struct RecordSchema<GazeSample> {
+    static constexpr auto fields = std::make_tuple(
+            field("time_ns", &GazeSample::time_ns),
+            field("left", &GazeSample::left),
+            field("right", &GazeSample::right),
+            field("fixation_angle_deg", &GazeSample::fixation_angle_deg),
+            field("flags", &GazeSample::flags),
+            field("exam_state", &GazeSample::exam_state),
+            field("track_id", &GazeSample::track_id),
+            field("eccentricity_deg", &GazeSample::eccentricity_deg));
+};
+
+// Encoding
+//
+// Every sample is a fixed list of integer fields. Floats are quantized to
+// fixed steps (direction and origin 1e-4, openness and pupil 1e-3, angles
+// 1e-3 deg), every field is stored as the zigzag varint of its difference
+// to the previous sample. Mostly constant fields cost one byte, a sample
+// is ~30-40 bytes, 20 minutes at 72 Hz about 3 MB.
+//
+// Samples go into chunks of CHUNK_BYTES. Each chunk starts from a zero
+// state, so chunks decode independently and a crash loses at most the
+// chunk being filled.
+//
+// File: "PGAZ" u16 version u16 field_count u32 reserved u32 reserved, then
+// per chunk u32 payload_bytes u32 sample_count payload.
+namespace gaze_file {
+constexpr char MAGIC[4] = {'P', 'G', 'A', 'Z'};
+constexpr std::uint16_t VERSION = 1;
+constexpr std::size_t HEADER_BYTES = 16;
+constexpr std::size_t CHUNK_HEADER_BYTES = 8;
+}
+
+class GazeChunkEncoder {
+public:
+    static constexpr std::size_t FIELD_COUNT = 28;
+    static constexpr std::size_t MAX_SAMPLE_BYTES = FIELD_COUNT * 10;
+
+    explicit GazeChunkEncoder(std::size_t capacity_bytes);
+
+    // False if the chunk is full, the sample is not added.
+    bool add(const GazeSample& sample);
+
+    const std::vector<std::uint8_t>& bytes() const { return m_bytes; }
+    std::uint32_t sample_count() const { return m_sample_count; }
+    bool empty() const { return m_sample_count == 0; }
+    // Hands out the payload and starts the next chunk from a zero state
+    std::vector<std::uint8_t> take();
+
+private:
+    std::size_t m_capacity;
+    std::vector<std::uint8_t> m_bytes;
+    std::array<std::int64_t, FIELD_COUNT> m_previous{};
+    std::uint32_t m_sample_count = 0;
+};
+
+// Appends the samples of one chunk payload to out. False if it is damaged.
+bool decode_gaze_chunk(const std::uint8_t* data, std::size_t size, std::uint32_t sample_count,
+                       std::vector<GazeSample>& out);
+// All samples of a gaze file. False (with error) on I/O or format errors,
+// out then holds the samples of the intact chunks before the damage.
+bool read_gaze_file(const std::string& path, std::vector<GazeSample>& out, std::string* error = nullptr);
+
+// Records the gaze stream of a session. add() runs on the render thread and
+// only encodes into the current chunk (no I/O, one buffer per chunk); full
+// chunks are appended to the file by the IoWorker.
+class GazeRecorder {
+public:
+    static constexpr std::size_t CHUNK_BYTES = 64 * 1024;
+
+    explicit GazeRecorder(IoWorker* worker, std::size_t chunk_bytes = CHUNK_BYTES);
+    ~GazeRecorder(); // Closes the open file
+
+    GazeRecorder(const GazeRecorder&) = delete;
+    GazeRecorder& operator=(const GazeRecorder&) = delete;
+
+    void open(const std::string& path);
+    // Writes the last partial chunk and closes the file
+    void close();
+    bool is_open() const { return m_file != nullptr; }
+
+    // Samples with the timestamp of the previous one are skipped (the
+    // tracker runs slower than the frame loop it is polled from).
+    void add(const GazeSample& sample);
+    // Hands the partial chunk to the writer, e.g. at the end of an eye
+    void flush();
+
+    std::uint64_t samples() const { return m_samples; }
+    std::uint64_t encoded_bytes() const { return m_encoded_bytes; }
+
+private:
+    struct File;
+    void submit(std::vector<std::uint8_t> payload, std::uint32_t sample_count);
+    void post(std::function<void()> job);
+
+    IoWorker* m_worker;
+    GazeChunkEncoder m_encoder;
+    std::shared_ptr<File> m_file;
+    std::int64_t m_last_time_ns = 0;
+    bool m_has_last = false;
+    std::uint64_t m_samples = 0;
+    std::uint64_t m_encoded_bytes = 0;
+};
@@ -0,0 +1,188 @@
+// GoldmannSheet.cpp
+#include "GoldmannSheet.h"
+#include "Longitude.h"
+#include "PerimetryLog.h"
+
+#include <algorithm>
+#include <limits>
+
+GoldmannSheet::GoldmannSheet()
+        : m_points_per_entry(NUMBER_ITERATIONS_PER_SIZE) {
+    m_slot_of_angle.fill(-1);
+}
+
+void GoldmannSheet::register_meridians(const std::vector<PerimetryVector>& meteoroid_l) {
+    std::vector<int> meridians = m_meridians;
+    for (auto& vec : meteoroid_l) {
+        int angle = normalize_angle(vec.angle_deg);
+        if (std::find(meridians.begin(), meridians.end(), angle) == meridians.end()) {
+            meridians.push_back(angle);
+        }
+    }
+    if (meridians.size() == m_meridians.size()) return;
+
+    // Keep meridians sorted so exports stay ordered by longitude. Existing
+    // entries are moved to their new slots.
+    std::sort(meridians.begin(), meridians.end());
+    const int block = GOLDMANN_SIZE_COUNT * GOLDMANN_STIMULUS_COUNT;
+    for (EyeSheet* sheet : {&m_sheet_right, &m_sheet_left}) {
+        EyeSheet resized;
+        resized.entries.resize(meridians.size() * block);
+        resized.points.resize(resized.entries.size() * m_points_per_entry);
+        for (int old_slot = 0; old_slot < static_cast<int>(m_meridians.size()); old_slot++) {
+            int new_slot = static_cast<int>(std::find(meridians.begin(), meridians.end(), m_meridians[old_slot]) - meridians.begin());
+            std::copy_n(sheet->entries.begin() + old_slot * block, block, resized.entries.begin() + new_slot * block);
+            std::copy_n(sheet->points.begin() + old_slot * block * m_points_per_entry, block * m_points_per_entry,
+                        resized.points.begin() + new_slot * block * m_points_per_entry);
+        }
+        *sheet = std::move(resized);
+    }
+
+    m_meridians = meridians;
+    m_slot_of_angle.fill(-1);
+    for (int slot = 0; slot < static_cast<int>(m_meridians.size()); slot++) {
+        m_slot_of_angle[m_meridians[slot]] = static_cast<std::int16_t>(slot);
+    }
+}
+
+void GoldmannSheet::setup_sheet(
+        const std::vector<PerimetryVector>& meteoroid_l,
+        const std::map<MeteoroidSizeID, std::vector<StimulusCode>>& sizes,
+        int eye,
+        const NormativeIsopters* normative) {
+    register_meridians(meteoroid_l);
+    EyeSheet* sheet = eye_sheet(eye);
+    if (!sheet) return;
+
+    for (int size_idx = 5; size_idx >= 1; size_idx--) {
+        MeteoroidSizeID size_id = getSizeByNumber(size_idx);
+        for (StimulusCode lum : sizes.at(size_id)) {
+            for (auto& vec : meteoroid_l) {
+                SheetEntry& entry = sheet->entries[find_index(vec.angle_deg, size_id, lum)];
+                entry = SheetEntry();
+                entry.in_use = true;
+                float expected = normative ? normative->expected(eye, vec.angle_deg, size_id, lum) : -1.0f;
+                if (expected >= 0.0f) entry.normalized_angle = expected;
+            }
+        }
+    }
+}
+
+void GoldmannSheet::add_point(PolarPoint p, MeteoroidSizeID size, int longitude, int eye, StimulusCode luminance) {
+    m_points.push_back(p);
+    m_sizes.push_back(size);
+
+    EyeSheet* sheet = eye_sheet(eye);
+    int index = find_index(longitude, size, luminance);
+    if (!sheet || index < 0) return;
+
+    SheetEntry& entry = sheet->entries[index];
+    if (entry.point_count == std::numeric_limits<decltype(entry.point_count)>::max()) {
+        m_dropped_points++;
+        LOGW("GoldmannSheet: entry full, point dropped (%zu dropped)", m_dropped_points);
+        return;
+    }
+    if (entry.point_count >= m_points_per_entry) {
+        // More repeats than planned (e.g. a retested vector): make room in every entry
+        grow_points_per_entry(std::min<int>(2 * m_points_per_entry,
+                                            std::numeric_limits<decltype(entry.point_count)>::max()));
+    }
+    sheet->points[index * m_points_per_entry + entry.point_count] = p;
+    entry.point_count++;
+}
+
+void GoldmannSheet::grow_points_per_entry(int points_per_entry) {
+    for (EyeSheet* sheet : {&m_sheet_right, &m_sheet_left}) {
+        std::vector<PolarPoint> points(sheet->entries.size() * points_per_entry);
+        for (size_t index = 0; index < sheet->entries.size(); index++) {
+            std::copy_n(sheet->points.begin() + index * m_points_per_entry, sheet->entries[index].point_count,
+                        points.begin() + index * points_per_entry);
+        }
+        sheet->points = std::move(points);
+    }
+    m_points_per_entry = points_per_entry;
+}
+
+int GoldmannSheet::meridian_slot(int longitude) const {
+    return m_slot_of_angle[normalize_angle(longitude)];
+}
+
+int GoldmannSheet::find_index(int longitude, MeteoroidSizeID size, StimulusCode luminance) const {
+    int slot = meridian_slot(longitude);
+    int size_index = static_cast<int>(size);
+    if (slot < 0 || size_index < 0 || size_index >= GOLDMANN_SIZE_COUNT ||
+        luminance.index >= GOLDMANN_STIMULUS_COUNT) {
+        return -1;
+    }
+    return entry_index(slot, size_index, luminance);
+}
+
+const SheetEntry* GoldmannSheet::find_entry(int eye, int longitude, MeteoroidSizeID size, StimulusCode luminance) const {
+    const EyeSheet* sheet = eye_sheet(eye);
+    int index = find_index(longitude, size, luminance);
+    if (!sheet || index < 0) return nullptr;
+    return &sheet->entries[index];
+}
+
+float GoldmannSheet::normalized_angle(int eye, int longitude, MeteoroidSizeID size, StimulusCode luminance) const {
+    const SheetEntry* entry = find_entry(eye, longitude, size, luminance);
+    return entry ? entry->normalized_angle : 90.0f;
+}
+
+void GoldmannSheet::set_longitude_normalized_angle(int eye, int longitude, float normalized_angle) {
+    EyeSheet* sheet = eye_sheet(eye);
+    int slot = meridian_slot(longitude);
+    if (!sheet || slot < 0) return;
+
+    const int block = GOLDMANN_SIZE_COUNT * GOLDMANN_STIMULUS_COUNT;
+    auto first = sheet->entries.begin() + slot * block;
+    std::for_each(first, first + block, [normalized_angle](SheetEntry& entry) {
+        entry.normalized_angle = normalized_angle;
+    });
+}
+
+const std::vector<SheetEntry>& GoldmannSheet::entries(int eye) const {
+    static const std::vector<SheetEntry> no_entries;
+    const EyeSheet* sheet = eye_sheet(eye);
+    return sheet ? sheet->entries : no_entries;
+}
+
+GoldmannSheet::PointRange GoldmannSheet::points(int eye, int entry_index) const {
+    const EyeSheet* sheet = eye_sheet(eye);
+    if (!sheet || entry_index < 0 || entry_index >= static_cast<int>(sheet->entries.size())) {
+        return {nullptr, nullptr};
+    }
+    return point_range(*sheet, entry_index);
+}
+
+std::shared_ptr<const GoldmannSheet> GoldmannSheet::snapshot(int eye) const {
+    auto copy = std::make_shared<GoldmannSheet>();
+    copy->m_meridians = m_meridians;
+    copy->m_slot_of_angle = m_slot_of_angle;
+    copy->m_points_per_entry = m_points_per_entry;
+    copy->m_points = m_points;
+    copy->m_sizes = m_sizes;
+    copy->m_dropped_points = m_dropped_points;
+
+    const EyeSheet* sheet = eye_sheet(eye);
+    EyeSheet* target = copy->eye_sheet(eye);
+    if (sheet && target) *target = *sheet;
+    return copy;
+}
+
+GoldmannSheet::PointRange GoldmannSheet::point_range(const EyeSheet& sheet, int index) const {
+    const PolarPoint* first = sheet.points.data() + index * m_points_per_entry;
+    return {first, first + sheet.entries[index].point_count};
+}
+
+GoldmannSheet::EyeSheet* GoldmannSheet::eye_sheet(int eye) {
+    if (eye == 1) return &m_sheet_right;
+    if (eye == 2) return &m_sheet_left;
+    return nullptr;
+}
+
+const GoldmannSheet::EyeSheet* GoldmannSheet::eye_sheet(int eye) const {
+    if (eye == 1) return &m_sheet_right;
+    if (eye == 2) return &m_sheet_left;
+    return nullptr;
+}
@@ -0,0 +1,120 @@
+// GoldmannSheet.h
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include <memory>
+#include "GoldmannSizes.h"
+#include "NormativeModel.h"
+#include "Settings.h"
+using namespace std;
+
+// Entspricht der PolarPoint-Klasse
+struct PolarPoint {
+    float theta;
+    float phi;
+};
+
+struct SheetEntry {
+    float normalized_angle = 90.0f;
+    std::uint8_t point_count = 0;
+    bool in_use = false;    // Part of the test plan (LUMINANCE_TO_USE), exported
+};
+
+// Dense result sheet. Each eye keeps one contiguous entry array indexed by
+// [meridian slot][size][luminance] and one points arena with the same number
+// of point slots per entry, so lookups never allocate and exports are linear.
+// The slots start at NUMBER_ITERATIONS_PER_SIZE and double when an entry
+// fills up; only points beyond 255 per entry are dropped (and counted).
+class GoldmannSheet {
+public:
+    struct PointRange {
+        const PolarPoint* first;
+        const PolarPoint* last;
+        const PolarPoint* begin() const { return first; }
+        const PolarPoint* end() const { return last; }
+        size_t size() const { return static_cast<size_t>(last - first); }
+    };
+
+    GoldmannSheet();
+
+    // Entries of the test plan start at the expected isopter of the patient
+    // (90° without normative isopters or for stimuli outside the model).
+    void setup_sheet(
+            const std::vector<PerimetryVector>& meteoroid_l,
+            const std::map<MeteoroidSizeID, std::vector<StimulusCode>>& sizes,
+            int eye,
+            const NormativeIsopters* normative = nullptr);
+
+    void add_point(PolarPoint p, MeteoroidSizeID size, int longitude, int eye, StimulusCode luminance);
+
+    // Read-only lookups, never insert. Unknown keys give nullptr / 90°.
+    const SheetEntry* find_entry(int eye, int longitude, MeteoroidSizeID size, StimulusCode luminance) const;
+    float normalized_angle(int eye, int longitude, MeteoroidSizeID size, StimulusCode luminance) const;
+
+    // A detection on a meridian moves the expected isopter of every stimulus on it.
+    void set_longitude_normalized_angle(int eye, int longitude, float normalized_angle);
+
+    int meridian_count() const { return static_cast<int>(m_meridians.size()); }
+    int meridian_angle(int slot) const { return m_meridians[slot]; }
+    int meridian_slot(int longitude) const;
+    int points_per_entry() const { return m_points_per_entry; }
+    size_t dropped_points() const { return m_dropped_points; }
+
+    static int entry_index(int slot, int size_index, StimulusCode luminance) {
+        return (slot * GOLDMANN_SIZE_COUNT + size_index) * GOLDMANN_STIMULUS_COUNT + luminance.index;
+    }
+    const std::vector<SheetEntry>& entries(int eye) const;
+    PointRange points(int eye, int entry_index) const;
+
+    // Visits every entry of the test plan in (longitude, size, luminance) order:
+    // f(longitude, MeteoroidSizeID, StimulusCode, const SheetEntry&, PointRange)
+    template <typename F>
+    void for_each_entry(int eye, F&& f) const {
+        const EyeSheet* sheet = eye_sheet(eye);
+        if (!sheet) return;
+        for (int index = 0; index < static_cast<int>(sheet->entries.size()); index++) {
+            const SheetEntry& entry = sheet->entries[index];
+            if (!entry.in_use) continue;
+            StimulusCode luminance{static_cast<std::uint8_t>(index % GOLDMANN_STIMULUS_COUNT)};
+            int size_index = (index / GOLDMANN_STIMULUS_COUNT) % GOLDMANN_SIZE_COUNT;
+            int slot = index / (GOLDMANN_STIMULUS_COUNT * GOLDMANN_SIZE_COUNT);
+            f(m_meridians[slot], static_cast<MeteoroidSizeID>(size_index), luminance, entry, point_range(*sheet, index));
+        }
+    }
+
+    // Immutable copy of one eye (two flat vectors, no per-entry allocation)
+    // and of the point list, for exports off the render thread. The other
+    // eye's entries are empty in the copy.
+    std::shared_ptr<const GoldmannSheet> snapshot(int eye) const;
+
+    // Getter (optional, aber guter Stil)
+    const std::vector<PolarPoint>& get_points() const { return m_points; }
+    const std::vector<MeteoroidSizeID>& get_sizes() const { return m_sizes; }
+
+private:
+    struct EyeSheet {
+        std::vector<SheetEntry> entries;
+        std::vector<PolarPoint> points;   // entries.size() * m_points_per_entry
+    };
+
+    EyeSheet m_sheet_right;
+    EyeSheet m_sheet_left;
+    std::vector<int> m_meridians;
+    std::array<std::int16_t, 360> m_slot_of_angle;
+    int m_points_per_entry;
+    size_t m_dropped_points = 0;
+
+    std::vector<PolarPoint> m_points;
+    std::vector<MeteoroidSizeID> m_sizes;
+
+    EyeSheet* eye_sheet(int eye);
+    const EyeSheet* eye_sheet(int eye) const;
+    int find_index(int longitude, MeteoroidSizeID size, StimulusCode luminance) const;
+    void register_meridians(const std::vector<PerimetryVector>& meteoroid_l);
+    void grow_points_per_entry(int points_per_entry);
+    PointRange point_range(const EyeSheet& sheet, int index) const;
+};
@@ -0,0 +1,68 @@
+// GoldmannSizes.h
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+
+
+// Ein Enum, um die Größen typsicher in Maps zu verwenden
+enum class MeteoroidSizeID { I, II, III, IV, V, None };
+
+// Size_I..Size_V, None is not a real stimulus
+constexpr int GOLDMANN_SIZE_COUNT = 5;
+
+MeteoroidSizeID getSizeByNumber(int number);
+
+// Plain descriptor of a Goldmann stimulus size (entspricht goldmann_sizes.py::MeteoroideSize).
+// The table below is indexed by MeteoroidSizeID, so lookups are a single array access.
+struct GoldmannSizeInfo {
+    MeteoroidSizeID id;
+    const char* name;
+    double size_deg;            // Angular diameter
+    int index;                  // 1..5, 0 for None
+    int speed;                  // deg/sec close to the expected isopter
+    MeteoroidSizeID next_size;
+};
+
+constexpr std::array<GoldmannSizeInfo, GOLDMANN_SIZE_COUNT + 1> GOLDMANN_SIZES = {{
+        {MeteoroidSizeID::I,    "Size_I",   0.11, 1, 2, MeteoroidSizeID::None},
+        {MeteoroidSizeID::II,   "Size_II",  0.22, 2, 3, MeteoroidSizeID::I},
+        {MeteoroidSizeID::III,  "Size_III", 0.43, 3, 5, MeteoroidSizeID::II},
+        {MeteoroidSizeID::IV,   "Size_IV",  0.86, 4, 5, MeteoroidSizeID::III},
+        {MeteoroidSizeID::V,    "Size_V",   1.72, 5, 5, MeteoroidSizeID::IV},
+        {MeteoroidSizeID::None, "Size_O",   0.0,  0, 0, MeteoroidSizeID::None},
+}};
+
+constexpr const GoldmannSizeInfo& size_info(MeteoroidSizeID id) {
+    return GOLDMANN_SIZES[static_cast<std::size_t>(id)];
+}
+
+// Projected disc of a size at a fixed viewing distance.
+struct ProjectedSize {
+    float radius_m;
+    float area_m2;   // A = π * r²
+};
+using ProjectedSizeTable = std::array<ProjectedSize, GOLDMANN_SIZE_COUNT + 1>;
+
+namespace goldmann_detail {
+// std::tan is not constexpr in C++17. The half angles are below one degree,
+// where this series is exact to float precision.
+constexpr double small_angle_tan(double x) {
+    double x2 = x * x;
+    return x * (1.0 + x2 * (1.0 / 3.0 + x2 * (2.0 / 15.0 + x2 * (17.0 / 315.0))));
+}
+}
+
+// r = tan(size / 2) * distance, evaluated once per viewing distance instead of
+// on every stimulus change.
+constexpr ProjectedSizeTable make_projected_sizes(double distance) {
+    ProjectedSizeTable table{};
+    for (std::size_t i = 0; i < table.size(); i++) {
+        double half_rad = GOLDMANN_SIZES[i].size_deg * M_PI / 360.0;
+        double radius_m = goldmann_detail::small_angle_tan(half_rad) * distance;
+        table[i] = {static_cast<float>(radius_m), static_cast<float>(radius_m * radius_m * M_PI)};
+    }
+    return table;
+}
@@ -0,0 +1,119 @@
+// GoldmannStimulus.h
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+// Goldmann luminance filters: coarse filter 1-4 (5 dB steps) combined with
+// fine filter a-e (1 dB steps) gives 20 stimuli, 1a (dimmest) .. 4e (0 dB).
+constexpr int GOLDMANN_STIMULUS_COUNT = 20;
+
+// One byte identifying a filter combination. Index 0 is "1a", 19 is "4e", so
+// the index order is the same as the string order used by the old exports.
+struct StimulusCode {
+    std::uint8_t index = 0;
+
+    constexpr int coarse() const { return 1 + index / 5; }          // 1..4
+    constexpr char fine() const { return static_cast<char>('a' + index % 5); } // a..e
+    constexpr int attenuation_db() const { return (4 - coarse()) * 5 + ('e' - fine()); }
+
+    static constexpr bool is_valid(char coarse, char fine) {
+        return coarse >= '1' && coarse <= '4' && fine >= 'a' && fine <= 'e';
+    }
+    static constexpr StimulusCode from_chars(char coarse, char fine) {
+        return is_valid(coarse, fine)
+               ? StimulusCode{static_cast<std::uint8_t>((coarse - '1') * 5 + (fine - 'a'))}
+               : throw std::invalid_argument("Invalid stimulus. Expected format like '3e'.");
+    }
+
+    constexpr bool operator==(StimulusCode other) const { return index == other.index; }
+    constexpr bool operator!=(StimulusCode other) const { return index != other.index; }
+    constexpr bool operator<(StimulusCode other) const { return index < other.index; }
+};
+
+// "3e"_stim
+constexpr StimulusCode operator""_stim(const char* id, std::size_t length) {
+    return length == 2 ? StimulusCode::from_chars(id[0], id[1])
+                       : throw std::invalid_argument("Invalid stimulus. Expected format like '3e'.");
+}
+
+struct StimulusInfo {
+    char name[3];               // "3e"
+    std::uint8_t attenuation_db;
+    float nits;                 // Stimulus intensity without background
+    std::array<float, 3> rgb;   // Gamma encoded colour on the headset
+};
+
+namespace goldmann_detail {
+// std::exp/std::log are not constexpr in C++17, the table is small enough to
+// evaluate these series at compile time.
+constexpr double LN_10 = 2.302585092994045684;
+
+constexpr double exp(double x) {
+    // e^x = (e^(x/2^k))^(2^k), keeps the Taylor argument small
+    int halvings = 0;
+    while (x > 0.5 || x < -0.5) {
+        x *= 0.5;
+        halvings++;
+    }
+    double term = 1.0;
+    double sum = 1.0;
+    for (int n = 1; n < 20; n++) {
+        term *= x / n;
+        sum += term;
+    }
+    for (int i = 0; i < halvings; i++) {
+        sum *= sum;
+    }
+    return sum;
+}
+
+constexpr double log(double x) {
+    // ln(x) = 2 * atanh((x - 1) / (x + 1)) after scaling x into [0.5, 2]
+    double result = 0.0;
+    while (x > 2.0) {
+        x *= 0.5;
+        result += 0.693147180559945309;
+    }
+    while (x < 0.5) {
+        x *= 2.0;
+        result -= 0.693147180559945309;
+    }
+    double y = (x - 1.0) / (x + 1.0);
+    double y2 = y * y;
+    double term = y;
+    double sum = 0.0;
+    for (int n = 1; n < 60; n += 2) {
+        sum += term / n;
+        term *= y2;
+    }
+    return result + 2.0 * sum;
+}
+}
+
+// Reference intensity for 4e (0 dB) is 315 cd/m^2 (nits), I = I_max * 10^(-dB / 10).
+// Colours are gamma encoded (1/2.2) relative to the headset maximum and
+// clipped to white where the headset cannot reach the target.
+constexpr std::array<StimulusInfo, GOLDMANN_STIMULUS_COUNT> make_stimulus_table(float background_nits, float max_headset_nits) {
+    std::array<StimulusInfo, GOLDMANN_STIMULUS_COUNT> table{};
+    for (int i = 0; i < GOLDMANN_STIMULUS_COUNT; i++) {
+        StimulusCode code{static_cast<std::uint8_t>(i)};
+        StimulusInfo& info = table[i];
+        info.name[0] = static_cast<char>('0' + code.coarse());
+        info.name[1] = code.fine();
+        info.name[2] = '\0';
+        info.attenuation_db = static_cast<std::uint8_t>(code.attenuation_db());
+        double nits = 315.0 * goldmann_detail::exp(-code.attenuation_db() / 10.0 * goldmann_detail::LN_10);
+        info.nits = static_cast<float>(nits);
+
+        double target = nits + background_nits;
+        float value = 1.0f;
+        if (target <= max_headset_nits) {
+            value = static_cast<float>(goldmann_detail::exp(goldmann_detail::log(target / max_headset_nits) / 2.2));
+        }
+        info.rgb = {value, value, value};
+    }
+    return table;
+}
@@ -0,0 +1,294 @@
+// IngestServer.cpp
+#include "IngestServer.h"
+#include "FileUtil.h"
+#include "PerimetryLog.h"
+#include "SessionFile.h"
+#include "SessionStore.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+constexpr int MAX_EVENTS = 64;
+constexpr std::size_t READ_CHUNK = 64 * 1024;
+// Per connection and wake-up, so one fast device cannot starve the others
+constexpr std::size_t READ_BUDGET = 4 << 20;
+
+std::uint32_t get_u32(const unsigned char* in) {
+    std::uint32_t value = 0;
+    for (int i = 0; i < 4; i++) value |= static_cast<std::uint32_t>(in[i]) << (8 * i);
+    return value;
+}
+}
+
+IngestServer::IngestServer(SessionStore& store) : m_store(store) {}
+
+IngestServer::~IngestServer() {
+    stop();
+    for (int fd : m_listeners) ::close(fd);
+}
+
+bool IngestServer::listen(const std::string& address) {
+    int fd = listen_upload_socket(address, &m_error);
+    if (fd < 0) return false;
+    m_listeners.push_back(fd);
+    return true;
+}
+
+bool IngestServer::start() {
+    if (m_thread.joinable()) return true;
+    if (m_listeners.empty()) {
+        m_error = "no listening address";
+        return false;
+    }
+    m_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+    m_wake = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_epoll < 0 || m_wake < 0) {
+        m_error = std::string("epoll: ") + std::strerror(errno);
+        return false;
+    }
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = m_wake;
+    ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wake, &ev);
+    for (int fd : m_listeners) {
+        ev.data.fd = fd;
+        ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev);
+    }
+    m_store.set_deferred_sync(true);
+    m_thread = std::thread(&IngestServer::run, this);
+    return true;
+}
+
+void IngestServer::stop() {
+    if (!m_thread.joinable()) return;
+    std::uint64_t one = 1;
+    if (::write(m_wake, &one, sizeof(one)) != sizeof(one)) LOGW("ingest: cannot wake the event loop");
+    m_thread.join();
+
+    for (auto& entry : m_connections) ::close(entry.first);
+    m_connections.clear();
+    ::close(m_wake);
+    ::close(m_epoll);
+    m_wake = m_epoll = -1;
+    m_store.set_deferred_sync(false);
+}
+
+void IngestServer::run() {
+    epoll_event events[MAX_EVENTS];
+    bool running = true;
+    while (running) {
+        int n = ::epoll_wait(m_epoll, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOGE("ingest: epoll_wait: %s", std::strerror(errno));
+            break;
+        }
+
+        m_batch_stored = false;
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == m_wake) {
+                running = false;
+                continue;
+            }
+            if (std::find(m_listeners.begin(), m_listeners.end(), fd) != m_listeners.end()) {
+                accept_all(fd);
+                continue;
+            }
+            auto it = m_connections.find(fd);
+            if (it == m_connections.end()) continue;
+            Connection& c = it->second;
+            if ((events[i].events & EPOLLOUT) && (!flush(c) || (c.eof && c.out.empty()))) {
+                close_connection(fd);
+                continue;
+            }
+            if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !read_all(c)) close_connection(fd);
+        }
+
+        // Group commit: one sync for every session of this round, then the
+        // acks. If the sync fails nothing is acked as stored, and the store
+        // has dropped the batch so the retries are not taken as duplicates.
+        if (m_batch.empty()) continue;
+        bool durable = true;
+        if (m_batch_stored) {
+            durable = m_store.sync();
+            m_stats.syncs++;
+            if (!durable) LOGE("ingest: %s", m_store.error().c_str());
+        }
+        for (int fd : m_batch) {
+            auto it = m_connections.find(fd);
+            if (it == m_connections.end()) continue;
+            Connection& c = it->second;
+            for (PendingAck& ack : c.acks) {
+                if (!durable && ack.status == UploadStatus::Stored) ack.status = UploadStatus::StoreFailed;
+                switch (ack.status) {
+                    case UploadStatus::Stored: m_stats.stored++; break;
+                    case UploadStatus::Duplicate: m_stats.duplicates++; break;
+                    case UploadStatus::Invalid: m_stats.invalid++; break;
+                    case UploadStatus::StoreFailed: m_stats.failed++; break;
+                }
+                c.out += encode_ack(ack.upload_id, ack.status, ack.eyes);
+            }
+            c.acks.clear();
+            if (!flush(c) || (c.eof && c.out.empty())) close_connection(fd);
+        }
+        m_batch.clear();
+    }
+}
+
+void IngestServer::accept_all(int listener) {
+    for (;;) {
+        int fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                LOGW("ingest: accept: %s", std::strerror(errno));
+            }
+            return;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (::epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            ::close(fd);
+            continue;
+        }
+        m_connections[fd].fd = fd;
+        m_stats.connections++;
+    }
+}
+
+bool IngestServer::read_all(Connection& c) {
+    std::size_t budget = READ_BUDGET;
+    while (budget > 0 && !c.eof) {
+        if (c.in.size() - c.in_bytes < READ_CHUNK) c.in.resize(c.in_bytes + READ_CHUNK);
+        ssize_t n = ::recv(c.fd, c.in.data() + c.in_bytes, c.in.size() - c.in_bytes, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        if (n == 0) {
+            // The device may half-close after its last frame, it still gets
+            // the acks of this batch
+            c.eof = true;
+            watch(c);
+            if (std::find(m_batch.begin(), m_batch.end(), c.fd) == m_batch.end()) m_batch.push_back(c.fd);
+            break;
+        }
+        c.in_bytes += static_cast<std::size_t>(n);
+        budget -= std::min(budget, static_cast<std::size_t>(n));
+        m_stats.bytes += static_cast<std::uint64_t>(n);
+
+        std::size_t pos = 0;
+        while (c.in_bytes - pos >= upload_protocol::HEADER_BYTES) {
+            UploadFrameHeader header;
+            if (!decode_upload_header(c.in.data() + pos, header)) {
+                m_stats.protocol_errors++;
+                return false;
+            }
+            std::size_t frame = upload_protocol::HEADER_BYTES + header.payload_bytes;
+            if (c.in_bytes - pos < frame) {
+                if (c.in.size() < pos + frame) c.in.resize(pos + frame);
+                break;
+            }
+            const unsigned char* payload = c.in.data() + pos + upload_protocol::HEADER_BYTES;
+            if (crc32(payload, header.payload_bytes) != header.crc || !handle_frame(c, header, payload)) {
+                m_stats.protocol_errors++;
+                return false;
+            }
+            pos += frame;
+        }
+        if (pos > 0) {
+            std::memmove(c.in.data(), c.in.data() + pos, c.in_bytes - pos);
+            c.in_bytes -= pos;
+        }
+    }
+    if (c.eof && c.in_bytes > 0) {
+        // Cut off inside a frame
+        m_stats.protocol_errors++;
+        return false;
+    }
+    return true;
+}
+
+bool IngestServer::handle_frame(Connection& c, const UploadFrameHeader& header, const unsigned char* payload) {
+    std::size_t size = header.payload_bytes;
+    if (header.type == UploadFrameType::Hello) {
+        if (c.hello || size < 8) return false;
+        c.hello = true;
+        LOGI("ingest: device %.*s connected", static_cast<int>(size - 8), payload + 8);
+        return true;
+    }
+    if (header.type != UploadFrameType::Session || !c.hello || size < upload_protocol::SESSION_PREFIX_BYTES) {
+        return false;
+    }
+    m_stats.sessions++;
+
+    PendingAck ack{get_u32(payload), UploadStatus::Invalid, 0};
+    std::uint32_t subject = get_u32(payload + 4);
+    const unsigned char* image = payload + upload_protocol::SESSION_PREFIX_BYTES;
+    std::size_t image_size = size - upload_protocol::SESSION_PREFIX_BYTES;
+    if (reinterpret_cast<std::uintptr_t>(image) % session_file::ALIGNMENT != 0) {
+        m_aligned.resize((image_size + 7) / 8);
+        std::memcpy(m_aligned.data(), image, image_size);
+        image = reinterpret_cast<const unsigned char*>(m_aligned.data());
+    }
+
+    SessionFileView file;
+    if (file.open_memory(image, image_size)) {
+        SessionFileAppend result = append_session_file(m_store, file, subject);
+        if (result.failed) {
+            LOGE("ingest: %s", m_store.error().c_str());
+            ack.status = UploadStatus::StoreFailed;
+        } else if (result.eyes > 0) {
+            ack.status = result.stored > 0 ? UploadStatus::Stored : UploadStatus::Duplicate;
+            ack.eyes = static_cast<std::uint8_t>(result.stored);
+        }
+        m_batch_stored = m_batch_stored || result.stored > 0;
+    }
+    if (c.acks.empty() && std::find(m_batch.begin(), m_batch.end(), c.fd) == m_batch.end()) m_batch.push_back(c.fd);
+    c.acks.push_back(ack);
+    return true;
+}
+
+bool IngestServer::flush(Connection& c) {
+    while (c.out_sent < c.out.size()) {
+        ssize_t n = ::send(c.fd, c.out.data() + c.out_sent, c.out.size() - c.out_sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        c.out_sent += static_cast<std::size_t>(n);
+    }
+    if (c.out_sent == c.out.size()) {
+        c.out.clear();
+        c.out_sent = 0;
+    }
+    if (c.writing != !c.out.empty()) watch(c);
+    return true;
+}
+
+void IngestServer::watch(Connection& c) {
+    // Level triggered: no EPOLLIN after the device closed its side, or the
+    // loop would wake for the end of file until the acks are out
+    c.writing = !c.out.empty();
+    epoll_event ev{};
+    ev.events = (c.eof ? 0u : static_cast<std::uint32_t>(EPOLLIN)) |
+                (c.writing ? static_cast<std::uint32_t>(EPOLLOUT) : 0u);
+    ev.data.fd = c.fd;
+    ::epoll_ctl(m_epoll, EPOLL_CTL_MOD, c.fd, &ev);
+}
+
+void IngestServer::close_connection(int fd) {
+    ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    m_connections.erase(fd);
+}
@@ -0,0 +1,90 @@
+// IngestServer.h
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "UploadProtocol.h"
+
+class SessionStore;
+
+struct IngestStats {
+    std::atomic<std::uint64_t> connections{0};
+    std::atomic<std::uint64_t> sessions{0};
+    std::atomic<std::uint64_t> stored{0};       // Sessions with at least one new eye
+    std::atomic<std::uint64_t> duplicates{0};
+    std::atomic<std::uint64_t> invalid{0};
+    std::atomic<std::uint64_t> failed{0};
+    std::atomic<std::uint64_t> protocol_errors{0}; // Connections closed on a malformed frame
+    std::atomic<std::uint64_t> syncs{0};        // Group commits
+    std::atomic<std::uint64_t> bytes{0};
+};
+
+// Receives session uploads (UploadProtocol.h) from any number of headsets
+// and stores them in a SessionStore.
+//
+// One thread runs an epoll loop over the listening sockets and all
+// connections, so the store has a single writer. Sessions are validated
+// (SessionFileView), deduplicated by the store, and written without a sync;
+// after each round of ready connections one fdatasync makes the whole batch
+// durable, and only then are the acks sent.
+class IngestServer {
+public:
+    explicit IngestServer(SessionStore& store);
+    ~IngestServer(); // stop()
+
+    IngestServer(const IngestServer&) = delete;
+    IngestServer& operator=(const IngestServer&) = delete;
+
+    // Adds a listening address, before start().
+    bool listen(const std::string& address);
+    bool start();
+    // Closes every connection; acks of the current batch are still sent.
+    void stop();
+
+    const IngestStats& stats() const { return m_stats; }
+    const std::string& error() const { return m_error; }
+
+private:
+    struct PendingAck {
+        std::uint32_t upload_id;
+        UploadStatus status;
+        std::uint8_t eyes;
+    };
+    struct Connection {
+        int fd = -1;
+        std::vector<unsigned char> in;
+        std::size_t in_bytes = 0;
+        std::string out;
+        std::size_t out_sent = 0;
+        bool hello = false;
+        bool eof = false;               // Half-closed by the device
+        bool writing = false;           // EPOLLOUT registered
+        std::vector<PendingAck> acks;   // Of the current batch
+    };
+
+    void run();
+    void accept_all(int listener);
+    bool read_all(Connection& c);
+    bool handle_frame(Connection& c, const UploadFrameHeader& header, const unsigned char* payload);
+    bool flush(Connection& c);
+    void watch(Connection& c);
+    void close_connection(int fd);
+
+    SessionStore& m_store;
+    std::vector<int> m_listeners;
+    int m_epoll = -1;
+    int m_wake = -1;                    // eventfd for stop()
+    std::unordered_map<int, Connection> m_connections;
+    std::vector<int> m_batch;           // Connections with acks in the current batch
+    bool m_batch_stored = false;        // The batch needs a sync
+    std::vector<std::uint64_t> m_aligned; // Session image copy, if the frame is not 8-byte aligned
+    std::thread m_thread;
+    IngestStats m_stats;
+    std::string m_error;
+};
@@ -0,0 +1,62 @@
+// IoWorker.cpp
+#include "IoWorker.h"
+
+#include <chrono>
+#include <utility>
+
+namespace {
+// Waits are timed so a lost notification only delays, never hangs
+constexpr std::chrono::milliseconds POLL_INTERVAL(100);
+}
+
+IoWorker::IoWorker() {
+    m_thread = std::thread(&IoWorker::run, this);
+}
+
+IoWorker::~IoWorker() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void IoWorker::post(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+    m_wake.notify_one();
+}
+
+void IoWorker::drain() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_idle.wait_for(lock, POLL_INTERVAL, [this] { return m_jobs.empty() && !m_busy; })) {
+    }
+}
+
+std::size_t IoWorker::pending() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_jobs.size() + (m_busy ? 1 : 0);
+}
+
+void IoWorker::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait_for(lock, POLL_INTERVAL, [this] { return m_stop || !m_jobs.empty(); });
+        if (m_jobs.empty()) {
+            if (m_stop) break;
+            continue;
+        }
+
+        std::function<void()> job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        m_busy = true;
+        lock.unlock();
+        job();
+        lock.lock();
+        m_busy = false;
+        m_idle.notify_all();
+    }
+}
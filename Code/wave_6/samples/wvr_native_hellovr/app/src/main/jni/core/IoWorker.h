@@ -0,0 +1,39 @@
+// IoWorker.h
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// One background thread for storage jobs (final sheet exports). post() only
+// takes a short lock to queue the job, the render thread never waits for the
+// job itself. Jobs run in the order they were posted.
+class IoWorker {
+public:
+    IoWorker();
+    ~IoWorker(); // Runs the remaining jobs, then stops
+
+    IoWorker(const IoWorker&) = delete;
+    IoWorker& operator=(const IoWorker&) = delete;
+
+    void post(std::function<void()> job);
+
+    // Blocks until every job posted so far has run.
+    void drain();
+
+    std::size_t pending() const;
+
+private:
+    void run();
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::deque<std::function<void()>> m_jobs;
+    bool m_busy = false;
+    bool m_stop = false;
+    std::thread m_thread;
+};
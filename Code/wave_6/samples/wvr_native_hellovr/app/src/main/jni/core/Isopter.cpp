@@ -0,0 +1,211 @@
+// Isopter.cpp
+#include "Isopter.h"
+#include "Longitude.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr double PERIOD_DEG = 360.0;
+constexpr double DEG_TO_RAD = M_PI / 180.0;
+
+// Longest row: a size name, a stimulus and four %g floats of at most 13
+// characters ("-1.23457e-05")
+constexpr std::size_t MAX_HEADER_CHARS = 64;
+constexpr std::size_t MAX_ROW_CHARS = 80;
+
+// Thomas algorithm on the tridiagonal part; a[i] below, b[i] on, c[i] above
+// the diagonal. rhs is overwritten with the solution, scratch holds n values.
+void solve_tridiagonal(const double* a, const double* b, const double* c, double* rhs, double* scratch,
+                       std::size_t n) {
+    double pivot = b[0];
+    rhs[0] /= pivot;
+    for (std::size_t i = 1; i < n; i++) {
+        scratch[i] = c[i - 1] / pivot;
+        pivot = b[i] - a[i] * scratch[i];
+        rhs[i] = (rhs[i] - a[i] * rhs[i - 1]) / pivot;
+    }
+    for (std::size_t i = n - 1; i > 0; i--) rhs[i - 1] -= scratch[i] * rhs[i];
+}
+}
+
+void fit_periodic_spline(const float* t, const float* r, std::size_t n, double period, std::vector<double>& m) {
+    m.assign(n, 0.0);
+    if (n < 3) return;
+
+    // Rows i of the cyclic system, indices modulo n:
+    //   h[i-1] M[i-1] + 2 (h[i-1] + h[i]) M[i] + h[i] M[i+1]
+    //     = 6 ((r[i+1] - r[i]) / h[i] - (r[i] - r[i-1]) / h[i-1])
+    std::vector<double> work(6 * n);
+    double* a = work.data();
+    double* b = a + n;
+    double* c = b + n;
+    double* z = c + n;
+    double* scratch = z + n;
+    double* h = scratch + n;
+    for (std::size_t i = 0; i < n; i++) {
+        double next = i + 1 < n ? t[i + 1] : t[0] + period;
+        h[i] = next - t[i];
+    }
+    for (std::size_t i = 0; i < n; i++) {
+        std::size_t prev = i == 0 ? n - 1 : i - 1;
+        std::size_t next = i + 1 == n ? 0 : i + 1;
+        a[i] = h[prev];
+        b[i] = 2.0 * (h[prev] + h[i]);
+        c[i] = h[i];
+        m[i] = 6.0 * ((r[next] - r[i]) / h[i] - (r[i] - r[prev]) / h[prev]);
+    }
+
+    // Sherman-Morrison: the corners a[0] and c[n-1] are moved into a rank-one
+    // update u v^T of a plain tridiagonal matrix
+    const double alpha = c[n - 1];
+    const double beta = a[0];
+    const double gamma = -b[0];
+    b[0] -= gamma;
+    b[n - 1] -= alpha * beta / gamma;
+    std::fill(z, z + n, 0.0);
+    z[0] = gamma;
+    z[n - 1] = alpha;
+    solve_tridiagonal(a, b, c, m.data(), scratch, n);
+    solve_tridiagonal(a, b, c, z, scratch, n);
+    const double fact = (m[0] + beta * m[n - 1] / gamma) / (1.0 + z[0] + beta * z[n - 1] / gamma);
+    for (std::size_t i = 0; i < n; i++) m[i] -= fact * z[i];
+}
+
+double evaluate_periodic_spline(const float* t, const float* r, const double* m, std::size_t n, double period,
+                                double angle) {
+    if (n == 0) return 0.0;
+    if (n < 3) return r[0];
+    double a = t[0] + std::fmod(angle - t[0], period);
+    if (a < t[0]) a += period;
+
+    // Interval [t[i], t[i+1]), the last one wraps to t[0] + period
+    std::size_t i = static_cast<std::size_t>(std::upper_bound(t, t + n, static_cast<float>(a)) - t);
+    i = i == 0 ? 0 : i - 1;
+    std::size_t next = i + 1 == n ? 0 : i + 1;
+    double t1 = i + 1 == n ? t[0] + period : t[i + 1];
+    double h = t1 - t[i];
+    double left = t1 - a;
+    double right = a - t[i];
+    return (m[i] * left * left * left + m[next] * right * right * right) / (6.0 * h) +
+           (r[i] / h - m[i] * h / 6.0) * left + (r[next] / h - m[next] * h / 6.0) * right;
+}
+
+void IsopterBuilder::add_point(int longitude, MeteoroidSizeID size, StimulusCode luminance, float phi,
+                               float theta) {
+    int size_index = static_cast<int>(size);
+    if (size_index < 0 || size_index >= GOLDMANN_SIZE_COUNT || luminance.index >= GOLDMANN_STIMULUS_COUNT) return;
+    if (!std::isfinite(phi) || !std::isfinite(theta)) return;
+    int key = (size_index * GOLDMANN_STIMULUS_COUNT + luminance.index) * 360 + normalize_angle(longitude);
+    m_samples.push_back({key, phi, theta});
+}
+
+void IsopterBuilder::add_sheet(const GoldmannSheet& sheet, int eye) {
+    sheet.for_each_entry(eye, [this](int longitude, MeteoroidSizeID size, StimulusCode luminance,
+                                     const SheetEntry&, GoldmannSheet::PointRange points) {
+        for (const PolarPoint& p : points) add_point(longitude, size, luminance, p.phi, p.theta);
+    });
+}
+
+void IsopterBuilder::build(std::vector<Isopter>& out) {
+    // A total order, so the sums (and the contours) do not depend on the
+    // order the points were added in
+    std::sort(m_samples.begin(), m_samples.end(), [](const Sample& l, const Sample& r) {
+        if (l.key != r.key) return l.key < r.key;
+        if (l.phi != r.phi) return l.phi < r.phi;
+        return l.theta < r.theta;
+    });
+
+    // Isopters of earlier builds are reused with their buffers
+    std::size_t used = 0;
+    Isopter* isopter = nullptr;
+    int stimulus = -1;
+    for (std::size_t first = 0; first < m_samples.size();) {
+        const int key = m_samples[first].key;
+        std::size_t last = first;
+        double sum_phi = 0.0;
+        double sum_theta = 0.0;
+        for (; last < m_samples.size() && m_samples[last].key == key; last++) {
+            sum_phi += m_samples[last].phi;
+            sum_theta += m_samples[last].theta;
+        }
+
+        if (key / 360 != stimulus) {
+            if (isopter) fit(*isopter);
+            stimulus = key / 360;
+            if (used == out.size()) out.emplace_back();
+            isopter = &out[used++];
+            isopter->size = static_cast<MeteoroidSizeID>(stimulus / GOLDMANN_STIMULUS_COUNT);
+            isopter->luminance = StimulusCode{static_cast<std::uint8_t>(stimulus % GOLDMANN_STIMULUS_COUNT)};
+            isopter->knot_longitude.clear();
+            isopter->knot_radius.clear();
+        }
+        double count = static_cast<double>(last - first);
+        isopter->knot_longitude.push_back(static_cast<float>(key % 360));
+        isopter->knot_radius.push_back(static_cast<float>(std::hypot(sum_phi / count, sum_theta / count)));
+        first = last;
+    }
+    if (isopter) fit(*isopter);
+    out.resize(used);
+    m_samples.clear();
+}
+
+void IsopterBuilder::fit(Isopter& isopter) {
+    isopter.angle.clear();
+    isopter.radius.clear();
+    isopter.x.clear();
+    isopter.y.clear();
+    const std::size_t n = isopter.knot_radius.size();
+    if (n < static_cast<std::size_t>(std::max(m_options.min_knots, 3)) || m_options.samples <= 0) return;
+
+    const float* t = isopter.knot_longitude.data();
+    const float* r = isopter.knot_radius.data();
+    fit_periodic_spline(t, r, n, PERIOD_DEG, m_second_derivatives);
+    const double step = PERIOD_DEG / m_options.samples;
+    for (int k = 0; k < m_options.samples; k++) {
+        double angle = k * step;
+        double radius = std::max(0.0, evaluate_periodic_spline(t, r, m_second_derivatives.data(), n, PERIOD_DEG,
+                                                               angle));
+        isopter.angle.push_back(static_cast<float>(angle));
+        isopter.radius.push_back(static_cast<float>(radius));
+        isopter.x.push_back(static_cast<float>(radius * std::cos(angle * DEG_TO_RAD)));
+        isopter.y.push_back(static_cast<float>(radius * std::sin(angle * DEG_TO_RAD)));
+    }
+}
+
+std::vector<Isopter> build_isopters(const GoldmannSheet& sheet, int eye, IsopterOptions options) {
+    IsopterBuilder builder(options);
+    builder.add_sheet(sheet, eye);
+    std::vector<Isopter> isopters;
+    builder.build(isopters);
+    return isopters;
+}
+
+std::size_t isopter_csv_capacity(const std::vector<Isopter>& isopters) {
+    std::size_t rows = 0;
+    for (const Isopter& isopter : isopters) rows += isopter.radius.size();
+    return MAX_HEADER_CHARS + rows * MAX_ROW_CHARS;
+}
+
+bool write_isopter_rows(const std::vector<Isopter>& isopters, FormatBuffer& out) {
+    IsopterSampleRow row;
+    for (const Isopter& isopter : isopters) {
+        row.size = isopter.size;
+        row.luminance = isopter.luminance;
+        for (std::size_t k = 0; k < isopter.radius.size(); k++) {
+            row.angle = isopter.angle[k];
+            row.radius = isopter.radius[k];
+            row.x = isopter.x[k];
+            row.y = isopter.y[k];
+            if (!write_csv_record(out, row)) return false;
+        }
+    }
+    return true;
+}
+
+std::string format_isopter_csv(const std::vector<Isopter>& isopters) {
+    FormatBuffer out(isopter_csv_capacity(isopters));
+    write_csv_header<IsopterSampleRow>(out);
+    write_isopter_rows(isopters, out);
+    return out.str();
+}
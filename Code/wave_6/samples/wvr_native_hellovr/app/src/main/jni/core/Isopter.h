@@ -0,0 +1,108 @@
+// Isopter.h
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "GoldmannSheet.h"
+#include "RecordSchema.h"
+
+// Isopters as drawn by Code/Analyisis/vis2.py, without scipy:
+//
+// The points of one stimulus are grouped by meridian, all repeats
+// (NUMBER_ITERATIONS_PER_SIZE per entry, or one journal row each) merged
+// into their mean (PHI|THETA). The knot of the meridian is its longitude
+// and the length of the mean point. A periodic cubic spline r(longitude)
+// through the knots (period 360°) is sampled into a closed contour,
+// x = r cos(longitude), y = r sin(longitude).
+struct IsopterOptions {
+    int samples = 360;      // Contour points, sample k at k * 360 / samples deg
+    int min_knots = 4;      // Fewer meridians with points give no contour
+};
+
+// One stimulus of one eye.
+struct Isopter {
+    MeteoroidSizeID size = MeteoroidSizeID::None;
+    StimulusCode luminance{};
+    std::vector<float> knot_longitude;  // Ascending, deg
+    std::vector<float> knot_radius;     // Eccentricity of the mean point, deg
+    // Closed contour (the last sample connects to the first), empty with
+    // fewer than min_knots knots. Radii below 0 (overshoot) are cut to 0.
+    std::vector<float> angle;
+    std::vector<float> radius;
+    std::vector<float> x;
+    std::vector<float> y;
+
+    bool has_contour() const { return !radius.empty(); }
+};
+
+// Second derivatives of the periodic cubic spline through (t[i], r[i]),
+// t ascending within one period. n >= 3; the cyclic tridiagonal system is
+// solved with Sherman-Morrison, O(n).
+void fit_periodic_spline(const float* t, const float* r, std::size_t n, double period, std::vector<double>& m);
+// The spline at angle (any value, taken modulo period).
+double evaluate_periodic_spline(const float* t, const float* r, const double* m, std::size_t n, double period,
+                                double angle);
+
+// Collects points of one eye and fits all its isopters. The buffers are
+// kept across build() calls, so a builder reused per worker thread stops
+// allocating after the first subjects.
+class IsopterBuilder {
+public:
+    explicit IsopterBuilder(IsopterOptions options = IsopterOptions()) : m_options(options) {}
+
+    void add_point(int longitude, MeteoroidSizeID size, StimulusCode luminance, float phi, float theta);
+    // Every point of the test plan entries of one eye.
+    void add_sheet(const GoldmannSheet& sheet, int eye);
+
+    // One isopter per stimulus with points, ordered by (size, luminance);
+    // clears the collected points.
+    void build(std::vector<Isopter>& out);
+    void clear() { m_samples.clear(); }
+
+private:
+    struct Sample {
+        int key;            // (size * GOLDMANN_STIMULUS_COUNT + luminance) * 360 + longitude
+        float phi;
+        float theta;
+    };
+
+    void fit(Isopter& isopter);
+
+    IsopterOptions m_options;
+    std::vector<Sample> m_samples;
+    std::vector<double> m_second_derivatives;
+};
+
+// Isopters of one eye of a sheet, as at the end of each eye in the app.
+std::vector<Isopter> build_isopters(const GoldmannSheet& sheet, int eye,
+                                    IsopterOptions options = IsopterOptions());
+
+// One contour point per row:
+// SizeIndex,Intensity,Angle,Radius,X,Y
+struct IsopterSampleRow {
+    MeteoroidSizeID size = MeteoroidSizeID::None;
+    StimulusCode luminance{};
+    float angle = 0.0f;
+    float radius = 0.0f;
+    float x = 0.0f;
+    float y = 0.0f;
+};
+
+template <>
+struct RecordSchema<IsopterSampleRow> {
+    static constexpr auto fields = std::make_tuple(
+            field("SizeIndex", &IsopterSampleRow::size),
+            field("Intensity", &IsopterSampleRow::luminance),
+            field("Angle", &IsopterSampleRow::angle),
+            field("Radius", &IsopterSampleRow::radius),
+            field("X", &IsopterSampleRow::x),
+            field("Y", &IsopterSampleRow::y));
+};
+
+std::size_t isopter_csv_capacity(const std::vector<Isopter>& isopters);
+// Rows of every contour, without the header. False if out is too small.
+bool write_isopter_rows(const std::vector<Isopter>& isopters, FormatBuffer& out);
+// Header and the contours of one eye.
+std::string format_isopter_csv(const std::vector<Isopter>& isopters);
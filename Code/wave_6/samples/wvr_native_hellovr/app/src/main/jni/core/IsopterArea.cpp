@@ -0,0 +1,137 @@
+// IsopterArea.cpp
+#include "IsopterArea.h"
+#include "NormativeModel.h"
+
+#include <algorithm>
+
+namespace {
+constexpr double DEG_TO_RAD = M_PI / 180.0;
+
+// 1 - cos(e) for a projected radius 90 sin(e), without cancellation for
+// small e: 1 - sqrt(1 - s^2) = s^2 / (1 + sqrt(1 - s^2))
+inline double cap_from_projected(double radius) {
+    double s = std::min(std::max(radius / 90.0, 0.0), 1.0);
+    double s2 = s * s;
+    return s2 / (1.0 + std::sqrt(1.0 - s2));
+}
+
+// 1 - cos(e) = 2 sin^2(e / 2)
+inline double cap_from_eccentricity(double eccentricity_deg) {
+    double half = std::sin(0.5 * eccentricity_deg * DEG_TO_RAD);
+    return 2.0 * half * half;
+}
+
+double overlap(double lo, double hi, double first, double last) {
+    return std::max(0.0, std::min(hi, last) - std::max(lo, first));
+}
+}
+
+double visual_eccentricity_deg(double projected_radius) {
+    return std::asin(std::min(std::max(projected_radius / 90.0, 0.0), 1.0)) / DEG_TO_RAD;
+}
+
+double visual_eccentricity_deg(float phi, float theta) {
+    return visual_eccentricity_deg(std::hypot(static_cast<double>(phi), static_cast<double>(theta)));
+}
+
+const char* quadrant_name(FieldQuadrant quadrant) {
+    switch (quadrant) {
+        case FieldQuadrant::SuperiorTemporal: return "superior_temporal";
+        case FieldQuadrant::SuperiorNasal: return "superior_nasal";
+        case FieldQuadrant::InferiorNasal: return "inferior_nasal";
+        case FieldQuadrant::InferiorTemporal: return "inferior_temporal";
+    }
+    return "";
+}
+
+FieldQuadrant field_quadrant(int eye, int longitude_quadrant) {
+    static constexpr FieldQuadrant RIGHT[FIELD_QUADRANT_COUNT] = {
+            FieldQuadrant::SuperiorTemporal, FieldQuadrant::SuperiorNasal, FieldQuadrant::InferiorNasal,
+            FieldQuadrant::InferiorTemporal};
+    static constexpr FieldQuadrant LEFT[FIELD_QUADRANT_COUNT] = {
+            FieldQuadrant::SuperiorNasal, FieldQuadrant::SuperiorTemporal, FieldQuadrant::InferiorTemporal,
+            FieldQuadrant::InferiorNasal};
+    int q = ((longitude_quadrant % FIELD_QUADRANT_COUNT) + FIELD_QUADRANT_COUNT) % FIELD_QUADRANT_COUNT;
+    return eye == 2 ? LEFT[q] : RIGHT[q];
+}
+
+IsopterAreaScorer::IsopterAreaScorer(int samples) : m_samples(std::max(samples, 1)) {
+    // Sample k stands for the meridians [k - 1/2, k + 1/2) * step; a sample
+    // on a quadrant border counts half to each side
+    const double step = 360.0 / m_samples;
+    m_angles.resize(m_samples);
+    for (auto& weights : m_weights) weights.assign(m_samples, 0.0);
+    for (int k = 0; k < m_samples; k++) {
+        m_angles[k] = static_cast<float>(k * step);
+        double lo = (k - 0.5) * step;
+        double hi = (k + 0.5) * step;
+        for (int q = 0; q < FIELD_QUADRANT_COUNT; q++) {
+            double share = 0.0;
+            for (double wrap : {-360.0, 0.0, 360.0}) share += overlap(lo, hi, 90.0 * q + wrap, 90.0 * (q + 1) + wrap);
+            m_weights[q][k] = share * DEG_TO_RAD;
+        }
+    }
+    m_cap.resize(m_samples);
+    m_normative_cap.resize(m_samples);
+}
+
+double IsopterAreaScorer::area_sr(const float* eccentricity_deg) const {
+    double area = 0.0;
+    for (int k = 0; k < m_samples; k++) {
+        double weight = 0.0;
+        for (int q = 0; q < FIELD_QUADRANT_COUNT; q++) weight += m_weights[q][k];
+        area += weight * cap_from_eccentricity(eccentricity_deg[k]);
+    }
+    return area;
+}
+
+const std::vector<float>& IsopterAreaScorer::normative(double age_years, int eye, int stimulus_row) {
+    auto key = std::make_tuple(age_years, eye, stimulus_row);
+    auto it = m_normative.find(key);
+    if (it != m_normative.end()) return it->second;
+    std::vector<float>& contour = m_normative[key];
+    contour.resize(m_samples);
+    evaluate_normative_contour(age_years, eye, stimulus_row, m_angles.data(), m_angles.size(), contour.data());
+    return contour;
+}
+
+bool IsopterAreaScorer::score(const Isopter& isopter, int eye, double age_years, IsopterArea& out) {
+    out = IsopterArea();
+    if (!isopter.has_contour() || isopter.radius.size() != static_cast<std::size_t>(m_samples)) return false;
+
+    // Caps of the measured contour, then one weighted sum per quadrant
+    const float* radius = isopter.radius.data();
+    double* cap = m_cap.data();
+    for (int k = 0; k < m_samples; k++) cap[k] = cap_from_projected(radius[k]);
+    std::array<double, FIELD_QUADRANT_COUNT> longitude_sr{};
+    for (int q = 0; q < FIELD_QUADRANT_COUNT; q++) {
+        const double* weight = m_weights[q].data();
+        double sum = 0.0;
+        for (int k = 0; k < m_samples; k++) sum += weight[k] * cap[k];
+        longitude_sr[q] = sum;
+    }
+    for (int q = 0; q < FIELD_QUADRANT_COUNT; q++) {
+        out.quadrant_sr[static_cast<int>(field_quadrant(eye, q))] = longitude_sr[q];
+        out.area_sr += longitude_sr[q];
+    }
+
+    int row = normative_stimulus_row(isopter.size, isopter.luminance);
+    if (row < 0 || (eye != 1 && eye != 2)) return true;
+    const float* expected = normative(age_years > 0.0 ? age_years : DEFAULT_PATIENT_AGE_YEARS, eye, row).data();
+    double* normative_cap = m_normative_cap.data();
+    for (int k = 0; k < m_samples; k++) normative_cap[k] = cap_from_eccentricity(expected[k]);
+    out.normative_sr = 0.0;
+    for (int q = 0; q < FIELD_QUADRANT_COUNT; q++) {
+        const double* weight = m_weights[q].data();
+        double normative_sum = 0.0;
+        double lost = 0.0;
+        for (int k = 0; k < m_samples; k++) {
+            normative_sum += weight[k] * normative_cap[k];
+            lost += weight[k] * std::max(0.0, normative_cap[k] - cap[k]);
+        }
+        out.normative_sr += normative_sum;
+        out.quadrant_lost_sr[static_cast<int>(field_quadrant(eye, q))] = lost;
+        out.lost_sr += lost;
+    }
+    return true;
+}
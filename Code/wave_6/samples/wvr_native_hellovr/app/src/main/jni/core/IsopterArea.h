@@ -0,0 +1,79 @@
+// IsopterArea.h
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include "Isopter.h"
+
+// Visual angles of sheet points. PerimetryEngine::_get_coordinates stores
+// the min-max normalized position on the bowl, not angles:
+//
+//   (PHI|THETA) = 90 sin(e) (cos m, sin m)
+//
+// with e the eccentricity from the fixation point and m the meridian, so
+// the length of a point (or an isopter radius) is 90 sin(e).
+double visual_eccentricity_deg(double projected_radius);
+double visual_eccentricity_deg(float phi, float theta);
+
+constexpr double SQUARE_DEGREES_PER_STERADIAN = (180.0 / M_PI) * (180.0 / M_PI);
+
+// Quadrants of the visual field. Longitude 90 is superior; 0 is temporal
+// for the right eye and nasal for the left eye (as in NormativeModel.h).
+enum class FieldQuadrant : std::uint8_t { SuperiorTemporal, SuperiorNasal, InferiorNasal, InferiorTemporal };
+constexpr int FIELD_QUADRANT_COUNT = 4;
+const char* quadrant_name(FieldQuadrant quadrant);
+// Eyes other than 2 are taken as right eyes.
+FieldQuadrant field_quadrant(int eye, int longitude_quadrant);
+
+// Solid angles (sr) of one isopter. The region inside an isopter is star
+// shaped around fixation, so its area is the integral of the spherical
+// caps over the meridians, A = integral of (1 - cos e(m)) dm.
+struct IsopterArea {
+    double area_sr = 0.0;
+    std::array<double, FIELD_QUADRANT_COUNT> quadrant_sr{};     // By FieldQuadrant
+    // Against the normative isopter of the patient's age; normative_sr is
+    // negative for stimuli outside NormativeModel
+    double normative_sr = -1.0;
+    double lost_sr = 0.0;       // Inside the normative isopter, outside the measured one
+    std::array<double, FIELD_QUADRANT_COUNT> quadrant_lost_sr{};
+
+    bool has_normative() const { return normative_sr >= 0.0; }
+    double area_deg2() const { return area_sr * SQUARE_DEGREES_PER_STERADIAN; }
+    double normative_deg2() const { return normative_sr * SQUARE_DEGREES_PER_STERADIAN; }
+    double lost_deg2() const { return lost_sr * SQUARE_DEGREES_PER_STERADIAN; }
+    double lost_fraction() const { return normative_sr > 0.0 ? lost_sr / normative_sr : 0.0; }
+};
+
+// Scores contours sampled on one grid (IsopterOptions::samples). The
+// quadrant weights of the grid are computed once; each isopter is then a
+// few dot products over its samples. Normative contours are cached by age,
+// eye and stimulus. One scorer per thread.
+class IsopterAreaScorer {
+public:
+    explicit IsopterAreaScorer(int samples = IsopterOptions().samples);
+
+    // False if the isopter has no contour or another sample count. Ages
+    // <= 0 use DEFAULT_PATIENT_AGE_YEARS.
+    bool score(const Isopter& isopter, int eye, double age_years, IsopterArea& out);
+
+    // Area of a contour given as eccentricities (deg) on the grid.
+    double area_sr(const float* eccentricity_deg) const;
+    int samples() const { return m_samples; }
+
+private:
+    const std::vector<float>& normative(double age_years, int eye, int stimulus_row);
+
+    int m_samples;
+    std::vector<float> m_angles;
+    // [longitude quadrant][sample] share of the sample's interval, in rad
+    std::array<std::vector<double>, FIELD_QUADRANT_COUNT> m_weights;
+    std::vector<double> m_cap;
+    std::vector<double> m_normative_cap;
+    std::map<std::tuple<double, int, int>, std::vector<float>> m_normative;
+};
@@ -0,0 +1,272 @@
+// IsopterStudy.cpp
+#include "IsopterStudy.h"
+#include "ChartRaster.h"
+#include "FileUtil.h"
+#include "ParallelFor.h"
+#include "SessionStore.h"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+void add_measurement_table(IsopterBuilder& builder, const MeasurementTable& table, int repeat) {
+    for (std::size_t row = 0; row < table.rows(); row++) {
+        std::uint32_t begin = table.point_begin[row];
+        std::uint32_t end = table.point_begin[row + 1];
+        if (repeat >= 0) {
+            if (begin + static_cast<std::uint32_t>(repeat) >= end) continue;
+            begin += static_cast<std::uint32_t>(repeat);
+            end = begin + 1;
+        }
+        for (std::uint32_t p = begin; p < end; p++) {
+            builder.add_point(table.longitude[row], table.size_id(row), table.stimulus(row), table.phi[p],
+                              table.theta[p]);
+        }
+    }
+}
+
+void add_session_sheet(IsopterBuilder& builder, const SessionFileView& file, int eye, int repeat) {
+    auto eyes = file.column<std::uint8_t>(SessionColumn::SheetEye);
+    auto longitudes = file.column<std::int16_t>(SessionColumn::SheetLongitude);
+    auto sizes = file.column<std::uint8_t>(SessionColumn::SheetSize);
+    auto luminances = file.column<std::uint8_t>(SessionColumn::SheetLuminance);
+    auto point_counts = file.column<std::uint8_t>(SessionColumn::SheetPointCount);
+    auto phis = file.column<float>(SessionColumn::SheetPointPhi);
+    auto thetas = file.column<float>(SessionColumn::SheetPointTheta);
+
+    std::size_t rows = std::min({eyes.size(), longitudes.size(), sizes.size(), luminances.size(),
+                                 point_counts.size()});
+    std::size_t points = std::min(phis.size(), thetas.size());
+    std::size_t point = 0;
+    for (std::size_t row = 0; row < rows; row++) {
+        std::size_t first = point;
+        point += point_counts[row];
+        if (eyes[row] != eye) continue;
+        if (sizes[row] >= GOLDMANN_SIZE_COUNT || luminances[row] >= GOLDMANN_STIMULUS_COUNT) continue;
+        std::size_t last = point;
+        if (repeat >= 0) {
+            if (first + static_cast<std::size_t>(repeat) >= last) continue;
+            first += static_cast<std::size_t>(repeat);
+            last = first + 1;
+        }
+        for (std::size_t i = first; i < last && i < points; i++) {
+            builder.add_point(longitudes[row], static_cast<MeteoroidSizeID>(sizes[row]), StimulusCode{luminances[row]},
+                              phis[i], thetas[i]);
+        }
+    }
+}
+
+bool build_study_isopters(const std::string& root, std::vector<StudyEyeIsopters>& out, IsopterOptions options,
+                          unsigned threads, StudyIsopterStats* stats, std::string* error) {
+    return build_study_repeats(root, out, 0, options, threads, stats, error);
+}
+
+bool build_study_repeats(const std::string& root, std::vector<StudyEyeIsopters>& out, int repeats,
+                         IsopterOptions options, unsigned threads, StudyIsopterStats* stats, std::string* error) {
+    StudyIsopterStats local;
+    StudyIsopterStats& s = stats ? *stats : local;
+    out.clear();
+    std::error_code ec;
+    if (!fs::is_directory(root, ec)) {
+        if (error) *error = root + " is not a directory";
+        return false;
+    }
+
+    std::vector<fs::path> files;
+    for (auto it = fs::recursive_directory_iterator(root, ec); !ec && it != fs::recursive_directory_iterator();
+         it.increment(ec)) {
+        if (!it->is_regular_file(ec)) continue;
+        if (it->path().extension() == ".csv" || it->path().extension() == ".pses") files.push_back(it->path());
+    }
+    if (ec) {
+        if (error) *error = root + ": " + ec.message();
+        return false;
+    }
+    std::sort(files.begin(), files.end());
+    s.files = files.size();
+
+    // One slot per file, filled by whichever worker takes it: one eye for a
+    // result sheet, up to two for a session, none for other files
+    std::vector<std::vector<StudyEyeIsopters>> results(files.size());
+    s.workers = parallel_workers(threads, files.size());
+    struct Worker {
+        MeasurementCsvReader reader;
+        MeasurementTable table;
+        MeasurementTable session_table;
+        IsopterBuilder builder;
+    };
+    std::vector<Worker> workers(s.workers);
+    for (Worker& worker : workers) worker.builder = IsopterBuilder(options);
+
+    parallel_for(files.size(), s.workers, [&](unsigned w, std::size_t index) {
+        Worker& worker = workers[w];
+        std::error_code relative_ec;
+        std::string file = fs::relative(files[index], root, relative_ec).generic_string();
+        if (files[index].extension() == ".pses") {
+            SessionFileView session;
+            if (!session.open(files[index].string())) return;
+            for (int eye = 1; eye <= 2; eye++) {
+                add_session_sheet(worker.builder, session, eye);
+                StudyEyeIsopters result;
+                worker.builder.build(result.isopters);
+                if (result.isopters.empty()) continue;
+                result.repeats.resize(static_cast<std::size_t>(std::max(repeats, 0)));
+                for (int repeat = 0; repeat < repeats; repeat++) {
+                    add_session_sheet(worker.builder, session, eye, repeat);
+                    worker.builder.build(result.repeats[repeat]);
+                }
+                result.file = file;
+                result.subject = static_cast<long>(session.header().patient_index);
+                result.eye = eye;
+                // Keyed like the final_*.csv the app writes next to it: the
+                // SubjectN of the folder, floats rounded as in the CSV
+                session_eye_table(session, eye, worker.session_table);
+                round_to_csv_digits(worker.session_table);
+                result.content_hash = measurement_content_hash(static_cast<std::uint32_t>(measurement_subject(file)),
+                                                               eye, worker.session_table);
+                results[index].push_back(std::move(result));
+            }
+            return;
+        }
+        if (!worker.reader.read(files[index].string(), worker.table) ||
+            worker.table.layout != MeasurementLayout::Sheet) {
+            return;
+        }
+        StudyEyeIsopters result;
+        result.file = file;
+        result.subject = measurement_subject(result.file);
+        std::string name = files[index].filename().string();
+        result.eye = name.find("Right") != std::string::npos ? 1 : (name.find("Left") != std::string::npos ? 2 : 0);
+        result.content_hash =
+                measurement_content_hash(static_cast<std::uint32_t>(result.subject), result.eye, worker.table);
+        add_measurement_table(worker.builder, worker.table);
+        worker.builder.build(result.isopters);
+        result.repeats.resize(static_cast<std::size_t>(std::max(repeats, 0)));
+        for (int repeat = 0; repeat < repeats; repeat++) {
+            add_measurement_table(worker.builder, worker.table, repeat);
+            worker.builder.build(result.repeats[repeat]);
+        }
+        results[index].push_back(std::move(result));
+    });
+
+    // Copies are dropped in the importer's order, out stays in path order
+    std::vector<std::size_t> copy_order(files.size());
+    for (std::size_t i = 0; i < files.size(); i++) copy_order[i] = i;
+    std::sort(copy_order.begin(), copy_order.end(), [&files](std::size_t a, std::size_t b) {
+        return measurement_copy_before(files[a].string(), files[b].string());
+    });
+    std::unordered_set<std::uint64_t> hashes;
+    std::vector<std::vector<bool>> duplicate(files.size());
+    for (std::size_t index : copy_order) {
+        for (const StudyEyeIsopters& eye : results[index]) {
+            duplicate[index].push_back(!hashes.insert(eye.content_hash).second);
+        }
+    }
+
+    for (std::size_t index = 0; index < results.size(); index++) {
+        std::vector<StudyEyeIsopters>& file_eyes = results[index];
+        if (file_eyes.empty()) {
+            s.skipped++;
+            continue;
+        }
+        for (std::size_t e = 0; e < file_eyes.size(); e++) {
+            StudyEyeIsopters& eye = file_eyes[e];
+            if (duplicate[index][e]) {
+                s.duplicates++;
+                continue;
+            }
+            for (const Isopter& isopter : eye.isopters) {
+                s.isopters++;
+                if (isopter.has_contour()) s.contours++;
+            }
+            out.push_back(std::move(eye));
+        }
+    }
+    s.sheets = out.size();
+
+    std::unordered_map<long, int> ages;
+    for (const SubjectAge& row : read_subject_ages((fs::path(root) / "subjects.csv").string())) {
+        ages[row.subject] = row.age_years;
+    }
+    for (StudyEyeIsopters& eye : out) {
+        auto age = ages.find(eye.subject);
+        if (age != ages.end()) eye.age_years = age->second;
+    }
+    return true;
+}
+
+void score_study_isopters(const std::vector<StudyEyeIsopters>& eyes, std::vector<std::vector<IsopterArea>>& out,
+                          int samples, unsigned threads) {
+    out.resize(eyes.size());
+    std::vector<IsopterAreaScorer> scorers(parallel_workers(threads, eyes.size()), IsopterAreaScorer(samples));
+    parallel_for(eyes.size(), threads, [&](unsigned worker, std::size_t index) {
+        const StudyEyeIsopters& eye = eyes[index];
+        out[index].resize(eye.isopters.size());
+        for (std::size_t i = 0; i < eye.isopters.size(); i++) {
+            scorers[worker].score(eye.isopters[i], eye.eye, eye.age_years, out[index][i]);
+        }
+    });
+}
+
+std::string study_chart_name(const StudyEyeIsopters& eye) {
+    fs::path path(eye.file);
+    std::string name = (path.parent_path() / path.stem()).generic_string();
+    std::replace(name.begin(), name.end(), '/', '_');
+    if (path.extension() == ".pses") name += eye.eye == 1 ? "_Right" : (eye.eye == 2 ? "_Left" : "");
+    return name;
+}
+
+bool render_study_charts(const std::vector<StudyEyeIsopters>& eyes, const std::string& out_dir,
+                         const StudyChartOptions& options, unsigned threads, StudyChartStats* stats,
+                         std::string* error) {
+    StudyChartStats local;
+    StudyChartStats& s = stats ? *stats : local;
+    s = StudyChartStats();
+    std::error_code ec;
+    fs::create_directories(out_dir, ec);
+    if (!fs::is_directory(out_dir, ec)) {
+        if (error) *error = "cannot create " + out_dir;
+        return false;
+    }
+
+    s.workers = parallel_workers(threads, eyes.size());
+    std::vector<ChartRasterizer> rasterizers(s.workers);
+    std::vector<RgbImage> images(s.workers);
+    std::atomic<std::size_t> files(0);
+    std::atomic<std::size_t> bytes(0);
+    std::mutex failed_mutex;
+    std::string failed;
+    auto write = [&](const std::string& path, const std::string& content) {
+        if (write_file_atomic(path, content)) {
+            files++;
+            bytes += content.size();
+            return;
+        }
+        std::lock_guard<std::mutex> lock(failed_mutex);
+        if (failed.empty()) failed = "cannot write " + path;
+    };
+
+    parallel_for(eyes.size(), s.workers, [&](unsigned worker, std::size_t index) {
+        const StudyEyeIsopters& eye = eyes[index];
+        ChartScene scene = build_field_chart(eye.isopters, eye.eye, eye.subject, eye.age_years, options.chart);
+        std::string path = (fs::path(out_dir) / study_chart_name(eye)).string();
+        if (options.svg) write(path + ".svg", format_chart_svg(scene));
+        if (options.png) {
+            rasterizers[worker].render(scene, images[worker]);
+            write(path + ".png", encode_png(images[worker]));
+        }
+    });
+    s.charts = eyes.size();
+    s.files = files;
+    s.bytes = bytes;
+    if (!failed.empty()) {
+        if (error) *error = failed;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,96 @@
+// IsopterStudy.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FieldChart.h"
+#include "Isopter.h"
+#include "IsopterArea.h"
+#include "MeasurementCsv.h"
+#include "SessionFile.h"
+
+// Isopters of one result sheet of a Measurements tree, or of one eye of a
+// session file.
+struct StudyEyeIsopters {
+    std::string file;       // Relative to the root
+    long subject = -1;      // SubjectN in the path (patient index of a session), -1 if there is none
+    int eye = 0;            // 1 right, 2 left (from the file name or session), 0 unknown
+    int age_years = 0;      // From ROOT/subjects.csv, 0 unknown
+    // measurement_content_hash() with the SubjectN of the path, at CSV
+    // precision: the same for copies and for a session and its final_*.csv
+    std::uint64_t content_hash = 0;
+    std::vector<Isopter> isopters;
+    // With build_study_repeats(): [repeat][isopter], the isopters of each
+    // repeat of the test plan entries on its own
+    std::vector<std::vector<Isopter>> repeats;
+};
+
+struct StudyIsopterStats {
+    std::size_t files = 0;      // *.csv and *.pses under the root
+    std::size_t sheets = 0;     // Result sheets and session eyes, in out
+    std::size_t skipped = 0;    // Journals, other CSVs, unreadable files
+    std::size_t duplicates = 0; // Copies of a sheet already in out
+    std::size_t isopters = 0;
+    std::size_t contours = 0;   // Isopters with enough knots for a contour
+    unsigned workers = 0;
+};
+
+// Fits the isopters of every result sheet under root (journals are
+// skipped, they repeat the points of their sheet) and of both eyes of
+// every session file (.pses). Copies of a measurement (Right.csv next to
+// its dated original) count once, as in import_measurement_tree(): the
+// copy first in measurement_copy_before() order is kept. The files are spread
+// over threads workers (0: one per core), each with its own reader and
+// builder. out is in path order whatever the thread count. The ages of an
+// optional ROOT/subjects.csv (Subject,Age) are filled in.
+bool build_study_isopters(const std::string& root, std::vector<StudyEyeIsopters>& out,
+                          IsopterOptions options = IsopterOptions(), unsigned threads = 0,
+                          StudyIsopterStats* stats = nullptr, std::string* error = nullptr);
+// As build_study_isopters(), and fits repeats 0 .. repeats - 1 of every
+// entry alone into StudyEyeIsopters::repeats, for test-retest statistics
+// (StudyStatistics.h). A repeat is the n-th point of a sheet row.
+bool build_study_repeats(const std::string& root, std::vector<StudyEyeIsopters>& out,
+                         int repeats = NUMBER_ITERATIONS_PER_SIZE, IsopterOptions options = IsopterOptions(),
+                         unsigned threads = 0, StudyIsopterStats* stats = nullptr, std::string* error = nullptr);
+
+// Adds every point of a table (a sheet or a journal) to builder, or with
+// repeat >= 0 only the repeat-th point of each row.
+void add_measurement_table(IsopterBuilder& builder, const MeasurementTable& table, int repeat = -1);
+// Adds the points of the final sheet of one eye of a session file, or
+// only the repeat-th point of each entry.
+void add_session_sheet(IsopterBuilder& builder, const SessionFileView& file, int eye, int repeat = -1);
+
+// Areas of every isopter of a study, out[i][j] for eyes[i].isopters[j]
+// (empty areas for isopters without a contour), against the normative
+// isopters at the age of each subject. Eyes are spread over threads
+// workers like build_study_isopters().
+void score_study_isopters(const std::vector<StudyEyeIsopters>& eyes, std::vector<std::vector<IsopterArea>>& out,
+                          int samples = IsopterOptions().samples, unsigned threads = 0);
+
+struct StudyChartOptions {
+    FieldChartOptions chart;
+    bool svg = true;
+    bool png = true;
+};
+
+struct StudyChartStats {
+    std::size_t charts = 0;     // Eyes drawn
+    std::size_t files = 0;      // Written
+    std::size_t bytes = 0;
+    unsigned workers = 0;
+};
+
+// File name of the chart of an eye, without extension: the relative path
+// with '/' as '_', plus _Right or _Left for session files.
+std::string study_chart_name(const StudyEyeIsopters& eye);
+
+// Draws the chart of every eye (with the normative isopters of the
+// subject's age) into out_dir as study_chart_name().svg and .png. The eyes
+// are spread over threads workers, each with its own rasterizer. False
+// (with error) if out_dir cannot be created or a file cannot be written.
+bool render_study_charts(const std::vector<StudyEyeIsopters>& eyes, const std::string& out_dir,
+                         const StudyChartOptions& options = StudyChartOptions(), unsigned threads = 0,
+                         StudyChartStats* stats = nullptr, std::string* error = nullptr);
@@ -0,0 +1,197 @@
+// JournalWriter.cpp
+#include "JournalWriter.h"
+#include "FileUtil.h"
+#include "PerimetryLog.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+// A full queue of lines; a buffer that still overflows is written early
+constexpr std::size_t LINE_BUFFER_SIZE = JournalWriter::QUEUE_CAPACITY * 64;
+
+int eye_slot(int eye) {
+    return (eye == 1 || eye == 2) ? eye - 1 : -1;
+}
+}
+
+JournalRecord JournalRecord::from_detection(const DetectedPoint& point) {
+    JournalRecord record;
+    record.p = std::get<0>(point);
+    record.size = std::get<1>(point);
+    record.longitude = std::get<2>(point);
+    record.eye = std::get<3>(point);
+    record.luminance = std::get<4>(point);
+    return record;
+}
+
+const std::string JournalWriter::HEADER = csv_header<JournalRecord>();
+
+std::string format_journal_line(const JournalRecord& record) {
+    FormatBuffer line(96);
+    write_csv_record(line, record);
+    return line.str();
+}
+
+JournalWriter::JournalWriter(std::chrono::milliseconds sync_interval, std::size_t sync_batch)
+        : m_sync_interval(sync_interval),
+          m_sync_batch(sync_batch > 0 ? sync_batch : 1) {
+    m_thread = std::thread(&JournalWriter::run, this);
+}
+
+JournalWriter::~JournalWriter() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    if (m_thread.joinable()) m_thread.join();
+    close_files();
+}
+
+bool JournalWriter::open_session(const std::string& right_path, const std::string& left_path) {
+    flush();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    close_files();
+    const std::string* paths[2] = {&right_path, &left_path};
+    bool ok = true;
+    for (int i = 0; i < 2; i++) {
+        int fd = ::open(paths[i]->c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            LOGE("Journal: cannot open %s: %s", paths[i]->c_str(), std::strerror(errno));
+            ok = false;
+            continue;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size == 0) {
+            write_all(fd, HEADER.data(), HEADER.size());
+        }
+        m_fd[i] = fd;
+    }
+    return ok;
+}
+
+void JournalWriter::close_session() {
+    flush();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    close_files();
+}
+
+bool JournalWriter::append(const JournalRecord& record) {
+    if (!m_queue.push(record)) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    m_appended.fetch_add(1, std::memory_order_release);
+    m_wake.notify_one();
+    return true;
+}
+
+void JournalWriter::flush() {
+    std::uint64_t target = m_appended.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_processed >= target) return;
+    m_flush_requested = true;
+    m_wake.notify_one();
+    // Timed like the worker, every round re-checks the counters
+    while (!m_done.wait_for(lock, m_sync_interval, [this, target] { return m_processed >= target; })) {
+        m_flush_requested = true;
+        m_wake.notify_one();
+    }
+}
+
+std::uint64_t JournalWriter::synced() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_synced;
+}
+
+std::uint64_t JournalWriter::failed() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_failed;
+}
+
+void JournalWriter::close_files() {
+    for (int& fd : m_fd) {
+        if (fd >= 0) {
+            ::fsync(fd);
+            ::close(fd);
+        }
+        fd = -1;
+    }
+}
+
+void JournalWriter::run() {
+    FormatBuffer lines[2] = {FormatBuffer(LINE_BUFFER_SIZE), FormatBuffer(LINE_BUFFER_SIZE)};
+    std::uint64_t line_count[2] = {0, 0};
+    std::uint64_t unsynced = 0;
+    auto last_sync = std::chrono::steady_clock::now();
+
+    auto write_lines = [&](int i) {
+        if (lines[i].empty()) return;
+        if (write_all(m_fd[i], lines[i].data(), lines[i].size())) {
+            unsynced += line_count[i];
+        } else {
+            LOGE("Journal: write failed: %s", std::strerror(errno));
+            m_failed += line_count[i];
+            m_processed += line_count[i];
+        }
+        lines[i].clear();
+        line_count[i] = 0;
+    };
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        // append() notifies without the lock, a missed wake up only delays
+        // the batch until the timeout
+        m_wake.wait_for(lock, m_sync_interval, [this] {
+            return m_stop || m_flush_requested || !m_queue.empty();
+        });
+
+        JournalRecord record;
+        while (m_queue.pop(record)) {
+            int slot = eye_slot(record.eye);
+            if (slot < 0 || m_fd[slot] < 0) {
+                m_failed++;
+                m_processed++;
+                continue;
+            }
+            if (!write_csv_record(lines[slot], record)) {
+                write_lines(slot);
+                write_csv_record(lines[slot], record);
+            }
+            line_count[slot]++;
+        }
+
+        for (int i = 0; i < 2; i++) write_lines(i);
+
+        auto now = std::chrono::steady_clock::now();
+        bool sync_due = m_flush_requested || m_stop || unsynced >= m_sync_batch ||
+                        now - last_sync >= m_sync_interval;
+        if (unsynced > 0 && sync_due) {
+            bool ok = true;
+            for (int fd : m_fd) {
+                if (fd >= 0 && ::fsync(fd) != 0) ok = false;
+            }
+            if (ok) {
+                m_synced += unsynced;
+            } else {
+                LOGE("Journal: fsync failed: %s", std::strerror(errno));
+                m_failed += unsynced;
+            }
+            m_processed += unsynced;
+            unsynced = 0;
+            last_sync = now;
+        }
+        if (unsynced == 0) {
+            m_flush_requested = false;
+            m_done.notify_all();
+        }
+
+        if (m_stop && unsynced == 0 && m_queue.empty()) break;
+    }
+}
@@ -0,0 +1,99 @@
+// JournalWriter.h
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "PerimetryEngine.h"
+#include "RecordSchema.h"
+#include "SpscQueue.h"
+
+// One detected point, as appended to the running CSV of its eye.
+struct JournalRecord {
+    int eye = 0;                // 1 right, 2 left
+    int longitude = 0;
+    MeteoroidSizeID size = MeteoroidSizeID::None;
+    StimulusCode luminance{};
+    PolarPoint p{0.0f, 0.0f};
+
+    static JournalRecord from_detection(const DetectedPoint& point);
+};
+
+// The eye is not a column, each eye has its own journal. The header keeps
+// the "(PHI|THETA)" spelling of the files already on the devices.
+template <>
+struct RecordSchema<JournalRecord> {
+    static constexpr auto fields = std::make_tuple(
+            field("Longitude", &JournalRecord::longitude),
+            field("SizeIndex", &JournalRecord::size),
+            field("Luminance", &JournalRecord::luminance),
+            field("Points[(PHI|THETA)]", &JournalRecord::p));
+};
+
+// Formats a record as one CSV line of the running journal (with '\n').
+std::string format_journal_line(const JournalRecord& record);
+
+// Running per-point journal of a session. The render thread appends records
+// to a bounded SPSC queue and never touches the file system; one long lived
+// worker thread formats them into two preallocated buffers, appends those to
+// the open journal files and fsyncs in batches, at the latest sync_interval
+// after a record was appended.
+class JournalWriter {
+public:
+    static constexpr std::size_t QUEUE_CAPACITY = 256;
+    static const std::string HEADER; // csv_header<JournalRecord>()
+
+    explicit JournalWriter(std::chrono::milliseconds sync_interval = std::chrono::milliseconds(500),
+                           std::size_t sync_batch = 32);
+    ~JournalWriter(); // Syncs everything queued, then stops the worker
+
+    JournalWriter(const JournalWriter&) = delete;
+    JournalWriter& operator=(const JournalWriter&) = delete;
+
+    // Once per session: syncs the previous session, then opens (appends to)
+    // both journals and writes the header into new files. Blocks on I/O,
+    // call it from menus, not while stimuli are running.
+    bool open_session(const std::string& right_path, const std::string& left_path);
+    void close_session();
+
+    // Render thread. Never blocks; false if the queue is full and the record
+    // was dropped.
+    bool append(const JournalRecord& record);
+
+    // Blocks until every record appended so far is written and synced.
+    void flush();
+
+    std::uint64_t appended() const { return m_appended.load(std::memory_order_relaxed); }
+    std::uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+    std::uint64_t synced() const;
+    std::uint64_t failed() const;   // Records without open journal or with a write error
+
+private:
+    void run();
+    void close_files();
+
+    const std::chrono::milliseconds m_sync_interval;
+    const std::size_t m_sync_batch;
+
+    SpscQueue<JournalRecord, QUEUE_CAPACITY> m_queue;
+    std::atomic<std::uint64_t> m_appended{0};
+    std::atomic<std::uint64_t> m_dropped{0};
+
+    // Everything below is guarded by m_mutex
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;     // Worker: new records, flush or stop
+    std::condition_variable m_done;     // flush(): records processed
+    int m_fd[2] = {-1, -1};             // [0] right, [1] left
+    std::uint64_t m_processed = 0;      // Synced or failed
+    std::uint64_t m_synced = 0;
+    std::uint64_t m_failed = 0;
+    bool m_flush_requested = false;
+    bool m_stop = false;
+
+    std::thread m_thread;
+};
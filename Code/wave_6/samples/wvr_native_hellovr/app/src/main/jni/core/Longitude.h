@@ -0,0 +1,9 @@
+// Longitude.h
+#pragma once
+
+// Meridian of a stimulus vector in [0, 360). The protocol and the exports
+// may give the same meridian as -90 or 270; tables are keyed by this.
+inline int normalize_angle(int longitude) {
+    int angle = longitude % 360;
+    return angle < 0 ? angle + 360 : angle;
+}
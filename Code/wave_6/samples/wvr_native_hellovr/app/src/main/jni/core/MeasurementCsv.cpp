@@ -0,0 +1,336 @@
+// MeasurementCsv.cpp
+#include "MeasurementCsv.h"
+#include "JournalWriter.h"
+#include "SheetExport.h"
+
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+// The headers the writers generate from their schemas, without '\n'
+template <typename Record>
+std::string header_line() {
+    std::string header = csv_header<Record>();
+    if (!header.empty()) header.pop_back();
+    return header;
+}
+
+const std::string SHEET_HEADER = header_line<SheetRow>();
+const std::string JOURNAL_HEADER = header_line<JournalRecord>();
+
+constexpr double POW10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// Cursor over the file image; every parse_* advances p past what it read
+struct Cursor {
+    const char* p;
+    const char* end;
+
+    bool eat(char c) {
+        if (p == end || *p != c) return false;
+        p++;
+        return true;
+    }
+    bool at_line_end() const { return p == end || *p == '\n' || *p == '\r'; }
+};
+
+bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+bool parse_int(Cursor& in, int& value) {
+    bool negative = in.eat('-');
+    if (in.p == in.end || !is_digit(*in.p)) return false;
+    long result = 0;
+    while (in.p != in.end && is_digit(*in.p)) {
+        result = result * 10 + (*in.p++ - '0');
+        if (result > 100000) return false;
+    }
+    value = static_cast<int>(negative ? -result : result);
+    return true;
+}
+
+bool match_word(Cursor& in, const char* word) {
+    std::size_t length = std::strlen(word);
+    if (static_cast<std::size_t>(in.end - in.p) < length || std::memcmp(in.p, word, length) != 0) return false;
+    in.p += length;
+    return true;
+}
+
+// What std::ostream writes for a float (%g: 6 significant digits, exponent
+// for small and large values, nan, inf). Mantissa and power of ten are
+// combined in double, exact for the digits the app writes.
+bool parse_float(Cursor& in, float& value) {
+    bool negative = in.eat('-');
+    if (!negative) in.eat('+');
+    if (match_word(in, "nan")) {
+        value = std::numeric_limits<float>::quiet_NaN();
+        return true;
+    }
+    if (match_word(in, "inf")) {
+        value = negative ? -std::numeric_limits<float>::infinity() : std::numeric_limits<float>::infinity();
+        return true;
+    }
+
+    std::uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    bool any = false;
+    while (in.p != in.end && is_digit(*in.p)) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + static_cast<std::uint64_t>(*in.p - '0');
+            if (mantissa) digits++;
+        } else {
+            exponent++;
+        }
+        in.p++;
+        any = true;
+    }
+    if (in.eat('.')) {
+        while (in.p != in.end && is_digit(*in.p)) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + static_cast<std::uint64_t>(*in.p - '0');
+                if (mantissa) digits++;
+                exponent--;
+            }
+            in.p++;
+            any = true;
+        }
+    }
+    if (!any) return false;
+    if (in.p != in.end && (*in.p == 'e' || *in.p == 'E')) {
+        in.p++;
+        int e = 0;
+        if (!parse_int(in, e)) return false;
+        exponent += e;
+    }
+
+    double result = static_cast<double>(mantissa);
+    if (exponent >= 0 && exponent <= 22) {
+        result *= POW10[exponent];
+    } else if (exponent < 0 && exponent >= -22) {
+        result /= POW10[-exponent];
+    } else {
+        result *= std::pow(10.0, exponent);
+    }
+    value = static_cast<float>(negative ? -result : result);
+    return true;
+}
+
+// Size_I .. Size_V, Size_O for MeteoroidSizeID::None
+bool parse_size(Cursor& in, std::uint8_t& size) {
+    if (!match_word(in, "Size_")) return false;
+    const char* start = in.p;
+    while (in.p != in.end && (*in.p == 'I' || *in.p == 'V' || *in.p == 'O')) in.p++;
+    std::size_t length = static_cast<std::size_t>(in.p - start);
+    for (std::size_t id = 0; id < GOLDMANN_SIZES.size(); id++) {
+        const char* roman = GOLDMANN_SIZES[id].name + 5;
+        if (std::strlen(roman) == length && std::memcmp(roman, start, length) == 0) {
+            size = static_cast<std::uint8_t>(id);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parse_stimulus(Cursor& in, std::uint8_t& luminance) {
+    if (in.end - in.p < 2 || !StimulusCode::is_valid(in.p[0], in.p[1])) return false;
+    luminance = StimulusCode::from_chars(in.p[0], in.p[1]).index;
+    in.p += 2;
+    return true;
+}
+
+void skip_line_end(Cursor& in) {
+    in.eat('\r');
+    in.eat('\n');
+}
+}
+
+void MeasurementTable::clear() {
+    longitude.clear();
+    size.clear();
+    luminance.clear();
+    normed_value.clear();
+    point_begin.clear();
+    phi.clear();
+    theta.clear();
+}
+
+bool parse_measurement_csv(const char* data, std::size_t size, MeasurementTable& out, std::string* error) {
+    out.clear();
+    out.point_begin.push_back(0);
+    Cursor in{data, data + size};
+    int line = 1;
+    auto fail = [error, &line](const char* what) {
+        if (error) *error = "line " + std::to_string(line) + ": " + what;
+        return false;
+    };
+
+    // Optional UTF-8 byte order mark, then one of the two headers
+    match_word(in, "\xEF\xBB\xBF");
+    if (match_word(in, SHEET_HEADER.c_str())) {
+        out.layout = MeasurementLayout::Sheet;
+    } else if (match_word(in, JOURNAL_HEADER.c_str())) {
+        out.layout = MeasurementLayout::Journal;
+    } else {
+        return fail("unknown header");
+    }
+    if (!in.at_line_end()) return fail("unknown header");
+    skip_line_end(in);
+    const bool sheet = out.layout == MeasurementLayout::Sheet;
+
+    while (in.p != in.end) {
+        line++;
+        if (in.at_line_end()) {
+            skip_line_end(in);
+            continue;
+        }
+
+        int longitude = 0;
+        std::uint8_t size_id = 0;
+        std::uint8_t luminance = 0;
+        if (!parse_int(in, longitude) || !in.eat(',')) return fail("expected longitude");
+        if (!parse_size(in, size_id) || !in.eat(',')) return fail("expected size (Size_I .. Size_V)");
+        if (!parse_stimulus(in, luminance) || !in.eat(',')) return fail("expected stimulus (1a .. 4e)");
+
+        if (!in.eat('[')) return fail("expected '[' before the points");
+        while (!in.eat(']')) {
+            float phi = 0.0f;
+            float theta = 0.0f;
+            if (!in.eat('(') || !parse_float(in, phi) || !in.eat('|') || !parse_float(in, theta) ||
+                !in.eat(')') || !in.eat(';')) {
+                return fail("expected point (PHI|THETA);");
+            }
+            out.phi.push_back(phi);
+            out.theta.push_back(theta);
+        }
+
+        float normed = std::numeric_limits<float>::quiet_NaN();
+        if (sheet && (!in.eat(',') || !parse_float(in, normed))) return fail("expected NormedValue");
+        if (!in.at_line_end()) return fail("unexpected text after the row");
+        skip_line_end(in);
+
+        out.longitude.push_back(static_cast<std::int16_t>(longitude));
+        out.size.push_back(size_id);
+        out.luminance.push_back(luminance);
+        out.normed_value.push_back(normed);
+        out.point_begin.push_back(static_cast<std::uint32_t>(out.phi.size()));
+    }
+    return true;
+}
+
+void round_to_csv_digits(MeasurementTable& table) {
+    char text[32];
+    for (std::vector<float>* column : {&table.normed_value, &table.phi, &table.theta}) {
+        for (float& value : *column) {
+            std::to_chars_result written = std::to_chars(text, text + sizeof(text), value,
+                                                         std::chars_format::general, 6);
+            Cursor in{text, written.ptr};
+            parse_float(in, value);
+        }
+    }
+}
+
+long measurement_subject(const std::string& relative_path) {
+    std::size_t start = 0;
+    while (start <= relative_path.size()) {
+        std::size_t end = relative_path.find('/', start);
+        if (end == std::string::npos) end = relative_path.size();
+        std::string part = relative_path.substr(start, end - start);
+        if (part.rfind("Subject", 0) == 0 && part.size() > 7) {
+            char* last = nullptr;
+            long subject = std::strtol(part.c_str() + 7, &last, 10);
+            if (*last == '\0' && subject >= 0) return subject;
+        }
+        start = end + 1;
+    }
+    return -1;
+}
+
+std::vector<SubjectAge> read_subject_ages(const std::string& path) {
+    std::vector<SubjectAge> ages;
+    std::ifstream in(path);
+    if (!in) return ages;
+    std::string line;
+    std::getline(in, line); // Header
+    while (std::getline(in, line)) {
+        std::string::size_type comma = line.find(',');
+        if (comma == std::string::npos) continue;
+        std::string subject = line.substr(0, comma);
+        if (subject.rfind("Subject", 0) == 0) subject = subject.substr(7);
+        char* end = nullptr;
+        long id = std::strtol(subject.c_str(), &end, 10);
+        long age = std::strtol(line.c_str() + comma + 1, nullptr, 10);
+        if (end == subject.c_str() || id < 0) continue;
+        ages.push_back({id, static_cast<int>(age)});
+    }
+    return ages;
+}
+
+std::vector<SubjectGroup> read_subject_groups(const std::string& path) {
+    std::vector<SubjectGroup> groups;
+    std::ifstream in(path);
+    if (!in) return groups;
+    std::string line;
+    std::getline(in, line); // Header
+    while (std::getline(in, line)) {
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.pop_back();
+        std::string::size_type comma = line.find(',');
+        if (comma == std::string::npos || comma + 1 == line.size()) continue;
+        std::string subject = line.substr(0, comma);
+        if (subject.rfind("Subject", 0) == 0) subject = subject.substr(7);
+        char* end = nullptr;
+        long id = std::strtol(subject.c_str(), &end, 10);
+        if (end == subject.c_str() || id < 0) continue;
+        groups.push_back({id, line.substr(comma + 1)});
+    }
+    return groups;
+}
+
+bool MeasurementCsvReader::read(const std::string& path, MeasurementTable& out) {
+    m_error.clear();
+    out.clear();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        m_error = path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        m_error = path + ": " + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+
+    std::size_t size = static_cast<std::size_t>(st.st_size);
+    if (m_buffer.size() < size) m_buffer.resize(size);
+    std::size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::read(fd, m_buffer.data() + done, size - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += static_cast<std::size_t>(n);
+    }
+    ::close(fd);
+    if (done != size) {
+        m_error = path + ": short read";
+        return false;
+    }
+    m_bytes_read += size;
+
+    std::string error;
+    if (!parse_measurement_csv(m_buffer.data(), size, out, &error)) {
+        m_error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,84 @@
+// MeasurementCsv.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "GoldmannSizes.h"
+#include "GoldmannStimulus.h"
+
+// The two CSV dialects the app writes into Measurements/:
+//   Sheet:   Longitude,SizeIndex,Intensity,Points[(PHI,THETA)],NormedValue
+//            (final_*.csv, Right.csv, Left.csv; see SheetExport.h)
+//   Journal: Longitude,SizeIndex,Luminance,Points[(PHI|THETA)]
+//            (current_*.csv, one point per row; see JournalWriter.h)
+enum class MeasurementLayout : std::uint8_t { Sheet, Journal };
+
+// Struct-of-arrays image of one file. Row r owns the points
+// [point_begin[r], point_begin[r + 1]) of phi/theta. clear() keeps the
+// capacity, so a table reused across files stops allocating.
+struct MeasurementTable {
+    MeasurementLayout layout = MeasurementLayout::Sheet;
+
+    std::vector<std::int16_t> longitude;
+    std::vector<std::uint8_t> size;         // MeteoroidSizeID
+    std::vector<std::uint8_t> luminance;    // StimulusCode::index
+    std::vector<float> normed_value;        // NaN in journals
+    std::vector<std::uint32_t> point_begin; // rows() + 1 entries
+
+    std::vector<float> phi;
+    std::vector<float> theta;
+
+    std::size_t rows() const { return longitude.size(); }
+    std::size_t points() const { return phi.size(); }
+    MeteoroidSizeID size_id(std::size_t row) const { return static_cast<MeteoroidSizeID>(size[row]); }
+    StimulusCode stimulus(std::size_t row) const { return StimulusCode{luminance[row]}; }
+
+    void clear();
+};
+
+// Parses a whole file image in one pass, without allocating per field. On
+// error (with line number) out holds the rows before the bad one.
+bool parse_measurement_csv(const char* data, std::size_t size, MeasurementTable& out, std::string* error = nullptr);
+
+// Rounds the floats of table to what its CSV file holds (%g, 6 significant
+// digits, read back like parse_measurement_csv), so the table of a session
+// file compares and hashes like the result sheet written from the same sheet.
+void round_to_csv_digits(MeasurementTable& table);
+
+// N of a SubjectN component of a path in a Measurements tree, -1 if there
+// is none.
+long measurement_subject(const std::string& relative_path);
+
+struct SubjectAge {
+    long subject;
+    int age_years;
+};
+
+// Rows of a subjects.csv (Subject,Age; the subject as N or SubjectN).
+// Empty if the file does not exist.
+std::vector<SubjectAge> read_subject_ages(const std::string& path);
+
+struct SubjectGroup {
+    long subject;
+    std::string group;
+};
+
+// Rows of a groups file (Subject,Group), for group comparisons. Empty if
+// the file does not exist.
+std::vector<SubjectGroup> read_subject_groups(const std::string& path);
+
+// Reads files into one reused buffer; for bulk conversions.
+class MeasurementCsvReader {
+public:
+    bool read(const std::string& path, MeasurementTable& out);
+    const std::string& error() const { return m_error; }
+    std::size_t bytes_read() const { return m_bytes_read; }
+
+private:
+    std::vector<char> m_buffer;
+    std::string m_error;
+    std::size_t m_bytes_read = 0;
+};
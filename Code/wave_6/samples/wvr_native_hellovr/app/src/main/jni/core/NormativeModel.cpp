@@ -0,0 +1,100 @@
+// NormativeModel.cpp
+#include "NormativeModel.h"
+#include "Longitude.h"
+
+#include <algorithm>
+#include <cmath>
+
+int normative_stimulus_row(MeteoroidSizeID size, StimulusCode luminance) {
+    for (std::size_t s = 0; s < NORMATIVE_STIMULI.size(); s++) {
+        if (NORMATIVE_STIMULI[s].size == size && NORMATIVE_STIMULI[s].luminance == luminance) {
+            return static_cast<int>(s);
+        }
+    }
+    return -1;
+}
+
+float NormativeIsopters::expected(int eye, int longitude, MeteoroidSizeID size, StimulusCode luminance) const {
+    if (eye != 1 && eye != 2) return -1.0f;
+    auto meridian = std::find(meridians.begin(), meridians.end(), normalize_angle(longitude));
+    if (meridian == meridians.end()) return -1.0f;
+    int s = normative_stimulus_row(size, luminance);
+    if (s < 0) return -1.0f;
+    std::size_t column = static_cast<std::size_t>(meridian - meridians.begin());
+    return eccentricity[((eye - 1) * NORMATIVE_STIMULI.size() + s) * meridians.size() + column];
+}
+
+void evaluate_normative_contour(double age_years, int eye, int stimulus_row, const float* longitudes,
+                                std::size_t count, float* out) {
+    if (stimulus_row < 0 || stimulus_row >= static_cast<int>(NORMATIVE_STIMULI.size())) {
+        std::fill(out, out + count, -1.0f);
+        return;
+    }
+    const auto& c = NORMATIVE_STIMULI[stimulus_row].coefficients;
+    const double age = std::max(age_years, 1.0);
+    const double ln_age = std::log(age);
+    // The age terms are the same for every longitude
+    const double base = c[0] + c[1] * age + c[2] * ln_age;
+    const double cos_weight = c[4] + c[8] * age + c[9] * ln_age;
+    for (std::size_t j = 0; j < count; j++) {
+        double longitude = eye == 2 ? 180.0 - longitudes[j] : longitudes[j];
+        double a = longitude * M_PI / 180.0;
+        double sin_a = std::sin(a);
+        double cos_a = std::cos(a);
+        double cos_2a = std::cos(2.0 * a);
+        double value = base + c[3] * sin_a + cos_weight * cos_a + c[5] * std::sin(2.0 * a) + c[6] * cos_2a +
+                       c[7] * sin_a * cos_2a;
+        out[j] = static_cast<float>(std::clamp(value, 0.0, 90.0));
+    }
+}
+
+NormativeIsopters evaluate_normative_isopters(double age_years, const std::vector<int>& meridians) {
+    NormativeIsopters result;
+    result.age_years = age_years;
+    for (int longitude : meridians) result.meridians.push_back(normalize_angle(longitude));
+
+    // Feature matrix, one column per (eye, meridian): right eye columns
+    // first, then the mirrored left eye
+    const std::size_t m = result.meridians.size();
+    const std::size_t columns = 2 * m;
+    const double age = std::max(age_years, 1.0);
+    const double ln_age = std::log(age);
+    std::array<std::vector<double>, NORMATIVE_FEATURE_COUNT> features;
+    for (auto& feature : features) feature.resize(columns);
+    for (std::size_t j = 0; j < columns; j++) {
+        int longitude = result.meridians[j % m];
+        double a = (j < m ? longitude : 180 - longitude) * M_PI / 180.0;
+        double sin_a = std::sin(a);
+        double cos_a = std::cos(a);
+        double cos_2a = std::cos(2.0 * a);
+        features[0][j] = 1.0;
+        features[1][j] = age;
+        features[2][j] = ln_age;
+        features[3][j] = sin_a;
+        features[4][j] = cos_a;
+        features[5][j] = std::sin(2.0 * a);
+        features[6][j] = cos_2a;
+        features[7][j] = sin_a * cos_2a;
+        features[8][j] = age * cos_a;
+        features[9][j] = ln_age * cos_a;
+    }
+
+    // Each stimulus row: acc[j] += c_k * feature_k[j], contiguous and
+    // branch free, so the inner loop vectorizes
+    std::vector<double> acc(columns);
+    result.eccentricity.resize(2 * NORMATIVE_STIMULI.size() * m);
+    for (std::size_t s = 0; s < NORMATIVE_STIMULI.size(); s++) {
+        std::fill(acc.begin(), acc.end(), 0.0);
+        for (std::size_t k = 0; k < NORMATIVE_FEATURE_COUNT; k++) {
+            const double c = NORMATIVE_STIMULI[s].coefficients[k];
+            const double* feature = features[k].data();
+            for (std::size_t j = 0; j < columns; j++) acc[j] += c * feature[j];
+        }
+        for (std::size_t j = 0; j < columns; j++) {
+            std::size_t eye = j / m;
+            float value = static_cast<float>(std::clamp(acc[j], 0.0, 90.0));
+            result.eccentricity[(eye * NORMATIVE_STIMULI.size() + s) * m + j % m] = value;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,82 @@
+// NormativeModel.h
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "GoldmannSizes.h"
+#include "GoldmannStimulus.h"
+
+// Age-specific isopters of healthy eyes, the regression of Grobbel et al.
+// (2016) as in Code/Analyisis/generate_isopter_tables.py:
+//
+//   ecc = c0 + c1 age + c2 ln(age)
+//       + c3 sin a + c4 cos a + c5 sin 2a + c6 cos 2a + c7 sin a cos 2a
+//       + c8 age cos a + c9 ln(age) cos a
+//
+// a is the meridian with 0 temporal for the right eye, the left eye is
+// mirrored (a = 180 - longitude). Each stimulus is one row of c, the base
+// coefficients with its main effect and interactions already added. V4e
+// uses the III4e main effects, like the script.
+constexpr std::size_t NORMATIVE_FEATURE_COUNT = 10;
+
+struct NormativeStimulus {
+    MeteoroidSizeID size;
+    StimulusCode luminance;
+    std::array<double, NORMATIVE_FEATURE_COUNT> coefficients;
+};
+
+namespace normative_detail {
+constexpr double INTERCEPT = 34.1081779;
+constexpr double AGE = -0.2572225;
+constexpr double LN_AGE = 4.50957638;
+constexpr std::array<double, 5> SHAPE = {-4.0582332, 7.65641149, -3.1203881, 5.25169817, 0.71985225};
+
+// Base model plus the stimulus terms: main effect, age and ln(age)
+// interactions, shape interaction, three-way cos terms
+constexpr std::array<double, NORMATIVE_FEATURE_COUNT> row(double offset, double age, double ln_age,
+                                                          std::array<double, 5> shape, double age_cos,
+                                                          double ln_age_cos) {
+    return {INTERCEPT + offset,     AGE + age,          LN_AGE + ln_age,    SHAPE[0] + shape[0],
+            SHAPE[1] + shape[1],    SHAPE[2] + shape[2], SHAPE[3] + shape[3], SHAPE[4] + shape[4],
+            age_cos,                ln_age_cos};
+}
+}
+
+constexpr std::array<NormativeStimulus, 3> NORMATIVE_STIMULI = {{
+        {MeteoroidSizeID::V, "4e"_stim,
+         normative_detail::row(31.4617962, 0.17008673, -3.2546707, {-3.693, 3.129, -3.396, 3.251, 0.224},
+                               -0.0769468, 2.38335733)},
+        {MeteoroidSizeID::I, "3e"_stim,
+         normative_detail::row(0.85379893, -0.2098779, 4.61051333, {-1.688, -1.880, 0.012, 0.772, -0.745},
+                               -0.0771797, 1.65190687)},
+        {MeteoroidSizeID::I, "2e"_stim,
+         normative_detail::row(-22.390857, -0.3074818, 7.80908545, {0.913, -10.349, 1.245, -0.769, -0.658},
+                               -0.107209, 3.41882728)},
+}};
+
+// Expected isopters of one patient on a fixed set of meridians, both eyes.
+struct NormativeIsopters {
+    double age_years = 0.0;
+    std::vector<int> meridians;
+    // [eye - 1][NORMATIVE_STIMULI row][meridian], deg clamped to 0..90
+    std::vector<float> eccentricity;
+
+    // Expected eccentricity (deg), negative if the stimulus is not in the
+    // model or the meridian was not evaluated.
+    float expected(int eye, int longitude, MeteoroidSizeID size, StimulusCode luminance) const;
+};
+
+// Row of NORMATIVE_STIMULI, -1 if the stimulus is not in the model.
+int normative_stimulus_row(MeteoroidSizeID size, StimulusCode luminance);
+
+// Expected eccentricity (deg, clamped to 0..90) of one stimulus row and eye
+// at any longitudes (deg), for comparisons with dense isopter contours.
+void evaluate_normative_contour(double age_years, int eye, int stimulus_row, const float* longitudes,
+                                std::size_t count, float* out);
+
+// Evaluates every meridian and modelled stimulus of both eyes in one pass:
+// the features are built once per (eye, meridian) column, then each
+// stimulus is a dot product over the columns.
+NormativeIsopters evaluate_normative_isopters(double age_years, const std::vector<int>& meridians);
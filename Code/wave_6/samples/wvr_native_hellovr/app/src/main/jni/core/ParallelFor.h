@@ -0,0 +1,33 @@
+// ParallelFor.h
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Worker count for threads == 0: one per core.
+inline unsigned parallel_workers(unsigned threads, std::size_t count) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    return static_cast<unsigned>(std::min<std::size_t>(threads, std::max<std::size_t>(count, 1)));
+}
+
+// Calls f(worker, index) for every index in [0, count) on up to threads
+// workers and returns when all are done. Workers claim the next index
+// themselves, so uneven items (subjects with more points) balance out.
+// worker is in [0, parallel_workers(threads, count)), for per-worker buffers
+// and random number generators; the calling thread is worker 0.
+template <typename F>
+void parallel_for(std::size_t count, unsigned threads, F&& f) {
+    const unsigned workers = parallel_workers(threads, count);
+    std::atomic<std::size_t> next(0);
+    auto run = [&](unsigned worker) {
+        for (std::size_t index = next++; index < count; index = next++) f(worker, index);
+    };
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    for (unsigned worker = 1; worker < workers; worker++) pool.emplace_back(run, worker);
+    run(0);
+    for (std::thread& thread : pool) thread.join();
+}
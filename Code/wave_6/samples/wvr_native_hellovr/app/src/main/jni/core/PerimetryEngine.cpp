@@ -0,0 +1,408 @@
+// PerimetryEngine.cpp
+#include "PerimetryEngine.h"
+#include "HelperFunctions.h"
+#include "PerimetryLog.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+// --- Implementierung ---
+
+PerimetryEngine::PerimetryEngine(const EngineClock* clock)
+        : m_perimetry_status(PerimetryStatus::NotStarted),
+          mActiveEye(0),
+          m_clock(clock ? clock : &SteadyEngineClock::instance()),
+          m_radius(METEOROID_DISTANCE),
+          m_longitudes(METEOROID_LONGITUDES_DEG),
+          m_current_longitude_index(0),
+          m_current_size(MeteoroidSizeID::V), // Standard
+          m_paused_star_size(MeteoroidSizeID::None),
+          m_rng(std::random_device{}())
+{
+    m_projected_sizes = make_projected_sizes(m_radius);
+    m_R = calc_rotation_matrix(GENERAL_THALES_POINT_VEC, Vector3(0.0f, 0.0f, -m_radius));
+
+    // Standard-Pausenwerte
+    m_paused_star_position = glm::vec3(0.0f, 0.0f, -m_radius);
+    m_paused_star_p = {0.0, 0.0};
+
+    // All vectors of the protocol run on these meridians, only their order changes
+    m_trajectories.build(METEOROID_LONGITUDES_DEG, [this](double longitude, double theta_regler) {
+        return _get_coordinates(longitude, theta_regler);
+    });
+
+    setup_sheets();
+}
+
+void PerimetryEngine::setup_sheets() {
+    // Expected isopters of this patient, every meridian and stimulus at once
+    std::vector<int> meridians;
+    for (const PerimetryVector& vec : METEOROID_LONGITUDES_DEG) meridians.push_back(vec.angle_deg);
+    m_normative = evaluate_normative_isopters(m_patient_age_years, meridians);
+
+    m_goldmann_sheet = GoldmannSheet();
+    m_goldmann_sheet.setup_sheet(METEOROID_LONGITUDES_DEG, LUMINANCE_TO_USE, 1, &m_normative);
+    m_goldmann_sheet.setup_sheet(METEOROID_LONGITUDES_DEG, LUMINANCE_TO_USE, 2, &m_normative);
+}
+
+void PerimetryEngine::set_patient_age(double years) {
+    m_patient_age_years = years;
+    if (m_goldmann_sheet.get_points().empty()) setup_sheets();
+}
+
+const FrameSnapshot& PerimetryEngine::tick(EngineClock::time_point frame_time) {
+    // The only place where exam time is integrated
+    double dt = std::chrono::duration<double>(frame_time - m_last_update_time).count();
+    m_last_update_time = frame_time;
+    if (dt < 0.0) dt = 0.0;
+
+    CurrentPointInfo info = advance(dt);
+    if (m_perimetry_status == PerimetryStatus::Running && info.is_visible) {
+        record_sample(frame_time, info.p);
+    }
+
+    FrameSnapshot snapshot;
+    snapshot.frame_index = m_snapshot.frame_index + 1;
+    snapshot.frame_time = frame_time;
+    snapshot.active_eye = mActiveEye;
+    snapshot.point = info.p;
+    snapshot.eccentricity_deg = current_eccentricity_deg();
+
+    if (info.is_visible) {
+        // Farbe (aus der Compile-Time-Tabelle)
+        StimulusCode luminance = m_perimetry_status == PerimetryStatus::Paused
+                ? m_paused_star_luminance
+                : m_longitudes[m_current_longitude_index].luminance;
+
+        snapshot.stimulus.is_visible = true;
+        snapshot.stimulus.position = info.position;
+        snapshot.stimulus.radius_m = m_projected_sizes[static_cast<std::size_t>(info.size)].radius_m;
+        snapshot.stimulus.color = stimulus_info(luminance).rgb;
+    }
+    m_snapshot = snapshot;
+    return m_snapshot;
+}
+
+const PerimetryVector* PerimetryEngine::current_vector() const {
+    if (m_perimetry_status == PerimetryStatus::NotStarted || m_current_longitude_index >= m_longitudes.size()) {
+        return nullptr;
+    }
+    return &m_longitudes[m_current_longitude_index];
+}
+
+// --- Logik-Funktionen (übersetzt aus meteoroid.py) ---
+
+void PerimetryEngine::setup_longitudes(std::uint32_t order_seed) {
+    // Fisher-Yates on the raw mt19937 output (std::shuffle and the standard
+    // distributions are implementation defined), so a seed from the resume
+    // journal gives the same order on every build.
+    std::mt19937 rng(order_seed);
+    auto shuffle = [&rng](vector<PerimetryVector>& l) {
+        for (size_t i = l.size(); i > 1; i--) {
+            std::swap(l[i - 1], l[rng() % i]);
+        }
+    };
+
+    vector<PerimetryVector> new_longitudes = {};
+    std::vector<MeteoroidSizeID> sizes = {MeteoroidSizeID::V, MeteoroidSizeID::IV, MeteoroidSizeID::III, MeteoroidSizeID::II, MeteoroidSizeID::I};
+    for (auto size : sizes) {
+        for (StimulusCode lum : LUMINANCE_TO_USE.at(size)) {
+            for (int iterations = 0; iterations < NUMBER_ITERATIONS_PER_SIZE; iterations++) {
+                vector<PerimetryVector> shuffled_l = METEOROID_LONGITUDES_DEG;
+                if (METEOROID_RANDOM) {
+                    shuffle(shuffled_l);
+                }
+                for (auto& longitude : shuffled_l) {
+                    longitude.luminance = lum;
+                    longitude.size= size;
+                }
+                new_longitudes.insert(new_longitudes.end(), shuffled_l.begin(), shuffled_l.end());
+            }
+        }
+    }
+    m_longitudes = new_longitudes;
+}
+
+void PerimetryEngine::start_animation(std::uint32_t order_seed, std::size_t first_vector) {
+    m_order_seed = order_seed;
+    setup_longitudes(order_seed);
+    m_current_longitude_start_time = m_clock->now();
+    m_last_update_time = m_current_longitude_start_time; // first frame starts at dt = 0
+    m_current_longitude_index = std::min(first_vector, m_longitudes.size());
+
+    // Finde die erste gültige Größe
+    if (m_current_longitude_index < m_longitudes.size()) {
+        m_current_size = m_longitudes[m_current_longitude_index].size;
+    }
+    m_current_radius_deg = 0.0;
+
+    m_perimetry_status = PerimetryStatus::Running;
+    begin_track(m_current_longitude_start_time);
+}
+
+void PerimetryEngine::pause_animation(bool point_detected) {
+    pause_animation_at(point_detected, m_clock->now());
+}
+
+void PerimetryEngine::pause_animation_at(bool point_detected, EngineClock::time_point press_time) {
+    if (m_perimetry_status == PerimetryStatus::Running) {
+        // No time passes here, the stimulus stays where the last tick put it
+        if (point_detected) {
+            apply_reaction_time(press_time);
+        }
+        CurrentPointInfo info = current_point_info();
+        m_paused_star_position = info.position;
+        m_paused_star_size = info.size;
+        m_paused_star_p = info.p;
+        if (m_current_longitude_index < m_longitudes.size()) {
+            m_paused_star_luminance = m_longitudes[m_current_longitude_index].luminance;
+        }
+        m_perimetry_status = PerimetryStatus::Paused;
+    }
+}
+
+void PerimetryEngine::resume_animation() {
+    if (m_perimetry_status == PerimetryStatus::Paused) {
+        // The stimulus continues from m_current_radius_deg; the first tick
+        // after the pause starts at dt = 0
+        auto now = m_clock->now();
+        m_current_longitude_start_time = now;
+        m_last_update_time = now;
+
+        m_paused_star_position = glm::vec3(0.0f, 0.0f, -m_radius);
+        m_paused_star_size = MeteoroidSizeID::I; // Standard
+        m_paused_star_p = {0.0, 0.0};
+        m_perimetry_status = PerimetryStatus::Running;
+        record_sample(now, current_point_info().p);
+    }
+}
+
+void PerimetryEngine::reset_animation() {
+    m_current_longitude_start_time = EngineClock::time_point();
+    m_current_longitude_index = 0;
+    m_perimetry_status = PerimetryStatus::NotStarted;
+}
+
+void PerimetryEngine::reset_session() {
+    reset_animation();
+    mActiveEye = 0;
+    m_current_radius_deg = 0.0;
+    m_current_speed = 0.0;
+    m_longitudes = METEOROID_LONGITUDES_DEG;
+    m_current_size = MeteoroidSizeID::V;
+    m_order_seed = 0;
+    m_detected_eccentricity_deg = 0.0;
+
+    m_paused_star_position = glm::vec3(0.0f, 0.0f, -m_radius);
+    m_paused_star_size = MeteoroidSizeID::None;
+    m_paused_star_p = {0.0, 0.0};
+
+    // Samples of the previous patient can never match a new track
+    m_track_id++;
+    m_snapshot.stimulus = StimulusToDraw();
+    m_snapshot.active_eye = 0;
+
+    setup_sheets();
+}
+
+double PerimetryEngine::calculate_adaptive_speed(double current_r, double normative_r) {
+
+    double v_slow = size_info(m_current_size).speed;
+    double v_fast = 25.0; // e.g., 5 degrees per second
+
+    // Rule: If we have passed the mean (current_r > normative_r),
+    // do not speed up again. Stay at precision speed.
+    if (current_r > (90-normative_r)) {
+        return v_slow;
+    }
+
+    // Gaussian Brake: Slow down as we get closer to normative_r
+    double distance = std::abs((90-current_r) - normative_r);
+
+    double safety_margin_deg = 15.0;
+
+    if (distance <= safety_margin_deg) {
+        return v_slow; // Within the danger zone, go slow.
+    } else {
+        // Linear ramp up between Safety Margin (15°) and Full Speed (at 30°+)
+        // This is smoother than an abrupt jump but faster than Gaussian
+        double ramp_length = 15.0; // Takes 15 degrees to accelerate fully
+        double factor = (distance - safety_margin_deg) / ramp_length;
+
+        // Clamp factor 0.0 to 1.0
+        if (factor > 1.0) factor = 1.0;
+
+        // Lerp (Linear Interpolation)
+        return v_slow + factor * (v_fast - v_slow);
+    }
+}
+
+PerimetryEngine::CurrentPointInfo PerimetryEngine::advance(double dt) {
+    // 1. Handle Paused State
+    if (m_perimetry_status == PerimetryStatus::Paused) {
+        return {true, m_paused_star_position, m_paused_star_size, m_paused_star_p};
+    }
+
+    // 2. Handle Not Running
+    if (m_perimetry_status != PerimetryStatus::Running) {
+        return {false, {}, MeteoroidSizeID::None, {}};
+    }
+
+    // Safety: If dt is too large (lag spike), clamp it to avoid teleporting
+    if (dt > 0.1) dt = 0.1;
+
+    // 3. Check if we have vectors left
+    if (m_current_longitude_index < m_longitudes.size()) {
+
+        // Get current vector data
+        PerimetryVector &current_vec = m_longitudes[m_current_longitude_index];
+
+        // --- ADAPTIVE SPEED LOGIC ---
+        m_current_speed = 1.0;
+        if (mActiveEye == 1 || mActiveEye == 2) {
+            m_current_speed = calculate_adaptive_speed(
+                    m_current_radius_deg,
+                    m_goldmann_sheet.normalized_angle(mActiveEye, current_vec.angle_deg, m_current_size, current_vec.luminance));
+        }
+
+        // Move the point: Radius decreases (Outer -> Inner)
+        m_current_radius_deg += (m_current_speed * dt);
+
+        // 4. Check if we reached the center (or end of track)
+        if (m_current_radius_deg >= 90.0) {
+            // Vector Complete: Move to next index
+            m_current_longitude_index++;
+            m_current_radius_deg = 0; // Reset to outer rim for next vector
+            m_track_id++;            // The tick records its first sample
+
+            if (m_current_longitude_index < m_longitudes.size()) {
+                m_current_size = m_longitudes[m_current_longitude_index].size;
+            }
+
+            // The new vector starts at the rim in this same frame
+            return advance(0.0);
+        }
+
+        return current_point_info();
+
+    } else {
+        m_perimetry_status = PerimetryStatus::Done;
+        return {false, {}, MeteoroidSizeID::None, {}};
+    }
+}
+
+PerimetryEngine::CurrentPointInfo PerimetryEngine::current_point_info() {
+    if (m_current_longitude_index >= m_longitudes.size()) {
+        return {false, {}, MeteoroidSizeID::None, {}};
+    }
+    // m_current_radius_deg represents the distance from the outer rim,
+    // theta_regler = deg / 90.0.
+    int angle = m_longitudes[m_current_longitude_index].angle_deg;
+    const MeridianTrajectory* trajectory = m_trajectories.find(angle);
+    if (trajectory) {
+        MeridianTrajectory::Sample sample = trajectory->at(m_current_radius_deg);
+        return {true, sample.position, m_current_size, sample.p};
+    }
+    auto coordinates = _get_coordinates(angle, m_current_radius_deg / 90.0);
+    return {true, coordinates.first, m_current_size, coordinates.second};
+}
+
+void PerimetryEngine::apply_reaction_time(EngineClock::time_point press_time) {
+    if (m_current_longitude_index >= m_longitudes.size()) return;
+
+    // The stimulus was seen REACTION_TIME before the button press. Look up
+    // where it was at that moment instead of stepping back from the last frame.
+    auto seen_time = press_time - std::chrono::duration_cast<EngineClock::duration>(
+            std::chrono::duration<double>(REACTION_TIME));
+    std::optional<double> eccentricity = m_history.eccentricity_at(seen_time, m_track_id, m_current_speed);
+    if (eccentricity) {
+        m_current_radius_deg = 90.0 - *eccentricity;
+    } else {
+        m_current_radius_deg -= m_current_speed * REACTION_TIME;
+    }
+    m_current_radius_deg = std::clamp(m_current_radius_deg, 0.0, 90.0);
+    m_detected_eccentricity_deg = current_eccentricity_deg();
+
+    // The detection moves the expected isopter of every stimulus on this meridian
+    m_goldmann_sheet.set_longitude_normalized_angle(
+            mActiveEye, m_longitudes[m_current_longitude_index].angle_deg,
+            static_cast<float>(90 - m_current_radius_deg));
+}
+
+void PerimetryEngine::begin_track(EngineClock::time_point time) {
+    m_track_id++;
+    record_sample(time, current_point_info().p);
+}
+
+void PerimetryEngine::record_sample(EngineClock::time_point time, const PolarPoint& p) {
+    TrajectorySample sample;
+    sample.time = time;
+    sample.track_id = m_track_id;
+    sample.eccentricity_deg = current_eccentricity_deg();
+    sample.point = p;
+    m_history.push(sample);
+}
+
+DetectedPoint PerimetryEngine::point_detected(EngineClock::time_point press_time) {
+    pause_animation_at(true, press_time);
+    if (m_perimetry_status != PerimetryStatus::Paused) {
+        auto empty = DetectedPoint{};
+        return empty;
+    };
+
+    PerimetryVector cur_vec = m_longitudes[m_current_longitude_index];
+
+    m_goldmann_sheet.add_point(m_paused_star_p, m_paused_star_size, cur_vec.angle_deg, mActiveEye, cur_vec.luminance);
+
+    m_current_longitude_index++;
+    if (m_current_longitude_index < m_longitudes.size()) {
+        m_current_size = m_longitudes[m_current_longitude_index].size;
+    }
+
+    // Reset time for the NEW animation path
+    m_current_longitude_start_time = m_clock->now();
+    m_last_update_time = m_current_longitude_start_time;
+    m_current_radius_deg = 0.0;
+
+    // Set status to running (Manually, instead of calling resume_animation)
+    m_perimetry_status = PerimetryStatus::Running;
+    begin_track(m_current_longitude_start_time);
+
+    LOGI("Point detected! Moving to longitude index: %zu", m_current_longitude_index);
+    auto return_value = DetectedPoint{m_paused_star_p, m_paused_star_size, cur_vec.angle_deg, mActiveEye, cur_vec.luminance};
+    return return_value;
+}
+
+// --- Private Python-Helfer, jetzt in C++ ---
+
+double PerimetryEngine::_theta_from_regler(double theta_regler) {
+    return theta_regler * (M_PI / 2.0) + (M_PI / 2.0);
+}
+
+double PerimetryEngine::_min_max_normalization(double value) const {
+    return 2.0 * ((value - (-m_radius)) / (m_radius - (-m_radius))) - 1.0;
+}
+
+std::pair<glm::vec3, PolarPoint> PerimetryEngine::_get_coordinates(double longitude, double theta_regler) {
+    double theta = _theta_from_regler(theta_regler);
+    double phi = glm::radians(longitude);
+
+    auto x = static_cast<float>(std::sin(theta) * std::cos(phi) * m_radius);
+    auto y = static_cast<float>(std::sin(theta) * std::sin(phi) * m_radius);
+    auto z = static_cast<float>(std::cos(theta) * m_radius);
+
+    glm::vec3 light_point_raw(x, y, z);
+    glm::vec3 p_vec = light_point_raw - GENERAL_THALES_POINT;
+
+    auto theta_p = static_cast<float>(_min_max_normalization(p_vec.y) * 90.0);
+    auto phi_t = static_cast<float>(_min_max_normalization(p_vec.x) * 90.0);
+    PolarPoint p = {theta_p, phi_t};
+
+    // Wende die Rotationsmatrix an (alles bleibt in GLM)
+    glm::vec4 transformed_point_v4 = m_R * glm::vec4(light_point_raw, 1.0f);
+    glm::vec3 light_point = glm::vec3(transformed_point_v4);
+
+    return {light_point, p};
+}
@@ -0,0 +1,149 @@
+// PerimetryEngine.h
+#pragma once
+
+#include <string>
+#include <tuple>
+#include <vector>
+#include <chrono>
+#include <random>
+
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+
+#include "EngineClock.h"
+#include "FrameSnapshot.h"
+#include "GoldmannSheet.h"
+#include "Settings.h"
+#include "StimulusToDraw.h"
+#include "TrajectoryHistory.h"
+#include "TrajectoryTable.h"
+
+// Result of a response: point, size, longitude, eye, luminance (eye 0 = nothing recorded)
+using DetectedPoint = std::tuple<PolarPoint, MeteoroidSizeID, int, int, StimulusCode>;
+
+enum class PerimetryStatus : std::uint8_t { NotStarted, Running, Paused, Done };
+
+// Headless kinetic perimetry engine (ported from meteoroid.py, formerly part
+// of the Meteoroid scene object). It owns the stimulus trajectory, the exam
+// state and the GoldmannSheet. It has no GL, JNI or WVR dependencies so it
+// can be built and tested on the host as part of perimetry_core.
+// All timing goes through the EngineClock passed in (not owned, must outlive
+// the engine); without one the monotonic SteadyEngineClock is used.
+class PerimetryEngine {
+public:
+    explicit PerimetryEngine(const EngineClock* clock = nullptr);
+
+    // Variablen
+    PerimetryStatus m_perimetry_status;
+    GoldmannSheet m_goldmann_sheet;
+    int mActiveEye;
+
+    // Animationssteuerung
+    void start_animation() { start_animation(m_rng(), 0); }
+    // The protocol order is shuffled from order_seed, the same seed always
+    // gives the same order. Starts at vector first_vector of that order, so
+    // an interrupted eye continues where it stopped (see ResumeJournal).
+    void start_animation(std::uint32_t order_seed, std::size_t first_vector);
+    void pause_animation(bool point_detected);
+    void resume_animation();
+    // press_time is the device timestamp of the button press. The recorded
+    // point is where the stimulus was at press_time - REACTION_TIME, taken
+    // from the trajectory history, so it does not depend on render latency.
+    DetectedPoint point_detected(EngineClock::time_point press_time);
+    DetectedPoint point_detected() { return point_detected(m_clock->now()); }
+    void reset_animation();
+    // Back to the state of a freshly constructed engine for the next patient:
+    // empty sheets, protocol order and pause state. The trajectory tables,
+    // the clock, the RNG and the patient age are kept.
+    void reset_session();
+
+    // The sheets start at the normative isopters for this age, so the slow
+    // zone of every vector is centred on where this patient should see it.
+    // Before the first detection it applies at once, otherwise from the next
+    // reset_session().
+    void set_patient_age(double years);
+    double patient_age() const { return m_patient_age_years; }
+    const NormativeIsopters& normative_isopters() const { return m_normative; }
+
+    // Advances the exam to frame_time, exactly once per rendered frame and
+    // before any eye is drawn. Pause, resume and detections never move time
+    // themselves, so the stimulus speed does not depend on how often the
+    // engine is queried.
+    const FrameSnapshot& tick(EngineClock::time_point frame_time);
+    const FrameSnapshot& tick() { return tick(m_clock->now()); }
+
+    // Result of the last tick, read by both eyes
+    const FrameSnapshot& snapshot() const { return m_snapshot; }
+    const TrajectoryHistory& history() const { return m_history; }
+    // Stimulus path of every meridian, built once in the constructor
+    const TrajectoryTables& trajectories() const { return m_trajectories; }
+
+    // Read-only view of the running exam (nullptr once all vectors are done)
+    const PerimetryVector* current_vector() const;
+    double current_eccentricity_deg() const { return 90.0 - m_current_radius_deg; }
+    size_t vector_count() const { return m_longitudes.size(); }
+    // Vectors of the running eye that are done (detected or ran through)
+    size_t vector_index() const { return m_current_longitude_index; }
+    std::uint32_t order_seed() const { return m_order_seed; }
+    // Eccentricity after the reaction time correction of the last detection,
+    // the value the normative isopter of its meridian was moved to
+    double detected_eccentricity_deg() const { return m_detected_eccentricity_deg; }
+    // Changes with every new vector, see TrajectorySample::track_id
+    std::uint32_t track_id() const { return m_track_id; }
+
+private:
+    const EngineClock* m_clock;
+    float m_radius;
+    std::vector<PerimetryVector> m_longitudes;
+
+    size_t m_current_longitude_index;
+    MeteoroidSizeID m_current_size;
+    ProjectedSizeTable m_projected_sizes; // Stimulus discs at m_radius
+
+    EngineClock::time_point m_current_longitude_start_time;
+    double m_current_radius_deg = 0.0; // State: Current position (starts outer)
+    double m_current_speed = 0.0; // deg/sec of the last tick
+    EngineClock::time_point m_last_update_time;
+
+    glm::mat4 m_R; // Rotationsmatrix
+
+    // Status für Pause-Modus
+    glm::vec3 m_paused_star_position;
+    MeteoroidSizeID m_paused_star_size;
+    PolarPoint m_paused_star_p;
+    StimulusCode m_paused_star_luminance{};
+
+    // Zufallsgenerator
+    std::mt19937 m_rng;
+    std::uint32_t m_order_seed = 0;
+    double m_detected_eccentricity_deg = 0.0;
+    double m_patient_age_years = DEFAULT_PATIENT_AGE_YEARS;
+    NormativeIsopters m_normative;
+
+    void setup_longitudes(std::uint32_t order_seed);
+    void setup_sheets();
+
+    struct CurrentPointInfo {
+        bool is_visible;
+        glm::vec3 position;
+        MeteoroidSizeID size;
+        PolarPoint p;
+    };
+    CurrentPointInfo advance(double dt);
+    CurrentPointInfo current_point_info();
+    void pause_animation_at(bool point_detected, EngineClock::time_point press_time);
+    void apply_reaction_time(EngineClock::time_point press_time);
+    void begin_track(EngineClock::time_point time);
+    void record_sample(EngineClock::time_point time, const PolarPoint& p);
+
+    FrameSnapshot m_snapshot;
+    TrajectoryTables m_trajectories;
+    TrajectoryHistory m_history;
+    std::uint32_t m_track_id = 0;
+
+    double calculate_adaptive_speed(double current_r, double normative_r);
+
+    std::pair<glm::vec3, PolarPoint> _get_coordinates(double longitude, double theta_regler);
+    static double _theta_from_regler(double theta_regler);
+    double _min_max_normalization(double value) const;
+};
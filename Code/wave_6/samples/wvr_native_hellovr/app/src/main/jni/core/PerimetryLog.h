@@ -0,0 +1,31 @@
+// PerimetryLog.h
+#pragma once
+
+// The perimetry core is built for the headset (Android.mk) and for the host
+// (CMakeLists.txt). On Android we log through log.h like the rest of the app,
+// on the host warnings and errors go to stderr. Info output is only printed
+// with PERIMETRY_VERBOSE so batch simulations stay quiet.
+
+#if defined(__ANDROID__)
+
+#include <log.h>
+
+#else
+
+#include <cstdio>
+
+#ifndef LOG_TAG
+#define LOG_TAG "perimetry_core"
+#endif
+
+#define LOGV(...) ((void) 0)
+#define LOGD(...) ((void) 0)
+#if defined(PERIMETRY_VERBOSE)
+#define LOGI(...) (std::fprintf(stderr, "I/" LOG_TAG ": " __VA_ARGS__), std::fputc('\n', stderr))
+#else
+#define LOGI(...) ((void) 0)
+#endif
+#define LOGW(...) (std::fprintf(stderr, "W/" LOG_TAG ": " __VA_ARGS__), std::fputc('\n', stderr))
+#define LOGE(...) (std::fprintf(stderr, "E/" LOG_TAG ": " __VA_ARGS__), std::fputc('\n', stderr))
+
+#endif
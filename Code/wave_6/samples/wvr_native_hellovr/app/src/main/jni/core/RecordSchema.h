@@ -0,0 +1,335 @@
+// RecordSchema.h
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "GoldmannSheet.h"
+#include "Settings.h"
+
+// The records are written as they are in memory
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "binary records are little-endian");
+
+// Output of the record writers. The storage is allocated once, by the owner;
+// writers never grow it. A record that does not fit is rolled back and
+// reported (false, overflowed()), the owner flushes and writes it again.
+class FormatBuffer {
+public:
+    explicit FormatBuffer(std::size_t capacity) : m_data(capacity) {}
+
+    const char* data() const { return m_data.data(); }
+    std::size_t size() const { return m_size; }
+    std::size_t capacity() const { return m_data.size(); }
+    bool empty() const { return m_size == 0; }
+    bool overflowed() const { return m_overflowed; }
+    std::string str() const { return std::string(data(), size()); }
+    void clear() {
+        m_size = 0;
+        m_overflowed = false;
+    }
+
+    bool put(char c) {
+        if (m_size == m_data.size()) return full();
+        m_data[m_size++] = c;
+        return true;
+    }
+    bool put(const char* text, std::size_t length) {
+        if (m_data.size() - m_size < length) return full();
+        std::memcpy(m_data.data() + m_size, text, length);
+        m_size += length;
+        return true;
+    }
+    bool put(const char* text) { return put(text, std::strlen(text)); }
+
+    // Shortest form for integers, "%g" (6 significant digits, like the
+    // iostreams the old writers used) for floating point
+    template <typename T>
+    bool put_chars(T value) {
+        char* first = m_data.data() + m_size;
+        char* last = m_data.data() + m_data.size();
+        std::to_chars_result result;
+        if constexpr (std::is_floating_point<T>::value) {
+            result = std::to_chars(first, last, value, std::chars_format::general, 6);
+        } else {
+            result = std::to_chars(first, last, value);
+        }
+        if (result.ec != std::errc()) return full();
+        m_size = static_cast<std::size_t>(result.ptr - m_data.data());
+        return true;
+    }
+
+    template <typename T>
+    bool put_binary(T value) {
+        static_assert(std::is_trivially_copyable<T>::value, "raw bytes only");
+        return put(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    std::size_t mark() const { return m_size; }
+    void rollback(std::size_t mark) { m_size = mark; }
+    // Fills in a value reserved earlier (a length before its contents)
+    void overwrite(std::size_t mark, const void* data, std::size_t length) {
+        if (mark <= m_size && length <= m_size - mark) std::memcpy(m_data.data() + mark, data, length);
+    }
+
+private:
+    bool full() {
+        m_overflowed = true;
+        return false;
+    }
+
+    std::vector<char> m_data;
+    std::size_t m_size = 0;
+    bool m_overflowed = false;
+};
+
+// One column of a record: its name in CSV headers and the member it reads.
+template <typename Record, typename Member>
+struct Field {
+    using member_type = Member;
+
+    const char* name;
+    Member Record::* member;
+};
+
+template <typename Record, typename Member>
+constexpr Field<Record, Member> field(const char* name, Member Record::* member) {
+    return {name, member};
+}
+
+// Specialized next to each record type:
+//
+//   template <> struct RecordSchema<JournalRecord> {
+//       static constexpr auto fields = std::make_tuple(
+//               field("Longitude", &JournalRecord::longitude), ...);
+//   };
+//
+// The tuple is the single definition of the file layout. The CSV header,
+// CSV rows and binary records are all generated from it, in field order.
+// Members that have a schema themselves are flattened (CSV columns get the
+// member name as prefix).
+template <typename T>
+struct RecordSchema {};
+
+template <typename T, typename = void>
+struct has_record_schema : std::false_type {};
+template <typename T>
+struct has_record_schema<T, std::void_t<decltype(RecordSchema<T>::fields)>> : std::true_type {};
+
+// --- Value formats ---
+//
+// CSV: integers and floats as numbers, sizes and stimuli by name ("Size_III",
+// "3e"), points as a point list "[(PHI|THETA);...]" (a single PolarPoint is
+// a list of one), std::array as one column per element (name_0, name_1..).
+// Binary: numbers as raw little-endian values, enums and stimuli as one
+// byte, a point as phi, theta (f32), a point list as u32 count + points.
+namespace record_format {
+
+inline bool csv_value(FormatBuffer& out, MeteoroidSizeID size) { return out.put(size_info(size).name); }
+inline bool csv_value(FormatBuffer& out, StimulusCode stimulus) { return out.put(stimulus_info(stimulus).name, 2); }
+
+inline bool csv_point(FormatBuffer& out, const PolarPoint& p) {
+    return out.put('(') && out.put_chars(p.phi) && out.put('|') && out.put_chars(p.theta) && out.put(')') &&
+           out.put(';');
+}
+inline bool csv_value(FormatBuffer& out, const PolarPoint& p) {
+    return out.put('[') && csv_point(out, p) && out.put(']');
+}
+inline bool csv_value(FormatBuffer& out, const GoldmannSheet::PointRange& points) {
+    if (!out.put('[')) return false;
+    for (const PolarPoint& p : points) {
+        if (!csv_point(out, p)) return false;
+    }
+    return out.put(']');
+}
+
+template <typename T>
+std::enable_if_t<std::is_arithmetic<T>::value, bool> csv_value(FormatBuffer& out, T value) {
+    if constexpr (std::is_floating_point<T>::value) {
+        return out.put_chars(value);
+    } else if constexpr (std::is_signed<T>::value) {
+        return out.put_chars(static_cast<long long>(value));
+    } else {
+        return out.put_chars(static_cast<unsigned long long>(value));
+    }
+}
+
+inline bool binary_value(FormatBuffer& out, MeteoroidSizeID size) {
+    return out.put_binary(static_cast<std::uint8_t>(size));
+}
+inline bool binary_value(FormatBuffer& out, StimulusCode stimulus) { return out.put_binary(stimulus.index); }
+inline bool binary_value(FormatBuffer& out, const PolarPoint& p) {
+    return out.put_binary(p.phi) && out.put_binary(p.theta);
+}
+inline bool binary_value(FormatBuffer& out, const GoldmannSheet::PointRange& points) {
+    if (!out.put_binary(static_cast<std::uint32_t>(points.size()))) return false;
+    for (const PolarPoint& p : points) {
+        if (!binary_value(out, p)) return false;
+    }
+    return true;
+}
+
+template <typename T>
+std::enable_if_t<std::is_arithmetic<T>::value, bool> binary_value(FormatBuffer& out, T value) {
+    return out.put_binary(value);
+}
+
+// Column names of nested members: prefix_name, arrays name_index
+struct ColumnName {
+    char text[64];
+    std::size_t length = 0;
+
+    ColumnName with(const char* part, char separator) const {
+        ColumnName name = *this;
+        if (name.length > 0 && name.length < sizeof(text) - 1) name.text[name.length++] = separator;
+        std::size_t part_length = std::min(std::strlen(part), sizeof(text) - 1 - name.length);
+        std::memcpy(name.text + name.length, part, part_length);
+        name.length += part_length;
+        return name;
+    }
+};
+
+template <typename T>
+bool csv_columns(FormatBuffer& out, const ColumnName& name, bool& first);
+template <typename T>
+bool csv_fields(FormatBuffer& out, const T& record, bool& first);
+template <typename T>
+bool binary_fields(FormatBuffer& out, const T& record);
+
+template <typename T>
+bool csv_column(FormatBuffer& out, const ColumnName& name, bool& first) {
+    if constexpr (has_record_schema<T>::value) {
+        return csv_columns<T>(out, name, first);
+    } else {
+        if (!first && !out.put(',')) return false;
+        first = false;
+        return out.put(name.text, name.length);
+    }
+}
+
+template <typename T, std::size_t N>
+bool csv_array_columns(FormatBuffer& out, const ColumnName& name, bool& first) {
+    for (std::size_t i = 0; i < N; i++) {
+        char index[8];
+        index[std::to_chars(index, index + sizeof(index) - 1, i).ptr - index] = '\0';
+        if (!csv_column<T>(out, name.with(index, '_'), first)) return false;
+    }
+    return true;
+}
+
+template <typename Member>
+struct ColumnsOf {
+    static bool write(FormatBuffer& out, const ColumnName& name, bool& first) {
+        return csv_column<Member>(out, name, first);
+    }
+};
+template <typename T, std::size_t N>
+struct ColumnsOf<std::array<T, N>> {
+    static bool write(FormatBuffer& out, const ColumnName& name, bool& first) {
+        return csv_array_columns<T, N>(out, name, first);
+    }
+};
+
+template <typename T>
+bool csv_columns(FormatBuffer& out, const ColumnName& name, bool& first) {
+    return std::apply([&](const auto&... fields) {
+        return (... && ColumnsOf<typename std::decay_t<decltype(fields)>::member_type>::write(
+                out, name.with(fields.name, '_'), first));
+    }, RecordSchema<T>::fields);
+}
+
+template <typename T>
+bool csv_field(FormatBuffer& out, const T& value, bool& first) {
+    if constexpr (has_record_schema<T>::value) {
+        return csv_fields(out, value, first);
+    } else {
+        if (!first && !out.put(',')) return false;
+        first = false;
+        return csv_value(out, value);
+    }
+}
+
+template <typename T, std::size_t N>
+bool csv_field(FormatBuffer& out, const std::array<T, N>& values, bool& first) {
+    for (const T& value : values) {
+        if (!csv_field(out, value, first)) return false;
+    }
+    return true;
+}
+
+template <typename T>
+bool csv_fields(FormatBuffer& out, const T& record, bool& first) {
+    return std::apply([&](const auto&... fields) {
+        return (... && csv_field(out, record.*(fields.member), first));
+    }, RecordSchema<T>::fields);
+}
+
+template <typename T>
+bool binary_field(FormatBuffer& out, const T& value) {
+    if constexpr (has_record_schema<T>::value) {
+        return binary_fields(out, value);
+    } else {
+        return binary_value(out, value);
+    }
+}
+
+template <typename T, std::size_t N>
+bool binary_field(FormatBuffer& out, const std::array<T, N>& values) {
+    for (const T& value : values) {
+        if (!binary_field(out, value)) return false;
+    }
+    return true;
+}
+
+template <typename T>
+bool binary_fields(FormatBuffer& out, const T& record) {
+    return std::apply([&](const auto&... fields) {
+        return (... && binary_field(out, record.*(fields.member)));
+    }, RecordSchema<T>::fields);
+}
+}
+
+// --- Writers ---
+
+// Header line of the CSV layout of T (with '\n').
+template <typename T>
+bool write_csv_header(FormatBuffer& out) {
+    std::size_t mark = out.mark();
+    bool first = true;
+    if (record_format::csv_columns<T>(out, record_format::ColumnName{}, first) && out.put('\n')) return true;
+    out.rollback(mark);
+    return false;
+}
+
+template <typename T>
+std::string csv_header() {
+    FormatBuffer buffer(1024);
+    write_csv_header<T>(buffer);
+    return buffer.str();
+}
+
+// One CSV row (with '\n'). False if it did not fit, nothing is written then.
+template <typename T>
+bool write_csv_record(FormatBuffer& out, const T& record) {
+    std::size_t mark = out.mark();
+    bool first = true;
+    if (record_format::csv_fields(out, record, first) && out.put('\n')) return true;
+    out.rollback(mark);
+    return false;
+}
+
+// One packed binary record. False if it did not fit, nothing is written then.
+template <typename T>
+bool write_binary_record(FormatBuffer& out, const T& record) {
+    std::size_t mark = out.mark();
+    if (record_format::binary_fields(out, record)) return true;
+    out.rollback(mark);
+    return false;
+}
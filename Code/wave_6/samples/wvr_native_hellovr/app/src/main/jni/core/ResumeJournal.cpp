@@ -0,0 +1,275 @@
+// ResumeJournal.cpp
+#include "ResumeJournal.h"
+#include "FileUtil.h"
+#include "IoWorker.h"
+#include "PerimetryLog.h"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+constexpr std::size_t CRC_OFFSET = resume_file::RECORD_BYTES - 4;
+
+void put_u32(std::uint8_t* out, std::uint32_t value) {
+    for (int i = 0; i < 4; i++) out[i] = static_cast<std::uint8_t>(value >> (8 * i));
+}
+
+std::uint32_t get_u32(const std::uint8_t* in) {
+    std::uint32_t value = 0;
+    for (int i = 0; i < 4; i++) value |= static_cast<std::uint32_t>(in[i]) << (8 * i);
+    return value;
+}
+
+void put_f32(std::uint8_t* out, float value) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    put_u32(out, bits);
+}
+
+float get_f32(const std::uint8_t* in) {
+    std::uint32_t bits = get_u32(in);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+int other_eye(int eye) {
+    return eye == 1 ? 2 : 1;
+}
+}
+
+void encode_resume_record(const ResumeRecord& record, std::uint8_t* out) {
+    out[0] = static_cast<std::uint8_t>(record.type);
+    out[1] = record.eye;
+    out[2] = static_cast<std::uint8_t>(record.point.size);
+    out[3] = record.point.luminance.index;
+    put_u32(out + 4, record.value);
+    put_u32(out + 8, record.vector);
+    put_u32(out + 12, static_cast<std::uint32_t>(record.point.longitude));
+    put_f32(out + 16, record.point.p.phi);
+    put_f32(out + 20, record.point.p.theta);
+    put_f32(out + 24, record.eccentricity_deg);
+    put_u32(out + CRC_OFFSET, crc32(out, CRC_OFFSET));
+}
+
+bool decode_resume_record(const std::uint8_t* in, ResumeRecord& record) {
+    if (get_u32(in + CRC_OFFSET) != crc32(in, CRC_OFFSET)) return false;
+    if (in[0] < static_cast<std::uint8_t>(ResumeRecordType::SessionBegin) ||
+        in[0] > static_cast<std::uint8_t>(ResumeRecordType::SessionEnd)) {
+        return false;
+    }
+    record.type = static_cast<ResumeRecordType>(in[0]);
+    record.eye = in[1];
+    record.value = get_u32(in + 4);
+    record.vector = get_u32(in + 8);
+    record.point = JournalRecord();
+    record.point.eye = in[1];
+    record.point.size = static_cast<MeteoroidSizeID>(in[2]);
+    record.point.luminance = StimulusCode{in[3]};
+    record.point.longitude = static_cast<std::int32_t>(get_u32(in + 12));
+    record.point.p.phi = get_f32(in + 16);
+    record.point.p.theta = get_f32(in + 20);
+    record.eccentricity_deg = get_f32(in + 24);
+    return true;
+}
+
+ResumeState replay_resume_journal(const std::uint8_t* data, std::size_t size) {
+    ResumeState state;
+    bool begun = false;
+    bool ended = false;
+    bool second_eye_finished = false;
+
+    for (std::size_t offset = 0; offset + resume_file::RECORD_BYTES <= size; offset += resume_file::RECORD_BYTES) {
+        ResumeRecord record;
+        if (!decode_resume_record(data + offset, record)) {
+            LOGW("Resume journal: damaged record %zu, replay stops there", state.records);
+            break;
+        }
+        state.records++;
+        ExamResumePoint& point = state.point;
+
+        switch (record.type) {
+            case ResumeRecordType::SessionBegin:
+                state = ResumeState();
+                state.records = 1;
+                state.patient_index = static_cast<int>(record.value);
+                state.point.first_eye = record.point.longitude;
+                state.point.active_eye = record.point.longitude;
+                begun = true;
+                ended = false;
+                second_eye_finished = false;
+                break;
+            case ResumeRecordType::EyeStarted:
+                point.active_eye = record.eye;
+                point.has_order = true;
+                point.order_seed = record.value;
+                point.next_vector = record.vector;
+                break;
+            case ResumeRecordType::Progress:
+            case ResumeRecordType::Response:
+                if (record.type == ResumeRecordType::Response) state.responses.push_back(record);
+                if (record.eye == point.active_eye) point.next_vector = record.vector;
+                break;
+            case ResumeRecordType::EyeFinished:
+                if (record.eye == point.first_eye) {
+                    state.first_eye_finished = true;
+                    point.active_eye = other_eye(point.first_eye);
+                    point.has_order = false;
+                    point.next_vector = 0;
+                } else {
+                    second_eye_finished = true;
+                }
+                break;
+            case ResumeRecordType::SessionEnd:
+                ended = true;
+                break;
+        }
+    }
+
+    state.resumable = begun && !ended && !second_eye_finished &&
+                      (state.point.first_eye == 1 || state.point.first_eye == 2) &&
+                      (state.point.has_order || state.first_eye_finished);
+    return state;
+}
+
+ResumeState read_resume_journal(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return ResumeState();
+    std::vector<std::uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return replay_resume_journal(bytes.data(), bytes.size());
+}
+
+void restore_sheets(GoldmannSheet& sheet, const ResumeState& state) {
+    for (const ResumeRecord& record : state.responses) {
+        const JournalRecord& point = record.point;
+        // Same order as PerimetryEngine::point_detected
+        sheet.set_longitude_normalized_angle(point.eye, point.longitude, record.eccentricity_deg);
+        sheet.add_point(point.p, point.size, point.longitude, point.eye, point.luminance);
+    }
+}
+
+// --- ResumeJournal ---
+
+struct ResumeJournal::File {
+    std::string path;
+    int fd = -1;
+};
+
+ResumeJournal::ResumeJournal(IoWorker* worker)
+        : m_worker(worker) {
+}
+
+ResumeJournal::~ResumeJournal() {
+    // Still open means the exam was not finished, it stays resumable
+    close();
+}
+
+void ResumeJournal::post(std::function<void()> job) {
+    if (m_worker) {
+        m_worker->post(std::move(job));
+    } else {
+        job();
+    }
+}
+
+void ResumeJournal::close() {
+    if (!m_file) return;
+    std::shared_ptr<File> file = std::move(m_file);
+    post([file]() {
+        if (file->fd >= 0) ::close(file->fd);
+        file->fd = -1;
+    });
+}
+
+void ResumeJournal::open(const std::string& path, bool truncate) {
+    close();
+    m_file = std::make_shared<File>();
+    m_file->path = path;
+
+    std::shared_ptr<File> file = m_file;
+    int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | (truncate ? O_TRUNC : 0);
+    post([file, flags]() {
+        file->fd = ::open(file->path.c_str(), flags, 0644);
+        if (file->fd < 0) {
+            LOGE("Resume journal: cannot open %s: %s", file->path.c_str(), std::strerror(errno));
+        }
+    });
+}
+
+void ResumeJournal::begin_session(const std::string& path, int patient_index, int first_eye) {
+    open(path, true);
+    ResumeRecord record;
+    record.type = ResumeRecordType::SessionBegin;
+    record.value = static_cast<std::uint32_t>(patient_index);
+    record.point.longitude = first_eye;
+    write(record);
+}
+
+void ResumeJournal::continue_session(const std::string& path) {
+    open(path, false);
+}
+
+void ResumeJournal::end_session() {
+    if (!m_file) return;
+    ResumeRecord record;
+    record.type = ResumeRecordType::SessionEnd;
+    write(record);
+    close();
+}
+
+void ResumeJournal::eye_started(int eye, std::uint32_t order_seed, std::size_t first_vector) {
+    ResumeRecord record;
+    record.type = ResumeRecordType::EyeStarted;
+    record.eye = static_cast<std::uint8_t>(eye);
+    record.value = order_seed;
+    record.vector = static_cast<std::uint32_t>(first_vector);
+    write(record);
+}
+
+void ResumeJournal::progress(int eye, std::size_t vectors_done) {
+    ResumeRecord record;
+    record.type = ResumeRecordType::Progress;
+    record.eye = static_cast<std::uint8_t>(eye);
+    record.vector = static_cast<std::uint32_t>(vectors_done);
+    write(record);
+}
+
+void ResumeJournal::response(const DetectedPoint& point, double eccentricity_deg, std::size_t vectors_done) {
+    ResumeRecord record;
+    record.type = ResumeRecordType::Response;
+    record.point = JournalRecord::from_detection(point);
+    record.eye = static_cast<std::uint8_t>(record.point.eye);
+    record.vector = static_cast<std::uint32_t>(vectors_done);
+    record.eccentricity_deg = static_cast<float>(eccentricity_deg);
+    write(record);
+}
+
+void ResumeJournal::eye_finished(int eye) {
+    ResumeRecord record;
+    record.type = ResumeRecordType::EyeFinished;
+    record.eye = static_cast<std::uint8_t>(eye);
+    write(record);
+}
+
+void ResumeJournal::write(const ResumeRecord& record) {
+    if (!m_file) return;
+    std::array<std::uint8_t, resume_file::RECORD_BYTES> bytes;
+    encode_resume_record(record, bytes.data());
+
+    std::shared_ptr<File> file = m_file;
+    post([file, bytes]() {
+        if (file->fd < 0) return;
+        // Synced one by one, a crash loses at most the record being written
+        if (!write_all(file->fd, reinterpret_cast<const char*>(bytes.data()), bytes.size()) ||
+            ::fdatasync(file->fd) != 0) {
+            LOGE("Resume journal: write to %s failed: %s", file->path.c_str(), std::strerror(errno));
+        }
+    });
+}
@@ -0,0 +1,101 @@
+// ResumeJournal.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ExamStateMachine.h"
+#include "JournalWriter.h"
+
+class IoWorker;
+
+enum class ResumeRecordType : std::uint8_t {
+    SessionBegin = 1,   // value: patient index, longitude: first eye
+    EyeStarted   = 2,   // value: order seed, vector: first vector
+    Progress     = 3,   // vector: vectors of the eye that are done
+    Response     = 4,   // A detected point, vector: done after it
+    EyeFinished  = 5,
+    SessionEnd   = 6,
+};
+
+// One fixed size record of the write-ahead journal.
+struct ResumeRecord {
+    ResumeRecordType type = ResumeRecordType::Progress;
+    std::uint8_t eye = 0;
+    std::uint32_t value = 0;
+    std::uint32_t vector = 0;
+    JournalRecord point;            // Response only
+    float eccentricity_deg = 0.0f;  // Response: PerimetryEngine::detected_eccentricity_deg
+};
+
+// Record layout: u8 type, u8 eye, u8 size, u8 luminance, u32 value,
+// u32 vector, i32 longitude, f32 phi, f32 theta, f32 eccentricity, u32 crc32
+// of the first 28 bytes. A record torn by a crash fails the CRC and ends
+// the replay.
+namespace resume_file {
+constexpr std::size_t RECORD_BYTES = 32;
+}
+
+void encode_resume_record(const ResumeRecord& record, std::uint8_t* out);
+bool decode_resume_record(const std::uint8_t* in, ResumeRecord& record);
+
+// Replayed journal of the last session.
+struct ResumeState {
+    bool resumable = false;         // Begun, not ended, and something to continue
+    int patient_index = 0;
+    ExamResumePoint point;
+    std::vector<ResumeRecord> responses;    // Both eyes, in order
+    bool first_eye_finished = false;
+    std::size_t records = 0;
+};
+
+// Replays the records of a journal. Stops at the first damaged record.
+ResumeState replay_resume_journal(const std::uint8_t* data, std::size_t size);
+// Replays the journal file; a missing file is not resumable.
+ResumeState read_resume_journal(const std::string& path);
+
+// Puts the responses of an interrupted exam back into the sheets, with the
+// same normative isopter moves the engine made when they were detected.
+void restore_sheets(GoldmannSheet& sheet, const ResumeState& state);
+
+// Write-ahead journal that lets an exam continue after the app was killed.
+// It holds only what the engine cannot recompute: the order seed of each
+// eye, how many vectors are done and every response (a few KB per exam).
+// Records are encoded on the calling thread and appended and fsynced one by
+// one on the IoWorker, the render thread never touches the file.
+class ResumeJournal {
+public:
+    explicit ResumeJournal(IoWorker* worker);
+    ~ResumeJournal();
+
+    ResumeJournal(const ResumeJournal&) = delete;
+    ResumeJournal& operator=(const ResumeJournal&) = delete;
+
+    // New session, replaces the journal at path
+    void begin_session(const std::string& path, int patient_index, int first_eye);
+    // Continues appending to the journal of an interrupted session
+    void continue_session(const std::string& path);
+    // Marks the session as complete and closes the journal
+    void end_session();
+    bool is_open() const { return m_file != nullptr; }
+
+    void eye_started(int eye, std::uint32_t order_seed, std::size_t first_vector);
+    // Vectors done changed without a response (the stimulus reached the center)
+    void progress(int eye, std::size_t vectors_done);
+    void response(const DetectedPoint& point, double eccentricity_deg, std::size_t vectors_done);
+    void eye_finished(int eye);
+
+private:
+    struct File;
+    void open(const std::string& path, bool truncate);
+    void close();
+    void write(const ResumeRecord& record);
+    void post(std::function<void()> job);
+
+    IoWorker* m_worker;
+    std::shared_ptr<File> m_file;
+};
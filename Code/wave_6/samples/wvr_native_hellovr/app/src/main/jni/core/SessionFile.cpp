@@ -0,0 +1,240 @@
+// SessionFile.cpp
+#include "SessionFile.h"
+#include "SheetExport.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The chunks are the in-memory arrays, written and mapped as they are
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "session files are little-endian");
+
+namespace {
+std::size_t align_up(std::size_t value) {
+    return (value + session_file::ALIGNMENT - 1) & ~(session_file::ALIGNMENT - 1);
+}
+}
+
+std::size_t session_column_element_size(SessionColumn column) {
+    std::size_t size = 0;
+    SessionData().for_each_column([column, &size](SessionColumn id, const auto& values) {
+        if (id == column) size = sizeof(values[0]);
+    });
+    return size;
+}
+
+std::string serialize_session(const SessionData& data) {
+    std::uint16_t column_count = 0;
+    data.for_each_column([&column_count](SessionColumn, const auto&) { column_count++; });
+
+    SessionFileHeader header{};
+    std::memcpy(header.magic, session_file::MAGIC, sizeof(header.magic));
+    header.version = session_file::VERSION;
+    header.column_count = column_count;
+    header.created_unix_ms = data.created_unix_ms;
+    header.patient_index = data.patient_index;
+    header.first_eye = data.first_eye;
+
+    // Layout: header, directory, then every chunk on an aligned offset
+    std::vector<SessionColumnEntry> directory;
+    std::size_t offset = align_up(sizeof(SessionFileHeader) + column_count * sizeof(SessionColumnEntry));
+    data.for_each_column([&directory, &offset](SessionColumn id, const auto& values) {
+        SessionColumnEntry entry{};
+        entry.id = static_cast<std::uint16_t>(id);
+        entry.element_size = static_cast<std::uint16_t>(sizeof(values[0]));
+        entry.offset = offset;
+        entry.count = values.size();
+        directory.push_back(entry);
+        offset = align_up(offset + values.size() * sizeof(values[0]));
+    });
+
+    std::string image(offset, '\0');
+    std::memcpy(&image[0], &header, sizeof(header));
+    std::memcpy(&image[sizeof(header)], directory.data(), directory.size() * sizeof(SessionColumnEntry));
+    std::size_t index = 0;
+    data.for_each_column([&image, &directory, &index](SessionColumn, const auto& values) {
+        if (!values.empty()) {
+            std::memcpy(&image[directory[index].offset], values.data(), values.size() * sizeof(values[0]));
+        }
+        index++;
+    });
+    return image;
+}
+
+// --- SessionFileView ---
+
+SessionFileView::~SessionFileView() {
+    close();
+}
+
+SessionFileView::SessionFileView(SessionFileView&& other) noexcept {
+    *this = std::move(other);
+}
+
+SessionFileView& SessionFileView::operator=(SessionFileView&& other) noexcept {
+    if (this != &other) {
+        close();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+        m_mapping = std::exchange(other.m_mapping, nullptr);
+        m_error = std::move(other.m_error);
+    }
+    return *this;
+}
+
+bool SessionFileView::open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        m_error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(SessionFileHeader))) {
+        ::close(fd);
+        m_error = path + ": not a session file (too small)";
+        return false;
+    }
+    std::size_t size = static_cast<std::size_t>(st.st_size);
+    void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        m_error = "cannot map " + path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    m_mapping = mapping;
+    m_data = static_cast<const unsigned char*>(mapping);
+    if (!validate(size)) {
+        std::string error = path + ": " + m_error;
+        close();
+        m_error = error;
+        return false;
+    }
+    return true;
+}
+
+bool SessionFileView::open_memory(const void* data, std::size_t size) {
+    close();
+    // Views hand out typed pointers, the image must be aligned like a mapping
+    if (reinterpret_cast<std::uintptr_t>(data) % session_file::ALIGNMENT != 0) {
+        m_error = "image is not 8-byte aligned";
+        return false;
+    }
+    m_data = static_cast<const unsigned char*>(data);
+    if (!validate(size)) {
+        std::string error = m_error;
+        close();
+        m_error = error;
+        return false;
+    }
+    return true;
+}
+
+void SessionFileView::close() {
+    if (m_mapping) ::munmap(m_mapping, m_size);
+    m_mapping = nullptr;
+    m_data = nullptr;
+    m_size = 0;
+    m_error.clear();
+}
+
+bool SessionFileView::validate(std::size_t size) {
+    m_size = size;
+    if (size < sizeof(SessionFileHeader)) {
+        m_error = "not a session file (too small)";
+        return false;
+    }
+    const SessionFileHeader& h = header();
+    if (std::memcmp(h.magic, session_file::MAGIC, sizeof(h.magic)) != 0) {
+        m_error = "not a session file (magic)";
+        return false;
+    }
+    if (h.version == 0 || h.version > session_file::VERSION) {
+        m_error = "unsupported session file version " + std::to_string(h.version);
+        return false;
+    }
+    std::size_t directory_end = sizeof(SessionFileHeader) + h.column_count * sizeof(SessionColumnEntry);
+    if (directory_end > size) {
+        m_error = "truncated column directory";
+        return false;
+    }
+
+    const SessionColumnEntry* directory = reinterpret_cast<const SessionColumnEntry*>(m_data + sizeof(SessionFileHeader));
+    for (std::uint16_t i = 0; i < h.column_count; i++) {
+        const SessionColumnEntry& entry = directory[i];
+        std::size_t expected = session_column_element_size(static_cast<SessionColumn>(entry.id));
+        if (expected != 0 && entry.element_size != expected) {
+            m_error = "column " + std::to_string(entry.id) + " has element size " + std::to_string(entry.element_size);
+            return false;
+        }
+        if (entry.element_size == 0 || entry.offset % session_file::ALIGNMENT != 0 || entry.offset < directory_end ||
+            entry.offset > size || entry.count > (size - entry.offset) / entry.element_size) {
+            m_error = "column " + std::to_string(entry.id) + " is out of bounds";
+            return false;
+        }
+    }
+    return true;
+}
+
+const SessionColumnEntry* SessionFileView::find(SessionColumn id) const {
+    if (!m_data) return nullptr;
+    const SessionColumnEntry* directory = reinterpret_cast<const SessionColumnEntry*>(m_data + sizeof(SessionFileHeader));
+    const SessionColumnEntry* last = directory + header().column_count;
+    const SessionColumnEntry* entry = std::find_if(directory, last, [id](const SessionColumnEntry& e) {
+        return e.id == static_cast<std::uint16_t>(id);
+    });
+    return entry == last ? nullptr : entry;
+}
+
+// --- Converter ---
+
+std::string session_to_legacy_csv(const SessionFileView& file, int eye) {
+    auto eyes = file.column<std::uint8_t>(SessionColumn::SheetEye);
+    auto longitudes = file.column<std::int16_t>(SessionColumn::SheetLongitude);
+    auto sizes = file.column<std::uint8_t>(SessionColumn::SheetSize);
+    auto luminances = file.column<std::uint8_t>(SessionColumn::SheetLuminance);
+    auto normalized = file.column<float>(SessionColumn::SheetNormalizedAngle);
+    auto point_counts = file.column<std::uint8_t>(SessionColumn::SheetPointCount);
+    auto phis = file.column<float>(SessionColumn::SheetPointPhi);
+    auto thetas = file.column<float>(SessionColumn::SheetPointTheta);
+
+    std::size_t rows = std::min({eyes.size(), longitudes.size(), sizes.size(), luminances.size(),
+                                 normalized.size(), point_counts.size()});
+    std::size_t points = std::min(phis.size(), thetas.size());
+
+    // Rows are formatted like SheetExport; the points are regrouped from the
+    // phi/theta columns into one scratch buffer per row
+    FormatBuffer out(sheet_csv_capacity(rows, points));
+    write_csv_header<SheetRow>(out);
+    std::vector<PolarPoint> row_points;
+    std::size_t point = 0;
+    for (std::size_t row = 0; row < rows; row++) {
+        std::size_t first = point;
+        point += point_counts[row];
+        if (eyes[row] != eye) continue;
+        if (sizes[row] >= GOLDMANN_SIZE_COUNT || luminances[row] >= GOLDMANN_STIMULUS_COUNT) continue;
+
+        row_points.clear();
+        for (std::size_t i = first; i < point && i < points; i++) {
+            PolarPoint p;
+            p.phi = phis[i];
+            p.theta = thetas[i];
+            row_points.push_back(p);
+        }
+        SheetRow sheet_row;
+        sheet_row.longitude = longitudes[row];
+        sheet_row.size = static_cast<MeteoroidSizeID>(sizes[row]);
+        sheet_row.luminance = StimulusCode{luminances[row]};
+        sheet_row.points = {row_points.data(), row_points.data() + row_points.size()};
+        sheet_row.normalized_angle = normalized[row];
+        write_csv_record(out, sheet_row);
+    }
+    return out.str();
+}
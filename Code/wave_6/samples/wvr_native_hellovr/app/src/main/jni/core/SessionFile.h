@@ -0,0 +1,238 @@
+// SessionFile.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Binary session file (*.pses), written once at the end of a patient.
+//
+// Little-endian, versioned, columnar:
+//
+//   SessionFileHeader                      32 bytes
+//   SessionColumnEntry[column_count]       24 bytes each
+//   column chunks                          8-byte aligned, fixed width
+//
+// Every column is one plain array of a fixed-width type, so a reader can map
+// the file and use the chunks in place. Rows of a table share the index over
+// all columns of that table. Readers skip column ids they do not know; a new
+// column never changes the layout of the existing ones.
+
+namespace session_file {
+constexpr char MAGIC[4] = {'P', 'S', 'E', 'S'};
+constexpr std::uint16_t VERSION = 1;
+constexpr std::size_t ALIGNMENT = 8;
+}
+
+enum class SessionColumn : std::uint16_t {
+    // Stimulus events, one row per presented vector
+    StimulusTime = 0x0100,      // int64 ns since session start
+    StimulusEye,                // uint8 1 right, 2 left
+    StimulusTrack,              // uint32 track id of the engine
+    StimulusLongitude,          // int16 deg
+    StimulusSize,               // uint8 MeteoroidSizeID
+    StimulusLuminance,          // uint8 StimulusCode::index
+
+    // Responses (button presses that recorded a point)
+    ResponseTime = 0x0200,      // int64 ns since session start
+    ResponseEye,                // uint8
+    ResponseLongitude,          // int16
+    ResponseSize,               // uint8
+    ResponseLuminance,          // uint8
+    ResponsePhi,                // float
+    ResponseTheta,              // float
+
+    // Pauses of the engine
+    PauseStart = 0x0300,        // int64 ns
+    PauseEnd,                   // int64 ns, -1 if the session ended paused
+    PauseReason,                // uint8 SessionPauseReason
+
+    // Fixation check, one row per eye tracking update
+    GazeTime = 0x0400,          // int64 ns
+    GazeOnTarget,               // uint8 0/1
+    GazeAngle,                  // float deg between gaze and fixation target
+
+    // Final sheet of each eye, entries of the test plan in export order
+    SheetEye = 0x0500,          // uint8
+    SheetLongitude,             // int16
+    SheetSize,                  // uint8
+    SheetLuminance,             // uint8
+    SheetNormalizedAngle,       // float
+    SheetPointCount,            // uint8, points follow in SheetPoint* in row order
+
+    SheetPointPhi = 0x0600,     // float
+    SheetPointTheta,            // float
+};
+
+enum class SessionPauseReason : std::uint8_t { FixationLost = 0, PauseMenu = 1 };
+
+#pragma pack(push, 1)
+struct SessionFileHeader {
+    char magic[4];
+    std::uint16_t version;
+    std::uint16_t column_count;
+    std::int64_t created_unix_ms;   // Wall clock at session start
+    std::uint32_t patient_index;    // Patients since app start
+    std::uint8_t first_eye;
+    std::uint8_t reserved[11];
+};
+
+struct SessionColumnEntry {
+    std::uint16_t id;               // SessionColumn
+    std::uint16_t element_size;
+    std::uint32_t reserved;
+    std::uint64_t offset;           // From the start of the file
+    std::uint64_t count;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(SessionFileHeader) == 32, "header layout is part of the format");
+static_assert(sizeof(SessionColumnEntry) == 24, "directory layout is part of the format");
+
+// In-memory columns of a session, filled by the SessionRecorder.
+struct SessionData {
+    std::int64_t created_unix_ms = 0;
+    std::uint32_t patient_index = 0;
+    std::uint8_t first_eye = 0;
+
+    struct {
+        std::vector<std::int64_t> time_ns;
+        std::vector<std::uint8_t> eye;
+        std::vector<std::uint32_t> track;
+        std::vector<std::int16_t> longitude;
+        std::vector<std::uint8_t> size;
+        std::vector<std::uint8_t> luminance;
+    } stimuli;
+
+    struct {
+        std::vector<std::int64_t> time_ns;
+        std::vector<std::uint8_t> eye;
+        std::vector<std::int16_t> longitude;
+        std::vector<std::uint8_t> size;
+        std::vector<std::uint8_t> luminance;
+        std::vector<float> phi;
+        std::vector<float> theta;
+    } responses;
+
+    struct {
+        std::vector<std::int64_t> start_ns;
+        std::vector<std::int64_t> end_ns;
+        std::vector<std::uint8_t> reason;
+    } pauses;
+
+    struct {
+        std::vector<std::int64_t> time_ns;
+        std::vector<std::uint8_t> on_target;
+        std::vector<float> angle_deg;
+    } gaze;
+
+    struct {
+        std::vector<std::uint8_t> eye;
+        std::vector<std::int16_t> longitude;
+        std::vector<std::uint8_t> size;
+        std::vector<std::uint8_t> luminance;
+        std::vector<float> normalized_angle;
+        std::vector<std::uint8_t> point_count;
+        std::vector<float> point_phi;
+        std::vector<float> point_theta;
+    } sheet;
+
+    // f(SessionColumn, const std::vector<T>&) for every column, in file order
+    template <typename F>
+    void for_each_column(F&& f) const {
+        f(SessionColumn::StimulusTime, stimuli.time_ns);
+        f(SessionColumn::StimulusEye, stimuli.eye);
+        f(SessionColumn::StimulusTrack, stimuli.track);
+        f(SessionColumn::StimulusLongitude, stimuli.longitude);
+        f(SessionColumn::StimulusSize, stimuli.size);
+        f(SessionColumn::StimulusLuminance, stimuli.luminance);
+
+        f(SessionColumn::ResponseTime, responses.time_ns);
+        f(SessionColumn::ResponseEye, responses.eye);
+        f(SessionColumn::ResponseLongitude, responses.longitude);
+        f(SessionColumn::ResponseSize, responses.size);
+        f(SessionColumn::ResponseLuminance, responses.luminance);
+        f(SessionColumn::ResponsePhi, responses.phi);
+        f(SessionColumn::ResponseTheta, responses.theta);
+
+        f(SessionColumn::PauseStart, pauses.start_ns);
+        f(SessionColumn::PauseEnd, pauses.end_ns);
+        f(SessionColumn::PauseReason, pauses.reason);
+
+        f(SessionColumn::GazeTime, gaze.time_ns);
+        f(SessionColumn::GazeOnTarget, gaze.on_target);
+        f(SessionColumn::GazeAngle, gaze.angle_deg);
+
+        f(SessionColumn::SheetEye, sheet.eye);
+        f(SessionColumn::SheetLongitude, sheet.longitude);
+        f(SessionColumn::SheetSize, sheet.size);
+        f(SessionColumn::SheetLuminance, sheet.luminance);
+        f(SessionColumn::SheetNormalizedAngle, sheet.normalized_angle);
+        f(SessionColumn::SheetPointCount, sheet.point_count);
+        f(SessionColumn::SheetPointPhi, sheet.point_phi);
+        f(SessionColumn::SheetPointTheta, sheet.point_theta);
+    }
+};
+
+// Element size of a known column, 0 for unknown ids.
+std::size_t session_column_element_size(SessionColumn column);
+
+// Complete file image of a session.
+std::string serialize_session(const SessionData& data);
+
+// Fixed-width column inside a mapped session file.
+template <typename T>
+struct ColumnView {
+    const T* first = nullptr;
+    std::size_t count = 0;
+
+    const T* begin() const { return first; }
+    const T* end() const { return first + count; }
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T& operator[](std::size_t i) const { return first[i]; }
+};
+
+// Zero-copy reader: maps the file read-only and hands out views into it.
+// Views stay valid as long as the SessionFileView lives.
+class SessionFileView {
+public:
+    SessionFileView() = default;
+    ~SessionFileView();
+    SessionFileView(SessionFileView&& other) noexcept;
+    SessionFileView& operator=(SessionFileView&& other) noexcept;
+    SessionFileView(const SessionFileView&) = delete;
+    SessionFileView& operator=(const SessionFileView&) = delete;
+
+    // False (with error()) if the file is missing, truncated or not a
+    // session file of a supported version.
+    bool open(const std::string& path);
+    // Same checks on a file image already in memory (not owned).
+    bool open_memory(const void* data, std::size_t size);
+    void close();
+
+    bool is_open() const { return m_data != nullptr; }
+    const std::string& error() const { return m_error; }
+    const SessionFileHeader& header() const { return *reinterpret_cast<const SessionFileHeader*>(m_data); }
+
+    // Empty if the column is not in the file or T has the wrong width.
+    template <typename T>
+    ColumnView<T> column(SessionColumn id) const {
+        const SessionColumnEntry* entry = find(id);
+        if (!entry || entry->element_size != sizeof(T)) return {};
+        return {reinterpret_cast<const T*>(m_data + entry->offset), static_cast<std::size_t>(entry->count)};
+    }
+
+private:
+    const SessionColumnEntry* find(SessionColumn id) const;
+    bool validate(std::size_t size);
+
+    const unsigned char* m_data = nullptr;
+    std::size_t m_size = 0;
+    void* m_mapping = nullptr;      // Owned mmap, nullptr for open_memory
+    std::string m_error;
+};
+
+// Legacy final CSV of one eye (see format_sheet_csv), for Code/Analyisis.
+std::string session_to_legacy_csv(const SessionFileView& file, int eye);
@@ -0,0 +1,104 @@
+// SessionRecorder.cpp
+#include "SessionRecorder.h"
+
+#include <utility>
+
+namespace {
+// One exam is about 10 min at 72 fps; growth is rare after this
+constexpr std::size_t FRAME_RESERVE = 72 * 60 * 10;
+constexpr std::size_t EVENT_RESERVE = 1024;
+}
+
+void SessionRecorder::begin(EngineClock::time_point start, std::int64_t created_unix_ms,
+                            std::uint32_t patient_index, int first_eye) {
+    m_data = std::make_shared<SessionData>();
+    m_data->created_unix_ms = created_unix_ms;
+    m_data->patient_index = patient_index;
+    m_data->first_eye = static_cast<std::uint8_t>(first_eye);
+    m_start = start;
+    m_last_track = 0;
+    m_paused = false;
+
+    auto& s = m_data->stimuli;
+    s.time_ns.reserve(EVENT_RESERVE); s.eye.reserve(EVENT_RESERVE); s.track.reserve(EVENT_RESERVE);
+    s.longitude.reserve(EVENT_RESERVE); s.size.reserve(EVENT_RESERVE); s.luminance.reserve(EVENT_RESERVE);
+    auto& g = m_data->gaze;
+    g.time_ns.reserve(FRAME_RESERVE); g.on_target.reserve(FRAME_RESERVE); g.angle_deg.reserve(FRAME_RESERVE);
+}
+
+std::int64_t SessionRecorder::since_start(EngineClock::time_point time) const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time - m_start).count();
+}
+
+void SessionRecorder::on_frame(const PerimetryEngine& engine, EngineClock::time_point time) {
+    if (!m_data || engine.m_perimetry_status != PerimetryStatus::Running) return;
+    const PerimetryVector* vec = engine.current_vector();
+    if (!vec || engine.track_id() == m_last_track) return;
+    m_last_track = engine.track_id();
+
+    auto& s = m_data->stimuli;
+    s.time_ns.push_back(since_start(time));
+    s.eye.push_back(static_cast<std::uint8_t>(engine.mActiveEye));
+    s.track.push_back(m_last_track);
+    s.longitude.push_back(static_cast<std::int16_t>(vec->angle_deg));
+    s.size.push_back(static_cast<std::uint8_t>(vec->size));
+    s.luminance.push_back(vec->luminance.index);
+}
+
+void SessionRecorder::on_response(const DetectedPoint& point, EngineClock::time_point time) {
+    if (!m_data) return;
+    auto& r = m_data->responses;
+    r.time_ns.push_back(since_start(time));
+    r.eye.push_back(static_cast<std::uint8_t>(std::get<3>(point)));
+    r.longitude.push_back(static_cast<std::int16_t>(std::get<2>(point)));
+    r.size.push_back(static_cast<std::uint8_t>(std::get<1>(point)));
+    r.luminance.push_back(std::get<4>(point).index);
+    r.phi.push_back(std::get<0>(point).phi);
+    r.theta.push_back(std::get<0>(point).theta);
+}
+
+void SessionRecorder::on_pause(EngineClock::time_point time, SessionPauseReason reason) {
+    if (!m_data || m_paused) return;
+    m_paused = true;
+    auto& p = m_data->pauses;
+    p.start_ns.push_back(since_start(time));
+    p.end_ns.push_back(-1);
+    p.reason.push_back(static_cast<std::uint8_t>(reason));
+}
+
+void SessionRecorder::on_resume(EngineClock::time_point time) {
+    if (!m_data || !m_paused) return;
+    m_paused = false;
+    m_data->pauses.end_ns.back() = since_start(time);
+}
+
+void SessionRecorder::on_gaze(EngineClock::time_point time, bool on_target, float angle_deg) {
+    if (!m_data) return;
+    auto& g = m_data->gaze;
+    g.time_ns.push_back(since_start(time));
+    g.on_target.push_back(on_target ? 1 : 0);
+    g.angle_deg.push_back(angle_deg);
+}
+
+void SessionRecorder::on_eye_finished(const GoldmannSheet& sheet, int eye) {
+    if (!m_data) return;
+    auto& t = m_data->sheet;
+    sheet.for_each_entry(eye, [&t, eye](int longitude, MeteoroidSizeID size, StimulusCode luminance,
+                                       const SheetEntry& entry, GoldmannSheet::PointRange points) {
+        t.eye.push_back(static_cast<std::uint8_t>(eye));
+        t.longitude.push_back(static_cast<std::int16_t>(longitude));
+        t.size.push_back(static_cast<std::uint8_t>(size));
+        t.luminance.push_back(luminance.index);
+        t.normalized_angle.push_back(entry.normalized_angle);
+        t.point_count.push_back(static_cast<std::uint8_t>(points.size()));
+        for (const PolarPoint& p : points) {
+            t.point_phi.push_back(p.phi);
+            t.point_theta.push_back(p.theta);
+        }
+    });
+}
+
+std::shared_ptr<const SessionData> SessionRecorder::take() {
+    m_paused = false;
+    return std::move(m_data);
+}
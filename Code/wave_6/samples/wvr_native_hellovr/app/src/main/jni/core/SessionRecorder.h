@@ -0,0 +1,45 @@
+// SessionRecorder.h
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "EngineClock.h"
+#include "PerimetryEngine.h"
+#include "SessionFile.h"
+
+// Collects the columns of the session file on the render thread. Every call
+// appends to preallocated vectors; nothing is formatted or written here.
+// take() hands the finished session over, e.g. to the IoWorker.
+class SessionRecorder {
+public:
+    // Starts a new, empty session. Times in the file are relative to start.
+    void begin(EngineClock::time_point start, std::int64_t created_unix_ms,
+               std::uint32_t patient_index, int first_eye);
+
+    // Once per frame after the engine tick, adds a row for every new vector
+    void on_frame(const PerimetryEngine& engine, EngineClock::time_point time);
+    void on_response(const DetectedPoint& point, EngineClock::time_point time);
+    // Pause and resume of the engine. Nested pauses (fixation lost, then
+    // the pause menu) stay one row with the reason of the first one.
+    void on_pause(EngineClock::time_point time, SessionPauseReason reason);
+    void on_resume(EngineClock::time_point time);
+    void on_gaze(EngineClock::time_point time, bool on_target, float angle_deg);
+    // Appends the final sheet of eye in export order
+    void on_eye_finished(const GoldmannSheet& sheet, int eye);
+
+    const SessionData& data() const { return *m_data; }
+    bool active() const { return m_data != nullptr; }
+
+    // Ends the session and returns its data; the recorder is inactive until
+    // the next begin().
+    std::shared_ptr<const SessionData> take();
+
+private:
+    std::int64_t since_start(EngineClock::time_point time) const;
+
+    std::shared_ptr<SessionData> m_data;
+    EngineClock::time_point m_start{};
+    std::uint32_t m_last_track = 0;
+    bool m_paused = false;
+};
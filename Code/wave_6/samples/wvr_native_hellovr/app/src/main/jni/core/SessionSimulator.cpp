@@ -0,0 +1,101 @@
+// SessionSimulator.cpp
+#include "SessionSimulator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <utility>
+
+SimulatedPatient SimulatedPatient::normative(double age_years) {
+    std::vector<int> meridians;
+    for (const PerimetryVector& vec : METEOROID_LONGITUDES_DEG) meridians.push_back(vec.angle_deg);
+    auto isopters = std::make_shared<NormativeIsopters>(evaluate_normative_isopters(age_years, meridians));
+
+    SimulatedPatient patient;
+    patient.isopter_deg = [isopters](int eye, const PerimetryVector& vec) {
+        return std::max(0.0, static_cast<double>(isopters->expected(eye, vec.angle_deg, vec.size, vec.luminance)));
+    };
+    return patient;
+}
+
+SessionSimulator::SessionSimulator(SimulatedPatient patient, double frame_rate_hz)
+        : m_patient(std::move(patient)),
+          m_frame_seconds(1.0 / frame_rate_hz),
+          m_engine(&m_clock) {
+}
+
+SessionReport SessionSimulator::run(const std::vector<int>& eyes) {
+    SessionReport report;
+    auto wall_start = std::chrono::steady_clock::now();
+    for (int eye : eyes) {
+        EyeSimulationResult result = run_eye(eye);
+        report.simulated_seconds += result.simulated_seconds;
+        report.eyes.push_back(result);
+    }
+    report.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    return report;
+}
+
+EyeSimulationResult SessionSimulator::run_eye(int eye) {
+    EyeSimulationResult result;
+    result.eye = eye;
+
+    m_engine.reset_animation();
+    m_engine.mActiveEye = eye;
+    m_engine.start_animation();
+    result.vectors = static_cast<int>(m_engine.vector_count());
+    double start = m_clock.elapsed_seconds();
+
+    // Pending button press: the vector it belongs to and when it happens
+    const PerimetryVector* seen_vec = nullptr;
+    EngineClock::time_point press_time;
+
+    // Previous frame, to find the exact moment the isopter was crossed
+    const PerimetryVector* last_vec = nullptr;
+    EngineClock::time_point last_time = m_clock.now();
+    double last_eccentricity = 90.0;
+
+    while (m_engine.m_perimetry_status != PerimetryStatus::Done && result.frames < max_frames_per_eye) {
+        m_clock.advance_seconds(m_frame_seconds);
+        EngineClock::time_point now = m_clock.now();
+        StimulusToDraw stimulus = m_engine.tick(now).stimulus;
+        result.frames++;
+
+        const PerimetryVector* vec = m_engine.current_vector();
+        if (!stimulus.is_visible || !vec) {
+            last_vec = nullptr;
+            continue;
+        }
+        double eccentricity = m_engine.current_eccentricity_deg();
+
+        if (seen_vec != vec) {
+            // Vector changed (or nothing seen yet): check whether it becomes visible now
+            seen_vec = nullptr;
+            double isopter = m_patient.isopter_deg ? m_patient.isopter_deg(eye, *vec) : 0.0;
+            if (isopter > 0.0 && eccentricity <= isopter) {
+                EngineClock::time_point crossing = now;
+                if (last_vec == vec && last_eccentricity > isopter) {
+                    double f = (last_eccentricity - isopter) / (last_eccentricity - eccentricity);
+                    crossing = last_time + std::chrono::duration_cast<EngineClock::duration>((now - last_time) * f);
+                }
+                seen_vec = vec;
+                press_time = crossing + std::chrono::duration_cast<EngineClock::duration>(
+                        std::chrono::duration<double>(m_patient.reaction_time_s));
+            }
+        } else if (now >= press_time) {
+            // The press is handled in the next input poll, with its own timestamp
+            m_engine.point_detected(press_time);
+            result.detections++;
+            seen_vec = nullptr;
+            vec = nullptr;
+        }
+
+        last_vec = vec;
+        last_time = now;
+        last_eccentricity = eccentricity;
+    }
+
+    result.completed = m_engine.m_perimetry_status == PerimetryStatus::Done;
+    result.simulated_seconds = m_clock.elapsed_seconds() - start;
+    return result;
+}
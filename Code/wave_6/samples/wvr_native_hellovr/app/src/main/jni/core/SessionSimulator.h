@@ -0,0 +1,61 @@
+// SessionSimulator.h
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "EngineClock.h"
+#include "PerimetryEngine.h"
+
+// Scripted patient for simulated sessions.
+struct SimulatedPatient {
+    // Eccentricity (deg) at which the stimulus of this vector is first seen,
+    // <= 0 if it is never seen.
+    std::function<double(int eye, const PerimetryVector& vec)> isopter_deg;
+    double reaction_time_s = REACTION_TIME;
+
+    // Sees every stimulus exactly at the normative isopter of its meridian
+    // for this age.
+    static SimulatedPatient normative(double age_years = DEFAULT_PATIENT_AGE_YEARS);
+};
+
+struct EyeSimulationResult {
+    int eye = 0;
+    int vectors = 0;            // Vectors in the shuffled protocol
+    int frames = 0;
+    int detections = 0;
+    double simulated_seconds = 0.0;
+    bool completed = false;     // Engine reached Done before max_frames
+};
+
+struct SessionReport {
+    std::vector<EyeSimulationResult> eyes;
+    double simulated_seconds = 0.0;
+    double wall_seconds = 0.0;
+
+    double speedup() const { return wall_seconds > 0.0 ? simulated_seconds / wall_seconds : 0.0; }
+};
+
+// Runs complete exams on a PerimetryEngine driven by a ManualClock, one
+// frame per step, as fast as the host allows. Used by the regression tests
+// and by tools/simulate_session to estimate protocol durations.
+class SessionSimulator {
+public:
+    explicit SessionSimulator(SimulatedPatient patient, double frame_rate_hz = 72.0);
+
+    SessionReport run(const std::vector<int>& eyes = {1, 2});
+
+    // Upper bound per eye, protects against a protocol that never finishes
+    int max_frames_per_eye = 10 * 60 * 60 * 72;
+
+    PerimetryEngine& engine() { return m_engine; }
+    const ManualClock& clock() const { return m_clock; }
+
+private:
+    EyeSimulationResult run_eye(int eye);
+
+    SimulatedPatient m_patient;
+    double m_frame_seconds;
+    ManualClock m_clock;
+    PerimetryEngine m_engine;
+};
@@ -0,0 +1,728 @@
+// SessionStore.cpp
+#include "SessionStore.h"
+#include "FileUtil.h"
+#include "SessionFile.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <ctime>
+#include <fstream>
+#include <tuple>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+#pragma pack(push, 1)
+struct IndexFileHeader {
+    char magic[4];
+    std::uint16_t version;
+    std::uint16_t reserved;
+    std::uint64_t data_bytes;       // Covered part of the data file
+    std::uint32_t subject_count;
+    std::uint32_t hash_count;
+    std::uint32_t entry_count;
+    std::uint32_t crc;              // Of everything after the header
+};
+#pragma pack(pop)
+static_assert(sizeof(IndexFileHeader) == 32, "index layout is part of the format");
+
+// A session of a few thousand points, anything larger is a broken record
+constexpr std::uint32_t MAX_PAYLOAD_BYTES = 64u << 20;
+
+auto index_key(const StoreIndexEntry& e) {
+    return std::make_tuple(e.size, e.luminance, e.meridian, e.subject, e.eye, e.date, e.time, e.points_offset);
+}
+
+bool index_less(const StoreIndexEntry& a, const StoreIndexEntry& b) {
+    return index_key(a) < index_key(b);
+}
+
+template <typename T>
+void append_raw(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+bool read_at(int fd, void* data, std::size_t size, std::uint64_t offset) {
+    auto* p = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t n = ::pread(fd, p, size, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<std::size_t>(n);
+        offset += static_cast<std::uint64_t>(n);
+    }
+    return true;
+}
+
+std::uint64_t fnv1a(std::uint64_t hash, const void* data, std::size_t size) {
+    const auto* bytes = static_cast<const std::uint8_t*>(data);
+    for (std::size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// Whether a complete record that checks out starts anywhere in bytes, i.e.
+// they are not just the torn tail of one interrupted append
+bool holds_intact_record(const std::vector<char>& bytes) {
+    StoreRecordHeader header;
+    for (std::size_t at = 0; at + sizeof(header) <= bytes.size(); at++) {
+        std::memcpy(&header, bytes.data() + at, sizeof(header));
+        bool known = header.type == static_cast<std::uint8_t>(StoreRecordType::Session) ||
+                     header.type == static_cast<std::uint8_t>(StoreRecordType::Subject);
+        if (!known || header.reserved[0] || header.reserved[1] || header.reserved[2] || header.reserved2 ||
+            header.payload_bytes == 0 || header.payload_bytes > bytes.size() - at - sizeof(header)) {
+            continue;
+        }
+        if (crc32(bytes.data() + at + sizeof(header), header.payload_bytes) == header.crc) return true;
+    }
+    return false;
+}
+
+template <typename T>
+std::uint64_t fnv1a(std::uint64_t hash, const std::vector<T>& values) {
+    return fnv1a(hash, values.data(), values.size() * sizeof(T));
+}
+}
+
+std::uint64_t measurement_content_hash(std::uint32_t subject, int eye, const MeasurementTable& table) {
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    std::uint8_t eye_byte = static_cast<std::uint8_t>(eye);
+    std::uint8_t layout = static_cast<std::uint8_t>(table.layout);
+    hash = fnv1a(hash, &subject, sizeof(subject));
+    hash = fnv1a(hash, &eye_byte, 1);
+    hash = fnv1a(hash, &layout, 1);
+    hash = fnv1a(hash, table.longitude);
+    hash = fnv1a(hash, table.size);
+    hash = fnv1a(hash, table.luminance);
+    hash = fnv1a(hash, table.normed_value);
+    hash = fnv1a(hash, table.point_begin);
+    hash = fnv1a(hash, table.phi);
+    hash = fnv1a(hash, table.theta);
+    return hash;
+}
+
+SessionStore::~SessionStore() {
+    close();
+}
+
+bool SessionStore::open(const std::string& directory) {
+    close();
+    m_error.clear();
+    m_directory = directory;
+    if (!m_directory.empty() && m_directory.back() != '/') m_directory += "/";
+
+    std::string path = m_directory + session_store::DATA_FILE;
+    m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        m_error = path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (::fstat(m_fd, &st) != 0) {
+        m_error = path + ": " + std::strerror(errno);
+        close();
+        return false;
+    }
+
+    char header[session_store::FILE_HEADER_BYTES] = {};
+    if (st.st_size == 0) {
+        std::memcpy(header, session_store::DATA_MAGIC, 4);
+        std::memcpy(header + 4, &session_store::VERSION, 2);
+        if (!write_all(m_fd, header, sizeof(header)) || ::fdatasync(m_fd) != 0) {
+            m_error = path + ": " + std::strerror(errno);
+            close();
+            return false;
+        }
+        m_data_bytes = sizeof(header);
+    } else {
+        std::uint16_t version = 0;
+        if (!read_at(m_fd, header, sizeof(header), 0) || std::memcmp(header, session_store::DATA_MAGIC, 4) != 0 ||
+            (std::memcpy(&version, header + 4, 2), version != session_store::VERSION)) {
+            m_error = path + ": not a session store of version " + std::to_string(session_store::VERSION);
+            close();
+            return false;
+        }
+        m_data_bytes = static_cast<std::uint64_t>(st.st_size);
+    }
+
+    if (!load_index() || m_indexed_bytes > m_data_bytes) {
+        m_index.clear();
+        m_hashes.clear();
+        m_ages.clear();
+        m_indexed_bytes = session_store::FILE_HEADER_BYTES;
+    }
+    m_sorted = m_index.size();
+    if (!scan(m_indexed_bytes)) {
+        close();
+        return false;
+    }
+    m_synced_bytes = m_data_bytes;
+    return true;
+}
+
+void SessionStore::close() {
+    if (m_fd < 0) return;
+    if (m_indexed_bytes != m_data_bytes) save_index();
+    ::close(m_fd);
+    m_fd = -1;
+    m_index.clear();
+    m_hashes.clear();
+    m_ages.clear();
+    m_sorted = 0;
+    m_data_bytes = 0;
+    m_indexed_bytes = 0;
+    m_synced_bytes = 0;
+    m_unsynced_hashes.clear();
+    m_unsynced_ages.clear();
+    m_broken_records = 0;
+}
+
+bool SessionStore::load_index() {
+    std::ifstream in(m_directory + session_store::INDEX_FILE, std::ios::binary);
+    if (!in) return false;
+    std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    IndexFileHeader header;
+    if (content.size() < sizeof(header)) return false;
+    std::memcpy(&header, content.data(), sizeof(header));
+    if (std::memcmp(header.magic, session_store::INDEX_MAGIC, 4) != 0 || header.version != session_store::VERSION) {
+        return false;
+    }
+    std::size_t expected = sizeof(header) + header.subject_count * sizeof(StoredSubject) +
+                           header.hash_count * sizeof(std::uint64_t) +
+                           header.entry_count * sizeof(StoreIndexEntry);
+    if (content.size() != expected ||
+        crc32(content.data() + sizeof(header), content.size() - sizeof(header)) != header.crc) {
+        return false;
+    }
+
+    const char* p = content.data() + sizeof(header);
+    for (std::uint32_t i = 0; i < header.subject_count; i++, p += sizeof(StoredSubject)) {
+        StoredSubject subject;
+        std::memcpy(&subject, p, sizeof(subject));
+        m_ages[subject.subject] = subject.age_years;
+    }
+    for (std::uint32_t i = 0; i < header.hash_count; i++, p += sizeof(std::uint64_t)) {
+        std::uint64_t hash;
+        std::memcpy(&hash, p, sizeof(hash));
+        m_hashes.insert(hash);
+    }
+    m_index.resize(header.entry_count);
+    std::memcpy(m_index.data(), p, header.entry_count * sizeof(StoreIndexEntry));
+    m_indexed_bytes = header.data_bytes;
+    return true;
+}
+
+bool SessionStore::save_index() {
+    if (m_fd < 0) return false;
+    sort_index();
+
+    IndexFileHeader header{};
+    std::memcpy(header.magic, session_store::INDEX_MAGIC, 4);
+    header.version = session_store::VERSION;
+    header.data_bytes = m_data_bytes;
+    header.subject_count = static_cast<std::uint32_t>(m_ages.size());
+    header.hash_count = static_cast<std::uint32_t>(m_hashes.size());
+    header.entry_count = static_cast<std::uint32_t>(m_index.size());
+
+    std::string body;
+    body.reserve(m_ages.size() * sizeof(StoredSubject) + m_hashes.size() * sizeof(std::uint64_t) +
+                 m_index.size() * sizeof(StoreIndexEntry));
+    for (const auto& age : m_ages) {
+        StoredSubject subject{};
+        subject.subject = age.first;
+        subject.age_years = age.second;
+        append_raw(body, subject);
+    }
+    for (std::uint64_t hash : m_hashes) append_raw(body, hash);
+    body.append(reinterpret_cast<const char*>(m_index.data()), m_index.size() * sizeof(StoreIndexEntry));
+    header.crc = crc32(body.data(), body.size());
+
+    std::string content;
+    content.reserve(sizeof(header) + body.size());
+    append_raw(content, header);
+    content += body;
+    if (!write_file_atomic(m_directory + session_store::INDEX_FILE, content)) {
+        m_error = "cannot write the index";
+        return false;
+    }
+    m_indexed_bytes = m_data_bytes;
+    return true;
+}
+
+bool SessionStore::scan(std::uint64_t from) {
+    std::vector<char> payload;
+    std::uint64_t offset = from;
+    while (offset < m_data_bytes) {
+        StoreRecordHeader header;
+        bool torn = offset + sizeof(header) > m_data_bytes;
+        if (!torn) {
+            if (!read_at(m_fd, &header, sizeof(header), offset)) {
+                m_error = "cannot read the record at offset " + std::to_string(offset);
+                return false;
+            }
+            if (header.payload_bytes > MAX_PAYLOAD_BYTES) {
+                // The length itself is broken, the records behind it cannot be found
+                m_error = "broken record header at offset " + std::to_string(offset);
+                return false;
+            }
+            if (offset + sizeof(header) + header.payload_bytes > m_data_bytes) {
+                // Runs past the end: the torn tail of an interrupted append,
+                // unless intact records follow and only its length is broken
+                payload.resize(m_data_bytes - offset - sizeof(header));
+                if (!read_at(m_fd, payload.data(), payload.size(), offset + sizeof(header))) {
+                    m_error = "cannot read the record at offset " + std::to_string(offset);
+                    return false;
+                }
+                if (holds_intact_record(payload)) {
+                    m_error = "broken record length at offset " + std::to_string(offset);
+                    return false;
+                }
+                torn = true;
+            }
+        }
+        if (torn) {
+            // Everything before the torn tail stays
+            if (::ftruncate(m_fd, static_cast<off_t>(offset)) != 0) {
+                m_error = "cannot cut off the torn tail: " + std::string(std::strerror(errno));
+                return false;
+            }
+            m_data_bytes = offset;
+            break;
+        }
+        payload.resize(header.payload_bytes);
+        bool ok = read_at(m_fd, payload.data(), payload.size(), offset + sizeof(header)) &&
+                  crc32(payload.data(), payload.size()) == header.crc;
+        if (ok && header.type == static_cast<std::uint8_t>(StoreRecordType::Session)) {
+            StoredSessionHeader session;
+            ok = payload.size() >= sizeof(session);
+            if (ok) {
+                std::memcpy(&session, payload.data(), sizeof(session));
+                ok = payload.size() == sizeof(session) + std::uint64_t{session.row_count} * sizeof(StoredRow) +
+                                               std::uint64_t{session.point_count} * 2 * sizeof(float);
+            }
+            if (ok) {
+                std::vector<StoredRow> rows(session.row_count);
+                std::memcpy(rows.data(), payload.data() + sizeof(session), rows.size() * sizeof(StoredRow));
+                index_session(session, rows.data(),
+                              offset + sizeof(header) + sizeof(session) + rows.size() * sizeof(StoredRow));
+            }
+        } else if (ok && header.type == static_cast<std::uint8_t>(StoreRecordType::Subject)) {
+            StoredSubject subject;
+            ok = payload.size() == sizeof(subject);
+            if (ok) {
+                std::memcpy(&subject, payload.data(), sizeof(subject));
+                m_ages[subject.subject] = subject.age_years;
+            }
+        }
+        // A complete record that does not check out is skipped by its
+        // length; the records behind it are still valid
+        if (!ok) m_broken_records++;
+        offset += sizeof(header) + header.payload_bytes;
+    }
+    return true;
+}
+
+void SessionStore::index_session(const StoredSessionHeader& session, const StoredRow* rows,
+                                 std::uint64_t points_offset) {
+    m_hashes.insert(session.content_hash);
+    for (std::uint32_t r = 0; r < session.row_count; r++) {
+        const StoredRow& row = rows[r];
+        StoreIndexEntry entry{};
+        entry.size = row.size;
+        entry.luminance = row.luminance;
+        entry.meridian = row.longitude;
+        entry.subject = session.subject;
+        entry.date = session.date;
+        entry.time = session.time;
+        entry.eye = session.eye;
+        entry.layout = session.layout;
+        entry.point_count = static_cast<std::uint16_t>(std::min<std::uint32_t>(row.point_count, 0xFFFF));
+        entry.normed_value = row.normed_value;
+        entry.points_offset = points_offset + std::uint64_t{row.first_point} * 2 * sizeof(float);
+        m_index.push_back(entry);
+    }
+}
+
+void SessionStore::sort_index() {
+    if (m_sorted == m_index.size()) return;
+    auto middle = m_index.begin() + static_cast<std::ptrdiff_t>(m_sorted);
+    std::sort(middle, m_index.end(), index_less);
+    std::inplace_merge(m_index.begin(), middle, m_index.end(), index_less);
+    m_sorted = m_index.size();
+}
+
+bool SessionStore::append_record(StoreRecordType type, const std::string& payload) {
+    StoreRecordHeader header{};
+    header.type = static_cast<std::uint8_t>(type);
+    header.payload_bytes = static_cast<std::uint32_t>(payload.size());
+    header.crc = crc32(payload.data(), payload.size());
+
+    std::string record;
+    record.reserve(sizeof(header) + payload.size());
+    append_raw(record, header);
+    record += payload;
+    if (!write_all(m_fd, record.data(), record.size()) || (!m_deferred_sync && ::fdatasync(m_fd) != 0)) {
+        m_error = std::string("cannot append: ") + std::strerror(errno);
+        if (::ftruncate(m_fd, static_cast<off_t>(m_data_bytes)) != 0) {
+            m_error += ", cannot cut off the partial record";
+        }
+        return false;
+    }
+    m_data_bytes += record.size();
+    if (!m_deferred_sync) m_synced_bytes = m_data_bytes;
+    return true;
+}
+
+bool SessionStore::sync() {
+    if (m_fd < 0) return false;
+    if (::fdatasync(m_fd) != 0) {
+        m_error = std::string("cannot sync: ") + std::strerror(errno);
+        drop_unsynced();
+        return false;
+    }
+    m_synced_bytes = m_data_bytes;
+    m_unsynced_hashes.clear();
+    m_unsynced_ages.clear();
+    return true;
+}
+
+void SessionStore::drop_unsynced() {
+    if (::ftruncate(m_fd, static_cast<off_t>(m_synced_bytes)) == 0) {
+        m_data_bytes = m_synced_bytes;
+        m_indexed_bytes = std::min(m_indexed_bytes, m_data_bytes);
+    } else {
+        // The records stay in the file and are indexed again on the next open
+        m_error += ", cannot cut off the unsynced records";
+    }
+    for (std::uint64_t hash : m_unsynced_hashes) m_hashes.erase(hash);
+    for (auto it = m_unsynced_ages.rbegin(); it != m_unsynced_ages.rend(); ++it) {
+        if (it->second < 0) {
+            m_ages.erase(it->first);
+        } else {
+            m_ages[it->first] = static_cast<std::uint8_t>(it->second);
+        }
+    }
+    m_unsynced_hashes.clear();
+    m_unsynced_ages.clear();
+
+    auto unsynced = [this](const StoreIndexEntry& e) { return e.points_offset > m_synced_bytes; };
+    auto sorted_end = m_index.begin() + static_cast<std::ptrdiff_t>(m_sorted);
+    m_sorted -= static_cast<std::size_t>(std::count_if(m_index.begin(), sorted_end, unsynced));
+    m_index.erase(std::remove_if(m_index.begin(), m_index.end(), unsynced), m_index.end());
+}
+
+StoreAppendResult SessionStore::append(const StoredSessionInfo& info, const MeasurementTable& table) {
+    if (m_fd < 0) {
+        m_error = "store is not open";
+        return StoreAppendResult::Failed;
+    }
+    std::uint64_t hash = info.content_hash ? info.content_hash
+                                           : measurement_content_hash(info.subject, info.eye, table);
+    if (contains(hash)) return StoreAppendResult::Duplicate;
+    if (table.point_begin.size() != table.rows() + 1) {
+        m_error = "table without point_begin";
+        return StoreAppendResult::Failed;
+    }
+
+    StoredSessionHeader session{};
+    session.content_hash = hash;
+    session.subject = info.subject;
+    session.date = info.date;
+    session.time = info.time;
+    session.eye = static_cast<std::uint8_t>(info.eye);
+    session.layout = static_cast<std::uint8_t>(table.layout);
+    session.row_count = static_cast<std::uint32_t>(table.rows());
+    session.point_count = static_cast<std::uint32_t>(table.points());
+
+    std::vector<StoredRow> rows(table.rows());
+    for (std::size_t r = 0; r < table.rows(); r++) {
+        rows[r].longitude = table.longitude[r];
+        rows[r].size = table.size[r];
+        rows[r].luminance = table.luminance[r];
+        rows[r].normed_value = table.normed_value[r];
+        rows[r].first_point = table.point_begin[r];
+        rows[r].point_count = table.point_begin[r + 1] - table.point_begin[r];
+    }
+
+    std::string payload;
+    payload.reserve(sizeof(session) + rows.size() * sizeof(StoredRow) + table.points() * 2 * sizeof(float));
+    append_raw(payload, session);
+    payload.append(reinterpret_cast<const char*>(rows.data()), rows.size() * sizeof(StoredRow));
+    for (std::size_t p = 0; p < table.points(); p++) {
+        append_raw(payload, table.phi[p]);
+        append_raw(payload, table.theta[p]);
+    }
+
+    std::uint64_t offset = m_data_bytes;
+    if (!append_record(StoreRecordType::Session, payload)) return StoreAppendResult::Failed;
+    index_session(session, rows.data(),
+                  offset + sizeof(StoreRecordHeader) + sizeof(session) + rows.size() * sizeof(StoredRow));
+    if (m_deferred_sync) m_unsynced_hashes.push_back(hash);
+    return StoreAppendResult::Stored;
+}
+
+bool SessionStore::set_subject_age(std::uint32_t subject, int age_years) {
+    if (m_fd < 0) return false;
+    StoredSubject record{};
+    record.subject = subject;
+    record.age_years = static_cast<std::uint8_t>(std::clamp(age_years, 0, 255));
+    std::string payload;
+    append_raw(payload, record);
+    if (!append_record(StoreRecordType::Subject, payload)) return false;
+    if (m_deferred_sync) m_unsynced_ages.emplace_back(subject, m_ages.count(subject) ? m_ages[subject] : -1);
+    m_ages[subject] = record.age_years;
+    return true;
+}
+
+int SessionStore::subject_age(std::uint32_t subject) const {
+    auto it = m_ages.find(subject);
+    return it == m_ages.end() ? 0 : it->second;
+}
+
+std::size_t SessionStore::query(const StoreQuery& query, std::vector<StoredPoint>& out) {
+    if (m_fd < 0) return 0;
+    sort_index();
+
+    // Narrow to the stimulus (and meridian) by binary search, the rest is
+    // filtered on the index entries
+    auto first = m_index.begin();
+    auto last = m_index.end();
+    if (query.size != MeteoroidSizeID::None) {
+        StoreIndexEntry low{};
+        low.size = static_cast<std::uint8_t>(query.size);
+        auto prefix = [&query](const StoreIndexEntry& e) {
+            if (query.luminance < 0) return std::make_tuple(int{e.size}, 0, 0);
+            if (query.meridian < 0) return std::make_tuple(int{e.size}, int{e.luminance}, 0);
+            return std::make_tuple(int{e.size}, int{e.luminance}, int{e.meridian});
+        };
+        low.luminance = static_cast<std::uint8_t>(std::max(query.luminance, 0));
+        low.meridian = static_cast<std::int16_t>(std::max(query.meridian, 0));
+        auto key = prefix(low);
+        first = std::lower_bound(m_index.begin(), m_index.end(), key,
+                                 [&prefix](const StoreIndexEntry& e, const auto& k) { return prefix(e) < k; });
+        last = std::upper_bound(first, m_index.end(), key,
+                                [&prefix](const auto& k, const StoreIndexEntry& e) { return k < prefix(e); });
+    }
+
+    std::vector<float> points;
+    std::size_t rows = 0;
+    for (auto it = first; it != last; ++it) {
+        const StoreIndexEntry& e = *it;
+        if (query.luminance >= 0 && e.luminance != query.luminance) continue;
+        if (query.meridian >= 0 && e.meridian != query.meridian) continue;
+        if (query.subject >= 0 && e.subject != query.subject) continue;
+        if (query.eye != 0 && e.eye != query.eye) continue;
+        if (e.date < query.date_from || e.date > query.date_to) continue;
+        if (!query.include_journals && e.layout != static_cast<std::uint8_t>(MeasurementLayout::Sheet)) continue;
+        if (query.min_age >= 0 || query.max_age >= 0) {
+            int age = subject_age(e.subject);
+            if (age == 0 || (query.min_age >= 0 && age < query.min_age) ||
+                (query.max_age >= 0 && age > query.max_age)) {
+                continue;
+            }
+        }
+        rows++;
+        if (e.point_count == 0) continue;
+
+        points.resize(std::size_t{e.point_count} * 2);
+        if (!read_at(m_fd, points.data(), points.size() * sizeof(float), e.points_offset)) {
+            m_error = "cannot read points: " + std::string(std::strerror(errno));
+            continue;
+        }
+        m_point_bytes_read += points.size() * sizeof(float);
+        for (std::size_t p = 0; p < e.point_count; p++) {
+            StoredPoint point;
+            point.subject = e.subject;
+            point.date = e.date;
+            point.time = e.time;
+            point.eye = e.eye;
+            point.size = static_cast<MeteoroidSizeID>(e.size);
+            point.luminance = StimulusCode{e.luminance};
+            point.meridian = e.meridian;
+            point.normed_value = e.normed_value;
+            point.phi = points[2 * p];
+            point.theta = points[2 * p + 1];
+            out.push_back(point);
+        }
+    }
+    return rows;
+}
+
+bool session_eye_table(const SessionFileView& file, int eye, MeasurementTable& out) {
+    auto eyes = file.column<std::uint8_t>(SessionColumn::SheetEye);
+    auto longitudes = file.column<std::int16_t>(SessionColumn::SheetLongitude);
+    auto sizes = file.column<std::uint8_t>(SessionColumn::SheetSize);
+    auto luminances = file.column<std::uint8_t>(SessionColumn::SheetLuminance);
+    auto normalized = file.column<float>(SessionColumn::SheetNormalizedAngle);
+    auto point_counts = file.column<std::uint8_t>(SessionColumn::SheetPointCount);
+    auto phis = file.column<float>(SessionColumn::SheetPointPhi);
+    auto thetas = file.column<float>(SessionColumn::SheetPointTheta);
+    std::size_t rows = std::min({eyes.size(), longitudes.size(), sizes.size(), luminances.size(),
+                                 normalized.size(), point_counts.size()});
+    std::size_t points = std::min(phis.size(), thetas.size());
+
+    out.clear();
+    out.layout = MeasurementLayout::Sheet;
+    out.point_begin.push_back(0);
+    std::size_t point = 0;
+    for (std::size_t row = 0; row < rows; row++) {
+        std::size_t first = point;
+        point += point_counts[row];
+        if (eyes[row] != eye) continue;
+        out.longitude.push_back(longitudes[row]);
+        out.size.push_back(sizes[row]);
+        out.luminance.push_back(luminances[row]);
+        out.normed_value.push_back(normalized[row]);
+        for (std::size_t i = first; i < point && i < points; i++) {
+            out.phi.push_back(phis[i]);
+            out.theta.push_back(thetas[i]);
+        }
+        out.point_begin.push_back(static_cast<std::uint32_t>(out.phi.size()));
+    }
+    return out.rows() != 0;
+}
+
+SessionFileAppend append_session_file(SessionStore& store, const SessionFileView& file, std::uint32_t subject) {
+    StoredSessionInfo info;
+    info.subject = subject;
+    std::time_t start = static_cast<std::time_t>(file.header().created_unix_ms / 1000);
+    std::tm utc{};
+    if (file.header().created_unix_ms > 0 && ::gmtime_r(&start, &utc)) {
+        info.date = static_cast<std::uint32_t>((utc.tm_year + 1900) * 10000 + (utc.tm_mon + 1) * 100 + utc.tm_mday);
+        info.time = static_cast<std::uint32_t>(utc.tm_hour * 10000 + utc.tm_min * 100 + utc.tm_sec);
+    }
+
+    SessionFileAppend result;
+    MeasurementTable table;
+    for (int eye = 1; eye <= 2; eye++) {
+        if (!session_eye_table(file, eye, table)) continue;
+        result.eyes++;
+        info.eye = eye;
+        switch (store.append(info, table)) {
+            case StoreAppendResult::Stored: result.stored++; break;
+            case StoreAppendResult::Duplicate: break;
+            case StoreAppendResult::Failed: result.failed = true; return result;
+        }
+    }
+    return result;
+}
+
+namespace {
+// _YYYY-MM-DD_HH-MM-SS anywhere in the name
+bool date_time_of(const std::string& name, std::uint32_t& date, std::uint32_t& time) {
+    const char* pattern = "_dddd-dd-dd_dd-dd-dd";
+    std::size_t length = std::strlen(pattern);
+    for (std::size_t start = 0; start + length <= name.size(); start++) {
+        std::uint32_t digits[6] = {};
+        int field = 0;
+        bool match = true;
+        for (std::size_t i = 0; i < length && match; i++) {
+            char c = name[start + i];
+            if (pattern[i] == 'd') {
+                match = c >= '0' && c <= '9';
+                digits[field] = digits[field] * 10 + static_cast<std::uint32_t>(c - '0');
+            } else {
+                match = c == pattern[i];
+                if (i > 0) field++;
+            }
+        }
+        if (match) {
+            date = digits[0] * 10000 + digits[1] * 100 + digits[2];
+            time = digits[3] * 10000 + digits[4] * 100 + digits[5];
+            return true;
+        }
+    }
+    return false;
+}
+
+bool import_subjects(SessionStore& store, const fs::path& path, std::string* error) {
+    for (const SubjectAge& row : read_subject_ages(path.string())) {
+        if (!store.set_subject_age(static_cast<std::uint32_t>(row.subject), row.age_years)) {
+            if (error) *error = store.error();
+            return false;
+        }
+    }
+    return true;
+}
+}
+
+bool measurement_copy_before(const std::string& a, const std::string& b) {
+    // Dated files first, so an undated copy is the duplicate
+    std::uint32_t date = 0;
+    std::uint32_t time = 0;
+    bool dated_a = date_time_of(fs::path(a).filename().string(), date, time);
+    bool dated_b = date_time_of(fs::path(b).filename().string(), date, time);
+    if (dated_a != dated_b) return dated_a;
+    return a < b;
+}
+
+bool import_measurement_tree(SessionStore& store, const std::string& root, StoreImportStats* stats,
+                             std::string* error) {
+    StoreImportStats local;
+    StoreImportStats& s = stats ? *stats : local;
+    std::error_code ec;
+    if (!fs::is_directory(root, ec)) {
+        if (error) *error = root + " is not a directory";
+        return false;
+    }
+    if (!import_subjects(store, fs::path(root) / "subjects.csv", error)) return false;
+
+    struct Candidate {
+        fs::path path;
+        long subject;
+        int eye;
+        std::uint32_t date;
+        std::uint32_t time;
+    };
+    std::vector<Candidate> candidates;
+    for (auto it = fs::recursive_directory_iterator(root, ec); !ec && it != fs::recursive_directory_iterator();
+         it.increment(ec)) {
+        if (!it->is_regular_file(ec) || it->path().extension() != ".csv") continue;
+        s.files++;
+        std::string name = it->path().filename().string();
+        Candidate c{it->path(), measurement_subject(fs::relative(it->path(), root, ec).string()), 0, 0, 0};
+        c.eye = name.find("Right") != std::string::npos ? 1 : (name.find("Left") != std::string::npos ? 2 : 0);
+        if (c.subject < 0 || c.eye == 0) {
+            s.skipped++;
+            continue;
+        }
+        date_time_of(name, c.date, c.time);
+        candidates.push_back(c);
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return measurement_copy_before(a.path.string(), b.path.string());
+    });
+
+    MeasurementCsvReader reader;
+    MeasurementTable table;
+    for (const Candidate& c : candidates) {
+        if (!reader.read(c.path.string(), table)) {
+            s.skipped++;
+            continue;
+        }
+        StoredSessionInfo info;
+        info.subject = static_cast<std::uint32_t>(c.subject);
+        info.eye = c.eye;
+        info.date = c.date;
+        info.time = c.time;
+        switch (store.append(info, table)) {
+            case StoreAppendResult::Stored: s.stored++; break;
+            case StoreAppendResult::Duplicate: s.duplicates++; break;
+            case StoreAppendResult::Failed:
+                if (error) *error = store.error();
+                return false;
+        }
+    }
+    return store.save_index();
+}
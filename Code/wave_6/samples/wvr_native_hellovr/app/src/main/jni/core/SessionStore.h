@@ -0,0 +1,244 @@
+// SessionStore.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "MeasurementCsv.h"
+
+class SessionFileView;
+
+// Local store of measured eyes, replacing the rescans of Measurements/.
+//
+// DIR/sessions.pstore is append-only and the only source of truth:
+//
+//   "PSTO" u16 version u16 reserved u64 reserved
+//   records: StoreRecordHeader, payload (CRC-32 in the header)
+//
+// A Session payload is a StoredSessionHeader, row_count StoredRow and
+// point_count (f32 phi, f32 theta); a Subject payload a StoredSubject
+// (later records of a subject win).
+//
+// DIR/sessions.pidx caches the index: one StoreIndexEntry per row, sorted
+// by stimulus (size, luminance), meridian, subject, eye, date, plus the
+// subjects and the content hashes. It records how much of the data file it
+// covers; records behind that (a crash after an append) are indexed on
+// open, a torn record at the end is cut off. A complete record with a bad
+// CRC is skipped and counted, not cut off with everything behind it. A
+// length that runs past the end with intact records behind it fails the
+// open and leaves the file as it is.
+// Without a valid index file the whole data file is scanned once.
+//
+// Queries only read the index and the points of the matching rows.
+namespace session_store {
+constexpr char DATA_MAGIC[4] = {'P', 'S', 'T', 'O'};
+constexpr char INDEX_MAGIC[4] = {'P', 'I', 'D', 'X'};
+constexpr std::uint16_t VERSION = 1;
+constexpr std::size_t FILE_HEADER_BYTES = 16;
+constexpr const char* DATA_FILE = "sessions.pstore";
+constexpr const char* INDEX_FILE = "sessions.pidx";
+}
+
+enum class StoreRecordType : std::uint8_t { Session = 1, Subject = 2 };
+
+#pragma pack(push, 1)
+struct StoreRecordHeader {
+    std::uint8_t type;              // StoreRecordType
+    std::uint8_t reserved[3];
+    std::uint32_t payload_bytes;
+    std::uint32_t crc;              // Of the payload
+    std::uint32_t reserved2;
+};
+
+struct StoredSessionHeader {
+    std::uint64_t content_hash;     // Duplicate uploads and copies have the same hash
+    std::uint32_t subject;
+    std::uint32_t date;             // YYYYMMDD, 0 if unknown
+    std::uint32_t time;             // HHMMSS
+    std::uint8_t eye;               // 1 right, 2 left
+    std::uint8_t layout;            // MeasurementLayout
+    std::uint16_t reserved;
+    std::uint32_t row_count;
+    std::uint32_t point_count;
+};
+
+struct StoredRow {
+    std::int16_t longitude;
+    std::uint8_t size;              // MeteoroidSizeID
+    std::uint8_t luminance;         // StimulusCode::index
+    float normed_value;             // NaN for journals
+    std::uint32_t first_point;      // In this session
+    std::uint32_t point_count;
+};
+
+struct StoredSubject {
+    std::uint32_t subject;
+    std::uint8_t age_years;         // 0 unknown
+    std::uint8_t reserved[3];
+};
+
+struct StoreIndexEntry {
+    std::uint8_t size;
+    std::uint8_t luminance;
+    std::int16_t meridian;
+    std::uint32_t subject;
+    std::uint32_t date;
+    std::uint32_t time;
+    std::uint8_t eye;
+    std::uint8_t layout;
+    std::uint16_t point_count;
+    float normed_value;
+    std::uint64_t points_offset;    // Of the first point in the data file
+};
+#pragma pack(pop)
+
+static_assert(sizeof(StoreRecordHeader) == 16, "record layout is part of the format");
+static_assert(sizeof(StoredSessionHeader) == 32, "record layout is part of the format");
+static_assert(sizeof(StoredRow) == 16, "record layout is part of the format");
+static_assert(sizeof(StoreIndexEntry) == 32, "index layout is part of the format");
+
+// One measured eye to append.
+struct StoredSessionInfo {
+    std::uint32_t subject = 0;
+    int eye = 0;                    // 1 right, 2 left
+    std::uint32_t date = 0;         // YYYYMMDD
+    std::uint32_t time = 0;         // HHMMSS
+    std::uint64_t content_hash = 0; // 0: computed from subject, eye and the table
+};
+
+// Every field narrows the result; the defaults match everything. Subjects
+// without a known age never match an age filter.
+struct StoreQuery {
+    std::int64_t subject = -1;
+    int eye = 0;
+    MeteoroidSizeID size = MeteoroidSizeID::None;
+    int luminance = -1;             // StimulusCode::index
+    int meridian = -1;
+    std::uint32_t date_from = 0;
+    std::uint32_t date_to = 0xFFFFFFFFu;
+    int min_age = -1;
+    int max_age = -1;
+    bool include_journals = false;  // Running journals next to the final sheets
+};
+
+// One isopter point of a matching row.
+struct StoredPoint {
+    std::uint32_t subject;
+    std::uint32_t date;
+    std::uint32_t time;
+    std::uint8_t eye;
+    MeteoroidSizeID size;
+    StimulusCode luminance;
+    std::int16_t meridian;
+    float normed_value;
+    float phi;
+    float theta;
+};
+
+enum class StoreAppendResult { Stored, Duplicate, Failed };
+
+class SessionStore {
+public:
+    SessionStore() = default;
+    ~SessionStore();            // Saves the index
+    SessionStore(const SessionStore&) = delete;
+    SessionStore& operator=(const SessionStore&) = delete;
+
+    // Opens or creates the store in an existing directory.
+    bool open(const std::string& directory);
+    void close();
+    bool is_open() const { return m_fd >= 0; }
+
+    // Appends and syncs one eye. The index file is only rewritten by
+    // save_index() and close().
+    StoreAppendResult append(const StoredSessionInfo& info, const MeasurementTable& table);
+    // With deferred sync appends only write; one sync() then makes a whole
+    // batch durable (group commit for the ingestion server). A failed sync
+    // drops everything appended since the last one, from the file as far as
+    // it can be cut off and from the index, so it can be stored again.
+    void set_deferred_sync(bool deferred) { m_deferred_sync = deferred; }
+    bool sync();
+    bool set_subject_age(std::uint32_t subject, int age_years);
+    bool save_index();
+
+    // Appends the points of every matching row to out, returns the number of
+    // matching rows (rows without points count, but add nothing).
+    std::size_t query(const StoreQuery& query, std::vector<StoredPoint>& out);
+
+    bool contains(std::uint64_t content_hash) const { return m_hashes.count(content_hash) != 0; }
+    std::size_t session_count() const { return m_hashes.size(); }
+    std::size_t row_count() const { return m_index.size(); }
+    int subject_age(std::uint32_t subject) const;
+    std::uint64_t point_bytes_read() const { return m_point_bytes_read; }
+    // Records skipped by the scan on open for a bad CRC or payload
+    std::size_t broken_records() const { return m_broken_records; }
+    const std::string& error() const { return m_error; }
+
+private:
+    bool load_index();
+    bool scan(std::uint64_t from);
+    bool append_record(StoreRecordType type, const std::string& payload);
+    void index_session(const StoredSessionHeader& session, const StoredRow* rows, std::uint64_t points_offset);
+    void sort_index();
+    void drop_unsynced();
+
+    std::string m_directory;
+    int m_fd = -1;
+    std::uint64_t m_data_bytes = 0;
+    std::uint64_t m_indexed_bytes = 0;     // Covered by the index file
+    std::uint64_t m_synced_bytes = 0;      // Known to be durable
+    std::vector<StoreIndexEntry> m_index;
+    std::size_t m_sorted = 0;              // m_index[0, m_sorted) is sorted
+    std::unordered_set<std::uint64_t> m_hashes;
+    std::unordered_map<std::uint32_t, std::uint8_t> m_ages;
+    // Appended since the last sync: hashes, and subjects with their age
+    // before (-1 if none)
+    std::vector<std::uint64_t> m_unsynced_hashes;
+    std::vector<std::pair<std::uint32_t, int>> m_unsynced_ages;
+    std::uint64_t m_point_bytes_read = 0;
+    std::size_t m_broken_records = 0;
+    bool m_deferred_sync = false;
+    std::string m_error;
+};
+
+// Hash of a measured eye for deduplication (FNV-1a over subject, eye and
+// the columns of the table).
+std::uint64_t measurement_content_hash(std::uint32_t subject, int eye, const MeasurementTable& table);
+
+struct SessionFileAppend {
+    int eyes = 0;                   // Eyes with a final sheet in the file
+    int stored = 0;                 // Of them new in the store
+    bool failed = false;
+};
+
+// Final sheet of one eye of a session file as a table, false if the eye
+// has none.
+bool session_eye_table(const SessionFileView& file, int eye, MeasurementTable& out);
+
+// Appends the final sheet of each eye of a session file, dated with the
+// session start (UTC).
+SessionFileAppend append_session_file(SessionStore& store, const SessionFileView& file, std::uint32_t subject);
+
+struct StoreImportStats {
+    std::size_t files = 0;
+    std::size_t stored = 0;
+    std::size_t duplicates = 0;
+    std::size_t skipped = 0;        // Other CSVs, unreadable files, files outside SubjectN/
+};
+
+// Order in which copies of one measurement are taken, the first is kept:
+// files with _YYYY-MM-DD_HH-MM-SS in the name before undated copies like
+// Right.csv, then by path.
+bool measurement_copy_before(const std::string& a, const std::string& b);
+
+// Imports a Measurements tree: SubjectN/{Right,Left}*.csv, eye from the
+// file name, date and time from its _YYYY-MM-DD_HH-MM-SS part. Dated files
+// are imported first, so the undated copies (Right.csv) are duplicates of
+// them. An optional ROOT/subjects.csv (Subject,Age) sets the ages.
+bool import_measurement_tree(SessionStore& store, const std::string& root, StoreImportStats* stats = nullptr,
+                             std::string* error = nullptr);
@@ -0,0 +1,291 @@
+// SessionUploader.cpp
+#include "SessionUploader.h"
+#include "PerimetryLog.h"
+#include "SessionFile.h"
+#include "UploadProtocol.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+// Waits are timed so a lost notification only delays, never hangs
+constexpr std::chrono::milliseconds POLL_INTERVAL(100);
+// A blocked send or a missing ack ends the connection after this
+constexpr std::chrono::milliseconds SOCKET_TIMEOUT(3000);
+constexpr std::chrono::milliseconds MIN_RETRY_DELAY(1000);
+constexpr std::chrono::milliseconds MAX_RETRY_DELAY(60000);
+constexpr std::size_t MAX_BATCH = 16;
+
+bool ends_with(const std::string& text, const char* suffix) {
+    std::size_t n = std::strlen(suffix);
+    return text.size() >= n && text.compare(text.size() - n, n, suffix) == 0;
+}
+
+bool file_exists(const std::string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0;
+}
+
+bool read_file(const std::string& path, std::string& out) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    bool ok = ::fstat(fd, &st) == 0;
+    if (ok) {
+        out.resize(static_cast<std::size_t>(st.st_size));
+        std::size_t done = 0;
+        while (ok && done < out.size()) {
+            ssize_t n = ::read(fd, &out[done], out.size() - done);
+            if (n < 0 && errno == EINTR) continue;
+            ok = n > 0;
+            if (ok) done += static_cast<std::size_t>(n);
+        }
+    }
+    ::close(fd);
+    return ok;
+}
+
+bool send_all(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool recv_all(int fd, unsigned char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t n = ::recv(fd, data, size, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+void put_u32(std::string& out, std::uint32_t value) {
+    for (int i = 0; i < 4; i++) out += static_cast<char>(value >> (8 * i));
+}
+}
+
+SessionUploader::SessionUploader(const std::string& address, std::uint64_t device_id,
+                                 const std::string& device_name)
+    : m_address(address), m_device_id(device_id), m_device_name(device_name) {
+    m_thread = std::thread(&SessionUploader::run, this);
+}
+
+SessionUploader::~SessionUploader() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    if (m_thread.joinable()) m_thread.join();
+    disconnect();
+}
+
+void SessionUploader::post_file(const std::string& path, std::uint32_t subject) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back({path, subject});
+    }
+    m_wake.notify_one();
+}
+
+std::size_t SessionUploader::post_pending(const std::string& directory) {
+    DIR* dir = ::opendir(directory.c_str());
+    if (!dir) return 0;
+    std::string prefix = directory;
+    if (!prefix.empty() && prefix.back() != '/') prefix += "/";
+    std::vector<std::string> paths;
+    while (dirent* entry = ::readdir(dir)) {
+        std::string path = prefix + entry->d_name;
+        if (ends_with(path, ".pses") && !file_exists(marker_path(path))) paths.push_back(path);
+    }
+    ::closedir(dir);
+
+    // Oldest first; the names carry the session time
+    std::sort(paths.begin(), paths.end());
+    for (const std::string& path : paths) {
+        // The subject is the patient index the session was recorded with
+        SessionFileView file;
+        post_file(path, file.open(path) ? file.header().patient_index : 0);
+    }
+    return paths.size();
+}
+
+bool SessionUploader::wait_idle(std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_queue.empty() || m_in_flight > 0) {
+        if (std::chrono::steady_clock::now() >= deadline) return false;
+        m_idle.wait_for(lock, POLL_INTERVAL);
+    }
+    return true;
+}
+
+std::size_t SessionUploader::pending() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_queue.size() + m_in_flight;
+}
+
+std::uint64_t SessionUploader::uploaded() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_uploaded;
+}
+
+std::uint64_t SessionUploader::rejected() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_rejected;
+}
+
+std::uint64_t SessionUploader::retries() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_retries;
+}
+
+void SessionUploader::run() {
+    std::chrono::milliseconds retry_delay = MIN_RETRY_DELAY;
+    std::vector<Item> batch;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait_for(lock, POLL_INTERVAL, [this] { return m_stop || !m_queue.empty(); });
+        if (m_stop) break;
+        if (m_queue.empty()) continue;
+
+        while (!m_queue.empty() && batch.size() < MAX_BATCH) {
+            batch.push_back(std::move(m_queue.front()));
+            m_queue.pop_front();
+        }
+        m_in_flight = batch.size();
+        lock.unlock();
+        bool delivered = upload(batch);
+        lock.lock();
+
+        // Undelivered files go back to the front, in their order
+        m_queue.insert(m_queue.begin(), std::make_move_iterator(batch.begin()),
+                       std::make_move_iterator(batch.end()));
+        batch.clear();
+        m_in_flight = 0;
+        m_idle.notify_all();
+        if (delivered) {
+            retry_delay = MIN_RETRY_DELAY;
+            continue;
+        }
+        m_retries++;
+        m_wake.wait_for(lock, retry_delay, [this] { return m_stop; });
+        retry_delay = std::min(retry_delay * 2, MAX_RETRY_DELAY);
+    }
+}
+
+bool SessionUploader::connect() {
+    if (m_fd >= 0) return true;
+    std::string error;
+    m_fd = connect_upload_socket(m_address, SOCKET_TIMEOUT, &error);
+    if (m_fd < 0) {
+        LOGW("Upload: cannot connect to %s", error.c_str());
+        return false;
+    }
+    std::string hello = encode_hello(m_device_id, m_device_name);
+    if (!send_all(m_fd, hello.data(), hello.size())) {
+        LOGW("Upload: %s: %s", m_address.c_str(), std::strerror(errno));
+        disconnect();
+        return false;
+    }
+    return true;
+}
+
+void SessionUploader::disconnect() {
+    if (m_fd < 0) return;
+    ::close(m_fd);
+    m_fd = -1;
+}
+
+bool SessionUploader::upload(std::vector<Item>& batch) {
+    if (!connect()) return false;
+
+    // Send the whole batch, then collect the acks in order
+    std::vector<std::uint32_t> ids;
+    std::vector<Item> sent;
+    std::vector<Item> unread;
+    std::string payload;
+    for (std::size_t next = 0; next < batch.size(); next++) {
+        Item& item = batch[next];
+        payload.clear();
+        std::uint32_t id = m_next_upload_id++;
+        put_u32(payload, id);
+        put_u32(payload, item.subject);
+        std::string image;
+        if (!read_file(item.path, image)) {
+            // Still being written or on a busy card, tried again with the
+            // undelivered files
+            LOGW("Upload: cannot read %s", item.path.c_str());
+            unread.push_back(std::move(item));
+            continue;
+        }
+        payload += image;
+        unsigned char header[upload_protocol::HEADER_BYTES];
+        encode_upload_header(UploadFrameType::Session, payload.data(), payload.size(), header);
+        if (!send_all(m_fd, reinterpret_cast<const char*>(header), sizeof(header)) ||
+            !send_all(m_fd, payload.data(), payload.size())) {
+            LOGW("Upload: %s: %s", m_address.c_str(), std::strerror(errno));
+            disconnect();
+            // No ack comes for what was sent; all of it goes again (the
+            // server acks Duplicate for what it already stored)
+            for (; next < batch.size(); next++) sent.push_back(std::move(batch[next]));
+            sent.insert(sent.end(), std::make_move_iterator(unread.begin()), std::make_move_iterator(unread.end()));
+            batch = std::move(sent);
+            return false;
+        }
+        ids.push_back(id);
+        sent.push_back(std::move(item));
+    }
+    batch = std::move(unread);
+
+    bool ok = batch.empty();
+    std::size_t acked = 0;
+    for (; acked < sent.size(); acked++) {
+        unsigned char header[upload_protocol::HEADER_BYTES];
+        unsigned char body[upload_protocol::ACK_BYTES];
+        UploadFrameHeader frame;
+        std::uint32_t id = 0;
+        UploadStatus status;
+        std::uint8_t eyes = 0;
+        if (!recv_all(m_fd, header, sizeof(header)) || !decode_upload_header(header, frame) ||
+            frame.type != UploadFrameType::Ack || frame.payload_bytes != sizeof(body) ||
+            !recv_all(m_fd, body, sizeof(body)) || !decode_ack(body, sizeof(body), id, status, eyes) ||
+            id != ids[acked]) {
+            LOGW("Upload: no ack from %s", m_address.c_str());
+            disconnect();
+            ok = false;
+            break;
+        }
+        if (status == UploadStatus::StoreFailed) {
+            LOGW("Upload: server could not store %s", sent[acked].path.c_str());
+            batch.push_back(std::move(sent[acked]));
+            ok = false;
+            continue;
+        }
+        if (status == UploadStatus::Invalid) LOGW("Upload: server rejected %s", sent[acked].path.c_str());
+        int fd = ::open(marker_path(sent[acked].path).c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+        if (fd >= 0) ::close(fd);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        (status == UploadStatus::Invalid ? m_rejected : m_uploaded)++;
+    }
+    for (std::size_t i = acked; i < sent.size(); i++) batch.push_back(std::move(sent[i]));
+    return ok;
+}
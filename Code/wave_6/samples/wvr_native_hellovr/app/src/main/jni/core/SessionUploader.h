@@ -0,0 +1,75 @@
+// SessionUploader.h
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Uploads session files (*.pses) to the ingestion server from a background
+// thread; post_file() only queues the path, the render thread never waits
+// for the network.
+//
+// Sessions are sent in batches without waiting for each ack. A file that
+// the server acked (stored, duplicate or invalid) gets an empty PATH.uploaded
+// marker, so post_pending() after a restart only sends the rest. Files that
+// could not be delivered stay queued and are retried with a growing delay.
+class SessionUploader {
+public:
+    SessionUploader(const std::string& address, std::uint64_t device_id, const std::string& device_name);
+    ~SessionUploader(); // Stops after the batch in flight, the rest stays pending on disk
+
+    SessionUploader(const SessionUploader&) = delete;
+    SessionUploader& operator=(const SessionUploader&) = delete;
+
+    // subject is sent with the file, the patient index of the session.
+    void post_file(const std::string& path, std::uint32_t subject);
+    // Queues every *.pses in directory without a marker, with the patient
+    // index in its header, returns how many.
+    std::size_t post_pending(const std::string& directory);
+
+    // True once every posted file was acked, false on timeout.
+    bool wait_idle(std::chrono::milliseconds timeout);
+
+    std::size_t pending() const;
+    std::uint64_t uploaded() const;     // Acked Stored or Duplicate
+    std::uint64_t rejected() const;     // Acked Invalid
+    std::uint64_t retries() const;      // Failed connections, unreadable files and StoreFailed acks
+
+    static std::string marker_path(const std::string& path) { return path + ".uploaded"; }
+
+private:
+    struct Item {
+        std::string path;
+        std::uint32_t subject;
+    };
+
+    void run();
+    // Sends the batch and waits for its acks; the items that were not
+    // delivered are left in batch.
+    bool upload(std::vector<Item>& batch);
+    bool connect();
+    void disconnect();
+
+    const std::string m_address;
+    const std::uint64_t m_device_id;
+    const std::string m_device_name;
+    int m_fd = -1;                          // Only touched by the thread
+    std::uint32_t m_next_upload_id = 1;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::deque<Item> m_queue;
+    std::size_t m_in_flight = 0;
+    std::uint64_t m_uploaded = 0;
+    std::uint64_t m_rejected = 0;
+    std::uint64_t m_retries = 0;
+    bool m_stop = false;
+    std::thread m_thread;
+};
@@ -0,0 +1,46 @@
+// SheetExport.cpp
+#include "SheetExport.h"
+
+namespace {
+// Longest fixed part of a row and of one point: two %g floats take at most
+// 13 characters each ("-1.23457e-05")
+constexpr std::size_t MAX_HEADER_CHARS = 128;
+constexpr std::size_t MAX_ROW_CHARS = 64;
+constexpr std::size_t MAX_POINT_CHARS = 32;
+}
+
+std::size_t sheet_csv_capacity(std::size_t rows, std::size_t points) {
+    return MAX_HEADER_CHARS + rows * MAX_ROW_CHARS + points * MAX_POINT_CHARS;
+}
+
+std::size_t sheet_csv_capacity(const GoldmannSheet& sheet, int eye) {
+    std::size_t rows = 0;
+    std::size_t points = 0;
+    sheet.for_each_entry(eye, [&rows, &points](int, MeteoroidSizeID, StimulusCode, const SheetEntry&,
+                                               GoldmannSheet::PointRange range) {
+        rows++;
+        points += range.size();
+    });
+    return sheet_csv_capacity(rows, points);
+}
+
+bool write_sheet_csv(const GoldmannSheet& sheet, int eye, FormatBuffer& out) {
+    bool ok = write_csv_header<SheetRow>(out);
+    sheet.for_each_entry(eye, [&out, &ok](int longitude, MeteoroidSizeID size_id, StimulusCode luminance,
+                                          const SheetEntry& entry, GoldmannSheet::PointRange points) {
+        SheetRow row;
+        row.longitude = longitude;
+        row.size = size_id;
+        row.luminance = luminance;
+        row.points = points;
+        row.normalized_angle = entry.normalized_angle;
+        ok = ok && write_csv_record(out, row);
+    });
+    return ok;
+}
+
+std::string format_sheet_csv(const GoldmannSheet& sheet, int eye) {
+    FormatBuffer out(sheet_csv_capacity(sheet, eye));
+    write_sheet_csv(sheet, eye, out);
+    return out.str();
+}
@@ -0,0 +1,39 @@
+// SheetExport.h
+#pragma once
+
+#include <string>
+
+#include "GoldmannSheet.h"
+#include "RecordSchema.h"
+
+// One row of the final result CSV of an eye, one per planned sheet entry.
+struct SheetRow {
+    int longitude = 0;
+    MeteoroidSizeID size = MeteoroidSizeID::None;
+    StimulusCode luminance{};
+    GoldmannSheet::PointRange points{nullptr, nullptr};
+    float normalized_angle = 0.0f;
+};
+
+// Longitude,SizeIndex,Intensity,Points[(PHI,THETA)],NormedValue
+// (the points themselves are written as (PHI|THETA), like the journal)
+template <>
+struct RecordSchema<SheetRow> {
+    static constexpr auto fields = std::make_tuple(
+            field("Longitude", &SheetRow::longitude),
+            field("SizeIndex", &SheetRow::size),
+            field("Intensity", &SheetRow::luminance),
+            field("Points[(PHI,THETA)]", &SheetRow::points),
+            field("NormedValue", &SheetRow::normalized_angle));
+};
+
+// Upper bound of the CSV size of one eye, for sizing a FormatBuffer.
+std::size_t sheet_csv_capacity(std::size_t rows, std::size_t points);
+std::size_t sheet_csv_capacity(const GoldmannSheet& sheet, int eye);
+
+// Header and one row per planned entry into out, without allocating. False
+// if out is too small (see sheet_csv_capacity).
+bool write_sheet_csv(const GoldmannSheet& sheet, int eye, FormatBuffer& out);
+
+// Final result CSV of one eye, as written at the end of each eye.
+std::string format_sheet_csv(const GoldmannSheet& sheet, int eye);
@@ -0,0 +1,45 @@
+// SpscQueue.h
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Bounded single producer / single consumer ring. push() and pop() never
+// block or allocate, so the render thread can hand work to a worker thread
+// without waiting for it. CAPACITY must be a power of two.
+template <typename T, std::size_t CAPACITY>
+class SpscQueue {
+    static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+public:
+    // Producer only. False if the queue is full, the item is not queued.
+    bool push(const T& item) {
+        std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == CAPACITY) return false;
+        m_items[head & (CAPACITY - 1)] = item;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. False if the queue is empty.
+    bool pop(T& out) {
+        std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire)) return false;
+        out = m_items[tail & (CAPACITY - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return m_tail.load(std::memory_order_acquire) == m_head.load(std::memory_order_acquire);
+    }
+
+    static constexpr std::size_t capacity() { return CAPACITY; }
+
+private:
+    std::array<T, CAPACITY> m_items{};
+    // Separate cache lines, producer and consumer do not share one
+    alignas(64) std::atomic<std::size_t> m_head{0};
+    alignas(64) std::atomic<std::size_t> m_tail{0};
+};
@@ -0,0 +1,195 @@
+// Statistics.cpp
+#include "Statistics.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+std::size_t resample_blocks(std::size_t resamples) { return (resamples + RESAMPLE_BLOCK - 1) / RESAMPLE_BLOCK; }
+
+// Linear between the order statistics, like numpy.percentile
+double quantile(const std::vector<double>& sorted, double q) {
+    double at = q * static_cast<double>(sorted.size() - 1);
+    std::size_t below = static_cast<std::size_t>(at);
+    if (below + 1 >= sorted.size()) return sorted.back();
+    return sorted[below] + (at - static_cast<double>(below)) * (sorted[below + 1] - sorted[below]);
+}
+
+ConfidenceInterval percentile_interval(double estimate, std::vector<double>& values, double confidence) {
+    ConfidenceInterval out;
+    out.estimate = estimate;
+    values.erase(std::remove_if(values.begin(), values.end(), [](double v) { return std::isnan(v); }), values.end());
+    if (values.empty()) return out;
+    std::sort(values.begin(), values.end());
+    double tail = (1.0 - confidence) / 2.0;
+    out.lower = quantile(values, tail);
+    out.upper = quantile(values, 1.0 - tail);
+    return out;
+}
+
+// Permuted differences this close to the observed one count as reaching
+// it; they differ by the rounding of another summation order only
+double tie_tolerance(const double* values, std::size_t n) {
+    double scale = 0.0;
+    for (std::size_t i = 0; i < n; i++) scale = std::max(scale, std::fabs(values[i]));
+    return 1e-9 * scale;
+}
+
+PermutationTest finish_test(PermutationTest test, const std::vector<std::size_t>& reached, std::size_t resamples) {
+    std::size_t k = 0;
+    for (std::size_t count : reached) k += count;
+    test.resamples = resamples;
+    test.p_value = static_cast<double>(1 + k) / static_cast<double>(1 + resamples);
+    return test;
+}
+}
+
+PairMoments pair_moments(const double* a, const double* b, std::size_t n) {
+    PairMoments moments;
+    for (std::size_t i = 0; i < n; i++) moments.add(a[i], b[i]);
+    return moments;
+}
+
+BlandAltman bland_altman(const PairMoments& m) {
+    BlandAltman out;
+    out.n = static_cast<std::size_t>(m.n);
+    if (m.n < 1.0) return out;
+    out.bias = (m.a - m.b) / m.n;
+    if (m.n < 2.0) return out;
+    double squares = m.aa - 2.0 * m.ab + m.bb;
+    out.sd = std::sqrt(std::max(0.0, (squares - m.n * out.bias * out.bias) / (m.n - 1.0)));
+    return out;
+}
+
+double icc_agreement(const PairMoments& m) {
+    if (m.n < 2.0) return std::numeric_limits<double>::quiet_NaN();
+    // Two-way ANOVA of n subjects by k = 2 repeats
+    double grand = (m.a + m.b) / (2.0 * m.n);
+    double total = m.aa + m.bb - 2.0 * m.n * grand * grand;
+    double subjects = (m.aa + 2.0 * m.ab + m.bb) / 2.0 - 2.0 * m.n * grand * grand;
+    double repeat_a = m.a / m.n - grand;
+    double repeat_b = m.b / m.n - grand;
+    double repeats = m.n * (repeat_a * repeat_a + repeat_b * repeat_b);
+    double error = std::max(0.0, total - subjects - repeats);
+
+    double ms_subjects = subjects / (m.n - 1.0);
+    double ms_repeats = repeats;
+    double ms_error = error / (m.n - 1.0);
+    double denominator = ms_subjects + ms_error + 2.0 / m.n * (ms_repeats - ms_error);
+    if (!(denominator > 0.0)) return std::numeric_limits<double>::quiet_NaN();
+    return (ms_subjects - ms_error) / denominator;
+}
+
+double pair_mean(const PairMoments& m) { return (m.a + m.b) / (2.0 * m.n); }
+double pair_bias(const PairMoments& m) { return bland_altman(m).bias; }
+double pair_lower_limit(const PairMoments& m) { return bland_altman(m).lower(); }
+double pair_upper_limit(const PairMoments& m) { return bland_altman(m).upper(); }
+double pair_icc(const PairMoments& m) { return icc_agreement(m); }
+
+std::vector<ConfidenceInterval> bootstrap_pairs(const double* a, const double* b, std::size_t n,
+                                                const std::vector<PairStatistic>& statistics,
+                                                const ResampleOptions& options) {
+    std::vector<ConfidenceInterval> out(statistics.size());
+    if (n == 0) return out;
+    PairMoments data = pair_moments(a, b, n);
+    for (std::size_t s = 0; s < statistics.size(); s++) out[s].estimate = statistics[s](data);
+    if (options.resamples == 0) return out;
+
+    // [statistic][resample]
+    std::vector<std::vector<double>> values(statistics.size(), std::vector<double>(options.resamples));
+    const std::uint32_t count = static_cast<std::uint32_t>(n);
+    parallel_for(resample_blocks(options.resamples), options.threads, [&](unsigned, std::size_t block) {
+        ResampleRng rng(options.seed, block);
+        std::size_t end = std::min(options.resamples, (block + 1) * RESAMPLE_BLOCK);
+        for (std::size_t r = block * RESAMPLE_BLOCK; r < end; r++) {
+            PairMoments moments;
+            for (std::size_t i = 0; i < n; i++) {
+                std::uint32_t j = rng.below(count);
+                moments.add(a[j], b[j]);
+            }
+            for (std::size_t s = 0; s < statistics.size(); s++) values[s][r] = statistics[s](moments);
+        }
+    });
+    for (std::size_t s = 0; s < statistics.size(); s++) {
+        out[s] = percentile_interval(out[s].estimate, values[s], options.confidence);
+    }
+    return out;
+}
+
+ConfidenceInterval bootstrap_mean(const double* values, std::size_t n, const ResampleOptions& options) {
+    return bootstrap_pairs(values, values, n, {pair_mean}, options)[0];
+}
+
+PermutationTest paired_permutation_test(const double* a, const double* b, std::size_t n,
+                                        const ResampleOptions& options) {
+    PermutationTest test;
+    test.n_a = test.n_b = n;
+    if (n == 0) return test;
+    std::vector<double> differences(n);
+    double sum = 0.0;
+    for (std::size_t i = 0; i < n; i++) {
+        differences[i] = a[i] - b[i];
+        sum += differences[i];
+    }
+    test.observed = sum / static_cast<double>(n);
+    const double reach = std::fabs(sum) - tie_tolerance(differences.data(), n) * static_cast<double>(n);
+
+    std::vector<std::size_t> reached(resample_blocks(options.resamples));
+    parallel_for(reached.size(), options.threads, [&](unsigned, std::size_t block) {
+        ResampleRng rng(options.seed, block);
+        std::size_t end = std::min(options.resamples, (block + 1) * RESAMPLE_BLOCK);
+        for (std::size_t r = block * RESAMPLE_BLOCK; r < end; r++) {
+            double flipped = 0.0;
+            std::uint32_t signs = 0;
+            for (std::size_t i = 0; i < n; i++) {
+                if (i % 32 == 0) signs = rng.next();
+                flipped += (signs & 1u) ? differences[i] : -differences[i];
+                signs >>= 1;
+            }
+            if (std::fabs(flipped) >= reach) reached[block]++;
+        }
+    });
+    return finish_test(test, reached, options.resamples);
+}
+
+PermutationTest group_permutation_test(const double* a, std::size_t n_a, const double* b, std::size_t n_b,
+                                       const ResampleOptions& options) {
+    PermutationTest test;
+    test.n_a = n_a;
+    test.n_b = n_b;
+    if (n_a == 0 || n_b == 0) return test;
+    std::vector<double> pooled(a, a + n_a);
+    pooled.insert(pooled.end(), b, b + n_b);
+    double sum_a = 0.0;
+    double total = 0.0;
+    for (std::size_t i = 0; i < pooled.size(); i++) {
+        if (i < n_a) sum_a += pooled[i];
+        total += pooled[i];
+    }
+    auto difference = [&](double sum) {
+        return sum / static_cast<double>(n_a) - (total - sum) / static_cast<double>(n_b);
+    };
+    test.observed = difference(sum_a);
+    const double reach = std::fabs(test.observed) - 2.0 * tie_tolerance(pooled.data(), pooled.size());
+
+    std::vector<std::size_t> reached(resample_blocks(options.resamples));
+    const std::uint32_t count = static_cast<std::uint32_t>(pooled.size());
+    parallel_for(reached.size(), options.threads, [&](unsigned, std::size_t block) {
+        // Every block starts from the data order, so its draws do not
+        // depend on the blocks its worker did before
+        std::vector<double> labels = pooled;
+        ResampleRng rng(options.seed, block);
+        std::size_t end = std::min(options.resamples, (block + 1) * RESAMPLE_BLOCK);
+        for (std::size_t r = block * RESAMPLE_BLOCK; r < end; r++) {
+            // The first n_a of a partial Fisher-Yates shuffle are group a
+            double sum = 0.0;
+            for (std::uint32_t i = 0; i < n_a; i++) {
+                std::swap(labels[i], labels[i + rng.below(count - i)]);
+                sum += labels[i];
+            }
+            if (std::fabs(difference(sum)) >= reach) reached[block]++;
+        }
+    });
+    return finish_test(test, reached, options.resamples);
+}
@@ -0,0 +1,131 @@
+// Statistics.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+// Test-retest agreement of paired measurements (Bland-Altman, ICC), with
+// percentile bootstrap intervals and permutation tests.
+//
+// Resamples are drawn in blocks of RESAMPLE_BLOCK; block k always uses
+// random stream k of the seed, whichever worker takes it, so the results
+// depend on the seed only, not on the thread count.
+
+constexpr std::size_t RESAMPLE_BLOCK = 256;
+
+// Random stream of a seed: mt19937 seeded through std::seed_seq (both are
+// fully specified by the standard), read raw like
+// PerimetryEngine::setup_longitudes, since std::uniform_int_distribution
+// is implementation defined.
+class ResampleRng {
+public:
+    ResampleRng(std::uint64_t seed, std::uint64_t stream) {
+        std::seed_seq sequence{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32),
+                               static_cast<std::uint32_t>(stream), static_cast<std::uint32_t>(stream >> 32)};
+        m_engine.seed(sequence);
+    }
+
+    std::uint32_t next() { return static_cast<std::uint32_t>(m_engine()); }
+    // Uniform in [0, n), the high half of next() * n (bias below n / 2^32)
+    std::uint32_t below(std::uint32_t n) {
+        return static_cast<std::uint32_t>((static_cast<std::uint64_t>(next()) * n) >> 32);
+    }
+
+private:
+    std::mt19937 m_engine;
+};
+
+struct ResampleOptions {
+    std::size_t resamples = 10000;
+    double confidence = 0.95;   // Of the bootstrap intervals
+    std::uint64_t seed = 1;
+    unsigned threads = 0;       // 0: one per core
+};
+
+// Sums over pairs (a, b), all the paired statistics below need; cheap to
+// accumulate over resampled indices.
+struct PairMoments {
+    double n = 0.0;
+    double a = 0.0;
+    double b = 0.0;
+    double aa = 0.0;
+    double bb = 0.0;
+    double ab = 0.0;
+
+    void add(double x, double y) {
+        n += 1.0;
+        a += x;
+        b += y;
+        aa += x * x;
+        bb += y * y;
+        ab += x * y;
+    }
+};
+
+PairMoments pair_moments(const double* a, const double* b, std::size_t n);
+
+// Agreement of a with b (Bland & Altman 1986): mean and standard deviation
+// of the differences a - b, limits of agreement at 1.96 SD.
+struct BlandAltman {
+    std::size_t n = 0;
+    double bias = std::numeric_limits<double>::quiet_NaN();
+    double sd = std::numeric_limits<double>::quiet_NaN();
+
+    double lower() const { return bias - 1.96 * sd; }
+    double upper() const { return bias + 1.96 * sd; }
+};
+
+BlandAltman bland_altman(const PairMoments& moments);
+
+// ICC(A,1) of McGraw & Wong (1996) for two repeats: two-way model,
+// absolute agreement, single measurement. NaN for fewer than two pairs or
+// no variance at all.
+double icc_agreement(const PairMoments& moments);
+
+// Statistics for bootstrap_pairs()
+using PairStatistic = double (*)(const PairMoments& moments);
+double pair_mean(const PairMoments& moments);       // Of all values, a and b
+double pair_bias(const PairMoments& moments);
+double pair_lower_limit(const PairMoments& moments);
+double pair_upper_limit(const PairMoments& moments);
+double pair_icc(const PairMoments& moments);
+
+struct ConfidenceInterval {
+    double estimate = std::numeric_limits<double>::quiet_NaN();   // On the data itself
+    double lower = std::numeric_limits<double>::quiet_NaN();
+    double upper = std::numeric_limits<double>::quiet_NaN();
+};
+
+// Percentile bootstrap: the n pairs are resampled with replacement
+// options.resamples times and every statistic is computed on the same
+// resamples, out[i] for statistics[i]. Resamples where a statistic is NaN
+// are left out of its interval.
+std::vector<ConfidenceInterval> bootstrap_pairs(const double* a, const double* b, std::size_t n,
+                                                const std::vector<PairStatistic>& statistics,
+                                                const ResampleOptions& options = ResampleOptions());
+
+// Bootstrap interval of the mean of values.
+ConfidenceInterval bootstrap_mean(const double* values, std::size_t n,
+                                  const ResampleOptions& options = ResampleOptions());
+
+// Two-sided test of a difference of means. p = (1 + k) / (1 + resamples)
+// with k resamples at least as far from 0 as the observed difference, so
+// it is never 0 (Phipson & Smyth 2010).
+struct PermutationTest {
+    std::size_t n_a = 0;
+    std::size_t n_b = 0;
+    double observed = std::numeric_limits<double>::quiet_NaN();   // mean(a) - mean(b)
+    double p_value = std::numeric_limits<double>::quiet_NaN();
+    std::size_t resamples = 0;
+};
+
+// Paired data (the right and left eye of each subject): the differences
+// a - b get random signs.
+PermutationTest paired_permutation_test(const double* a, const double* b, std::size_t n,
+                                        const ResampleOptions& options = ResampleOptions());
+// Independent groups: the pooled values are randomly relabelled.
+PermutationTest group_permutation_test(const double* a, std::size_t n_a, const double* b, std::size_t n_b,
+                                       const ResampleOptions& options = ResampleOptions());
@@ -0,0 +1,14 @@
+// StimulusToDraw.h
+#pragma once
+
+#include <array>
+#include <glm/vec3.hpp>
+
+// Everything the renderer needs to draw the moving stimulus for one frame.
+// Produced by PerimetryEngine, consumed by Meteoroid::draw.
+struct StimulusToDraw {
+    bool is_visible = false;
+    glm::vec3 position = glm::vec3(0.0f);   // World position on the perimetry sphere
+    float radius_m = 0.0f;                  // Radius of the projected stimulus disc
+    std::array<float, 3> color = {0.0f, 0.0f, 0.0f}; // Gamma encoded RGB
+};
@@ -0,0 +1,227 @@
+// StudyStatistics.cpp
+#include "StudyStatistics.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <set>
+
+namespace {
+int stimulus_key(MeteoroidSizeID size, StimulusCode luminance) {
+    return static_cast<int>(size) * GOLDMANN_STIMULUS_COUNT + luminance.index;
+}
+MeteoroidSizeID key_size(int key) { return static_cast<MeteoroidSizeID>(key / GOLDMANN_STIMULUS_COUNT); }
+StimulusCode key_luminance(int key) { return StimulusCode{static_cast<std::uint8_t>(key % GOLDMANN_STIMULUS_COUNT)}; }
+
+// Areas (deg²) of the isopters with a contour of one eye by stimulus key:
+// [0] of all repeats, [1 + r] of repeat r alone
+using EyeAreas = std::vector<std::map<int, double>>;
+
+std::vector<EyeAreas> score_eyes(const std::vector<StudyEyeIsopters>& eyes, int samples, unsigned threads,
+                                 bool repeats) {
+    std::vector<EyeAreas> out(eyes.size());
+    std::vector<IsopterAreaScorer> scorers(parallel_workers(threads, eyes.size()), IsopterAreaScorer(samples));
+    parallel_for(eyes.size(), threads, [&](unsigned worker, std::size_t index) {
+        const StudyEyeIsopters& eye = eyes[index];
+        EyeAreas& areas = out[index];
+        areas.resize(1 + (repeats ? eye.repeats.size() : 0));
+        auto score = [&](const std::vector<Isopter>& isopters, std::map<int, double>& into) {
+            IsopterArea area;
+            for (const Isopter& isopter : isopters) {
+                if (scorers[worker].score(isopter, eye.eye, eye.age_years, area)) {
+                    into[stimulus_key(isopter.size, isopter.luminance)] = area.area_deg2();
+                }
+            }
+        };
+        score(eye.isopters, areas[0]);
+        for (std::size_t r = 1; r < areas.size(); r++) score(eye.repeats[r - 1], areas[r]);
+    });
+    return out;
+}
+
+struct Mean {
+    double sum = 0.0;
+    int n = 0;
+
+    void add(double value) {
+        sum += value;
+        n++;
+    }
+    double value() const { return sum / n; }
+};
+
+double mean(const std::vector<double>& values) {
+    double sum = 0.0;
+    for (double value : values) sum += value;
+    return sum / static_cast<double>(values.size());
+}
+}
+
+int field_meridian(int eye, int longitude) {
+    int meridian = eye == 2 ? 180 - longitude : longitude;
+    return ((meridian % 360) + 360) % 360;
+}
+
+std::vector<MeridianRepeatability> meridian_repeatability(const std::vector<StudyEyeIsopters>& eyes) {
+    std::map<std::pair<int, int>, PairMoments> moments;
+    for (const StudyEyeIsopters& eye : eyes) {
+        if (eye.repeats.size() < 2) continue;
+        for (const Isopter& first : eye.repeats[0]) {
+            auto second = std::find_if(eye.repeats[1].begin(), eye.repeats[1].end(), [&](const Isopter& isopter) {
+                return isopter.size == first.size && isopter.luminance == first.luminance;
+            });
+            if (second == eye.repeats[1].end()) continue;
+            int key = stimulus_key(first.size, first.luminance);
+            // Both knot lists are ascending
+            std::size_t j = 0;
+            for (std::size_t i = 0; i < first.knot_longitude.size(); i++) {
+                while (j < second->knot_longitude.size() && second->knot_longitude[j] < first.knot_longitude[i]) j++;
+                if (j == second->knot_longitude.size()) break;
+                if (second->knot_longitude[j] != first.knot_longitude[i]) continue;
+                int meridian = field_meridian(eye.eye, static_cast<int>(std::lround(first.knot_longitude[i])));
+                moments[{key, meridian}].add(visual_eccentricity_deg(first.knot_radius[i]),
+                                             visual_eccentricity_deg(second->knot_radius[j]));
+            }
+        }
+    }
+
+    std::vector<MeridianRepeatability> out;
+    out.reserve(moments.size());
+    for (const auto& entry : moments) {
+        MeridianRepeatability row;
+        row.size = key_size(entry.first.first);
+        row.luminance = key_luminance(entry.first.first);
+        row.meridian = entry.first.second;
+        row.agreement = bland_altman(entry.second);
+        row.icc = icc_agreement(entry.second);
+        out.push_back(row);
+    }
+    return out;
+}
+
+std::vector<IsopterRepeatability> isopter_repeatability(const std::vector<StudyEyeIsopters>& eyes,
+                                                        const ResampleOptions& options, int samples) {
+    std::vector<EyeAreas> areas = score_eyes(eyes, samples, options.threads, true);
+    std::set<int> keys;
+    for (const EyeAreas& eye : areas) {
+        for (const auto& area : eye[0]) keys.insert(area.first);
+    }
+
+    std::vector<IsopterRepeatability> out;
+    std::vector<double> first;
+    std::vector<double> second;
+    std::vector<double> all;
+    for (int key : keys) {
+        first.clear();
+        second.clear();
+        all.clear();
+        for (const EyeAreas& eye : areas) {
+            auto area = eye[0].find(key);
+            if (area != eye[0].end()) all.push_back(area->second);
+            if (eye.size() < 3) continue;
+            auto a = eye[1].find(key);
+            auto b = eye[2].find(key);
+            if (a == eye[1].end() || b == eye[2].end()) continue;
+            first.push_back(a->second);
+            second.push_back(b->second);
+        }
+
+        IsopterRepeatability row;
+        row.size = key_size(key);
+        row.luminance = key_luminance(key);
+        row.pairs = first.size();
+        std::vector<ConfidenceInterval> intervals = bootstrap_pairs(
+                first.data(), second.data(), first.size(),
+                {pair_bias, pair_lower_limit, pair_upper_limit, pair_icc}, options);
+        row.bias = intervals[0];
+        row.lower_limit = intervals[1];
+        row.upper_limit = intervals[2];
+        row.icc = intervals[3];
+        row.eyes = all.size();
+        row.mean_area = bootstrap_mean(all.data(), all.size(), options);
+        out.push_back(row);
+    }
+    return out;
+}
+
+std::vector<AreaComparison> compare_eyes(const std::vector<StudyEyeIsopters>& eyes, const ResampleOptions& options,
+                                         int samples) {
+    std::vector<EyeAreas> areas = score_eyes(eyes, samples, options.threads, false);
+    // [stimulus][subject] right and left
+    std::map<int, std::map<long, std::pair<Mean, Mean>>> subjects;
+    for (std::size_t i = 0; i < eyes.size(); i++) {
+        if (eyes[i].subject < 0 || (eyes[i].eye != 1 && eyes[i].eye != 2)) continue;
+        for (const auto& area : areas[i][0]) {
+            std::pair<Mean, Mean>& subject = subjects[area.first][eyes[i].subject];
+            (eyes[i].eye == 1 ? subject.first : subject.second).add(area.second);
+        }
+    }
+
+    std::vector<AreaComparison> out;
+    std::vector<double> right;
+    std::vector<double> left;
+    for (const auto& stimulus : subjects) {
+        right.clear();
+        left.clear();
+        for (const auto& subject : stimulus.second) {
+            if (subject.second.first.n == 0 || subject.second.second.n == 0) continue;
+            right.push_back(subject.second.first.value());
+            left.push_back(subject.second.second.value());
+        }
+        if (right.empty()) continue;
+        AreaComparison row;
+        row.size = key_size(stimulus.first);
+        row.luminance = key_luminance(stimulus.first);
+        row.a = "right";
+        row.b = "left";
+        row.mean_a = mean(right);
+        row.mean_b = mean(left);
+        row.test = paired_permutation_test(right.data(), left.data(), right.size(), options);
+        out.push_back(row);
+    }
+    return out;
+}
+
+std::vector<AreaComparison> compare_groups(const std::vector<StudyEyeIsopters>& eyes,
+                                           const std::vector<SubjectGroup>& groups, const ResampleOptions& options,
+                                           int samples) {
+    std::map<long, std::string> group_of;
+    for (const SubjectGroup& row : groups) group_of[row.subject] = row.group;
+    std::vector<EyeAreas> areas = score_eyes(eyes, samples, options.threads, false);
+    // [group][stimulus][subject]
+    std::map<std::string, std::map<int, std::map<long, Mean>>> subjects;
+    for (std::size_t i = 0; i < eyes.size(); i++) {
+        auto group = group_of.find(eyes[i].subject);
+        if (group == group_of.end()) continue;
+        for (const auto& area : areas[i][0]) subjects[group->second][area.first][eyes[i].subject].add(area.second);
+    }
+
+    std::vector<AreaComparison> out;
+    std::vector<double> a;
+    std::vector<double> b;
+    auto values = [](const std::map<long, Mean>& subject_means, std::vector<double>& into) {
+        into.clear();
+        for (const auto& subject : subject_means) into.push_back(subject.second.value());
+    };
+    for (auto first = subjects.begin(); first != subjects.end(); ++first) {
+        for (auto second = std::next(first); second != subjects.end(); ++second) {
+            for (const auto& stimulus : first->second) {
+                auto other = second->second.find(stimulus.first);
+                if (other == second->second.end()) continue;
+                values(stimulus.second, a);
+                values(other->second, b);
+                AreaComparison row;
+                row.size = key_size(stimulus.first);
+                row.luminance = key_luminance(stimulus.first);
+                row.a = first->first;
+                row.b = second->first;
+                row.mean_a = mean(a);
+                row.mean_b = mean(b);
+                row.test = group_permutation_test(a.data(), a.size(), b.data(), b.size(), options);
+                out.push_back(row);
+            }
+        }
+    }
+    return out;
+}
@@ -0,0 +1,79 @@
+// StudyStatistics.h
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "IsopterStudy.h"
+#include "Statistics.h"
+
+// Test-retest and between-eye statistics of a study, what
+// Code/Analyisis/general_analyzation.py was meant to become. Every entry
+// of the test plan is measured NUMBER_ITERATIONS_PER_SIZE times; the
+// repeats are compared as fitted by build_study_repeats(), repeat 1
+// against repeat 2. Areas are solid angles in deg² (IsopterArea.h).
+
+// Meridians in the orientation of a right eye: 0 temporal, 90 superior.
+// The longitudes of left eyes are mirrored (180 - longitude).
+int field_meridian(int eye, int longitude);
+
+// Eccentricity (deg) of repeat 1 against repeat 2 on one meridian, over
+// all eyes with a knot of this stimulus there in both repeats.
+struct MeridianRepeatability {
+    MeteoroidSizeID size = MeteoroidSizeID::None;
+    StimulusCode luminance{};
+    int meridian = 0;
+    BlandAltman agreement;
+    double icc = std::numeric_limits<double>::quiet_NaN();
+};
+
+// Ordered by (size, luminance, meridian).
+std::vector<MeridianRepeatability> meridian_repeatability(const std::vector<StudyEyeIsopters>& eyes);
+
+// Area of the isopter of one stimulus. The repeat statistics are over the
+// eyes with a contour in both repeats, the mean area over the eyes with a
+// contour of all repeats together; the intervals resample eyes.
+struct IsopterRepeatability {
+    MeteoroidSizeID size = MeteoroidSizeID::None;
+    StimulusCode luminance{};
+    std::size_t pairs = 0;
+    ConfidenceInterval bias;            // Repeat 1 - repeat 2
+    ConfidenceInterval lower_limit;     // Limits of agreement
+    ConfidenceInterval upper_limit;
+    ConfidenceInterval icc;
+    std::size_t eyes = 0;
+    ConfidenceInterval mean_area;
+};
+
+// Ordered by (size, luminance).
+std::vector<IsopterRepeatability> isopter_repeatability(const std::vector<StudyEyeIsopters>& eyes,
+                                                        const ResampleOptions& options = ResampleOptions(),
+                                                        int samples = IsopterOptions().samples);
+
+// Mean area of one stimulus in two sets of subjects, and the permutation
+// test of their difference.
+struct AreaComparison {
+    MeteoroidSizeID size = MeteoroidSizeID::None;
+    StimulusCode luminance{};
+    std::string a;
+    std::string b;
+    double mean_a = std::numeric_limits<double>::quiet_NaN();
+    double mean_b = std::numeric_limits<double>::quiet_NaN();
+    PermutationTest test;
+};
+
+// Right ("right") against left eye ("left") of the subjects with both,
+// paired by subject. Several sheets of one eye (a CSV sheet and a session)
+// are averaged.
+std::vector<AreaComparison> compare_eyes(const std::vector<StudyEyeIsopters>& eyes,
+                                         const ResampleOptions& options = ResampleOptions(),
+                                         int samples = IsopterOptions().samples);
+
+// Every pair of groups (in name order) per stimulus; a subject counts
+// once, with the mean area of its eyes. Subjects without a group are
+// left out.
+std::vector<AreaComparison> compare_groups(const std::vector<StudyEyeIsopters>& eyes,
+                                           const std::vector<SubjectGroup>& groups,
+                                           const ResampleOptions& options = ResampleOptions(),
+                                           int samples = IsopterOptions().samples);
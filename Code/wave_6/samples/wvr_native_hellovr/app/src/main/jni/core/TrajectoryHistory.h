@@ -0,0 +1,91 @@
+// TrajectoryHistory.h
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "EngineClock.h"
+#include "GoldmannSheet.h"
+
+// Where the stimulus was at the end of one tick.
+struct TrajectorySample {
+    EngineClock::time_point time{};
+    std::uint32_t track_id = 0;     // Changes with every new vector (and eye)
+    double eccentricity_deg = 90.0;
+    PolarPoint point{0.0f, 0.0f};
+};
+
+// Fixed size ring of the most recent trajectory samples. One writer (the
+// tick) and any number of readers, without locks: every slot carries a
+// sequence number that is odd while the slot is written, so a reader that
+// races with the writer drops that slot instead of blocking the frame.
+class TrajectoryHistory {
+public:
+    // ~7 s at 72 fps, far more than any reaction time
+    static constexpr std::size_t CAPACITY = 512;
+
+    void push(const TrajectorySample& sample) {
+        std::uint64_t index = m_write_index.load(std::memory_order_relaxed);
+        Slot& slot = m_slots[index % CAPACITY];
+        std::uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+        slot.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.sample = sample;
+        slot.seq.store(seq + 2, std::memory_order_release);
+        m_write_index.store(index + 1, std::memory_order_release);
+    }
+
+    // Eccentricity of track_id at time t, linearly interpolated between the
+    // two samples around t. Before the first sample of the track its first
+    // eccentricity is returned, after the last one speed_deg_per_s is used to
+    // extrapolate. Empty if the track is not (or no longer) in the history.
+    std::optional<double> eccentricity_at(EngineClock::time_point t, std::uint32_t track_id,
+                                          double speed_deg_per_s) const {
+        std::uint64_t end = m_write_index.load(std::memory_order_acquire);
+        std::uint64_t count = end < CAPACITY ? end : CAPACITY;
+
+        std::optional<TrajectorySample> newer; // Oldest sample at or after t
+        for (std::uint64_t i = 0; i < count; i++) {
+            TrajectorySample sample;
+            if (!read(end - 1 - i, sample)) continue;
+            if (sample.track_id != track_id) {
+                if (newer) break; // Only older tracks follow
+                continue;         // Still in samples newer than the track
+            }
+            if (sample.time <= t) {
+                if (!newer) {
+                    double dt = std::chrono::duration<double>(t - sample.time).count();
+                    return sample.eccentricity_deg - speed_deg_per_s * dt;
+                }
+                double span = std::chrono::duration<double>(newer->time - sample.time).count();
+                if (span <= 0.0) return newer->eccentricity_deg;
+                double f = std::chrono::duration<double>(t - sample.time).count() / span;
+                return sample.eccentricity_deg + f * (newer->eccentricity_deg - sample.eccentricity_deg);
+            }
+            newer = sample;
+        }
+        if (newer) return newer->eccentricity_deg;
+        return std::nullopt;
+    }
+
+private:
+    struct Slot {
+        std::atomic<std::uint32_t> seq{0};
+        TrajectorySample sample;
+    };
+
+    bool read(std::uint64_t index, TrajectorySample& out) const {
+        const Slot& slot = m_slots[index % CAPACITY];
+        std::uint32_t before = slot.seq.load(std::memory_order_acquire);
+        if (before & 1u) return false;
+        out = slot.sample;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.seq.load(std::memory_order_relaxed) == before;
+    }
+
+    std::array<Slot, CAPACITY> m_slots;
+    std::atomic<std::uint64_t> m_write_index{0};
+};
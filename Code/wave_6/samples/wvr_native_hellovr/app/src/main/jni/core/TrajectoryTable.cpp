@@ -0,0 +1,47 @@
+// TrajectoryTable.cpp
+#include "TrajectoryTable.h"
+#include "Longitude.h"
+
+#include <algorithm>
+#include <glm/glm.hpp>
+
+MeridianTrajectory::MeridianTrajectory(int angle_deg, const CoordinateFunction& coordinates)
+        : m_angle_deg(angle_deg) {
+    m_samples.reserve(SAMPLE_COUNT);
+    for (int i = 0; i < SAMPLE_COUNT; i++) {
+        auto point = coordinates(i * STEP_DEG / 90.0);
+        m_samples.push_back({point.first, point.second});
+    }
+}
+
+MeridianTrajectory::Sample MeridianTrajectory::at(double radius_deg) const {
+    double position = std::clamp(radius_deg, 0.0, 90.0) / STEP_DEG;
+    int index = std::min(static_cast<int>(position), SAMPLE_COUNT - 2);
+    float f = static_cast<float>(position - index);
+
+    const Sample& a = m_samples[index];
+    const Sample& b = m_samples[index + 1];
+    Sample result;
+    result.position = glm::mix(a.position, b.position, f);
+    result.p.theta = a.p.theta + f * (b.p.theta - a.p.theta);
+    result.p.phi = a.p.phi + f * (b.p.phi - a.p.phi);
+    return result;
+}
+
+void TrajectoryTables::build(const std::vector<PerimetryVector>& vectors,
+                             const std::function<std::pair<glm::vec3, PolarPoint>(double, double)>& coordinates) {
+    for (auto& vec : vectors) {
+        int angle = normalize_angle(vec.angle_deg);
+        if (m_slot_of_angle[angle] >= 0) continue;
+
+        m_slot_of_angle[angle] = static_cast<std::int16_t>(m_tables.size());
+        m_tables.emplace_back(vec.angle_deg, [&](double theta_regler) {
+            return coordinates(vec.angle_deg, theta_regler);
+        });
+    }
+}
+
+const MeridianTrajectory* TrajectoryTables::find(int angle_deg) const {
+    int slot = m_slot_of_angle[normalize_angle(angle_deg)];
+    return slot < 0 ? nullptr : &m_tables[slot];
+}
@@ -0,0 +1,58 @@
+// TrajectoryTable.h
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "GoldmannSheet.h"
+
+// Stimulus path along one meridian, sampled from the rim (radius 0°) to the
+// fixation point (radius 90°) every STEP_DEG. The path only depends on the
+// meridian, so one table serves every iteration, size and luminance of it.
+class MeridianTrajectory {
+public:
+    static constexpr double STEP_DEG = 0.1;
+    static constexpr int SAMPLE_COUNT = 901; // 0° .. 90° inclusive
+
+    struct Sample {
+        glm::vec3 position;     // World position (rotated into the Thales frame)
+        PolarPoint p;           // Perimetric coordinates
+    };
+
+    // coordinates(theta_regler) with theta_regler = radius_deg / 90
+    using CoordinateFunction = std::function<std::pair<glm::vec3, PolarPoint>(double theta_regler)>;
+
+    MeridianTrajectory(int angle_deg, const CoordinateFunction& coordinates);
+
+    // Linear interpolation between the two samples around radius_deg
+    Sample at(double radius_deg) const;
+
+    int angle_deg() const { return m_angle_deg; }
+    const std::vector<Sample>& samples() const { return m_samples; }
+
+private:
+    int m_angle_deg;
+    std::vector<Sample> m_samples;
+};
+
+// One MeridianTrajectory per distinct meridian, looked up by angle.
+class TrajectoryTables {
+public:
+    TrajectoryTables() { m_slot_of_angle.fill(-1); }
+
+    // coordinates(longitude_deg, theta_regler)
+    void build(const std::vector<PerimetryVector>& vectors,
+               const std::function<std::pair<glm::vec3, PolarPoint>(double, double)>& coordinates);
+
+    const MeridianTrajectory* find(int angle_deg) const;
+    const std::vector<MeridianTrajectory>& tables() const { return m_tables; }
+
+private:
+    std::vector<MeridianTrajectory> m_tables;
+    std::array<std::int16_t, 360> m_slot_of_angle;
+};
@@ -0,0 +1,216 @@
+// UploadProtocol.cpp
+#include "UploadProtocol.h"
+#include "FileUtil.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+void put_u32(unsigned char* out, std::uint32_t value) {
+    for (int i = 0; i < 4; i++) out[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+std::uint32_t get_u32(const unsigned char* in) {
+    std::uint32_t value = 0;
+    for (int i = 0; i < 4; i++) value |= static_cast<std::uint32_t>(in[i]) << (8 * i);
+    return value;
+}
+
+void set_error(std::string* error, const std::string& text) {
+    if (error) *error = text;
+}
+
+bool unix_path(const std::string& address, std::string& path) {
+    if (address.rfind("unix:", 0) == 0) {
+        path = address.substr(5);
+        return true;
+    }
+    if (!address.empty() && address[0] == '/') {
+        path = address;
+        return true;
+    }
+    return false;
+}
+
+bool fill_unix_address(const std::string& path, sockaddr_un& addr, std::string* error) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        set_error(error, "bad socket path " + path);
+        return false;
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size());
+    return true;
+}
+
+// host:port through getaddrinfo; the caller frees the list
+addrinfo* resolve(const std::string& address, bool passive, std::string* error) {
+    std::string::size_type colon = address.rfind(':');
+    if (colon == std::string::npos) {
+        set_error(error, "address without port: " + address);
+        return nullptr;
+    }
+    std::string host = address.substr(0, colon);
+    std::string port = address.substr(colon + 1);
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (passive) hints.ai_flags = AI_PASSIVE;
+    addrinfo* list = nullptr;
+    int rc = ::getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &list);
+    if (rc != 0) {
+        set_error(error, address + ": " + ::gai_strerror(rc));
+        return nullptr;
+    }
+    return list;
+}
+
+void set_timeouts(int fd, std::chrono::milliseconds timeout) {
+    timeval tv{};
+    tv.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+    tv.tv_usec = static_cast<suseconds_t>((timeout.count() % 1000) * 1000);
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+}
+
+void encode_upload_header(UploadFrameType type, const void* payload, std::size_t size,
+                          unsigned char (&out)[upload_protocol::HEADER_BYTES]) {
+    std::memcpy(out, upload_protocol::MAGIC, 4);
+    out[4] = upload_protocol::VERSION;
+    out[5] = static_cast<unsigned char>(type);
+    out[6] = 0;
+    out[7] = 0;
+    put_u32(out + 8, static_cast<std::uint32_t>(size));
+    put_u32(out + 12, crc32(payload, size));
+}
+
+bool decode_upload_header(const unsigned char* in, UploadFrameHeader& header) {
+    if (std::memcmp(in, upload_protocol::MAGIC, 4) != 0 || in[4] != upload_protocol::VERSION) return false;
+    header.type = static_cast<UploadFrameType>(in[5]);
+    header.payload_bytes = get_u32(in + 8);
+    header.crc = get_u32(in + 12);
+    return header.payload_bytes <= upload_protocol::MAX_PAYLOAD_BYTES;
+}
+
+std::string encode_upload_frame(UploadFrameType type, const std::string& payload) {
+    unsigned char header[upload_protocol::HEADER_BYTES];
+    encode_upload_header(type, payload.data(), payload.size(), header);
+    std::string frame(reinterpret_cast<const char*>(header), sizeof(header));
+    frame += payload;
+    return frame;
+}
+
+std::string encode_hello(std::uint64_t device_id, const std::string& device_name) {
+    std::string payload(8, '\0');
+    for (int i = 0; i < 8; i++) payload[i] = static_cast<char>(device_id >> (8 * i));
+    payload += device_name;
+    return encode_upload_frame(UploadFrameType::Hello, payload);
+}
+
+std::string encode_ack(std::uint32_t upload_id, UploadStatus status, std::uint8_t eyes_stored) {
+    unsigned char payload[upload_protocol::ACK_BYTES] = {};
+    put_u32(payload, upload_id);
+    payload[4] = static_cast<unsigned char>(status);
+    payload[5] = eyes_stored;
+    return encode_upload_frame(UploadFrameType::Ack, std::string(reinterpret_cast<char*>(payload), sizeof(payload)));
+}
+
+bool decode_ack(const unsigned char* payload, std::size_t size, std::uint32_t& upload_id, UploadStatus& status,
+                std::uint8_t& eyes_stored) {
+    if (size != upload_protocol::ACK_BYTES || payload[4] > static_cast<unsigned char>(UploadStatus::StoreFailed)) {
+        return false;
+    }
+    upload_id = get_u32(payload);
+    status = static_cast<UploadStatus>(payload[4]);
+    eyes_stored = payload[5];
+    return true;
+}
+
+int connect_upload_socket(const std::string& address, std::chrono::milliseconds timeout, std::string* error) {
+    std::string path;
+    if (unix_path(address, path)) {
+        sockaddr_un addr;
+        if (!fill_unix_address(path, addr, error)) return -1;
+        int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            set_error(error, std::string("socket: ") + std::strerror(errno));
+            return -1;
+        }
+        set_timeouts(fd, timeout);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            set_error(error, address + ": " + std::strerror(errno));
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    addrinfo* list = resolve(address, false, error);
+    if (!list) return -1;
+    int fd = -1;
+    for (addrinfo* ai = list; ai && fd < 0; ai = ai->ai_next) {
+        fd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+        // Linux applies the send timeout to connect() as well
+        set_timeouts(fd, timeout);
+        if (::connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+            set_error(error, address + ": " + std::strerror(errno));
+            ::close(fd);
+            fd = -1;
+            continue;
+        }
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    ::freeaddrinfo(list);
+    return fd;
+}
+
+int listen_upload_socket(const std::string& address, std::string* error) {
+    std::string path;
+    int fd = -1;
+    if (unix_path(address, path)) {
+        sockaddr_un addr;
+        if (!fill_unix_address(path, addr, error)) return -1;
+        struct stat st;
+        if (::stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) ::unlink(path.c_str());
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            set_error(error, address + ": " + std::strerror(errno));
+            if (fd >= 0) ::close(fd);
+            return -1;
+        }
+    } else {
+        addrinfo* list = resolve(address, true, error);
+        if (!list) return -1;
+        for (addrinfo* ai = list; ai && fd < 0; ai = ai->ai_next) {
+            fd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+            if (fd < 0) continue;
+            int one = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (::bind(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+                set_error(error, address + ": " + std::strerror(errno));
+                ::close(fd);
+                fd = -1;
+            }
+        }
+        ::freeaddrinfo(list);
+        if (fd < 0) return -1;
+    }
+    if (::listen(fd, SOMAXCONN) != 0) {
+        set_error(error, address + ": " + std::strerror(errno));
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
@@ -0,0 +1,73 @@
+// UploadProtocol.h
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Session upload protocol between the headsets (SessionUploader) and the
+// ingestion service (IngestServer), over a stream socket.
+//
+// Every message is a frame, all integers little-endian:
+//
+//   "PUPL" u8 version u8 type u16 reserved u32 payload_bytes u32 crc32
+//   payload (crc32 is the CRC-32 of the payload)
+//
+//   Hello    device -> server  u64 device_id, device name (UTF-8, rest of
+//                              the payload). Once, first frame.
+//   Session  device -> server  u32 upload_id, u32 subject (0 unassigned),
+//                              the complete session file (*.pses).
+//   Ack      server -> device  u32 upload_id, u8 UploadStatus, u8 eyes
+//                              stored, u16 reserved. Sent once the session
+//                              is durable in the store.
+//
+// A device may send several sessions without waiting, acks come in order.
+// The server closes the connection on a malformed frame; a session that is
+// framed correctly but not a valid session file is acked Invalid.
+//
+// Addresses: "unix:/path" or an absolute path for a Unix socket,
+// "host:port" for TCP.
+namespace upload_protocol {
+constexpr char MAGIC[4] = {'P', 'U', 'P', 'L'};
+constexpr std::uint8_t VERSION = 1;
+constexpr std::size_t HEADER_BYTES = 16;
+constexpr std::size_t SESSION_PREFIX_BYTES = 8;
+constexpr std::size_t ACK_BYTES = 8;
+constexpr std::uint32_t MAX_PAYLOAD_BYTES = 64u << 20;
+}
+
+enum class UploadFrameType : std::uint8_t { Hello = 1, Session = 2, Ack = 3 };
+
+enum class UploadStatus : std::uint8_t {
+    Stored = 0,         // At least one eye is new in the store
+    Duplicate = 1,      // Every eye was already stored
+    Invalid = 2,        // Not a session file, or no final sheet
+    StoreFailed = 3,    // Server side I/O error, retry later
+};
+
+struct UploadFrameHeader {
+    UploadFrameType type;
+    std::uint32_t payload_bytes;
+    std::uint32_t crc;
+};
+
+// Header of a frame with payload; false if the bytes are not a frame
+// header of this version or the payload is too large.
+void encode_upload_header(UploadFrameType type, const void* payload, std::size_t size,
+                          unsigned char (&out)[upload_protocol::HEADER_BYTES]);
+bool decode_upload_header(const unsigned char* in, UploadFrameHeader& header);
+
+// Whole frames, for small messages
+std::string encode_upload_frame(UploadFrameType type, const std::string& payload);
+std::string encode_hello(std::uint64_t device_id, const std::string& device_name);
+std::string encode_ack(std::uint32_t upload_id, UploadStatus status, std::uint8_t eyes_stored);
+bool decode_ack(const unsigned char* payload, std::size_t size, std::uint32_t& upload_id, UploadStatus& status,
+                std::uint8_t& eyes_stored);
+
+// Blocking, connected socket with send/receive timeouts, -1 on error.
+int connect_upload_socket(const std::string& address, std::chrono::milliseconds timeout,
+                          std::string* error = nullptr);
+// Non-blocking listening socket, -1 on error. A stale Unix socket file is
+// replaced.
+int listen_upload_socket(const std::string& address, std::string* error = nullptr);
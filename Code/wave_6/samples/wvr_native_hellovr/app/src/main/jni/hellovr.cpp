@@ -15,6 +15,7 @@
 #include <limits>
 #include <sys/types.h>
 #include <sys/time.h>
+#include <time.h>
 #include <cstdlib>
 #include <math.h>
 //#include <Texture.h>
@@ -112,12 +113,19 @@ MainApplication::MainApplication()
     memset(mDevClassChar, 0, sizeof(mDevClassChar));
     mStars = NULL;
     mSky = NULL;
+    mEngine = NULL;
+    mExam = NULL;
+    mJournal = NULL;
+    mIoWorker = NULL;
+    mSessionRecorder = NULL;
+    mGazeRecorder = NULL;
+    mResumeJournal = NULL;
+    mUploader = NULL;
     mMeteoroid = NULL;
     mSphere=NULL;
     // mFloor=NULL;
     mGridPicture = NULL;
     //mReticlePointer = NULL;
-    mActiveEye=0; //0 for not started 1 for right, 2 for left
     // Initialize Menu Panel
     // Position: x=0, y=1.5 (eye level), z=-2.0 (2 meters in front)
     // Size: Width=1.5m, Height=1.0m
@@ -128,17 +136,9 @@ MainApplication::MainApplication()
     mLeftEyeMenu = NULL;
     mRightEyeMenu = NULL;
     mEndMenu = NULL;
-    mShowStartMenu = true;
-    mShowRightEyeMenu= false;
-    mShowLeftEyeMenu = false;
-    mShowEndMenu = false;
-    allDataSaved = false;
 
     //paused Menu
     mPauseMenu = NULL;
-    mShowPauseMenu = false;
-    realPausedReleased = false;
-    mPausedReleased = std::chrono::high_resolution_clock::now();
 
 
 
@@ -218,7 +218,6 @@ bool MainApplication::initVR() {
 
 
     LOGI("initVR() mInteractionMode: %d, mGazeTriggerType: %d", mInteractionMode, mGazeTriggerType);
-    //initPerimetryFiles();
     return true;
 }
 
@@ -240,18 +239,9 @@ void MainApplication::initPerimetryFiles() {
     mRightEyeCsvPath = basePath + "current_Right_" + filename;
     mLeftEyeCsvPath = basePath + "current_Left_" + filename;
 
-    // 3. Write Headers for both files
-    auto writeHeader = [](const std::string& path) {
-        std::ofstream outFile(path, std::ios::out);
-        if (outFile.is_open()) {
-            // NormedValue is excluded as requested
-            outFile << "Longitude,SizeIndex,Luminance,Points[(PHI|THETA)]\n";
-            outFile.close();
-        }
-    };
-
-    writeHeader(mRightEyeCsvPath);
-    writeHeader(mLeftEyeCsvPath);
+    // 3. Open both journals, the writer thread adds the headers
+    if (mJournal)
+        mJournal->open_session(mRightEyeCsvPath, mLeftEyeCsvPath);
 
     LOGI("Perimetry files initialized:\n  R: %s\n  L: %s", mRightEyeCsvPath.c_str(), mLeftEyeCsvPath.c_str());
 }
@@ -291,26 +281,19 @@ bool MainApplication::initGL() {
     // Start Menu
     mStartMenu = new Panel(mMenuPosition, mMenuWidth, mMenuHeight);
     mStartMenu->setTexture("textures/StartBox.png"); // Make sure this image exists!
-    mShowStartMenu = true; // Start with menu showing
     // Right Eye
     mRightEyeMenu = new Panel(mMenuPosition, mMenuWidth, mMenuHeight);
     mRightEyeMenu->setTexture("textures/RightEyeBox.png");
-    mShowRightEyeMenu = false;
     // Left Eye
     mLeftEyeMenu = new Panel(mMenuPosition, mMenuWidth, mMenuHeight);
     mLeftEyeMenu->setTexture("textures/LeftEyeBox.png");
-    mShowLeftEyeMenu = false;
     // EndMenu
     mEndMenu = new Panel(mMenuPosition, mMenuWidth, mMenuHeight);
     mEndMenu->setTexture("textures/EndBox.png");
-    mShowEndMenu = false;
 
     // Pause Menu
     mPauseMenu = new SkySphere();
     mPauseMenu->setTexture("textures/PauseMenu2.png");
-    mShowPauseMenu = false;
-    realPausedReleased = false;
-    mPausedReleased = std::chrono::high_resolution_clock::now();
 
 
 
@@ -319,6 +302,9 @@ bool MainApplication::initGL() {
     OBJ_ERROR_CHECK(mStars);
     mSky = new Sky(gDebug);
     OBJ_ERROR_CHECK(mSky);
+    mEngine = new PerimetryEngine();
+    if (mPatientAge > 0.0f)
+        mEngine->set_patient_age(mPatientAge);
     mMeteoroid = new Meteoroid();
     OBJ_ERROR_CHECK(mMeteoroid);
     mTerrain = new Terrain(gDebug);
@@ -326,8 +312,7 @@ bool MainApplication::initGL() {
     mLightDir = Vector4(0, 1, 0, 0);
 
     // Set Balancing Eye
-    std::bernoulli_distribution coin_flip(0.5);
-    mFirstEye = coin_flip(m_rng) ? 1 : 2;
+    mFirstEye = chooseFirstEye();
     /*
     std::uniform_real_distribution<float> dist(0.0f, 1.0f);
     float rndNumber = dist(m_rng);
@@ -338,6 +323,66 @@ bool MainApplication::initGL() {
     }
     */
 
+    // Exam flow, starts in the start menu
+    ExamHooks examHooks;
+    examHooks.on_eye_finished = [this](int eye) {
+        if (mResumeJournal) {
+            mResumeJournal->eye_finished(eye);
+            if (eye != mFirstEye)
+                mResumeJournal->end_session(); // Nothing left to resume
+        }
+        savePerimetryData(mEngine->m_goldmann_sheet, eye);
+        if (mSessionRecorder)
+            mSessionRecorder->on_eye_finished(mEngine->m_goldmann_sheet, eye);
+        if (mGazeRecorder)
+            mGazeRecorder->flush();
+        if (eye != mFirstEye)
+            saveSessionFile(); // Both eyes done
+    };
+    examHooks.on_close = [this]() { CloseApplication(); };
+    examHooks.on_next_patient = [this]() { return startNextPatient(); };
+    examHooks.on_point_detected = [this](const DetectedPoint& point, EngineClock::time_point time) {
+        appendPointToCSV(point);
+        if (mSessionRecorder)
+            mSessionRecorder->on_response(point, time);
+        if (mResumeJournal) {
+            mResumeVectorsLogged = mEngine->vector_index();
+            mResumeJournal->response(point, mEngine->detected_eccentricity_deg(), mResumeVectorsLogged);
+        }
+    };
+    examHooks.on_pause_changed = [this](bool paused, ExamState state, EngineClock::time_point time) {
+        if (!mSessionRecorder)
+            return;
+        if (paused) {
+            mSessionRecorder->on_pause(time, state == ExamState::FixationLost
+                    ? SessionPauseReason::FixationLost : SessionPauseReason::PauseMenu);
+        } else {
+            mSessionRecorder->on_resume(time);
+        }
+    };
+    examHooks.on_eye_started = [this](int eye) {
+        mResumeVectorsLogged = mEngine->vector_index();
+        if (mResumeJournal)
+            mResumeJournal->eye_started(eye, mEngine->order_seed(), mResumeVectorsLogged);
+    };
+    examHooks.on_resume_choice = [this](bool accepted) { chooseResume(accepted); };
+    mExam = new ExamStateMachine(*mEngine, mFirstEye, examHooks);
+
+    // Running journal of every response, one file per eye
+    mJournal = new JournalWriter();
+    // Final exports of finished eyes
+    mIoWorker = new IoWorker();
+    mSessionRecorder = new SessionRecorder();
+    mGazeRecorder = new GazeRecorder(mIoWorker);
+    mResumeJournal = new ResumeJournal(mIoWorker);
+    startUploader();
+    // An interrupted exam waits for the operator in the start menu
+    if (!offerResume()) {
+        beginResumeJournal();
+        beginSessionFile();
+        initPerimetryFiles();
+    }
+
 
 #if defined(USE_CONTROLLER)
     mControllerObjs[0] = new Controller(WVR_DeviceType_Controller_Right);
@@ -476,6 +521,38 @@ void MainApplication::shutdownGL() {
         delete mMeteoroid;
     mMeteoroid = NULL;
 
+    if (mExam != NULL)
+        delete mExam;
+    mExam = NULL;
+
+    if (mJournal != NULL)
+        delete mJournal; // Syncs the queued points
+    mJournal = NULL;
+
+    if (mSessionRecorder != NULL)
+        delete mSessionRecorder; // Unfinished sessions are not written
+    mSessionRecorder = NULL;
+
+    if (mGazeRecorder != NULL)
+        delete mGazeRecorder; // Writes the last chunk through mIoWorker
+    mGazeRecorder = NULL;
+
+    if (mResumeJournal != NULL)
+        delete mResumeJournal; // An unfinished exam stays resumable
+    mResumeJournal = NULL;
+
+    if (mIoWorker != NULL)
+        delete mIoWorker; // Finishes pending exports
+    mIoWorker = NULL;
+
+    if (mUploader != NULL)
+        delete mUploader; // Files not yet acked are sent on the next start
+    mUploader = NULL;
+
+    if (mEngine != NULL)
+        delete mEngine;
+    mEngine = NULL;
+
     if (mStars != NULL)
         delete mStars;
     mStars = NULL;
@@ -584,6 +661,30 @@ public:
 //-----------------------------------------------------------------------------
 // Purpose: Poll events.  Quit application if return true.
 //-----------------------------------------------------------------------------
+// Device timestamp of an input event on the engine clock (steady_clock).
+// WVR stamps events with CLOCK_MONOTONIC nanoseconds. Instead of relying on
+// steady_clock having the same epoch, the age of the event is measured on
+// CLOCK_MONOTONIC itself and taken back from the engine clock's now.
+// Timestamps that are missing, in the future or older than a second (a
+// different clock base) fall back to the poll time, logged once.
+static EngineClock::time_point eventTime(const WVR_Event_t& event) {
+    auto now = SteadyEngineClock::instance().now();
+    timespec monotonic;
+    clock_gettime(CLOCK_MONOTONIC, &monotonic);
+    int64_t monotonic_ns = static_cast<int64_t>(monotonic.tv_sec) * 1000000000 + monotonic.tv_nsec;
+    int64_t age_ns = monotonic_ns - static_cast<int64_t>(event.common.timestamp);
+    if (event.common.timestamp <= 0 || age_ns < 0 || age_ns > 1000000000) {
+        static bool warned = false;
+        if (!warned) {
+            LOGW("Event timestamp %lld is not on CLOCK_MONOTONIC (now %lld), using the poll time",
+                 static_cast<long long>(event.common.timestamp), static_cast<long long>(monotonic_ns));
+            warned = true;
+        }
+        return now;
+    }
+    return now - std::chrono::nanoseconds(age_ns);
+}
+
 bool MainApplication::handleInput() {
     LOGENTRY();
     if (mShouldQuit) {
@@ -638,60 +739,13 @@ bool MainApplication::handleInput() {
                         (event.input.inputId == WVR_InputId_Alias1_Trigger) or
                         (event.input.inputId == WVR_InputId_Alias1_Touchpad)
                 ) {
-                    if (mMeteoroid->m_perimetry_status == "running") {
-                        auto resultTuple = mMeteoroid->point_detected();
-
-                        // 2. Save asynchronously to prevent VR stutter
-                        // We pass 'this' and the 'resultTuple' to the helper function
-                        /*
-                        std::thread saverThread([this, resultTuple]() {
-                            this->appendPointToCSV(resultTuple);
-                        });
-                        saverThread.detach();
-                         */
-
-                    }
-                    if (mShowRightEyeMenu) {
-                        mShowRightEyeMenu = false;
-                        mMeteoroid->start_animation();
-                        mActiveEye = 1;
-                        mMeteoroid->mActiveEye = 1;
-                    }
-
-                    if (mShowLeftEyeMenu) {
-                        mShowLeftEyeMenu = false;
-                        mMeteoroid->start_animation();
-                        mActiveEye = 2;
-                        mMeteoroid->mActiveEye = 2;
-                    }
-
-                    if (mShowStartMenu) {
-                        mShowStartMenu = false;
-                        if (mFirstEye == 1) {
-                            mShowRightEyeMenu = true;
-                        } else if (mFirstEye == 2) {
-                            mShowLeftEyeMenu = true;
-                        }
-                    }
-
-                    if (mShowEndMenu) {
-                        mShowEndMenu = false;
-                        mActiveEye = 0;
-                        mMeteoroid->mActiveEye = 0;
-                        CloseApplication();
-                    }
+                    // Response, menu confirmation or closing, depending on the exam state
+                    mExam->post(ExamEventType::Trigger, eventTime(event));
                 // If A or X Button is Pressed
-                } else if (((event.input.inputId == WVR_InputId_Alias1_A) or
-                           (event.input.inputId == WVR_InputId_Alias1_X))
-                           and !mShowStartMenu and !mShowRightEyeMenu and !mShowLeftEyeMenu and !mShowEndMenu) {
-                    if (mShowPauseMenu) {
-                        realPausedReleased = true;
-                        mShowPauseMenu = false;
-                        mPausedReleased = std::chrono::high_resolution_clock::now();
-                    } else {
-                        mShowPauseMenu = true;
-                        mMeteoroid->pause_animation(false);
-                    }
+                } else if ((event.input.inputId == WVR_InputId_Alias1_A) or
+                           (event.input.inputId == WVR_InputId_Alias1_X)) {
+                    // Pause / resume, in the end menu: next patient
+                    mExam->post(ExamEventType::PauseButton, eventTime(event));
                 } else if (event.input.inputId == WVR_InputId_Alias1_B) {
                     if (gaze_correction < 10.0) {
                         gaze_correction += 1.0;
@@ -944,6 +998,7 @@ bool MainApplication::renderFrame() {
     if (mInteractionMode == WVR_InteractionMode_Gaze) {
         drawReticlePointer();
     }*/
+    tickPerimetry();
     renderStereoTargets();
     ext |= WVR_SubmitExtend_Default;
 #if ENABLE_LOW_FOVEATED_RENDERING
@@ -1087,31 +1142,35 @@ void MainApplication::renderStereoTargets() {
 }
 
 
+// Advances the exam exactly once per frame, before any eye is rendered:
+// queued input/gaze/timer events and their transitions (saving, eye switch)
+// first, then the engine tick. renderScene only reads the results.
+void MainApplication::tickPerimetry() {
+    if (!mEngine || !mExam)
+        return;
+
+    EngineClock::time_point now = std::chrono::steady_clock::now();
+    mExam->update(now);
+
+    const FrameSnapshot& snapshot = mEngine->tick(now);
+    if (mMeteoroid)
+        mMeteoroid->setStimulus(snapshot.stimulus);
+    if (mSessionRecorder)
+        mSessionRecorder->on_frame(*mEngine, now);
+    // Vectors that ran through without a response
+    if (mResumeJournal && mExam->exam_running() && mEngine->vector_index() != mResumeVectorsLogged) {
+        mResumeVectorsLogged = mEngine->vector_index();
+        mResumeJournal->progress(mExam->active_eye(), mResumeVectorsLogged);
+    }
+}
+
 void MainApplication::renderScene(WVR_Eye nEye) {
     WVR_RenderMask(nEye);
 
-    // Reset for second eye
-    if (mMeteoroid and mMeteoroid->m_perimetry_status == "Done") {
-        if (mActiveEye == mFirstEye) {
-            savePerimetryData(mMeteoroid->m_goldmann_sheet);
-            mMeteoroid->reset_animation();
-            if (mFirstEye == 1) {
-                mActiveEye = 2;
-                mMeteoroid->mActiveEye = 2;
-                mShowLeftEyeMenu = true;
-            } else if (mFirstEye == 2) {
-                mActiveEye = 1;
-                mMeteoroid->mActiveEye = 1;
-                mShowRightEyeMenu = true;
-            }
-        } else {
-            if (!allDataSaved) {
-                savePerimetryData(mMeteoroid->m_goldmann_sheet);
-                allDataSaved = true;
-                mShowEndMenu = true;
-            }
-        }
-    }
+    ExamState examState = mExam ? mExam->state() : ExamState::StartMenu;
+    int eye = activeEye();
+    bool showPauseMenu = (examState == ExamState::Paused);
+
     /*
     if (mGridPicture && mGridPicture->isEnabled()) {
         if (nEye == WVR_Eye_Left)
@@ -1122,52 +1181,39 @@ void MainApplication::renderScene(WVR_Eye nEye) {
     }
      */
     // Menus
-    if (mStartMenu && mShowStartMenu) {
+    if (mStartMenu && examState == ExamState::StartMenu) {
         if (nEye == WVR_Eye_Left)
             mStartMenu->draw(mProjectionLeft, mEyePosLeft, mHMDPose, mLightDir);
         else if (nEye == WVR_Eye_Right)
             mStartMenu->draw(mProjectionRight, mEyePosRight, mHMDPose, mLightDir);
     }
-    if (mRightEyeMenu && mShowRightEyeMenu) {
+    if (mRightEyeMenu && examState == ExamState::EyeMenu && eye == 1) {
         if (nEye == WVR_Eye_Left)
             mRightEyeMenu->draw(mProjectionLeft, mEyePosLeft, mHMDPose, mLightDir);
         else if (nEye == WVR_Eye_Right)
             mRightEyeMenu->draw(mProjectionRight, mEyePosRight, mHMDPose, mLightDir);
     }
-    if (mLeftEyeMenu && mShowLeftEyeMenu) {
+    if (mLeftEyeMenu && examState == ExamState::EyeMenu && eye == 2) {
         if (nEye == WVR_Eye_Left)
             mLeftEyeMenu->draw(mProjectionLeft, mEyePosLeft, mHMDPose, mLightDir);
         else if (nEye == WVR_Eye_Right)
             mLeftEyeMenu->draw(mProjectionRight, mEyePosRight, mHMDPose, mLightDir);
     }
-    if (mEndMenu && mShowEndMenu) {
+    if (mEndMenu && examState == ExamState::EndMenu) {
         if (nEye == WVR_Eye_Left)
             mEndMenu->draw(mProjectionLeft, mEyePosLeft, mHMDPose, mLightDir);
         else if (nEye == WVR_Eye_Right)
             mEndMenu->draw(mProjectionRight, mEyePosRight, mHMDPose, mLightDir);
     }
-    if (mPauseMenu && mShowPauseMenu) {
+    if (mPauseMenu && showPauseMenu) {
         if (nEye == WVR_Eye_Left)
             mPauseMenu->draw(mProjectionLeft, mEyePosLeft, mHMDPose, mLightDir);
         else if (nEye == WVR_Eye_Right)
             mPauseMenu->draw(mProjectionRight, mEyePosRight, mHMDPose, mLightDir);
     }
 
-    if (realPausedReleased) {
-        auto now = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::seconds>(now - mPausedReleased);
-        if (duration.count() > 4) {
-            realPausedReleased = false;
-            mShowPauseMenu = false;
-            mPausedReleased = now;
-            mMeteoroid->resume_animation();
-        }
-    }
-
-
-
     // Sky
-    if (mSky and !mShowPauseMenu) {
+    if (mSky and !showPauseMenu) {
         if (nEye == WVR_Eye_Left)
             mSky->draw(mProjectionLeft, mEyePosLeft, mHMDPose, mLightDir);
         else if (nEye == WVR_Eye_Right)
@@ -1175,14 +1221,15 @@ void MainApplication::renderScene(WVR_Eye nEye) {
     }
 
     // Meteoroid
-    if (mMeteoroid and !mShowPauseMenu) {
-        if (nEye == WVR_Eye_Left and mActiveEye == 2)
+    if (mMeteoroid and !showPauseMenu) {
+        if (nEye == WVR_Eye_Left and eye == 2) {
             mMeteoroid->draw(mProjectionLeft, mEyePosLeft, mHMDPose, mLightDir);
-        else if (nEye == WVR_Eye_Right and mActiveEye == 1)
+        } else if (nEye == WVR_Eye_Right and eye == 1) {
             mMeteoroid->draw(mProjectionRight, mEyePosRight, mHMDPose, mLightDir);
+        }
     }
     // Stars
-    if (mStars and SHOW_STARS and !mShowPauseMenu) {
+    if (mStars and SHOW_STARS and !showPauseMenu) {
         if (nEye == WVR_Eye_Left)
             mStars->draw(mProjectionLeft, mEyePosLeft, mHMDPose, mLightDir);
         else if (nEye == WVR_Eye_Right)
@@ -1190,7 +1237,7 @@ void MainApplication::renderScene(WVR_Eye nEye) {
     }
 
     // Terrain
-    if (mTerrain and SHOW_TERRAIN and !mShowPauseMenu) {
+    if (mTerrain and SHOW_TERRAIN and !showPauseMenu) {
         if (nEye == WVR_Eye_Left)
             mTerrain->draw(mProjectionLeft, mEyePosLeft, mHMDPose, mLightDir);
         else if (nEye == WVR_Eye_Right)
@@ -1198,7 +1245,8 @@ void MainApplication::renderScene(WVR_Eye nEye) {
     }
 
     // Sphere
-    if (mSphere and (!mShowStartMenu and !mShowRightEyeMenu and !mShowLeftEyeMenu and !mShowEndMenu and !mShowPauseMenu)) {
+    // Fixation target while the exam runs (also during the resume countdown)
+    if (mSphere and (mExam and (mExam->exam_running() or examState == ExamState::Resuming))) {
     // mSphere->setSphereColor(currColor);
         if (nEye == WVR_Eye_Left)
             mSphere->draw(mProjectionLeft, mEyePosLeft, mHMDPose, mLightDir);
@@ -1393,7 +1441,8 @@ void MainApplication::updateEyeTracking() {
     }
     bool isSet = false;
     Vector3 gazeDirLocal;
-    if ((mActiveEye == 1) && mEyeTrackingData.right.eyeTrackingValidBitMask /*&& WVR_GazeDirectionNormalizedValid*/) {
+    int eye = activeEye();
+    if ((eye == 1) && mEyeTrackingData.right.eyeTrackingValidBitMask /*&& WVR_GazeDirectionNormalizedValid*/) {
         gazeDirLocal = Vector3(
                 mEyeTrackingData.right.gazeDirectionNormalized.v[0],
                 mEyeTrackingData.right.gazeDirectionNormalized.v[1],
@@ -1401,7 +1450,7 @@ void MainApplication::updateEyeTracking() {
         );
         isSet = true;
     }
-    if ((mActiveEye == 2) && mEyeTrackingData.left.eyeTrackingValidBitMask /*&& WVR_GazeDirectionNormalizedValid*/) {
+    if ((eye == 2) && mEyeTrackingData.left.eyeTrackingValidBitMask /*&& WVR_GazeDirectionNormalizedValid*/) {
         gazeDirLocal = Vector3(
                 mEyeTrackingData.left.gazeDirectionNormalized.v[0],
                 mEyeTrackingData.left.gazeDirectionNormalized.v[1],
@@ -1410,6 +1459,11 @@ void MainApplication::updateEyeTracking() {
         isSet = true;
     }
 
+    // Fixation check result, recorded with the raw sample below
+    bool angleValid = false;
+    bool onTarget = false;
+    float angle = 0.0f;
+
     // Check if combined gaze data is valid
     if (isSet) {
         // --- A. CALCULATE VECTORS ---
@@ -1455,32 +1509,75 @@ void MainApplication::updateEyeTracking() {
         if(dotProduct < -1.0f) dotProduct = -1.0f;
 
         // Calculate Angle in Degrees
-        float angle = acos(dotProduct) * 180.0f / M_PI;
+        angle = acos(dotProduct) * 180.0f / M_PI;
+        angleValid = true;
 
         // DEFINE TOLERANCE: How strict are we?
         // 8-10 degrees is usually a comfortable "foveal" view.
         // 15+ degrees is very loose.
 
-        if (angle <= (MAX_ACCEPTANCE_ANGLE_DEG + gaze_correction)) {
+        onTarget = angle <= (MAX_ACCEPTANCE_ANGLE_DEG + gaze_correction);
+        if (onTarget) {
             // --- STATE: LOOKING AT SPHERE ---
             mSphere->setSphereColor(Sphere::Color::green); // Renders as Grey/White
+            if (mSessionRecorder)
+                mSessionRecorder->on_gaze(std::chrono::steady_clock::now(), true, angle);
 
-            if (mMeteoroid and !realPausedReleased) {
-                mMeteoroid->resume_animation();
+            if (mExam) {
+                mExam->post(ExamEventType::GazeOnTarget);
             }
         } else {
             // --- STATE: LOOKING AWAY ---
             mSphere->setSphereColor(Sphere::Color::red);   // Renders as Red
+            if (mSessionRecorder)
+                mSessionRecorder->on_gaze(std::chrono::steady_clock::now(), false, angle);
 
-            if (mMeteoroid and !realPausedReleased) {
-                mMeteoroid->pause_animation(false);
+            if (mExam) {
+                mExam->post(ExamEventType::GazeLost);
             }
         }
     }
+    recordGazeSample(angleValid, angle, onTarget);
 }
 
+void MainApplication::recordGazeSample(bool angleValid, float angle, bool onTarget) {
+    if (!mGazeRecorder || !mGazeRecorder->is_open())
+        return;
+
+    auto copyEye = [](const WVR_SingleEyeTracking_t& in, GazeEyeSample& out) {
+        out.valid_mask = in.eyeTrackingValidBitMask;
+        for (int i = 0; i < 3; i++) {
+            out.origin[i] = in.gazeOrigin.v[i];
+            out.direction[i] = in.gazeDirectionNormalized.v[i];
+        }
+        out.openness = in.eyeOpenness;
+        out.pupil_diameter_mm = in.pupilDiameter;
+        out.pupil_position[0] = in.pupilPositionInSensorArea.v[0];
+        out.pupil_position[1] = in.pupilPositionInSensorArea.v[1];
+    };
 
-void MainApplication::savePerimetryData(const GoldmannSheet& sheet) {
+    GazeSample sample;
+    sample.time_ns = mEyeTrackingData.timestamp;
+    copyEye(mEyeTrackingData.left, sample.left);
+    copyEye(mEyeTrackingData.right, sample.right);
+    sample.fixation_angle_deg = angle;
+    sample.flags = (onTarget ? GazeSample::ON_TARGET : 0) | (angleValid ? GazeSample::ANGLE_VALID : 0);
+    if (mEngine) {
+        const FrameSnapshot& snapshot = mEngine->snapshot();
+        if (snapshot.stimulus.is_visible)
+            sample.flags |= GazeSample::STIMULUS_VISIBLE;
+        if (mEngine->m_perimetry_status == PerimetryStatus::Paused)
+            sample.flags |= GazeSample::ENGINE_PAUSED;
+        sample.track_id = mEngine->track_id();
+        sample.eccentricity_deg = static_cast<float>(snapshot.eccentricity_deg);
+    }
+    if (mExam)
+        sample.exam_state = static_cast<std::uint8_t>(mExam->state());
+    mGazeRecorder->add(sample);
+}
+
+
+void MainApplication::savePerimetryData(const GoldmannSheet& sheet, int eye) {
     if (mExportPath.empty()) {
         LOGE("Cannot save data: Export path is empty.");
         return;
@@ -1499,131 +1596,246 @@ void MainApplication::savePerimetryData(const GoldmannSheet& sheet) {
     // --- 3. Construct Full Path ---
     // Ensure mExportPath doesn't already have a trailing slash
     std::string fullPath;
+    std::string isopterPath;
     std::string eyeAppendix;
-    map<int, map<MeteoroidSizeID, map<string, SheetEntry>>> sheet_to_save;
-    if (mActiveEye == 1) {
-        eyeAppendix = "final_Right_";
-        sheet_to_save = sheet.m_sheet_right;
-    } else if (mActiveEye == 2) {
-        eyeAppendix = "final_Left_";
-        sheet_to_save = sheet.m_sheet_left;
-    }
-    if (mExportPath.back() == '/') {
-        fullPath = mExportPath + eyeAppendix + filename;
+    if (eye == 1) {
+        eyeAppendix = "Right_";
+    } else if (eye == 2) {
+        eyeAppendix = "Left_";
+    }
+    std::string directory = mExportPath.back() == '/' ? mExportPath : mExportPath + "/";
+    fullPath = directory + "final_" + eyeAppendix + filename;
+    isopterPath = directory + "isopters_" + eyeAppendix + filename;
+
+    // --- 4. Snapshot now, format and write on the I/O worker ---
+    // The copy is two flat vectors; the sheet may change right after this
+    // (next eye, next patient) without affecting the export.
+    std::shared_ptr<const GoldmannSheet> snapshot = sheet.snapshot(eye);
+    double age = mEngine ? mEngine->patient_age() : DEFAULT_PATIENT_AGE_YEARS;
+    auto job = [snapshot, eye, age, fullPath, isopterPath]() {
+        if (write_file_atomic(fullPath, format_sheet_csv(*snapshot, eye))) {
+            LOGI("Data saved to: %s", fullPath.c_str());
+        } else {
+            LOGE("Failed to save data to: %s", fullPath.c_str());
+        }
+
+        // Contours of the eye, as the analysis draws them
+        std::vector<Isopter> isopters = build_isopters(*snapshot, eye);
+        if (write_file_atomic(isopterPath, format_isopter_csv(isopters))) {
+            LOGI("%zu isopters saved to: %s", isopters.size(), isopterPath.c_str());
+        } else {
+            LOGE("Failed to save isopters to: %s", isopterPath.c_str());
+        }
+        IsopterAreaScorer scorer;
+        for (const Isopter& isopter : isopters) {
+            IsopterArea area;
+            if (!scorer.score(isopter, eye, age, area))
+                continue;
+            LOGI("Isopter %s %s: %.0f deg2, %.0f deg2 lost (%.0f%% of normal)", size_info(isopter.size).name,
+                 stimulus_info(isopter.luminance).name, area.area_deg2(), area.lost_deg2(),
+                 100.0 * area.lost_fraction());
+        }
+    };
+    if (mIoWorker) {
+        mIoWorker->post(job);
     } else {
-        fullPath = mExportPath + "/"+ eyeAppendix + filename;
+        job();
     }
+}
 
-    LOGI("Saving data to: %s", fullPath.c_str());
-
-    // --- 4. Open and Write ---
-    std::ofstream outFile;
-    outFile.open(fullPath, std::ios::out); // Default to overwrite since filename is unique
-
-    if (!outFile.is_open()) {
-        LOGE("Failed to open file for writing: %s", fullPath.c_str());
+void MainApplication::appendPointToCSV(const DetectedPoint& data) {
+    if (!mJournal)
         return;
-    }
-
-    // Write CSV Header
-    outFile << "Longitude,SizeIndex,Intensity,Points[(PHI,THETA)],NormedValue\n";
-
-    //const auto& points = sheet.get_points();
-    //const auto& sizes = sheet.get_sizes(); // Assuming you have sizes stored similarly
-
-    auto inn_it = sheet.inner_it;
-    auto mid_it = sheet.middle_it;
-    auto out_it = sheet.outer_it;
 
+    // Written and synced by the journal thread within its sync interval
+    if (!mJournal->append(JournalRecord::from_detection(data))) {
+        LOGE("Journal queue full, point dropped (%llu dropped)",
+             static_cast<unsigned long long>(mJournal->dropped()));
+    }
+}
 
-    for (out_it = sheet_to_save.begin(); out_it != sheet_to_save.end(); out_it++) {
-        for (mid_it = out_it->second.begin(); mid_it != out_it->second.end(); mid_it++) {
+void MainApplication::CloseApplication() {
+    LOGI("CloseApplication called. Exiting main loop...");
+    mShouldQuit = true;
+}
 
-            for (inn_it = mid_it->second.begin(); inn_it != mid_it->second.end(); inn_it++) {
-                auto longitude = out_it->first;
-                MeteoroidSizeID size_id = mid_it->first;
-                string luminance = inn_it->first;
-                auto entry = inn_it->second;
-                AnyMeteoroidSize size = m_size_map.at(size_id);
-                string size_name = std::visit([](auto &&s) {
-                    return s.get_name();
-                }, size);
+void MainApplication::beginSessionFile() {
+    if (!mSessionRecorder)
+        return;
+    auto wallNow = std::chrono::system_clock::now().time_since_epoch();
+    mSessionRecorder->begin(std::chrono::steady_clock::now(),
+                            std::chrono::duration_cast<std::chrono::milliseconds>(wallNow).count(),
+                            mExam ? mExam->patient_index() : 0, mFirstEye);
+
+    // Raw eye tracking stream of the same patient
+    if (mGazeRecorder && !mExportPath.empty()) {
+        std::time_t t = std::time(nullptr);
+        char buffer[128];
+        std::strftime(buffer, sizeof(buffer), "gaze_%Y-%m-%d_%H-%M-%S.pgaz", std::localtime(&t));
+        std::string path = mExportPath;
+        if (path.back() != '/') path += "/";
+        mGazeRecorder->open(path + buffer);
+    }
+}
 
-                // Write Data
+void MainApplication::saveSessionFile() {
+    if (mGazeRecorder)
+        mGazeRecorder->close();
+    if (!mSessionRecorder || !mSessionRecorder->active())
+        return;
+    std::shared_ptr<const SessionData> session = mSessionRecorder->take();
+    if (mExportPath.empty()) {
+        LOGE("Cannot save session file: Export path is empty.");
+        return;
+    }
 
-                outFile << longitude << ","
-                        << size_name << ","
-                        << luminance << ",[";
+    std::time_t t = std::time(nullptr);
+    char buffer[128];
+    std::strftime(buffer, sizeof(buffer), "session_%Y-%m-%d_%H-%M-%S.pses", std::localtime(&t));
+    std::string fullPath = mExportPath;
+    if (fullPath.back() != '/') fullPath += "/";
+    fullPath += buffer;
+
+    // Serialized and written on the I/O worker, like the final CSVs. The
+    // DICOM files of both eyes are written from the same file image.
+    SessionUploader* uploader = mUploader;
+    auto job = [session, fullPath, uploader]() {
+        std::string image = serialize_session(*session);
+        if (write_file_atomic(fullPath, image)) {
+            LOGI("Session saved to: %s", fullPath.c_str());
+            if (uploader)
+                uploader->post_file(fullPath, session->patient_index);
+        } else {
+            LOGE("Failed to save session to: %s", fullPath.c_str());
+        }
 
-                for (auto &val: entry.points) {
-                    outFile << "(" << val.phi
-                            << "|" << val.theta
-                            << ");";
-                }
-                outFile << "]," << entry.normalized_angle << "\n";
+        SessionFileView file;
+        if (!file.open_memory(image.data(), image.size()))
+            return;
+        DicomStudyInfo info = default_dicom_study_info(file.header());
+        std::string basePath = fullPath.substr(0, fullPath.size() - strlen(".pses"));
+        const char* suffixes[2] = {"_Right.dcm", "_Left.dcm"};
+        for (int eye = 1; eye <= 2; eye++) {
+            FormatBuffer dicom(dicom_capacity(file, eye));
+            std::string error;
+            if (!write_session_dicom(file, eye, info, dicom, &error)) {
+                LOGW("No DICOM of eye %d: %s", eye, error.c_str());
+                continue;
             }
+            std::string dicomPath = basePath + suffixes[eye - 1];
+            if (!write_file_atomic(dicomPath, dicom.str()))
+                LOGE("Failed to save DICOM to: %s", dicomPath.c_str());
         }
+    };
+    if (mIoWorker) {
+        mIoWorker->post(job);
+    } else {
+        job();
     }
+}
 
-    outFile.close();
-    LOGI("Data saved successfully with timestamp.");
+void MainApplication::setPatientAge(float years) {
+    // Called from the Java thread; the render thread hands it to the engine
+    // in initGL() and startNextPatient()
+    mPatientAge = years;
 }
 
-void MainApplication::appendPointToCSV(const std::tuple<PolarPoint, AnyMeteoroidSize, int, int, string>& data) {
-    int eyeID = std::get<3>(data);
+void MainApplication::startUploader() {
+    if (mExportPath.empty())
+        return;
+    std::string dir = mExportPath;
+    if (dir.back() != '/') dir += "/";
+    std::ifstream config(dir + "upload_address.txt");
+    std::string address;
+    std::string name;
+    if (!std::getline(config, address) || address.empty())
+        return;
+    if (!std::getline(config, name) || name.empty())
+        name = "headset";
+    mUploader = new SessionUploader(address, std::hash<std::string>()(name), name);
+    // Sessions of earlier runs that never reached the server
+    size_t pending = mUploader->post_pending(dir);
+    LOGI("Uploading sessions to %s as %s, %zu pending", address.c_str(), name.c_str(), pending);
+}
 
-    // Select File
-    std::string targetFile;
-    if (eyeID == 1) targetFile = mRightEyeCsvPath;
-    else if (eyeID == 2) targetFile = mLeftEyeCsvPath;
-    else { LOGE("Invalid Eye ID: %d", eyeID); return; }
+std::string MainApplication::resumeJournalPath() const {
+    if (mExportPath.empty())
+        return std::string();
+    std::string path = mExportPath;
+    if (path.back() != '/') path += "/";
+    return path + "exam_resume.journal";
+}
 
-    if (targetFile.empty()) {
-        LOGE("Target filename is empty! Check initPerimetryFiles.");
-        return;
-    }
+void MainApplication::beginResumeJournal() {
+    if (mResumeJournal && !mExportPath.empty())
+        mResumeJournal->begin_session(resumeJournalPath(), mExam ? mExam->patient_index() : 0, mFirstEye);
+}
 
-    // --- DIAGNOSTIC WRITE ---
-    // Use std::ios::out | std::ios::app to be explicit
-    std::ofstream outFile(targetFile, std::ios::out | std::ios::app | std::ios::ate);
+bool MainApplication::offerResume() {
+    if (!mExam || mExportPath.empty())
+        return false;
+    mResumeState = read_resume_journal(resumeJournalPath());
+    if (!mResumeState.resumable)
+        return false;
+    LOGI("Interrupted exam: %zu responses, eye %d from vector %zu. A/X continues, trigger starts over.",
+         mResumeState.responses.size(), mResumeState.point.active_eye, mResumeState.point.next_vector);
+    mExam->offer_resume(mResumeState.point);
+    return true;
+}
 
-    // Check if OPEN failed
-    if (!outFile.is_open()) {
-        // strerror(errno) will print the ACTUAL OS error (e.g., "Permission denied", "No such file or directory")
-        LOGE("CRITICAL: Failed to open %s. Error: %s", targetFile.c_str(), std::strerror(errno));
+void MainApplication::chooseResume(bool accepted) {
+    if (!accepted) {
+        mResumeState = ResumeState();
+        beginResumeJournal();
+        beginSessionFile();
+        initPerimetryFiles();
         return;
     }
 
-    // Extract Data
-    PolarPoint p = std::get<0>(data);
-    AnyMeteoroidSize size = std::get<1>(data);
-    int longitude = std::get<2>(data);
-    string luminance = std::get<4>(data);
-    string size_name = std::visit([](auto &&s) { return s.get_name(); }, size);
-
-    // Write Data
-    outFile << longitude << ","
-            << size_name << ","
-            << luminance << ",[("
-            << p.phi << "|" << p.theta
-            << ");]" << "\n"; // Use \n instead of endl for now
-
-    // 3. FORCE FLUSH to physical disk
-    outFile.flush();
-
-    // Check if WRITE failed
-    if (outFile.fail() || outFile.bad()) {
-        LOGE("CRITICAL: Write operation failed. Error: %s", std::strerror(errno));
-    } else {
-        LOGI("Success: Appended point to %s", targetFile.c_str());
+    // The state machine already took over the eyes of the interrupted exam
+    mFirstEye = mResumeState.point.first_eye;
+    restore_sheets(mEngine->m_goldmann_sheet, mResumeState);
+    beginSessionFile();
+    if (mResumeState.first_eye_finished && mSessionRecorder)
+        mSessionRecorder->on_eye_finished(mEngine->m_goldmann_sheet, mFirstEye);
+
+    // New running CSVs, starting with the points from before the interruption
+    initPerimetryFiles();
+    if (mJournal) {
+        for (const ResumeRecord& record : mResumeState.responses) {
+            if (!mJournal->append(record.point)) {
+                mJournal->flush(); // Menu, blocking is fine
+                mJournal->append(record.point);
+            }
+        }
     }
+    if (mResumeJournal)
+        mResumeJournal->continue_session(resumeJournalPath());
+    LOGI("Continuing exam: %zu points restored", mResumeState.responses.size());
+    mResumeState = ResumeState();
+}
 
-    outFile.close();
+int MainApplication::chooseFirstEye() {
+    std::bernoulli_distribution coin_flip(0.5);
+    return coin_flip(m_rng) ? 1 : 2;
 }
 
-void MainApplication::CloseApplication() {
-    LOGI("CloseApplication called. Exiting main loop...");
-    mShouldQuit = true;
+int MainApplication::startNextPatient() {
+    // The engine is already reset by the exam state machine
+    mFirstEye = chooseFirstEye();
+    gaze_correction = 0.0f;
+    if (mPatientAge > 0.0f && mEngine)
+        mEngine->set_patient_age(mPatientAge);
+    if (mMeteoroid)
+        mMeteoroid->setStimulus(StimulusToDraw());
+
+    // Running CSV files are per patient, new timestamp
+    initPerimetryFiles();
+    beginSessionFile();
+    beginResumeJournal();
+
+    LOGI("Next patient, first eye: %d", mFirstEye);
+    return mFirstEye;
 }
 
 #if defined(USE_CONTROLLER) || defined(USE_CUSTOM_CONTROLLER)
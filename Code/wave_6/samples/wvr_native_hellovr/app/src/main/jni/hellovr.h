@@ -10,6 +10,7 @@
 
 #pragma once
 #include <stdio.h>
+#include <atomic>
 #include <fstream> // Required for file writing
 #include <string>
 #include <vector>
@@ -29,6 +30,19 @@
 #include <GoldmannSheet.h>
 #include <Sky.h>
 #include <Meteoroid.h>
+#include <PerimetryEngine.h>
+#include <ExamStateMachine.h>
+#include <JournalWriter.h>
+#include <IoWorker.h>
+#include <FileUtil.h>
+#include <SheetExport.h>
+#include <Isopter.h>
+#include <IsopterArea.h>
+#include <SessionRecorder.h>
+#include <GazeRecorder.h>
+#include <ResumeJournal.h>
+#include <DicomExport.h>
+#include <SessionUploader.h>
 #include <chrono>
 #include <Picture.h>
 #include "SkySphere.h"
@@ -83,6 +97,7 @@ public:
     //void handleHandInput(HandTypeEnum handType);
     //void calculateHandInteraction(DrawModeEnum iMode, size_t iEyeID);
 
+    void tickPerimetry();
     void renderStereoTargets();
     //void drawControllers();
     void renderScene(WVR_Eye nEye);
@@ -95,10 +110,27 @@ public:
     bool initEyeTracking();
     void shutdownEyeTracking();
     void updateEyeTracking();
+    void recordGazeSample(bool angleValid, float angle, bool onTarget);
     // Write to SD Card
     void setExportPath(std::string path) { mExportPath = path; }
-    void savePerimetryData(const GoldmannSheet& sheet);
+    // Age for the normative isopters, from the next session on
+    void setPatientAge(float years);
+    void savePerimetryData(const GoldmannSheet& sheet, int eye);
+    int activeEye() const { return mExam ? mExam->active_eye() : 0; }
     void CloseApplication();
+    // Next patient in the same process: resets engine, sheets, eye order and
+    // export files, keeps GL resources, texture queues and the eye tracker.
+    int startNextPatient();
+    // Binary session file (*.pses) of the current patient
+    void beginSessionFile();
+    void saveSessionFile();
+    // Uploader for EXPORT/upload_address.txt (address, optional device name)
+    void startUploader();
+    // Write-ahead journal to continue an exam after the app was killed
+    std::string resumeJournalPath() const;
+    void beginResumeJournal();
+    bool offerResume();
+    void chooseResume(bool accepted);
     //
 
     inline Matrix4 wvrmatrixConverter(const WVR_Matrix4f_t& mat) const {
@@ -112,7 +144,7 @@ public:
 
 private:
     std::string mExportPath;
-    bool allDataSaved;
+    std::atomic<float> mPatientAge{0.0f}; // 0: unknown, the engine uses DEFAULT_PATIENT_AGE_YEARS
     bool mShouldQuit;
 protected:
     //void moveSphereHandler();
@@ -177,33 +209,34 @@ protected:
     float mMenuWidth;
     float mMenuHeight;
     Panel* mStartMenu;
-    bool mShowStartMenu;
     Panel* mRightEyeMenu;
-    bool mShowRightEyeMenu;
     Panel* mLeftEyeMenu;
-    bool mShowLeftEyeMenu;
     Panel* mEndMenu;
-    bool mShowEndMenu;
-
-
-    bool realPausedReleased;
     SkySphere* mPauseMenu;
-    bool mShowPauseMenu;
-    std::chrono::time_point<std::chrono::high_resolution_clock> mPausedReleased;
 
     std::mt19937 m_rng{ std::random_device{}() };
-    int mActiveEye;
     int mFirstEye;
+    int chooseFirstEye();
     // Saving data to sd card
     // Store fixed file paths for the current session
     std::string mRightEyeCsvPath;
     std::string mLeftEyeCsvPath;
-    // Helper to initialize files at start
+    // Opens the running journals once per session
     void initPerimetryFiles();
-    // Helper to append a single point
-    void appendPointToCSV(const std::tuple<PolarPoint, AnyMeteoroidSize, int, int, string>& data);
-
-
+    // Queues a single point for the journal thread, never blocks
+    void appendPointToCSV(const DetectedPoint& data);
+
+
+    PerimetryEngine* mEngine;
+    ExamStateMachine* mExam; // Exam flow: menus, pause, eye switching, saving
+    JournalWriter* mJournal; // Writer thread of the running per-point CSVs
+    IoWorker* mIoWorker;     // Final sheet exports, off the render thread
+    SessionRecorder* mSessionRecorder; // Columns of the binary session file
+    GazeRecorder* mGazeRecorder;       // Every eye tracking sample, delta encoded
+    ResumeJournal* mResumeJournal;     // Seed, progress and responses of the running exam
+    SessionUploader* mUploader;        // Session files to the ingestion server, if configured
+    ResumeState mResumeState;          // Interrupted exam offered in the start menu
+    size_t mResumeVectorsLogged = 0;
     Meteoroid* mMeteoroid;
     Picture * mGridPicture;
     //ReticlePointer * mReticlePointer;
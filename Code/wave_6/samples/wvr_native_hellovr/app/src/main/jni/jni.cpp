@@ -26,6 +26,7 @@ extern bool gSceneOld;
 // --- 1. GLOBAL APP POINTER ---
 MainApplication *app = nullptr;
 std::string g_cachedPath = "";
+float g_cachedPatientAge = 0.0f;
 
 int main(int argc, char *argv[]) {
     LOGENTRY();
@@ -35,6 +36,8 @@ int main(int argc, char *argv[]) {
         LOGI("Main: Applying cached path to app: %s", g_cachedPath.c_str());
         app->setExportPath(g_cachedPath);
     }
+    if (g_cachedPatientAge > 0.0f)
+        app->setPatientAge(g_cachedPatientAge);
     LOGI("HelloVR main, start call app->initVR()");
     if (!app) return 1;
     if (!app->initVR()) {
@@ -104,6 +107,16 @@ Java_com_htc_vr_samples_wvr_1hellovr_MainActivity_setExportPath(JNIEnv *env, job
     }
 }
 
+extern "C"
+JNIEXPORT void JNICALL
+Java_com_htc_vr_samples_wvr_1hellovr_MainActivity_setPatientAge(JNIEnv *env, jobject instance, jfloat years) {
+    g_cachedPatientAge = years;
+    if (app != nullptr) {
+        app->setPatientAge(years);
+        LOGI("JNI: Patient age set to %.1f", years);
+    }
+}
+
 extern "C" {
     JNIEXPORT void JNICALL Java_com_htc_vr_samples_wvr_1hellovr_MainActivity_init(JNIEnv * env, jobject act, jobject am);
     JNIEXPORT void JNICALL Java_com_htc_vr_samples_wvr_1hellovr_MainActivity_setFlag(JNIEnv * env, jclass clazz, jint flag);
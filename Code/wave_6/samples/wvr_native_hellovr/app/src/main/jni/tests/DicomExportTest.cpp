@@ -0,0 +1,307 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "DicomExport.h"
+
+namespace {
+// Two rows for the right eye (one with two points, one not seen), one row
+// for the left eye
+std::string make_session_image() {
+    SessionData data;
+    data.created_unix_ms = 1769702874000; // 2026-01-29 16:07:54 UTC
+    data.patient_index = 7;
+    data.first_eye = 1;
+    data.stimuli.time_ns = {0, 4000000000, 9000000000};
+    data.stimuli.eye = {1, 1, 2};
+    data.stimuli.track = {1, 2, 3};
+    data.stimuli.longitude = {90, 0, 180};
+    data.stimuli.size = {4, 0, 2};
+    data.stimuli.luminance = {19, 9, 14};
+    data.responses.time_ns = {1000000000, 2000000000, 9500000000};
+    data.responses.eye = {1, 1, 2};
+    data.responses.longitude = {90, 90, 180};
+    data.responses.size = {4, 4, 2};
+    data.responses.luminance = {19, 19, 14};
+    data.responses.phi = {0.0f, 0.0f, -40.0f};
+    data.responses.theta = {60.0f, 58.0f, 0.0f};
+
+    data.sheet.eye = {1, 1, 2};
+    data.sheet.longitude = {90, 0, 180};
+    data.sheet.size = {4, 0, 2};
+    data.sheet.luminance = {19, 9, 14};
+    data.sheet.normalized_angle = {59.0f, 0.0f, 40.0f};
+    data.sheet.point_count = {2, 0, 1};
+    data.sheet.point_phi = {0.0f, 0.0f, -40.0f};
+    data.sheet.point_theta = {60.0f, 58.0f, 0.0f};
+    return serialize_session(data);
+}
+
+DicomStudyInfo make_info() {
+    DicomStudyInfo info;
+    info.patient_name = "Doe^Jane";
+    info.patient_id = "P-123";
+    info.patient_birth_date = "19700101";
+    info.patient_sex = "F";
+    info.study_uid = make_dicom_uid(1, 2);
+    info.series_uid = make_dicom_uid(3, 4);
+    return info;
+}
+
+struct Element {
+    std::uint32_t tag;
+    std::string vr;
+    std::string value;
+};
+
+// Minimal explicit VR little endian reader: the top level elements of the
+// dataset, and the items of the one sequence flattened into item_elements
+struct ParsedFile {
+    std::map<std::uint32_t, Element> meta;
+    std::map<std::uint32_t, Element> dataset;
+    std::vector<std::map<std::uint32_t, Element>> items;
+    std::string error;
+};
+
+std::uint16_t u16(const char* p) {
+    std::uint16_t v;
+    std::memcpy(&v, p, 2);
+    return v;
+}
+
+std::uint32_t u32(const char* p) {
+    std::uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+bool is_long_vr(const std::string& vr) {
+    return vr == "OB" || vr == "OW" || vr == "SQ" || vr == "UN" || vr == "UT";
+}
+
+ParsedFile parse(const std::string& file) {
+    ParsedFile parsed;
+    if (file.size() < 132 || file.compare(128, 4, "DICM") != 0) {
+        parsed.error = "no DICM prefix";
+        return parsed;
+    }
+    const char* p = file.data() + 132;
+    const char* end = file.data() + file.size();
+    std::uint32_t last_tag = 0;
+    std::map<std::uint32_t, Element>* item = nullptr;
+    std::uint32_t item_last_tag = 0;
+    bool in_sequence = false;
+    while (p + 8 <= end) {
+        std::uint32_t tag = (static_cast<std::uint32_t>(u16(p)) << 16) | u16(p + 2);
+        if (tag == 0xFFFEE000u) {
+            parsed.items.emplace_back();
+            item = &parsed.items.back();
+            item_last_tag = 0;
+            p += 8;
+            continue;
+        }
+        if (tag == 0xFFFEE00Du) {
+            item = nullptr;
+            p += 8;
+            continue;
+        }
+        if (tag == 0xFFFEE0DDu) {
+            in_sequence = false;
+            p += 8;
+            continue;
+        }
+        Element element;
+        element.tag = tag;
+        element.vr.assign(p + 4, 2);
+        std::uint32_t length;
+        if (is_long_vr(element.vr)) {
+            length = u32(p + 8);
+            p += 12;
+        } else {
+            length = u16(p + 6);
+            p += 8;
+        }
+        if (element.vr == "SQ") {
+            in_sequence = true;
+            parsed.dataset[tag] = element;
+            last_tag = tag;
+            continue;
+        }
+        if (length % 2 != 0 || p + length > end) {
+            parsed.error = "bad length";
+            return parsed;
+        }
+        element.value.assign(p, length);
+        p += length;
+
+        std::uint32_t& previous = item ? item_last_tag : last_tag;
+        if (tag <= previous) {
+            parsed.error = "tags not ascending";
+            return parsed;
+        }
+        previous = tag;
+        if (item) {
+            (*item)[tag] = element;
+        } else if ((tag >> 16) == 0x0002) {
+            parsed.meta[tag] = element;
+        } else if (!in_sequence) {
+            parsed.dataset[tag] = element;
+        }
+    }
+    if (p != end) parsed.error = "trailing bytes";
+    return parsed;
+}
+
+std::string text(const std::map<std::uint32_t, Element>& elements, std::uint32_t tag) {
+    auto it = elements.find(tag);
+    if (it == elements.end()) return "<missing>";
+    std::string value = it->second.value;
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\0')) value.pop_back();
+    return value;
+}
+
+float fl(const std::map<std::uint32_t, Element>& elements, std::uint32_t tag) {
+    auto it = elements.find(tag);
+    if (it == elements.end() || it->second.value.size() != 4) return NAN;
+    float v;
+    std::memcpy(&v, it->second.value.data(), 4);
+    return v;
+}
+}
+
+TEST(DicomExport, WritesAPart10FileOfTheEye) {
+    std::string image = make_session_image();
+    SessionFileView file;
+    ASSERT_TRUE(file.open_memory(image.data(), image.size())) << file.error();
+
+    std::string dicom = format_session_dicom(file, 1, make_info());
+    ParsedFile parsed = parse(dicom);
+    ASSERT_TRUE(parsed.error.empty()) << parsed.error;
+
+    // Group length covers exactly the rest of the meta group
+    std::size_t meta_bytes = 0;
+    for (const auto& entry : parsed.meta) {
+        if (entry.first == 0x00020000u) continue;
+        meta_bytes += (is_long_vr(entry.second.vr) ? 12 : 8) + entry.second.value.size();
+    }
+    EXPECT_EQ(u32(parsed.meta[0x00020000u].value.data()), meta_bytes);
+    EXPECT_EQ(text(parsed.meta, 0x00020010u), dicom::EXPLICIT_VR_LITTLE_ENDIAN);
+    EXPECT_EQ(text(parsed.meta, 0x00020003u), make_dicom_uid(3, 4) + ".1");
+
+    EXPECT_EQ(text(parsed.dataset, 0x00080016u), dicom::OPV_SOP_CLASS);
+    EXPECT_EQ(text(parsed.dataset, 0x00080060u), "OPV");
+    EXPECT_EQ(text(parsed.dataset, 0x00080020u), "20260129");
+    EXPECT_EQ(text(parsed.dataset, 0x00080030u), "160754");
+    EXPECT_EQ(text(parsed.dataset, 0x00100010u), "Doe^Jane");
+    EXPECT_EQ(text(parsed.dataset, 0x00100020u), "P-123");
+    EXPECT_EQ(text(parsed.dataset, 0x00200060u), "R");
+    EXPECT_EQ(u32(parsed.dataset[0x00411001u].value.data()), 2u);
+    EXPECT_FLOAT_EQ(fl(parsed.dataset, 0x00411002u), 4.0f);
+
+    // Two seen points at meridian 90, then the planned entry without a point
+    ASSERT_EQ(parsed.items.size(), 3u);
+    EXPECT_EQ(text(parsed.items[0], 0x00240093u), "SEEN");
+    EXPECT_FLOAT_EQ(fl(parsed.items[0], 0x00240090u), 0.0f);
+    EXPECT_FLOAT_EQ(fl(parsed.items[0], 0x00240091u), 60.0f);
+    EXPECT_EQ(text(parsed.items[0], 0x00410010u), dicom::PRIVATE_CREATOR);
+    EXPECT_EQ(text(parsed.items[0], 0x00411011u), "V");
+    EXPECT_EQ(text(parsed.items[0], 0x00411012u), "4e");
+    EXPECT_FLOAT_EQ(fl(parsed.items[1], 0x00411014u), 58.0f);
+    EXPECT_EQ(text(parsed.items[2], 0x00240093u), "NOT SEEN");
+    EXPECT_EQ(parsed.items[2].count(0x00240090u), 0u);
+    EXPECT_EQ(text(parsed.items[2], 0x00411011u), "I");
+
+    std::string left = format_session_dicom(file, 2, make_info());
+    ParsedFile parsed_left = parse(left);
+    ASSERT_TRUE(parsed_left.error.empty()) << parsed_left.error;
+    EXPECT_EQ(text(parsed_left.dataset, 0x00200060u), "L");
+    ASSERT_EQ(parsed_left.items.size(), 1u);
+    EXPECT_FLOAT_EQ(fl(parsed_left.items[0], 0x00240090u), -40.0f);
+    EXPECT_FLOAT_EQ(fl(parsed_left.items[0], 0x00411014u), 40.0f);
+}
+
+TEST(DicomExport, FailsWithoutSheetOrSpace) {
+    SessionData empty;
+    std::string image = serialize_session(empty);
+    SessionFileView file;
+    ASSERT_TRUE(file.open_memory(image.data(), image.size()));
+    EXPECT_TRUE(format_session_dicom(file, 1, make_info()).empty());
+
+    image = make_session_image();
+    ASSERT_TRUE(file.open_memory(image.data(), image.size()));
+    FormatBuffer small(600);
+    EXPECT_FALSE(write_session_dicom(file, 1, make_info(), small));
+    EXPECT_TRUE(small.empty());
+}
+
+TEST(DicomExport, RejectsOverlongValues) {
+    std::string image = make_session_image();
+    SessionFileView file;
+    ASSERT_TRUE(file.open_memory(image.data(), image.size()));
+
+    // A cut UID or patient id would name another study or patient
+    DicomStudyInfo info = make_info();
+    info.study_uid = "2.25." + std::string(60, '1');
+    FormatBuffer out(dicom_capacity(file, 1));
+    std::string error;
+    EXPECT_FALSE(write_session_dicom(file, 1, info, out, &error));
+    EXPECT_TRUE(out.empty());
+    EXPECT_NE(error.find("(0020,000D) UI"), std::string::npos) << error;
+
+    info = make_info();
+    info.patient_id = std::string(65, 'P');
+    EXPECT_TRUE(format_session_dicom(file, 1, info, &error).empty());
+    EXPECT_NE(error.find("(0010,0020) LO"), std::string::npos) << error;
+
+    info.patient_id = std::string(64, 'P');
+    EXPECT_FALSE(format_session_dicom(file, 1, info).empty());
+}
+
+TEST(DicomExport, UidsAreValid) {
+    EXPECT_EQ(make_dicom_uid(0, 0), "2.25.0");
+    EXPECT_EQ(make_dicom_uid(~0ull, ~0ull), "2.25.340282366920938463463374607431768211455");
+    std::string uid = generate_dicom_uid();
+    EXPECT_LE(uid.size(), 64u);
+    EXPECT_NE(uid, generate_dicom_uid());
+    EXPECT_NE(uid[5], '0');
+}
+
+TEST(DicomExport, FullSheetFitsTheCapacity) {
+    // 24 meridians x 15 stimuli with 4 points each, both eyes
+    SessionData data;
+    for (int eye = 1; eye <= 2; eye++) {
+        for (int longitude = 0; longitude < 360; longitude += 15) {
+            for (int stimulus = 0; stimulus < 15; stimulus++) {
+                data.sheet.eye.push_back(static_cast<std::uint8_t>(eye));
+                data.sheet.longitude.push_back(static_cast<std::int16_t>(longitude));
+                data.sheet.size.push_back(static_cast<std::uint8_t>(stimulus % 5));
+                data.sheet.luminance.push_back(static_cast<std::uint8_t>(stimulus));
+                data.sheet.normalized_angle.push_back(30.0f);
+                data.sheet.point_count.push_back(4);
+                for (int i = 0; i < 4; i++) {
+                    data.sheet.point_phi.push_back(static_cast<float>(longitude));
+                    data.sheet.point_theta.push_back(30.0f + i);
+                }
+            }
+        }
+    }
+    std::string image = serialize_session(data);
+    SessionFileView file;
+    ASSERT_TRUE(file.open_memory(image.data(), image.size()));
+
+    // session_to_dicom prints the time per file
+    FormatBuffer out(dicom_capacity(file, 1));
+    ASSERT_TRUE(write_session_dicom(file, 1, make_info(), out));
+    std::string first = out.str();
+    out.clear();
+    ASSERT_TRUE(write_session_dicom(file, 1, make_info(), out));
+    EXPECT_EQ(out.str(), first);
+    ParsedFile parsed = parse(out.str());
+    ASSERT_TRUE(parsed.error.empty()) << parsed.error;
+    EXPECT_EQ(parsed.items.size(), 24u * 15u * 4u);
+}
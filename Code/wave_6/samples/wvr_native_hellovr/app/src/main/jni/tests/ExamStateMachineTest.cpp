@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+
+#include <utility>
+#include <vector>
+
+#include "ExamStateMachine.h"
+
+namespace {
+struct ExamFixture : ::testing::Test {
+    ManualClock clock;
+    PerimetryEngine engine{&clock};
+    std::vector<int> saved_eyes;
+    bool closed = false;
+    int next_patients = 0;
+    ExamStateMachine exam{engine, 2, hooks()};
+
+    ExamHooks hooks() {
+        ExamHooks hooks;
+        hooks.on_eye_finished = [this](int eye) { saved_eyes.push_back(eye); };
+        hooks.on_close = [this]() { closed = true; };
+        hooks.on_next_patient = [this]() { next_patients++; return 1; };
+        return hooks;
+    }
+
+    void step(double seconds = 1.0 / 72.0) {
+        clock.advance_seconds(seconds);
+        exam.update(clock.now());
+        engine.tick(clock.now());
+    }
+    void press(ExamEventType type) {
+        exam.post(type, clock.now());
+        step();
+    }
+    void run_until_eye_finished() {
+        // Nobody responds, every vector runs to the center
+        for (int i = 0; i < 100000 && exam.exam_running(); i++) step(0.1);
+    }
+};
+}
+
+TEST_F(ExamFixture, MenusLeadIntoTheFirstEye) {
+    EXPECT_EQ(exam.state(), ExamState::StartMenu);
+    EXPECT_EQ(exam.active_eye(), 0);
+
+    press(ExamEventType::PauseButton); // Ignored in menus
+    EXPECT_EQ(exam.state(), ExamState::StartMenu);
+
+    press(ExamEventType::Trigger);
+    EXPECT_EQ(exam.state(), ExamState::EyeMenu);
+    EXPECT_EQ(exam.active_eye(), 2);
+    EXPECT_EQ(engine.m_perimetry_status, PerimetryStatus::NotStarted);
+
+    press(ExamEventType::Trigger);
+    EXPECT_EQ(exam.state(), ExamState::Testing);
+    EXPECT_EQ(engine.m_perimetry_status, PerimetryStatus::Running);
+    EXPECT_EQ(engine.mActiveEye, 2);
+}
+
+TEST_F(ExamFixture, GazeIsIgnoredWhilePausedAndResumeWaits) {
+    press(ExamEventType::Trigger);
+    press(ExamEventType::Trigger);
+
+    press(ExamEventType::GazeLost);
+    EXPECT_EQ(exam.state(), ExamState::FixationLost);
+    EXPECT_EQ(engine.m_perimetry_status, PerimetryStatus::Paused);
+    press(ExamEventType::GazeOnTarget);
+    EXPECT_EQ(engine.m_perimetry_status, PerimetryStatus::Running);
+
+    press(ExamEventType::PauseButton);
+    EXPECT_EQ(exam.state(), ExamState::Paused);
+    EXPECT_FALSE(exam.scene_visible());
+    press(ExamEventType::GazeOnTarget);
+    EXPECT_EQ(engine.m_perimetry_status, PerimetryStatus::Paused);
+
+    press(ExamEventType::PauseButton);
+    EXPECT_EQ(exam.state(), ExamState::Resuming);
+    step(PAUSE_RESUME_DELAY_S - 0.5);
+    EXPECT_EQ(exam.state(), ExamState::Resuming);
+    step(1.0);
+    EXPECT_EQ(exam.state(), ExamState::Testing);
+    EXPECT_EQ(engine.m_perimetry_status, PerimetryStatus::Running);
+}
+
+TEST_F(ExamFixture, FinishedEyesAreSavedOnceAndSwitched) {
+    press(ExamEventType::Trigger);
+    press(ExamEventType::Trigger);
+    run_until_eye_finished();
+
+    EXPECT_EQ(exam.state(), ExamState::EyeMenu);
+    EXPECT_EQ(exam.active_eye(), 1);
+    ASSERT_EQ(saved_eyes, std::vector<int>({2}));
+
+    press(ExamEventType::Trigger);
+    run_until_eye_finished();
+    EXPECT_EQ(exam.state(), ExamState::EndMenu);
+    step();
+    EXPECT_EQ(saved_eyes, std::vector<int>({2, 1}));
+
+    press(ExamEventType::Trigger);
+    EXPECT_EQ(exam.state(), ExamState::Closed);
+    EXPECT_TRUE(closed);
+}
+
+TEST_F(ExamFixture, NextPatientStartsOverWithoutClosing) {
+    press(ExamEventType::Trigger);
+    press(ExamEventType::Trigger);
+    run_until_eye_finished();
+    press(ExamEventType::Trigger);
+    run_until_eye_finished();
+    step();
+    ASSERT_EQ(exam.state(), ExamState::EndMenu);
+
+    engine.m_goldmann_sheet.add_point({10.0f, 20.0f}, MeteoroidSizeID::V, 0, 1, "4e"_stim);
+    press(ExamEventType::PauseButton);
+    EXPECT_EQ(exam.state(), ExamState::StartMenu);
+    EXPECT_FALSE(closed);
+    EXPECT_EQ(next_patients, 1);
+    EXPECT_EQ(exam.patient_index(), 1);
+    EXPECT_EQ(exam.first_eye(), 1);
+    EXPECT_EQ(exam.active_eye(), 0);
+    EXPECT_EQ(engine.m_perimetry_status, PerimetryStatus::NotStarted);
+    EXPECT_EQ(engine.mActiveEye, 0);
+    const SheetEntry* entry = engine.m_goldmann_sheet.find_entry(1, 0, MeteoroidSizeID::V, "4e"_stim);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->point_count, 0);
+
+    // Second patient runs on the same engine, first eye from the hook
+    press(ExamEventType::Trigger);
+    press(ExamEventType::Trigger);
+    EXPECT_EQ(exam.state(), ExamState::Testing);
+    EXPECT_EQ(engine.mActiveEye, 1);
+    run_until_eye_finished();
+    EXPECT_EQ(exam.active_eye(), 2);
+    EXPECT_EQ(saved_eyes, std::vector<int>({2, 1, 1}));
+}
+
+TEST(ExamStateMachine, PauseHookOnlyReportsChanges) {
+    ManualClock clock;
+    PerimetryEngine engine{&clock};
+    std::vector<std::pair<bool, ExamState>> pauses;
+    ExamHooks hooks;
+    hooks.on_pause_changed = [&](bool paused, ExamState state, EngineClock::time_point) {
+        pauses.push_back({paused, state});
+    };
+    ExamStateMachine exam{engine, 1, hooks};
+    auto press = [&](ExamEventType type) {
+        clock.advance_seconds(1.0 / 72.0);
+        exam.post(type, clock.now());
+        exam.update(clock.now());
+        engine.tick(clock.now());
+    };
+    press(ExamEventType::Trigger);
+    press(ExamEventType::Trigger);
+    ASSERT_EQ(exam.state(), ExamState::Testing);
+
+    // Fixation lost, then the pause menu: one pause, one resume
+    press(ExamEventType::GazeLost);
+    press(ExamEventType::PauseButton);
+    EXPECT_EQ(exam.state(), ExamState::Paused);
+    press(ExamEventType::PauseButton);
+    for (int i = 0; i < 1000 && exam.state() == ExamState::Resuming; i++) press(ExamEventType::GazeOnTarget);
+    ASSERT_EQ(exam.state(), ExamState::Testing);
+    using P = std::pair<bool, ExamState>;
+    EXPECT_EQ(pauses, std::vector<P>({P{true, ExamState::FixationLost}, P{false, ExamState::Testing}}));
+
+    // Both eyes end while testing: the engine never paused, nothing to report
+    pauses.clear();
+    for (int eye = 0; eye < 2; eye++) {
+        for (int i = 0; i < 100000 && exam.exam_running(); i++) {
+            clock.advance_seconds(0.1);
+            exam.update(clock.now());
+            engine.tick(clock.now());
+        }
+        if (exam.state() == ExamState::EyeMenu) press(ExamEventType::Trigger);
+    }
+    clock.advance_seconds(0.1);
+    exam.update(clock.now());
+    EXPECT_EQ(exam.state(), ExamState::EndMenu);
+    EXPECT_TRUE(pauses.empty());
+}
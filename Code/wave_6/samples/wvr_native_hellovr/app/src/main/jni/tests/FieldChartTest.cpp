@@ -0,0 +1,316 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "ChartRaster.h"
+#include "FileUtil.h"
+#include "IsopterStudy.h"
+#include "SessionRecorder.h"
+#include "SheetExport.h"
+#include "TestUtil.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+// Every planned stimulus on every meridian at a fixed projected radius,
+// dimmer stimuli further in
+GoldmannSheet make_sheet(int eye, double radius) {
+    return planned_sheet(eye, 1, [radius](int, StimulusCode luminance, int) {
+        return radius - (19 - luminance.index) * 5.0;
+    });
+}
+
+std::size_t count(const std::string& text, const std::string& what) {
+    std::size_t n = 0;
+    for (std::size_t at = text.find(what); at != std::string::npos; at = text.find(what, at + 1)) n++;
+    return n;
+}
+
+std::uint32_t read_u32_be(const std::string& data, std::size_t at) {
+    return (static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[at])) << 24) |
+           (static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[at + 1])) << 16) |
+           (static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[at + 2])) << 8) |
+           static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[at + 3]));
+}
+
+// Inflates the zlib stream of encode_png(): fixed-Huffman blocks only
+// (RFC 1951, 3.2.6), which is all the encoder writes
+class FixedInflater {
+public:
+    explicit FixedInflater(const std::string& data) : m_data(data) {}
+
+    bool inflate(std::string& out) {
+        m_bit = 16;     // After the zlib header
+        bool last = false;
+        while (!last) {
+            last = bits(1) == 1;
+            if (bits(2) != 1) return false;
+            for (;;) {
+                int symbol = literal();
+                if (symbol < 0) return false;
+                if (symbol < 256) {
+                    out += static_cast<char>(symbol);
+                    continue;
+                }
+                if (symbol == 256) break;
+                static const int BASE[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                             31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+                static const int EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                              2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+                if (symbol > 285) return false;
+                int length = BASE[symbol - 257] + static_cast<int>(bits(EXTRA[symbol - 257]));
+                int distance_code = static_cast<int>(huffman(5));
+                if (distance_code > 3) return false;    // The encoder only repeats recent bytes
+                std::size_t distance = static_cast<std::size_t>(distance_code) + 1;
+                if (distance > out.size()) return false;
+                for (int i = 0; i < length; i++) out += out[out.size() - distance];
+            }
+        }
+        return true;
+    }
+    std::size_t end_byte() const { return (m_bit + 7) / 8; }
+
+private:
+    std::uint32_t bits(int count) {
+        std::uint32_t value = 0;
+        for (int i = 0; i < count; i++, m_bit++) {
+            if (m_bit / 8 >= m_data.size()) return 0;
+            value |= ((static_cast<std::uint8_t>(m_data[m_bit / 8]) >> (m_bit % 8)) & 1u) << i;
+        }
+        return value;
+    }
+    std::uint32_t huffman(int count) {
+        std::uint32_t value = 0;
+        for (int i = 0; i < count; i++) value = (value << 1) | bits(1);
+        return value;
+    }
+    int literal() {
+        std::uint32_t code = huffman(7);
+        if (code <= 0x17) return 256 + static_cast<int>(code);
+        code = (code << 1) | bits(1);
+        if (code >= 0x30 && code <= 0xbf) return static_cast<int>(code) - 0x30;
+        if (code >= 0xc0 && code <= 0xc7) return 280 + static_cast<int>(code) - 0xc0;
+        code = (code << 1) | bits(1);
+        if (code >= 0x190 && code <= 0x1ff) return 144 + static_cast<int>(code) - 0x190;
+        return -1;
+    }
+
+    const std::string& m_data;
+    std::size_t m_bit = 0;
+};
+
+bool is_white(const std::uint8_t* pixel) { return pixel[0] == 255 && pixel[1] == 255 && pixel[2] == 255; }
+
+}
+
+TEST(FieldChart, StimulusColoursAreStable) {
+    ChartColor i2e = stimulus_chart_color(MeteoroidSizeID::I, "2e"_stim);
+    ChartColor i3e = stimulus_chart_color(MeteoroidSizeID::I, "3e"_stim);
+    ChartColor v4e = stimulus_chart_color(MeteoroidSizeID::V, "4e"_stim);
+    EXPECT_EQ(i2e.b, 180);      // tab:blue
+    EXPECT_EQ(i3e.r, 255);      // tab:orange
+    EXPECT_EQ(v4e.g, 160);      // tab:green
+    // Unplanned stimuli do not take the colours of the planned ones
+    ChartColor iii4e = stimulus_chart_color(MeteoroidSizeID::III, "4e"_stim);
+    for (ChartColor planned : {i2e, i3e, v4e}) {
+        EXPECT_FALSE(iii4e.r == planned.r && iii4e.g == planned.g && iii4e.b == planned.b);
+    }
+}
+
+TEST(FieldChart, SvgHasGridIsoptersAndNorm) {
+    std::vector<Isopter> isopters = build_isopters(make_sheet(1, 80.0), 1);
+    ASSERT_EQ(isopters.size(), 3u);
+    ChartScene scene = build_field_chart(isopters, 1, 12, 45.0);
+    std::string svg = format_chart_svg(scene);
+
+    EXPECT_EQ(svg.rfind("<?xml", 0), 0u);
+    EXPECT_NE(svg.find("width=\"800\" height=\"800\""), std::string::npos);
+    // Rings every 10°, the knots of the three isopters
+    EXPECT_EQ(count(svg, "<circle"), 9u + 3u * METEOROID_LONGITUDES_DEG.size());
+    // Measured and normative contours, the normative ones dashed
+    EXPECT_EQ(count(svg, "<polygon"), 6u);
+    EXPECT_EQ(count(svg, "stroke-dasharray"), 3u + 1u);     // And its legend entry
+    // Meridians every 15° and the legend lines
+    EXPECT_EQ(count(svg, "<polyline"), 24u + 3u + 1u);
+    for (const char* label : {">30°<", ">90°<", ">270°<", ">I2e<", ">V4e<", ">normal, 45 y<",
+                              "Right eye (OD), Subject 12, 45 y"}) {
+        EXPECT_NE(svg.find(label), std::string::npos) << label;
+    }
+
+    // Without the norm (or for an unknown eye) only the measured contours
+    FieldChartOptions options;
+    options.normative = false;
+    EXPECT_EQ(count(format_chart_svg(build_field_chart(isopters, 1, 12, 45.0, options)), "<polygon"), 3u);
+    std::string unknown = format_chart_svg(build_field_chart(isopters, 0, -1, 0.0));
+    EXPECT_EQ(count(unknown, "<polygon"), 3u);
+    EXPECT_NE(unknown.find(">Eye unknown<"), std::string::npos);
+}
+
+TEST(FieldChart, RasterDrawsTheScene) {
+    // V4e on a circle of true eccentricity 60°
+    std::vector<Isopter> isopters = build_isopters(make_sheet(2, 90.0 * std::sin(60.0 * M_PI / 180.0)), 2);
+    FieldChartOptions options;
+    options.normative = false;
+    options.knots = false;
+    ChartScene scene = build_field_chart(isopters, 2, 3, 0.0, options);
+    ChartRasterizer rasterizer;
+    RgbImage image;
+    rasterizer.render(scene, image);
+    ASSERT_EQ(image.width, 800);
+    ASSERT_EQ(image.height, 800);
+    ASSERT_EQ(image.rgb.size(), 800u * 800u * 3u);
+
+    const float cx = 400.0f, cy = 424.0f, radius = 320.0f;
+    auto at = [&](double eccentricity, double longitude) {
+        int x = static_cast<int>(cx + eccentricity / 90.0 * radius * std::cos(longitude * M_PI / 180.0));
+        int y = static_cast<int>(cy - eccentricity / 90.0 * radius * std::sin(longitude * M_PI / 180.0));
+        return image.pixel(x, y);
+    };
+    // The V4e contour in green on the 60° ring, between the meridians
+    const std::uint8_t* contour = at(60.0, 52.5);
+    EXPECT_GT(contour[1], contour[0] + 40);
+    EXPECT_GT(contour[1], contour[2] + 40);
+    // Empty field inside and corners outside the chart
+    EXPECT_TRUE(is_white(at(45.0, 52.5)));
+    EXPECT_TRUE(is_white(image.pixel(790, 790)));
+    // The 90° ring in grey
+    const std::uint8_t* ring = at(90.0, 52.5);
+    EXPECT_FALSE(is_white(ring));
+    EXPECT_EQ(ring[0], ring[1]);
+    // Some of the title is drawn
+    int title = 0;
+    for (int x = 0; x < 800; x++) title += is_white(image.pixel(x, 32)) ? 0 : 1;
+    EXPECT_GT(title, 20);
+
+    // The same scene renders the same image with a reused rasterizer
+    RgbImage again;
+    rasterizer.render(scene, again);
+    EXPECT_EQ(again.rgb, image.rgb);
+}
+
+TEST(FieldChart, PngChunksAreValid) {
+    ChartScene scene = build_field_chart(build_isopters(make_sheet(1, 80.0), 1), 1, 1, 30.0);
+    ChartRasterizer rasterizer;
+    RgbImage image;
+    rasterizer.render(scene, image);
+    std::string png = encode_png(image);
+
+    ASSERT_GT(png.size(), 8u);
+    EXPECT_EQ(png.substr(0, 8), std::string("\x89PNG\r\n\x1a\n", 8));
+    std::vector<std::string> types;
+    std::size_t at = 8;
+    while (at + 12 <= png.size()) {
+        std::uint32_t length = read_u32_be(png, at);
+        ASSERT_LE(at + 12 + length, png.size());
+        types.push_back(png.substr(at + 4, 4));
+        EXPECT_EQ(read_u32_be(png, at + 8 + length), crc32(png.data() + at + 4, 4 + length)) << types.back();
+        if (types.back() == "IHDR") {
+            EXPECT_EQ(read_u32_be(png, at + 8), 800u);
+            EXPECT_EQ(read_u32_be(png, at + 12), 800u);
+        }
+        at += 12 + length;
+    }
+    EXPECT_EQ(at, png.size());
+    ASSERT_EQ(types, (std::vector<std::string>{"IHDR", "IDAT", "IEND"}));
+
+    // The pixels come back: inflate, check the Adler-32, undo the filters
+    std::string idat = png.substr(8 + 12 + 13 + 8, read_u32_be(png, 8 + 12 + 13));
+    EXPECT_EQ((static_cast<std::uint8_t>(idat[0]) * 256 + static_cast<std::uint8_t>(idat[1])) % 31, 0);
+    std::string raw;
+    FixedInflater inflater(idat);
+    ASSERT_TRUE(inflater.inflate(raw));
+    const std::size_t stride = 800 * 3;
+    ASSERT_EQ(raw.size(), (stride + 1) * 800);
+    ASSERT_EQ(inflater.end_byte() + 4, idat.size());
+    EXPECT_EQ(read_u32_be(idat, idat.size() - 4), adler32(raw.data(), raw.size()));
+    std::vector<std::uint8_t> pixels(stride * 800);
+    for (std::size_t y = 0; y < 800; y++) {
+        int filter = raw[y * (stride + 1)];
+        ASSERT_TRUE(filter == 1 || (filter == 2 && y > 0)) << y;
+        for (std::size_t i = 0; i < stride; i++) {
+            std::uint8_t prior = filter == 1 ? (i >= 3 ? pixels[y * stride + i - 3] : 0) : pixels[(y - 1) * stride + i];
+            pixels[y * stride + i] = static_cast<std::uint8_t>(raw[y * (stride + 1) + 1 + i] + prior);
+        }
+    }
+    EXPECT_TRUE(pixels == image.rgb);
+    // Mostly background: far below the 1.9 MB of raw pixels
+    EXPECT_LT(png.size(), image.rgb.size() / 8);
+
+    EXPECT_EQ(adler32("Wikipedia", 9), 0x11E60398u);
+}
+
+TEST(FieldChart, StudyChartsInParallelMatchSerial) {
+    std::string root = temp_dir("charts", "study");
+    const int subjects = 12;
+    for (int subject = 1; subject <= subjects; subject++) {
+        std::string dir = root + "/Subject" + std::to_string(subject);
+        fs::create_directories(dir);
+        ASSERT_TRUE(write_file_atomic(dir + "/final_Right_perimetry.csv",
+                                      format_sheet_csv(make_sheet(1, 70.0 + subject), 1)));
+        ASSERT_TRUE(write_file_atomic(dir + "/final_Left_perimetry.csv",
+                                      format_sheet_csv(make_sheet(2, 70.0 + subject), 2)));
+    }
+    ASSERT_TRUE(write_file_atomic(root + "/subjects.csv", "Subject,Age\n1,64\n13,70\n"));
+    // The session file the app writes next to the sheets of subject 1 has
+    // them at full precision; the eyes count once
+    SessionRecorder recorder;
+    recorder.begin(EngineClock::time_point(), 1700000000000, 1, 1);
+    recorder.on_eye_finished(make_sheet(1, 71.0), 1);
+    recorder.on_eye_finished(make_sheet(2, 71.0), 2);
+    ASSERT_TRUE(write_file_atomic(root + "/Subject1/session.pses", serialize_session(*recorder.take())));
+    // A session of patient 13 outside the SubjectN folders
+    recorder.begin(EngineClock::time_point(), 1700000600000, 13, 1);
+    recorder.on_eye_finished(make_sheet(1, 83.5), 1);
+    recorder.on_eye_finished(make_sheet(2, 83.5), 2);
+    fs::create_directories(root + "/headset");
+    ASSERT_TRUE(write_file_atomic(root + "/headset/session.pses", serialize_session(*recorder.take())));
+
+    std::vector<StudyEyeIsopters> eyes;
+    StudyIsopterStats study_stats;
+    ASSERT_TRUE(build_study_isopters(root, eyes, IsopterOptions(), 0, &study_stats));
+    ASSERT_EQ(eyes.size(), 2u * subjects + 2u);
+    EXPECT_EQ(study_stats.files, 2u * subjects + 3u);   // subjects.csv is skipped
+    EXPECT_EQ(study_stats.skipped, 1u);
+    EXPECT_EQ(study_stats.duplicates, 2u);
+    // Subject1: the CSV sheets (left, right); the session of patient 13 last
+    EXPECT_EQ(study_chart_name(eyes[0]), "Subject1_final_Left_perimetry");
+    EXPECT_EQ(study_chart_name(eyes[1]), "Subject1_final_Right_perimetry");
+    ASSERT_EQ(study_chart_name(eyes[2u * subjects]), "headset_session_Right");
+    const StudyEyeIsopters& session = eyes.back();
+    EXPECT_EQ(study_chart_name(session), "headset_session_Left");
+    EXPECT_EQ(session.subject, 13);
+    EXPECT_EQ(session.age_years, 70);
+    ASSERT_EQ(session.isopters.size(), eyes[0].isopters.size());
+    for (std::size_t j = 0; j < eyes[0].isopters.size(); j++) {
+        EXPECT_EQ(session.isopters[j].knot_longitude, eyes[0].isopters[j].knot_longitude);
+        EXPECT_GT(session.isopters[j].knot_radius[0], eyes[0].isopters[j].knot_radius[0]);
+    }
+
+    StudyChartStats serial_stats;
+    ASSERT_TRUE(render_study_charts(eyes, root + "/serial", StudyChartOptions(), 1, &serial_stats));
+    StudyChartStats stats;
+    ASSERT_TRUE(render_study_charts(eyes, root + "/parallel", StudyChartOptions(), 4, &stats));
+
+    EXPECT_EQ(stats.charts, eyes.size());
+    EXPECT_EQ(stats.files, 2 * eyes.size());
+    EXPECT_EQ(stats.workers, 4u);
+    EXPECT_EQ(stats.bytes, serial_stats.bytes);
+    for (const StudyEyeIsopters& eye : eyes) {
+        for (const char* extension : {".svg", ".png"}) {
+            std::string name = study_chart_name(eye) + extension;
+            std::string serial = read_file(root + "/serial/" + name);
+            EXPECT_FALSE(serial.empty()) << name;
+            EXPECT_EQ(read_file(root + "/parallel/" + name), serial) << name;
+        }
+    }
+    EXPECT_NE(read_file(root + "/serial/Subject1_final_Right_perimetry.svg").find("Subject 1, 64 y"),
+              std::string::npos);
+
+    std::string error;
+    EXPECT_FALSE(render_study_charts(eyes, root + "/subjects.csv/charts", StudyChartOptions(), 1, nullptr, &error));
+    EXPECT_FALSE(error.empty());
+    fs::remove_all(root);
+}
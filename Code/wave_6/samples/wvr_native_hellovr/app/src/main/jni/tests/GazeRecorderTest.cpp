@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "GazeRecorder.h"
+#include "IoWorker.h"
+
+namespace {
+// Fixating eye with small drift and noise, a saccade now and then
+std::vector<GazeSample> make_stream(std::size_t count) {
+    std::mt19937 rng(7);
+    std::normal_distribution<float> noise(0.0f, 0.002f);
+    std::uniform_real_distribution<float> saccade(-0.2f, 0.2f);
+    std::vector<GazeSample> samples(count);
+    float x = 0.0f, y = 0.0f;
+    for (std::size_t i = 0; i < count; i++) {
+        GazeSample& s = samples[i];
+        s.time_ns = 5000000000LL + static_cast<std::int64_t>(i) * 8333333;
+        if (i % 300 == 299) { x = saccade(rng); y = saccade(rng); }
+        for (GazeEyeSample* eye : {&s.left, &s.right}) {
+            eye->valid_mask = 0x1f;
+            eye->origin = {0.032f, 0.0f, 0.0f};
+            eye->direction = {x + noise(rng), y + noise(rng), -1.0f};
+            eye->openness = 1.0f;
+            eye->pupil_diameter_mm = 3.5f + noise(rng);
+            eye->pupil_position = {0.5f + noise(rng), 0.5f + noise(rng)};
+        }
+        s.fixation_angle_deg = std::abs(x) * 57.3f;
+        s.flags = GazeSample::ANGLE_VALID | (s.fixation_angle_deg < 10.0f ? GazeSample::ON_TARGET : 0);
+        s.exam_state = 2;
+        s.track_id = static_cast<std::uint32_t>(1 + i / 500);
+        s.eccentricity_deg = 90.0f - static_cast<float>(i % 500) * 0.1f;
+    }
+    return samples;
+}
+
+void expect_close(const GazeSample& a, const GazeSample& b) {
+    EXPECT_EQ(a.time_ns, b.time_ns);
+    EXPECT_EQ(a.flags, b.flags);
+    EXPECT_EQ(a.exam_state, b.exam_state);
+    EXPECT_EQ(a.track_id, b.track_id);
+    EXPECT_NEAR(a.eccentricity_deg, b.eccentricity_deg, 1e-3);
+    EXPECT_NEAR(a.fixation_angle_deg, b.fixation_angle_deg, 1e-3);
+    EXPECT_EQ(a.left.valid_mask, b.left.valid_mask);
+    for (int i = 0; i < 3; i++) EXPECT_NEAR(a.right.direction[i], b.right.direction[i], 1e-4);
+    EXPECT_NEAR(a.left.pupil_diameter_mm, b.left.pupil_diameter_mm, 1e-3);
+    EXPECT_NEAR(a.right.pupil_position[1], b.right.pupil_position[1], 1e-4);
+}
+}
+
+TEST(GazeRecorder, ChunksDecodeIndependently) {
+    std::vector<GazeSample> stream = make_stream(2000);
+    GazeChunkEncoder encoder(4096);
+
+    std::vector<GazeSample> decoded;
+    std::size_t chunks = 0;
+    for (const GazeSample& sample : stream) {
+        if (!encoder.add(sample)) {
+            std::uint32_t count = encoder.sample_count();
+            std::vector<std::uint8_t> payload = encoder.take();
+            ASSERT_TRUE(decode_gaze_chunk(payload.data(), payload.size(), count, decoded));
+            chunks++;
+            ASSERT_TRUE(encoder.add(sample));
+        }
+    }
+    std::uint32_t count = encoder.sample_count();
+    std::vector<std::uint8_t> payload = encoder.take();
+    ASSERT_TRUE(decode_gaze_chunk(payload.data(), payload.size(), count, decoded));
+    EXPECT_GT(chunks, 5u);
+
+    ASSERT_EQ(decoded.size(), stream.size());
+    for (std::size_t i = 0; i < stream.size(); i += 97) expect_close(decoded[i], stream[i]);
+    expect_close(decoded.back(), stream.back());
+
+    // A cut payload is reported, not misread
+    std::vector<GazeSample> damaged;
+    EXPECT_FALSE(decode_gaze_chunk(payload.data(), payload.size() - 1, count, damaged));
+}
+
+TEST(GazeRecorder, TwentyMinutesStayCompact) {
+    // 20 min at the 72 Hz frame rate, the figure in GazeRecorder.h
+    std::vector<GazeSample> stream = make_stream(20 * 60 * 72);
+    GazeChunkEncoder encoder(GazeRecorder::CHUNK_BYTES);
+    std::size_t total_bytes = 0;
+    for (const GazeSample& sample : stream) {
+        if (!encoder.add(sample)) {
+            total_bytes += encoder.take().size();
+            encoder.add(sample);
+        }
+    }
+    total_bytes += encoder.bytes().size();
+    // Encoding speed is measured by tools/gaze_benchmark
+    EXPECT_LT(total_bytes, 3000000u);
+}
+
+TEST(GazeRecorder, WritesAFileThroughTheWorker) {
+    std::string path = ::testing::TempDir() + "gaze_" + std::to_string(::getpid()) + ".pgaz";
+    std::vector<GazeSample> stream = make_stream(5000);
+    {
+        IoWorker worker;
+        GazeRecorder recorder(&worker, 8192);
+        recorder.add(stream[0]); // Not open yet, ignored
+        recorder.open(path);
+        for (const GazeSample& sample : stream) {
+            recorder.add(sample);
+            recorder.add(sample); // Same timestamp, skipped
+        }
+        EXPECT_EQ(recorder.samples(), stream.size());
+        recorder.close();
+        worker.drain();
+    }
+
+    std::vector<GazeSample> decoded;
+    std::string error;
+    ASSERT_TRUE(read_gaze_file(path, decoded, &error)) << error;
+    ASSERT_EQ(decoded.size(), stream.size());
+    expect_close(decoded[1234], stream[1234]);
+    expect_close(decoded.back(), stream.back());
+    std::remove(path.c_str());
+}
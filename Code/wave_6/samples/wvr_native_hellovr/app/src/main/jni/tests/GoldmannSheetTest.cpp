@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include "GoldmannSheet.h"
+#include "NormativeModel.h"
+
+namespace {
+std::vector<PerimetryVector> make_meridians(int count) {
+    std::vector<PerimetryVector> meridians;
+    for (int i = 0; i < count; i++) {
+        meridians.push_back(PerimetryVector{i * 360 / count, "1a"_stim, MeteoroidSizeID::None});
+    }
+    return meridians;
+}
+}
+
+TEST(GoldmannStimulus, CodesFollowStringOrder) {
+    static_assert("1a"_stim.index == 0, "1a is the first filter");
+    static_assert("4e"_stim.index == GOLDMANN_STIMULUS_COUNT - 1, "4e is the last filter");
+    EXPECT_LT("2e"_stim, "3e"_stim);
+    EXPECT_STREQ(stimulus_info("3e"_stim).name, "3e");
+    EXPECT_THROW(StimulusCode::from_chars('5', 'e'), std::invalid_argument);
+}
+
+TEST(GoldmannStimulus, TableMatchesFilterAttenuation) {
+    static_assert(stimulus_info("4e"_stim).attenuation_db == 0, "4e is unattenuated");
+    static_assert(stimulus_info("3e"_stim).attenuation_db == 5, "one coarse step is 5 dB");
+    static_assert(stimulus_info("4d"_stim).attenuation_db == 1, "one fine step is 1 dB");
+    EXPECT_NEAR(stimulus_info("4e"_stim).nits, 315.0f, 0.01f);
+    EXPECT_NEAR(stimulus_info("3e"_stim).nits, 99.61f, 0.01f);
+    EXPECT_FLOAT_EQ(stimulus_info("4e"_stim).rgb[0], 1.0f);
+    EXPECT_LT(stimulus_info("1a"_stim).rgb[0], stimulus_info("2e"_stim).rgb[0]);
+}
+
+TEST(GoldmannSheet, LookupsDoNotInsert) {
+    GoldmannSheet sheet;
+    NormativeIsopters normative = evaluate_normative_isopters(31.0, {0, 90});
+    sheet.setup_sheet(METEOROID_LONGITUDES_DEG, LUMINANCE_TO_USE, 1, &normative);
+    size_t entries = sheet.entries(1).size();
+
+    EXPECT_EQ(sheet.find_entry(1, 17, MeteoroidSizeID::V, "4e"_stim), nullptr);
+    EXPECT_FLOAT_EQ(sheet.normalized_angle(1, 17, MeteoroidSizeID::V, "4e"_stim), 90.0f);
+    EXPECT_EQ(sheet.entries(1).size(), entries);
+
+    const SheetEntry* entry = sheet.find_entry(1, 0, MeteoroidSizeID::V, "4e"_stim);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_TRUE(entry->in_use);
+    EXPECT_FLOAT_EQ(entry->normalized_angle, normative.expected(1, 0, MeteoroidSizeID::V, "4e"_stim));
+    // Stimuli and meridians outside the model start at the rim
+    EXPECT_FLOAT_EQ(sheet.normalized_angle(1, 0, MeteoroidSizeID::III, "4e"_stim), 90.0f);
+    EXPECT_FLOAT_EQ(sheet.normalized_angle(1, 30, MeteoroidSizeID::V, "4e"_stim), 90.0f);
+    EXPECT_LT(sheet.normalized_angle(1, 90, MeteoroidSizeID::I, "2e"_stim), 40.0f);
+}
+
+TEST(GoldmannSheet, DetectionUpdatesWholeMeridian) {
+    GoldmannSheet sheet;
+    NormativeIsopters normative = evaluate_normative_isopters(31.0, {35, 40});
+    sheet.setup_sheet(make_meridians(72), LUMINANCE_TO_USE, 2, &normative);
+    ASSERT_EQ(sheet.meridian_count(), 72);
+
+    sheet.set_longitude_normalized_angle(2, 35, 42.0f);
+    EXPECT_FLOAT_EQ(sheet.normalized_angle(2, 35, MeteoroidSizeID::V, "4e"_stim), 42.0f);
+    EXPECT_FLOAT_EQ(sheet.normalized_angle(2, 35, MeteoroidSizeID::I, "2e"_stim), 42.0f);
+    EXPECT_FLOAT_EQ(sheet.normalized_angle(2, 40, MeteoroidSizeID::V, "4e"_stim),
+                    normative.expected(2, 40, MeteoroidSizeID::V, "4e"_stim));
+}
+
+TEST(GoldmannSheet, ExportIsOrderedAndKeepsRepeatedPoints) {
+    GoldmannSheet sheet;
+    sheet.setup_sheet(make_meridians(12), LUMINANCE_TO_USE, 1);
+    sheet.add_point({7.0f, 8.0f}, MeteoroidSizeID::V, 60, 1, "4e"_stim);
+    const int repeats = NUMBER_ITERATIONS_PER_SIZE + 1;
+    for (int i = 0; i < repeats; i++) {
+        sheet.add_point({1.0f * i, 2.0f}, MeteoroidSizeID::I, 30, 1, "2e"_stim);
+    }
+    EXPECT_GE(sheet.points_per_entry(), repeats);
+
+    int last_longitude = -1;
+    int rows = 0;
+    size_t points = 0;
+    sheet.for_each_entry(1, [&](int longitude, MeteoroidSizeID, StimulusCode, const SheetEntry&, GoldmannSheet::PointRange range) {
+        EXPECT_GE(longitude, last_longitude);
+        last_longitude = longitude;
+        points += range.size();
+        rows++;
+    });
+    EXPECT_EQ(rows, 12 * 3);
+    EXPECT_EQ(points, static_cast<size_t>(repeats) + 1);
+    // Growing moved the points of the other entries along
+    const SheetEntry* entry = sheet.find_entry(1, 60, MeteoroidSizeID::V, "4e"_stim);
+    ASSERT_TRUE(entry);
+    GoldmannSheet::PointRange moved = sheet.points(1, static_cast<int>(entry - sheet.entries(1).data()));
+    ASSERT_EQ(moved.size(), 1u);
+    EXPECT_FLOAT_EQ(moved.first->theta, 7.0f);
+    GoldmannSheet::PointRange added = sheet.points(1, static_cast<int>(
+            sheet.find_entry(1, 30, MeteoroidSizeID::I, "2e"_stim) - sheet.entries(1).data()));
+    ASSERT_EQ(added.size(), static_cast<size_t>(repeats));
+    EXPECT_FLOAT_EQ(added.first[repeats - 1].theta, repeats - 1.0f);
+
+    // Only beyond 255 points per entry are points dropped, and counted
+    for (int i = repeats; i < 300; i++) sheet.add_point({1.0f * i, 2.0f}, MeteoroidSizeID::I, 30, 1, "2e"_stim);
+    EXPECT_EQ(sheet.find_entry(1, 30, MeteoroidSizeID::I, "2e"_stim)->point_count, 255);
+    EXPECT_EQ(sheet.dropped_points(), 300u - 255u);
+    EXPECT_EQ(sheet.get_points().size(), 301u);
+}
+
+TEST(GoldmannSizes, ProjectedSizesMatchViewingDistance) {
+    static_assert(size_info(MeteoroidSizeID::III).next_size == MeteoroidSizeID::II, "sizes step down");
+    constexpr ProjectedSizeTable sizes = make_projected_sizes(50.0);
+    const ProjectedSize& size_v = sizes[static_cast<size_t>(MeteoroidSizeID::V)];
+    EXPECT_NEAR(size_v.radius_m, std::tan(1.72 * M_PI / 360.0) * 50.0, 1e-6);
+    EXPECT_NEAR(size_v.area_m2, M_PI * size_v.radius_m * size_v.radius_m, 1e-6);
+    EXPECT_FLOAT_EQ(sizes[static_cast<size_t>(MeteoroidSizeID::None)].radius_m, 0.0f);
+    EXPECT_STREQ(size_info(MeteoroidSizeID::I).name, "Size_I");
+}
@@ -0,0 +1,282 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "FileUtil.h"
+#include "IngestServer.h"
+#include "SessionFile.h"
+#include "SessionStore.h"
+#include "SessionUploader.h"
+#include "TestUtil.h"
+#include "UploadProtocol.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+// Full sheet of both eyes: 24 meridians x 15 stimuli, two points each.
+// seed makes the content (and so the store hash) unique.
+std::string make_session_image(int seed) {
+    SessionData data;
+    data.created_unix_ms = 1769702874000 + seed * 60000;
+    data.patient_index = static_cast<std::uint32_t>(seed);
+    data.first_eye = 1;
+    for (int eye = 1; eye <= 2; eye++) {
+        for (int longitude = 0; longitude < 360; longitude += 15) {
+            for (int stimulus = 0; stimulus < 15; stimulus++) {
+                data.sheet.eye.push_back(static_cast<std::uint8_t>(eye));
+                data.sheet.longitude.push_back(static_cast<std::int16_t>(longitude));
+                data.sheet.size.push_back(static_cast<std::uint8_t>(stimulus % 5));
+                data.sheet.luminance.push_back(static_cast<std::uint8_t>(stimulus));
+                data.sheet.normalized_angle.push_back(30.0f + seed % 7);
+                data.sheet.point_count.push_back(2);
+                for (int i = 0; i < 2; i++) {
+                    data.sheet.point_phi.push_back(static_cast<float>(longitude) + 0.001f * seed);
+                    data.sheet.point_theta.push_back(30.0f + i);
+                }
+            }
+        }
+    }
+    return serialize_session(data);
+}
+
+std::string write_session(const std::string& dir, int seed) {
+    std::string path = dir + "/session_" + std::to_string(100000 + seed) + ".pses";
+    EXPECT_TRUE(write_file_atomic(path, make_session_image(seed)));
+    return path;
+}
+
+// Server on a Unix socket in its own directory, with its own store
+struct Loopback {
+    std::string dir;
+    std::string address;
+    SessionStore store;
+    std::unique_ptr<IngestServer> server;
+
+    explicit Loopback(const char* name) : dir(temp_dir("ingest", name)), address("unix:" + dir + "/ingest.sock") {
+        EXPECT_TRUE(store.open(dir)) << store.error();
+        server.reset(new IngestServer(store));
+        EXPECT_TRUE(server->listen(address)) << server->error();
+        EXPECT_TRUE(server->start()) << server->error();
+    }
+};
+
+bool closed_by_server(int fd) {
+    char byte;
+    return ::recv(fd, &byte, 1, 0) == 0;
+}
+}
+
+TEST(IngestServer, ClinicDayFromSeveralHeadsets) {
+    Loopback loopback("day");
+    const int headsets = 8;
+    const int sessions_per_headset = 40;
+
+    std::vector<std::string> device_dirs;
+    for (int h = 0; h < headsets; h++) {
+        device_dirs.push_back(loopback.dir + "/device" + std::to_string(h));
+        fs::create_directories(device_dirs.back());
+        for (int s = 0; s < sessions_per_headset; s++) write_session(device_dirs.back(), h * 1000 + s);
+    }
+
+    std::vector<std::unique_ptr<SessionUploader>> uploaders;
+    for (int h = 0; h < headsets; h++) {
+        uploaders.emplace_back(new SessionUploader(loopback.address, h, "headset" + std::to_string(h)));
+        EXPECT_EQ(uploaders.back()->post_pending(device_dirs[h]), static_cast<std::size_t>(sessions_per_headset));
+    }
+    for (auto& uploader : uploaders) ASSERT_TRUE(uploader->wait_idle(std::chrono::seconds(60)));
+
+    const IngestStats& stats = loopback.server->stats();
+    const std::uint64_t total = headsets * sessions_per_headset;
+    EXPECT_EQ(stats.sessions.load(), total);
+    EXPECT_EQ(stats.stored.load(), total);
+    EXPECT_EQ(stats.protocol_errors.load(), 0u);
+    // Group commit: far fewer syncs than sessions
+    EXPECT_LT(stats.syncs.load(), total / 2);
+    for (auto& uploader : uploaders) EXPECT_EQ(uploader->uploaded(), static_cast<std::uint64_t>(sessions_per_headset));
+
+    // Everything acked is in the store, also after a restart
+    uploaders.clear();
+    for (const std::string& dir : device_dirs) {
+        SessionUploader restarted(loopback.address, 0, "headset");
+        EXPECT_EQ(restarted.post_pending(dir), 0u);
+    }
+    loopback.server->stop();
+    loopback.store.close();
+    SessionStore reopened;
+    ASSERT_TRUE(reopened.open(loopback.dir)) << reopened.error();
+    EXPECT_EQ(reopened.session_count(), 2 * total);
+    std::vector<StoredPoint> points;
+    StoreQuery query;
+    query.eye = 2;
+    query.meridian = 90;
+    query.size = MeteoroidSizeID::I;
+    query.luminance = 0;
+    EXPECT_EQ(reopened.query(query, points), total);
+    // Pending files are sent with the patient index of their header
+    StoreQuery subject;
+    subject.subject = 1005;
+    EXPECT_EQ(reopened.query(subject, points), 2u * 24u * 15u);
+}
+
+TEST(IngestServer, DeduplicatesAndRejectsInvalidSessions) {
+    Loopback loopback("dedupe");
+    std::string first = write_session(loopback.dir, 1);
+    std::string copy = loopback.dir + "/copy.pses";
+    fs::copy_file(first, copy);
+    std::string broken = loopback.dir + "/broken.pses";
+    ASSERT_TRUE(write_file_atomic(broken, "not a session file"));
+    // A session without a final sheet is not worth storing either
+    std::string empty = loopback.dir + "/empty.pses";
+    ASSERT_TRUE(write_file_atomic(empty, serialize_session(SessionData())));
+
+    SessionUploader uploader(loopback.address, 1, "headset");
+    for (const std::string& path : {first, copy, broken, empty}) uploader.post_file(path, 42);
+    ASSERT_TRUE(uploader.wait_idle(std::chrono::seconds(20)));
+
+    const IngestStats& stats = loopback.server->stats();
+    EXPECT_EQ(stats.stored.load(), 1u);
+    EXPECT_EQ(stats.duplicates.load(), 1u);
+    EXPECT_EQ(stats.invalid.load(), 2u);
+    EXPECT_EQ(uploader.uploaded(), 2u);
+    EXPECT_EQ(uploader.rejected(), 2u);
+    for (const std::string& path : {first, copy, broken, empty}) {
+        EXPECT_TRUE(fs::exists(SessionUploader::marker_path(path))) << path;
+    }
+    EXPECT_EQ(loopback.store.session_count(), 2u);
+
+    std::vector<StoredPoint> points;
+    StoreQuery query;
+    query.subject = 42;
+    EXPECT_EQ(loopback.store.query(query, points), 2u * 24u * 15u);
+    ASSERT_FALSE(points.empty());
+    EXPECT_EQ(points[0].date, 20260129u);
+}
+
+TEST(IngestServer, UploaderResendsABatchCutOffBySendFailure) {
+    std::string dir = temp_dir("ingest", "cut");
+    std::string address = "unix:" + dir + "/ingest.sock";
+    const int sessions = 16;
+    std::vector<std::string> paths;
+    for (int s = 0; s < sessions; s++) paths.push_back(write_session(dir, s));
+
+    // A server that takes the hello and part of the first session, then
+    // drops the connection while the rest of the batch is being sent
+    int listener = listen_upload_socket(address);
+    ASSERT_GE(listener, 0);
+    std::thread dropper([listener] {
+        pollfd pfd{listener, POLLIN, 0};
+        if (::poll(&pfd, 1, 10000) != 1) return;
+        int fd = ::accept(listener, nullptr, nullptr);
+        if (fd < 0) return;
+        char buffer[4096];
+        std::size_t received = 0;
+        while (received < sizeof(buffer)) {
+            ssize_t n = ::recv(fd, buffer, sizeof(buffer) - received, 0);
+            if (n <= 0) break;
+            received += static_cast<std::size_t>(n);
+        }
+        ::close(fd);
+    });
+
+    SessionUploader uploader(address, 1, "headset");
+    for (int s = 0; s < sessions; s++) uploader.post_file(paths[s], static_cast<std::uint32_t>(s));
+    dropper.join();
+    ::close(listener);
+    for (int i = 0; i < 200 && uploader.retries() == 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_GE(uploader.retries(), 1u);
+    EXPECT_EQ(uploader.pending(), static_cast<std::size_t>(sessions));
+
+    // The real server comes up; nothing of the batch was lost
+    SessionStore store;
+    ASSERT_TRUE(store.open(dir)) << store.error();
+    IngestServer server(store);
+    ASSERT_TRUE(server.listen(address)) << server.error();
+    ASSERT_TRUE(server.start()) << server.error();
+    ASSERT_TRUE(uploader.wait_idle(std::chrono::seconds(20)));
+    EXPECT_EQ(uploader.uploaded(), static_cast<std::uint64_t>(sessions));
+    EXPECT_EQ(server.stats().stored.load(), static_cast<std::uint64_t>(sessions));
+    for (const std::string& path : paths) EXPECT_TRUE(fs::exists(SessionUploader::marker_path(path))) << path;
+    server.stop();
+}
+
+TEST(IngestServer, UploaderRetriesAFileItCannotReadYet) {
+    Loopback loopback("unread");
+    std::string path = loopback.dir + "/session_100001.pses";
+
+    SessionUploader uploader(loopback.address, 1, "headset");
+    uploader.post_file(path, 1);
+    for (int i = 0; i < 200 && uploader.retries() == 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_GE(uploader.retries(), 1u);
+    EXPECT_EQ(uploader.pending(), 1u);
+
+    // The file shows up (e.g. the card was busy) and goes out with the retry
+    write_session(loopback.dir, 1);
+    ASSERT_TRUE(uploader.wait_idle(std::chrono::seconds(20)));
+    EXPECT_EQ(uploader.uploaded(), 1u);
+    EXPECT_EQ(loopback.server->stats().stored.load(), 1u);
+    EXPECT_TRUE(fs::exists(SessionUploader::marker_path(path)));
+}
+
+TEST(IngestServer, ClosesConnectionsOnMalformedFrames) {
+    Loopback loopback("malformed");
+
+    // Not a frame at all
+    int fd = connect_upload_socket(loopback.address, std::chrono::seconds(5));
+    ASSERT_GE(fd, 0);
+    std::string garbage(32, 'x');
+    ASSERT_EQ(::send(fd, garbage.data(), garbage.size(), MSG_NOSIGNAL), 32);
+    EXPECT_TRUE(closed_by_server(fd));
+    ::close(fd);
+
+    // A session before the hello
+    fd = connect_upload_socket(loopback.address, std::chrono::seconds(5));
+    std::string frame = encode_upload_frame(UploadFrameType::Session, std::string(8, '\0'));
+    ASSERT_EQ(::send(fd, frame.data(), frame.size(), MSG_NOSIGNAL), static_cast<ssize_t>(frame.size()));
+    EXPECT_TRUE(closed_by_server(fd));
+    ::close(fd);
+
+    // Damaged payload
+    fd = connect_upload_socket(loopback.address, std::chrono::seconds(5));
+    frame = encode_hello(7, "headset") + encode_upload_frame(UploadFrameType::Session, std::string(64, 'a'));
+    frame.back() = 'b';
+    ASSERT_EQ(::send(fd, frame.data(), frame.size(), MSG_NOSIGNAL), static_cast<ssize_t>(frame.size()));
+    EXPECT_TRUE(closed_by_server(fd));
+    ::close(fd);
+
+    EXPECT_EQ(loopback.server->stats().protocol_errors.load(), 3u);
+
+    // The server still takes uploads, and a device that closes its side
+    // right after the frame still gets the ack
+    fd = connect_upload_socket(loopback.address, std::chrono::seconds(5));
+    std::string payload(8, '\0');
+    payload[0] = 9;
+    payload += make_session_image(3);
+    frame = encode_hello(7, "headset") + encode_upload_frame(UploadFrameType::Session, payload);
+    ASSERT_EQ(::send(fd, frame.data(), frame.size(), MSG_NOSIGNAL), static_cast<ssize_t>(frame.size()));
+    ::shutdown(fd, SHUT_WR);
+    unsigned char ack[upload_protocol::HEADER_BYTES + upload_protocol::ACK_BYTES];
+    ASSERT_EQ(::recv(fd, ack, sizeof(ack), MSG_WAITALL), static_cast<ssize_t>(sizeof(ack)));
+    std::uint32_t id = 0;
+    UploadStatus status = UploadStatus::Invalid;
+    std::uint8_t eyes = 0;
+    ASSERT_TRUE(decode_ack(ack + upload_protocol::HEADER_BYTES, upload_protocol::ACK_BYTES, id, status, eyes));
+    EXPECT_EQ(id, 9u);
+    EXPECT_EQ(status, UploadStatus::Stored);
+    EXPECT_EQ(eyes, 2);
+    EXPECT_TRUE(closed_by_server(fd));
+    ::close(fd);
+}
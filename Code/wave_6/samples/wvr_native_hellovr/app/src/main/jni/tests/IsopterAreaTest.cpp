@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+#include "IsopterArea.h"
+#include "IsopterStudy.h"
+#include "NormativeModel.h"
+
+namespace {
+// Contour on the default grid from true eccentricities, stored like the
+// sheet points (radius 90 sin e)
+Isopter make_isopter(MeteoroidSizeID size, StimulusCode luminance, const std::vector<float>& eccentricity_deg) {
+    Isopter isopter;
+    isopter.size = size;
+    isopter.luminance = luminance;
+    for (std::size_t k = 0; k < eccentricity_deg.size(); k++) {
+        isopter.angle.push_back(static_cast<float>(k));
+        isopter.radius.push_back(static_cast<float>(90.0 * std::sin(eccentricity_deg[k] * M_PI / 180.0)));
+        isopter.x.push_back(0.0f);
+        isopter.y.push_back(0.0f);
+    }
+    return isopter;
+}
+
+double cap_sr(double eccentricity_deg) {
+    return 2.0 * M_PI * (1.0 - std::cos(eccentricity_deg * M_PI / 180.0));
+}
+
+double sum(const std::array<double, FIELD_QUADRANT_COUNT>& values) {
+    return std::accumulate(values.begin(), values.end(), 0.0);
+}
+}
+
+TEST(IsopterArea, ProjectedRadiusIsNotAnAngle) {
+    EXPECT_NEAR(visual_eccentricity_deg(45.0), 30.0, 1e-9);
+    EXPECT_NEAR(visual_eccentricity_deg(90.0), 90.0, 1e-9);
+    EXPECT_NEAR(visual_eccentricity_deg(120.0), 90.0, 1e-9);
+    EXPECT_NEAR(visual_eccentricity_deg(0.0f, -45.0f), 30.0, 1e-5);
+}
+
+TEST(IsopterArea, CirclesAreSphericalCaps) {
+    IsopterAreaScorer scorer;
+    IsopterArea area;
+    for (float eccentricity : {1.0f, 30.0f, 60.0f, 90.0f}) {
+        Isopter circle = make_isopter(MeteoroidSizeID::III, "4e"_stim, std::vector<float>(360, eccentricity));
+        ASSERT_TRUE(scorer.score(circle, 1, 40.0, area));
+        EXPECT_NEAR(area.area_sr, cap_sr(eccentricity), 1e-6 * cap_sr(eccentricity)) << eccentricity;
+        for (double quadrant : area.quadrant_sr) EXPECT_NEAR(quadrant, area.area_sr / 4.0, 1e-9);
+        EXPECT_FALSE(area.has_normative());
+    }
+    // The whole hemisphere
+    EXPECT_NEAR(area.area_deg2(), 2.0 * M_PI * SQUARE_DEGREES_PER_STERADIAN, 0.01);
+    EXPECT_NEAR(area.area_deg2(), 20626.5, 0.1);
+
+    // Other sample counts need their own scorer
+    Isopter coarse = make_isopter(MeteoroidSizeID::V, "4e"_stim, std::vector<float>(72, 30.0f));
+    EXPECT_FALSE(scorer.score(coarse, 1, 40.0, area));
+    IsopterAreaScorer coarse_scorer(72);
+    ASSERT_TRUE(coarse_scorer.score(coarse, 1, 40.0, area));
+    EXPECT_NEAR(area.area_sr, cap_sr(30.0), 1e-9);
+}
+
+TEST(IsopterArea, QuadrantsFollowTheEye) {
+    // Wide between longitude 0 and 90 only
+    std::vector<float> eccentricity(360, 10.0f);
+    for (int k = 1; k < 90; k++) eccentricity[k] = 60.0f;
+    Isopter isopter = make_isopter(MeteoroidSizeID::III, "4e"_stim, eccentricity);
+    IsopterAreaScorer scorer;
+
+    IsopterArea right;
+    ASSERT_TRUE(scorer.score(isopter, 1, 40.0, right));
+    int widest = static_cast<int>(std::max_element(right.quadrant_sr.begin(), right.quadrant_sr.end()) -
+                                  right.quadrant_sr.begin());
+    EXPECT_EQ(widest, static_cast<int>(FieldQuadrant::SuperiorTemporal));
+    EXPECT_NEAR(sum(right.quadrant_sr), right.area_sr, 1e-12);
+
+    IsopterArea left;
+    ASSERT_TRUE(scorer.score(isopter, 2, 40.0, left));
+    widest = static_cast<int>(std::max_element(left.quadrant_sr.begin(), left.quadrant_sr.end()) -
+                              left.quadrant_sr.begin());
+    EXPECT_EQ(widest, static_cast<int>(FieldQuadrant::SuperiorNasal));
+    EXPECT_STREQ(quadrant_name(FieldQuadrant::SuperiorNasal), "superior_nasal");
+    // 89 of the 360 samples are wide, the borders count half (the radii are
+    // floats, hence the tolerance)
+    EXPECT_NEAR(right.area_sr, (89.0 * cap_sr(60.0) + 271.0 * cap_sr(10.0)) / 360.0, 1e-6);
+}
+
+TEST(IsopterArea, LossAgainstNormativeIsopter) {
+    std::vector<float> angles(360);
+    for (int k = 0; k < 360; k++) angles[k] = static_cast<float>(k);
+    std::vector<float> normal(360);
+    int row = normative_stimulus_row(MeteoroidSizeID::I, "2e"_stim);
+    ASSERT_GE(row, 0);
+    evaluate_normative_contour(65.0, 2, row, angles.data(), angles.size(), normal.data());
+
+    // The contour agrees with the isopter table of the model
+    NormativeIsopters table = evaluate_normative_isopters(65.0, {0, 90, 135});
+    for (int longitude : {0, 90, 135}) {
+        EXPECT_FLOAT_EQ(normal[longitude], table.expected(2, longitude, MeteoroidSizeID::I, "2e"_stim));
+    }
+
+    IsopterAreaScorer scorer;
+    IsopterArea area;
+    ASSERT_TRUE(scorer.score(make_isopter(MeteoroidSizeID::I, "2e"_stim, normal), 2, 65.0, area));
+    ASSERT_TRUE(area.has_normative());
+    EXPECT_NEAR(area.area_sr, area.normative_sr, 1e-6);
+    EXPECT_NEAR(area.lost_sr, 0.0, 1e-6);
+
+    // Half the eccentricity in the inferior field (longitude 180..360)
+    std::vector<float> shrunk = normal;
+    for (int k = 181; k < 360; k++) shrunk[k] *= 0.5f;
+    ASSERT_TRUE(scorer.score(make_isopter(MeteoroidSizeID::I, "2e"_stim, shrunk), 2, 65.0, area));
+    EXPECT_NEAR(area.lost_sr, area.normative_sr - area.area_sr, 1e-6);
+    EXPECT_GT(area.lost_fraction(), 0.2);
+    EXPECT_LT(area.lost_fraction(), 0.5);
+    EXPECT_NEAR(sum(area.quadrant_lost_sr), area.lost_sr, 1e-12);
+    EXPECT_NEAR(area.quadrant_lost_sr[static_cast<int>(FieldQuadrant::SuperiorNasal)], 0.0, 1e-6);
+    EXPECT_NEAR(area.quadrant_lost_sr[static_cast<int>(FieldQuadrant::SuperiorTemporal)], 0.0, 1e-6);
+    EXPECT_GT(area.quadrant_lost_sr[static_cast<int>(FieldQuadrant::InferiorNasal)], 0.0);
+
+    // Older patients have smaller normal fields, so less is lost
+    IsopterArea older;
+    ASSERT_TRUE(scorer.score(make_isopter(MeteoroidSizeID::I, "2e"_stim, shrunk), 2, 85.0, older));
+    EXPECT_LT(older.normative_sr, area.normative_sr);
+    EXPECT_LT(older.lost_sr, area.lost_sr);
+}
+
+TEST(IsopterArea, WholeStudyInMilliseconds) {
+    std::vector<StudyEyeIsopters> eyes(400);
+    for (std::size_t i = 0; i < eyes.size(); i++) {
+        eyes[i].subject = static_cast<long>(i / 2);
+        eyes[i].eye = 1 + static_cast<int>(i % 2);
+        eyes[i].age_years = 20 + static_cast<int>(i % 60);
+        std::vector<float> eccentricity(360);
+        for (int k = 0; k < 360; k++) eccentricity[k] = 30.0f + 20.0f * std::sin(k * 0.05f + i);
+        eyes[i].isopters.push_back(make_isopter(MeteoroidSizeID::I, "2e"_stim, eccentricity));
+        eyes[i].isopters.push_back(make_isopter(MeteoroidSizeID::I, "3e"_stim, eccentricity));
+        eyes[i].isopters.push_back(make_isopter(MeteoroidSizeID::V, "4e"_stim, eccentricity));
+        eyes[i].isopters.push_back(Isopter()); // No contour
+    }
+
+    std::vector<std::vector<IsopterArea>> serial;
+    score_study_isopters(eyes, serial, 360, 1);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::vector<IsopterArea>> parallel;
+    score_study_isopters(eyes, parallel, 360, 4);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    ASSERT_EQ(parallel.size(), eyes.size());
+    for (std::size_t i = 0; i < eyes.size(); i++) {
+        ASSERT_EQ(parallel[i].size(), 4u);
+        for (std::size_t j = 0; j < 4; j++) {
+            EXPECT_EQ(parallel[i][j].area_sr, serial[i][j].area_sr);
+            EXPECT_EQ(parallel[i][j].lost_sr, serial[i][j].lost_sr);
+        }
+        EXPECT_TRUE(parallel[i][0].has_normative());
+        EXPECT_EQ(parallel[i][3].area_sr, 0.0);
+    }
+    // Generous for debug builds, a release build takes about a millisecond
+    EXPECT_LT(seconds, 1.0) << seconds << " s";
+}
@@ -0,0 +1,188 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "FileUtil.h"
+#include "IsopterStudy.h"
+#include "JournalWriter.h"
+#include "SheetExport.h"
+#include "TestUtil.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+double smooth_radius(double longitude_deg) {
+    double a = longitude_deg * M_PI / 180.0;
+    return 40.0 + 10.0 * std::cos(a) + 4.0 * std::sin(2.0 * a);
+}
+
+// Both repeats of every planned entry, around smooth_radius - shift for V4e
+// and further in for the dimmer stimuli
+GoldmannSheet make_sheet(int eye, double shift) {
+    return planned_sheet(eye, 2, [shift](int longitude, StimulusCode luminance, int repeat) {
+        return smooth_radius(longitude) - shift - (19 - luminance.index) + (repeat == 0 ? 1.0 : -1.0);
+    });
+}
+}
+
+TEST(PeriodicSpline, InterpolatesAndWrapsAround) {
+    // Uneven meridians, the gap over 0° included
+    std::vector<float> t = {20, 45, 90, 150, 200, 240, 300, 330};
+    std::vector<float> r;
+    for (float longitude : t) r.push_back(static_cast<float>(smooth_radius(longitude)));
+    std::vector<double> m;
+    fit_periodic_spline(t.data(), r.data(), t.size(), 360.0, m);
+
+    for (std::size_t i = 0; i < t.size(); i++) {
+        EXPECT_NEAR(evaluate_periodic_spline(t.data(), r.data(), m.data(), t.size(), 360.0, t[i]), r[i], 1e-4);
+        EXPECT_NEAR(evaluate_periodic_spline(t.data(), r.data(), m.data(), t.size(), 360.0, t[i] + 360.0), r[i],
+                    1e-4);
+    }
+    // Continuous over the seam, and close to the smooth curve in between
+    double before = evaluate_periodic_spline(t.data(), r.data(), m.data(), t.size(), 360.0, 359.999);
+    double after = evaluate_periodic_spline(t.data(), r.data(), m.data(), t.size(), 360.0, 0.0);
+    EXPECT_NEAR(before, after, 1e-3);
+    for (int angle = 0; angle < 360; angle += 5) {
+        EXPECT_NEAR(evaluate_periodic_spline(t.data(), r.data(), m.data(), t.size(), 360.0, angle),
+                    smooth_radius(angle), 1.0)
+                << angle;
+    }
+
+    // A circle stays a circle
+    std::vector<float> circle(t.size(), 30.0f);
+    fit_periodic_spline(t.data(), circle.data(), t.size(), 360.0, m);
+    for (int angle = 0; angle < 360; angle += 7) {
+        EXPECT_NEAR(evaluate_periodic_spline(t.data(), circle.data(), m.data(), t.size(), 360.0, angle), 30.0,
+                    1e-5);
+    }
+}
+
+TEST(IsopterBuilder, MergesRepeatsIntoMeanPoints) {
+    GoldmannSheet sheet = make_sheet(1, 0.0);
+    std::vector<Isopter> isopters = build_isopters(sheet, 1);
+
+    // I2e, I3e, V4e: ordered by size, then luminance
+    ASSERT_EQ(isopters.size(), 3u);
+    EXPECT_EQ(isopters[0].size, MeteoroidSizeID::I);
+    EXPECT_EQ(isopters[0].luminance, "2e"_stim);
+    EXPECT_EQ(isopters[1].luminance, "3e"_stim);
+    EXPECT_EQ(isopters[2].size, MeteoroidSizeID::V);
+
+    const Isopter& v4e = isopters[2];
+    ASSERT_EQ(v4e.knot_longitude.size(), METEOROID_LONGITUDES_DEG.size());
+    for (std::size_t i = 0; i < v4e.knot_longitude.size(); i++) {
+        // The two repeats are 1° in front of and behind the mean
+        EXPECT_NEAR(v4e.knot_radius[i], smooth_radius(v4e.knot_longitude[i]), 1e-3);
+    }
+    ASSERT_TRUE(v4e.has_contour());
+    ASSERT_EQ(v4e.radius.size(), 360u);
+    for (std::size_t k = 0; k < v4e.radius.size(); k += 15) {
+        EXPECT_FLOAT_EQ(v4e.angle[k], static_cast<float>(k));
+        EXPECT_NEAR(v4e.radius[k], smooth_radius(v4e.angle[k]), 0.5) << v4e.angle[k];
+        EXPECT_NEAR(std::hypot(v4e.x[k], v4e.y[k]), v4e.radius[k], 1e-3);
+    }
+    EXPECT_NEAR(v4e.x[0], v4e.radius[0], 1e-4);
+    EXPECT_NEAR(v4e.y[90], v4e.radius[90], 1e-4);
+}
+
+TEST(IsopterBuilder, SparseMeridiansAndPointOrder) {
+    IsopterBuilder builder;
+    // Three meridians are too few for a contour, like vis2.py
+    for (int longitude : {0, 120, 240}) {
+        builder.add_point(longitude, MeteoroidSizeID::I, "2e"_stim, 0.0f, 20.0f);
+    }
+    // The same V4e points forwards and backwards give the same contour
+    std::vector<std::pair<int, PolarPoint>> points;
+    for (int longitude = 0; longitude < 360; longitude += 45) {
+        points.push_back({longitude, point_at(longitude, smooth_radius(longitude) + 0.3)});
+        points.push_back({longitude + 360, point_at(longitude, smooth_radius(longitude) - 0.7)});
+    }
+    for (const auto& p : points) {
+        builder.add_point(p.first, MeteoroidSizeID::V, "4e"_stim, p.second.phi, p.second.theta);
+    }
+    std::vector<Isopter> forward;
+    builder.build(forward);
+    for (auto it = points.rbegin(); it != points.rend(); ++it) {
+        builder.add_point(it->first, MeteoroidSizeID::V, "4e"_stim, it->second.phi, it->second.theta);
+    }
+    std::vector<Isopter> backward;
+    builder.build(backward);
+
+    ASSERT_EQ(forward.size(), 2u);
+    EXPECT_EQ(forward[0].knot_longitude.size(), 3u);
+    EXPECT_FALSE(forward[0].has_contour());
+    ASSERT_EQ(backward.size(), 1u);
+    EXPECT_EQ(forward[1].knot_longitude, backward[0].knot_longitude);
+    EXPECT_EQ(forward[1].radius, backward[0].radius);
+    EXPECT_EQ(backward[0].knot_longitude.size(), 8u);
+
+    // One contour row per sample, the header from the schema
+    std::string csv = format_isopter_csv(backward);
+    EXPECT_EQ(csv.rfind("SizeIndex,Intensity,Angle,Radius,X,Y\n", 0), 0u);
+    EXPECT_EQ(static_cast<std::size_t>(std::count(csv.begin(), csv.end(), '\n')), 1u + 360u);
+}
+
+TEST(IsopterStudy, SubjectsInParallelMatchSerial) {
+    std::string root = temp_dir("isopters", "study");
+    const int subjects = 40;
+    for (int subject = 1; subject <= subjects; subject++) {
+        std::string dir = root + "/Subject" + std::to_string(subject);
+        fs::create_directories(dir);
+        for (int eye = 1; eye <= 2; eye++) {
+            std::string name = eye == 1 ? "final_Right_perimetry_2026-01-29_10-00-00.csv"
+                                        : "final_Left_perimetry_2026-01-29_10-05-00.csv";
+            ASSERT_TRUE(write_file_atomic(dir + "/" + name, format_sheet_csv(make_sheet(eye, subject % 7), eye)));
+        }
+        // An undated copy of the sheet is the same measurement
+        fs::copy_file(dir + "/final_Right_perimetry_2026-01-29_10-00-00.csv", dir + "/Right.csv");
+        // Journals and other files are not result sheets
+        ASSERT_TRUE(write_file_atomic(dir + "/current_Right.csv", csv_header<JournalRecord>()));
+        ASSERT_TRUE(write_file_atomic(dir + "/notes.csv", "Note\nfine\n"));
+    }
+
+    std::vector<StudyEyeIsopters> serial;
+    StudyIsopterStats serial_stats;
+    ASSERT_TRUE(build_study_isopters(root, serial, IsopterOptions(), 1, &serial_stats));
+    auto start = std::chrono::steady_clock::now();
+    std::vector<StudyEyeIsopters> parallel;
+    StudyIsopterStats stats;
+    ASSERT_TRUE(build_study_isopters(root, parallel, IsopterOptions(), 4, &stats));
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    EXPECT_EQ(stats.files, 5u * subjects);
+    EXPECT_EQ(stats.sheets, 2u * subjects);
+    EXPECT_EQ(stats.duplicates, 1u * subjects);
+    EXPECT_EQ(stats.skipped, 2u * subjects);
+    EXPECT_EQ(stats.contours, 3u * 2u * subjects);
+    EXPECT_EQ(stats.workers, 4u);
+    ASSERT_EQ(parallel.size(), serial.size());
+    for (std::size_t i = 0; i < parallel.size(); i++) {
+        EXPECT_EQ(parallel[i].file, serial[i].file);
+        ASSERT_EQ(parallel[i].isopters.size(), serial[i].isopters.size());
+        for (std::size_t j = 0; j < parallel[i].isopters.size(); j++) {
+            EXPECT_EQ(parallel[i].isopters[j].radius, serial[i].isopters[j].radius);
+        }
+    }
+
+    // Path order: Subject1, Subject10, ...; left before right
+    EXPECT_EQ(parallel[0].file, "Subject1/final_Left_perimetry_2026-01-29_10-05-00.csv");
+    EXPECT_EQ(parallel[0].subject, 1);
+    EXPECT_EQ(parallel[0].eye, 2);
+    EXPECT_EQ(parallel[1].eye, 1);
+    // The dated original is kept, not the copy
+    EXPECT_EQ(parallel[1].file, "Subject1/final_Right_perimetry_2026-01-29_10-00-00.csv");
+    const Isopter& v4e = parallel[0].isopters[2];
+    EXPECT_NEAR(v4e.knot_radius[0], smooth_radius(0) - 1.0, 1e-3);
+    // Generous for debug builds
+    EXPECT_LT(seconds, 5.0);
+
+    std::string error;
+    EXPECT_FALSE(build_study_isopters(root + "/missing", parallel, IsopterOptions(), 0, nullptr, &error));
+    EXPECT_FALSE(error.empty());
+    fs::remove_all(root);
+}
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+
+#include "JournalWriter.h"
+#include "TestUtil.h"
+
+namespace {
+JournalRecord record(int eye, int longitude, float phi, float theta) {
+    JournalRecord r;
+    r.eye = eye;
+    r.longitude = longitude;
+    r.size = MeteoroidSizeID::I;
+    r.luminance = "3e"_stim;
+    r.p = {theta, phi};
+    return r;
+}
+}
+
+TEST(SpscQueue, KeepsOrderAndRejectsWhenFull) {
+    SpscQueue<int, 4> queue;
+    for (int i = 0; i < 4; i++) EXPECT_TRUE(queue.push(i));
+    EXPECT_FALSE(queue.push(4));
+
+    int value = -1;
+    ASSERT_TRUE(queue.pop(value));
+    EXPECT_EQ(value, 0);
+    EXPECT_TRUE(queue.push(4));
+    for (int expected = 1; expected <= 4; expected++) {
+        ASSERT_TRUE(queue.pop(value));
+        EXPECT_EQ(value, expected);
+    }
+    EXPECT_FALSE(queue.pop(value));
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(JournalWriter, FormatsLikeTheRunningCsv) {
+    EXPECT_EQ(format_journal_line(record(1, 30, 12.5f, 40.25f)), "30,Size_I,3e,[(12.5|40.25);]\n");
+}
+
+TEST(JournalWriter, FlushMakesEveryPointDurable) {
+    std::string right = temp_path("journal", "right", "csv"), left = temp_path("journal", "left", "csv");
+    std::remove(right.c_str());
+    std::remove(left.c_str());
+
+    JournalWriter journal(std::chrono::milliseconds(50), 4);
+    ASSERT_TRUE(journal.open_session(right, left));
+    for (int i = 0; i < 10; i++) {
+        ASSERT_TRUE(journal.append(record(1 + i % 2, i * 30, 1.0f * i, 2.0f)));
+    }
+    journal.append(record(0, 0, 0.0f, 0.0f)); // No eye, counted as failed
+    journal.flush();
+
+    EXPECT_EQ(journal.appended(), 11u);
+    EXPECT_EQ(journal.synced(), 10u);
+    EXPECT_EQ(journal.failed(), 1u);
+    EXPECT_EQ(journal.dropped(), 0u);
+
+    std::string content = read_file(right);
+    EXPECT_EQ(content.rfind(JournalWriter::HEADER, 0), 0u);
+    EXPECT_NE(content.find("0,Size_I,3e,[(0|2);]\n"), std::string::npos);
+    EXPECT_NE(content.find("240,Size_I,3e,[(8|2);]\n"), std::string::npos);
+    EXPECT_EQ(content.find("30,Size_I"), std::string::npos); // Left eye
+    EXPECT_NE(read_file(left).find("270,Size_I,3e,[(9|2);]\n"), std::string::npos);
+
+    // Reopening appends, the header is not repeated
+    ASSERT_TRUE(journal.open_session(right, left));
+    journal.append(record(1, 330, 3.0f, 4.0f));
+    journal.close_session();
+    content = read_file(right);
+    EXPECT_EQ(content.find(JournalWriter::HEADER, 1), std::string::npos);
+    EXPECT_NE(content.find("330,Size_I,3e,[(3|4);]\n"), std::string::npos);
+
+    std::remove(right.c_str());
+    std::remove(left.c_str());
+}
+
+TEST(JournalWriter, PointsAreSyncedWithoutFlush) {
+    std::string right = temp_path("journal", "interval_right", "csv"), left = temp_path("journal", "interval_left", "csv");
+    std::remove(right.c_str());
+    std::remove(left.c_str());
+    {
+        JournalWriter journal(std::chrono::milliseconds(20), 100);
+        ASSERT_TRUE(journal.open_session(right, left));
+        journal.append(record(2, 90, 5.0f, 6.0f));
+        for (int i = 0; i < 200 && journal.synced() == 0; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        EXPECT_EQ(journal.synced(), 1u);
+    }
+    EXPECT_NE(read_file(left).find("90,Size_I,3e,[(5|6);]\n"), std::string::npos);
+    std::remove(right.c_str());
+    std::remove(left.c_str());
+}
@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+#include <unistd.h>
+
+#include "FileUtil.h"
+#include "JournalWriter.h"
+#include "MeasurementCsv.h"
+#include "SheetExport.h"
+#include "TestUtil.h"
+
+namespace {
+GoldmannSheet make_sheet() {
+    GoldmannSheet sheet = planned_sheet(1);
+    sheet.add_point({30.9358f, 0.0f}, MeteoroidSizeID::I, 0, 1, "2e"_stim);
+    sheet.add_point({10.1238f, 0.0f}, MeteoroidSizeID::I, 0, 1, "2e"_stim);
+    sheet.add_point({-4.5e-05f, 62.0116f}, MeteoroidSizeID::V, 90, 1, "4e"_stim);
+    sheet.set_longitude_normalized_angle(1, 90, 61.5f);
+    return sheet;
+}
+}
+
+TEST(MeasurementCsv, ReadsTheFinalSheetExport) {
+    GoldmannSheet sheet = make_sheet();
+    std::string csv = format_sheet_csv(sheet, 1);
+
+    MeasurementTable table;
+    std::string error;
+    ASSERT_TRUE(parse_measurement_csv(csv.data(), csv.size(), table, &error)) << error;
+    EXPECT_EQ(table.layout, MeasurementLayout::Sheet);
+    ASSERT_EQ(table.point_begin.size(), table.rows() + 1);
+    EXPECT_EQ(table.points(), 3u);
+
+    // Same rows, in the same order, as the sheet
+    std::size_t row = 0;
+    sheet.for_each_entry(1, [&](int longitude, MeteoroidSizeID size, StimulusCode luminance,
+                                const SheetEntry& entry, GoldmannSheet::PointRange points) {
+        ASSERT_LT(row, table.rows());
+        EXPECT_EQ(table.longitude[row], longitude);
+        EXPECT_EQ(table.size_id(row), size);
+        EXPECT_EQ(table.stimulus(row), luminance);
+        EXPECT_FLOAT_EQ(table.normed_value[row], entry.normalized_angle);
+        ASSERT_EQ(table.point_begin[row + 1] - table.point_begin[row], points.size());
+        std::size_t p = table.point_begin[row];
+        for (const PolarPoint& point : points) {
+            EXPECT_FLOAT_EQ(table.phi[p], point.phi);
+            EXPECT_FLOAT_EQ(table.theta[p], point.theta);
+            p++;
+        }
+        row++;
+    });
+    EXPECT_EQ(row, table.rows());
+}
+
+TEST(MeasurementCsv, ReadsTheRunningJournal) {
+    std::string csv = JournalWriter::HEADER;
+    JournalRecord record;
+    record.eye = 2;
+    record.longitude = 330;
+    record.size = MeteoroidSizeID::III;
+    record.luminance = "4e"_stim;
+    record.p.phi = -12.25f;
+    record.p.theta = 1e-7f;
+    csv += format_journal_line(record);
+    record.longitude = 0;
+    record.p.phi = 45.0f;
+    record.p.theta = -0.5f;
+    csv += format_journal_line(record);
+    // Edited on Windows, no newline at the end
+    csv += "15,Size_V,1a,[(1|2);]\r\n\r\n";
+    csv += "15,Size_II,3c,[]";
+
+    MeasurementTable table;
+    std::string error;
+    ASSERT_TRUE(parse_measurement_csv(csv.data(), csv.size(), table, &error)) << error;
+    EXPECT_EQ(table.layout, MeasurementLayout::Journal);
+    ASSERT_EQ(table.rows(), 4u);
+    ASSERT_EQ(table.points(), 3u);
+    EXPECT_EQ(table.longitude[0], 330);
+    EXPECT_EQ(table.size_id(0), MeteoroidSizeID::III);
+    EXPECT_FLOAT_EQ(table.phi[0], -12.25f);
+    EXPECT_FLOAT_EQ(table.theta[0], 1e-7f);
+    EXPECT_TRUE(std::isnan(table.normed_value[0]));
+    EXPECT_EQ(table.stimulus(2), "1a"_stim);
+    EXPECT_EQ(table.point_begin[4] - table.point_begin[3], 0u);
+}
+
+TEST(MeasurementCsv, ReportsTheBadLine) {
+    const std::string header = "Longitude,SizeIndex,Intensity,Points[(PHI,THETA)],NormedValue\n";
+    MeasurementTable table;
+    std::string error;
+
+    std::string wrong_header = "Longitude,Size\n0,Size_I,2e,[],1\n";
+    EXPECT_FALSE(parse_measurement_csv(wrong_header.data(), wrong_header.size(), table, &error));
+    EXPECT_NE(error.find("header"), std::string::npos);
+
+    std::string bad_size = header + "0,Size_I,2e,[],1\n0,Size_VI,2e,[],1\n";
+    EXPECT_FALSE(parse_measurement_csv(bad_size.data(), bad_size.size(), table, &error));
+    EXPECT_EQ(error.rfind("line 3:", 0), 0u) << error;
+    EXPECT_EQ(table.rows(), 1u);
+
+    std::string cut_point = header + "0,Size_I,2e,[(30.9|0);(10.1|";
+    EXPECT_FALSE(parse_measurement_csv(cut_point.data(), cut_point.size(), table, &error));
+    EXPECT_NE(error.find("point"), std::string::npos);
+
+    std::string no_normed = header + "0,Size_I,2e,[]\n";
+    EXPECT_FALSE(parse_measurement_csv(no_normed.data(), no_normed.size(), table, &error));
+
+    MeasurementCsvReader reader;
+    EXPECT_FALSE(reader.read(::testing::TempDir() + "missing_measurement.csv", table));
+    EXPECT_FALSE(reader.error().empty());
+}
+
+TEST(MeasurementCsv, OneReaderReadsManyFiles) {
+    std::string csv = format_sheet_csv(make_sheet(), 1);
+    std::string path = ::testing::TempDir() + "measurement_" + std::to_string(::getpid()) + ".csv";
+    ASSERT_TRUE(write_file_atomic(path, csv));
+
+    // The reader reuses its buffer and the table; the throughput over a
+    // whole tree is printed by tools/convert_measurements
+    MeasurementCsvReader reader;
+    MeasurementTable first;
+    ASSERT_TRUE(reader.read(path, first)) << reader.error();
+    MeasurementTable table;
+    const int files = 2000;
+    for (int i = 1; i < files; i++) {
+        ASSERT_TRUE(reader.read(path, table)) << reader.error();
+    }
+    EXPECT_EQ(reader.bytes_read(), files * csv.size());
+    EXPECT_EQ(table.rows(), first.rows());
+    EXPECT_EQ(table.point_begin, first.point_begin);
+    EXPECT_EQ(table.phi, first.phi);
+    EXPECT_EQ(table.theta, first.theta);
+    std::remove(path.c_str());
+}
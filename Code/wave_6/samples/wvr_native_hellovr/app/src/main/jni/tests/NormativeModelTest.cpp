@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "NormativeModel.h"
+#include "PerimetryEngine.h"
+
+namespace {
+std::vector<int> every_30_deg() {
+    std::vector<int> meridians;
+    for (int longitude = 0; longitude < 360; longitude += 30) meridians.push_back(longitude);
+    return meridians;
+}
+}
+
+TEST(NormativeModel, MatchesAnalysisScript) {
+    // generate_isopter_tables.py at 31 years, right eye, before clamping
+    const std::array<double, 12> v4e = {92.27, 76.51, 58.45, 49.98, 53.16, 59.07,
+                                        59.10, 55.06, 56.11, 67.37, 83.98, 95.08};
+    const std::array<double, 12> i3e = {66.88, 57.08, 45.66, 40.06, 41.99, 46.78,
+                                        48.77, 47.16, 46.53, 51.50, 60.97, 68.23};
+    const std::array<double, 12> i2e = {46.72, 40.53, 32.76, 28.82, 30.28, 33.86,
+                                        35.27, 33.73, 32.54, 35.24, 41.51, 46.89};
+
+    NormativeIsopters isopters = evaluate_normative_isopters(31.0, every_30_deg());
+    for (int i = 0; i < 12; i++) {
+        int longitude = 30 * i;
+        EXPECT_NEAR(isopters.expected(1, longitude, MeteoroidSizeID::V, "4e"_stim), std::min(v4e[i], 90.0), 0.01)
+                << longitude;
+        EXPECT_NEAR(isopters.expected(1, longitude, MeteoroidSizeID::I, "3e"_stim), i3e[i], 0.01) << longitude;
+        EXPECT_NEAR(isopters.expected(1, longitude, MeteoroidSizeID::I, "2e"_stim), i2e[i], 0.01) << longitude;
+    }
+}
+
+TEST(NormativeModel, LeftEyeIsMirrored) {
+    NormativeIsopters isopters = evaluate_normative_isopters(55.0, every_30_deg());
+    for (int longitude = 0; longitude < 360; longitude += 30) {
+        EXPECT_FLOAT_EQ(isopters.expected(2, longitude, MeteoroidSizeID::I, "2e"_stim),
+                        isopters.expected(1, 180 - longitude, MeteoroidSizeID::I, "2e"_stim))
+                << longitude;
+    }
+}
+
+TEST(NormativeModel, FieldShrinksWithAge) {
+    NormativeIsopters young = evaluate_normative_isopters(25.0, every_30_deg());
+    NormativeIsopters old = evaluate_normative_isopters(80.0, every_30_deg());
+    for (int longitude = 0; longitude < 360; longitude += 30) {
+        EXPECT_LT(old.expected(1, longitude, MeteoroidSizeID::I, "2e"_stim),
+                  young.expected(1, longitude, MeteoroidSizeID::I, "2e"_stim))
+                << longitude;
+    }
+}
+
+TEST(NormativeModel, UnknownStimuliAndMeridians) {
+    NormativeIsopters isopters = evaluate_normative_isopters(31.0, {0, 90, -90});
+    EXPECT_LT(isopters.expected(1, 0, MeteoroidSizeID::III, "4e"_stim), 0.0f);
+    EXPECT_LT(isopters.expected(1, 45, MeteoroidSizeID::V, "4e"_stim), 0.0f);
+    EXPECT_LT(isopters.expected(0, 0, MeteoroidSizeID::V, "4e"_stim), 0.0f);
+    // Longitudes are compared modulo 360
+    EXPECT_FLOAT_EQ(isopters.expected(1, 270, MeteoroidSizeID::I, "3e"_stim),
+                    isopters.expected(1, -90, MeteoroidSizeID::I, "3e"_stim));
+    EXPECT_GE(isopters.expected(1, 270, MeteoroidSizeID::I, "3e"_stim), 0.0f);
+}
+
+TEST(NormativeModel, EngineSheetFollowsPatientAge) {
+    PerimetryEngine engine;
+    EXPECT_DOUBLE_EQ(engine.patient_age(), DEFAULT_PATIENT_AGE_YEARS);
+    float default_angle = engine.m_goldmann_sheet.normalized_angle(1, 90, MeteoroidSizeID::I, "2e"_stim);
+
+    engine.set_patient_age(80.0);
+    NormativeIsopters expected = evaluate_normative_isopters(80.0, {90});
+    float angle = engine.m_goldmann_sheet.normalized_angle(1, 90, MeteoroidSizeID::I, "2e"_stim);
+    EXPECT_FLOAT_EQ(angle, expected.expected(1, 90, MeteoroidSizeID::I, "2e"_stim));
+    EXPECT_LT(angle, default_angle);
+
+    // A new patient keeps the age
+    engine.reset_session();
+    EXPECT_FLOAT_EQ(engine.m_goldmann_sheet.normalized_angle(1, 90, MeteoroidSizeID::I, "2e"_stim), angle);
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+
+#include <glm/glm.hpp>
+
+#include "PerimetryEngine.h"
+
+TEST(PerimetryEngine, NothingIsDrawnBeforeStart) {
+    PerimetryEngine engine;
+    EXPECT_EQ(engine.m_perimetry_status, PerimetryStatus::NotStarted);
+    EXPECT_FALSE(engine.tick().stimulus.is_visible);
+}
+
+TEST(PerimetryEngine, StimulusStaysOnPerimetrySphere) {
+    PerimetryEngine engine;
+    engine.mActiveEye = 1;
+    engine.start_animation();
+    ASSERT_EQ(engine.m_perimetry_status, PerimetryStatus::Running);
+
+    StimulusToDraw stimulus = engine.tick().stimulus;
+    ASSERT_TRUE(stimulus.is_visible);
+    EXPECT_NEAR(glm::length(stimulus.position), METEOROID_DISTANCE, 1e-3);
+    EXPECT_GT(stimulus.radius_m, 0.0f);
+    for (float c : stimulus.color) {
+        EXPECT_GE(c, 0.0f);
+        EXPECT_LE(c, 1.0f);
+    }
+}
+
+TEST(PerimetryEngine, DetectionIsRecordedInSheet) {
+    PerimetryEngine engine;
+    engine.mActiveEye = 2;
+    engine.start_animation();
+    engine.tick().stimulus;
+
+    auto result = engine.point_detected();
+    EXPECT_EQ(std::get<3>(result), 2);
+    EXPECT_EQ(engine.m_perimetry_status, PerimetryStatus::Running);
+    EXPECT_EQ(engine.m_goldmann_sheet.get_points().size(), 1u);
+}
+
+TEST(PerimetryEngine, OnlyTickMovesTheStimulus) {
+    ManualClock clock;
+    PerimetryEngine engine(&clock);
+    engine.mActiveEye = 1;
+    engine.start_animation();
+
+    clock.advance_seconds(0.05);
+    const FrameSnapshot& first = engine.tick();
+    double eccentricity = first.eccentricity_deg;
+    glm::vec3 position = first.stimulus.position;
+
+    // Reading the snapshot for both eyes or pausing must not integrate time
+    clock.advance_seconds(0.05);
+    EXPECT_EQ(engine.snapshot().stimulus.position, position);
+    engine.pause_animation(false);
+    EXPECT_DOUBLE_EQ(engine.current_eccentricity_deg(), eccentricity);
+
+    const FrameSnapshot& paused = engine.tick();
+    EXPECT_EQ(paused.frame_index, 2u);
+    EXPECT_TRUE(paused.stimulus.is_visible);
+    EXPECT_EQ(paused.stimulus.position, position);
+}
+
+TEST(PerimetryEngine, ExtraTicksInTheSameFrameDoNotMove) {
+    ManualClock clock;
+    PerimetryEngine engine(&clock);
+    engine.mActiveEye = 2;
+    engine.start_animation();
+
+    clock.advance_seconds(1.0 / 72.0);
+    double eccentricity = engine.tick().eccentricity_deg;
+    EXPECT_LT(eccentricity, 90.0);
+    EXPECT_DOUBLE_EQ(engine.tick(clock.now()).eccentricity_deg, eccentricity);
+}
+
+TEST(TrajectoryHistory, InterpolatesWithinTrack) {
+    TrajectoryHistory history;
+    EngineClock::time_point t0{};
+    history.push({t0, 1, 90.0, {}});
+    history.push({t0 + std::chrono::seconds(1), 1, 80.0, {}});
+    history.push({t0 + std::chrono::seconds(2), 2, 90.0, {}});
+
+    auto at = [&](double seconds, std::uint32_t track) {
+        auto t = t0 + std::chrono::duration_cast<EngineClock::duration>(std::chrono::duration<double>(seconds));
+        return history.eccentricity_at(t, track, 10.0);
+    };
+    EXPECT_NEAR(*at(0.25, 1), 87.5, 1e-9);
+    EXPECT_NEAR(*at(-1.0, 1), 90.0, 1e-9);  // Before the track started
+    EXPECT_NEAR(*at(1.5, 1), 75.0, 1e-9);   // Extrapolated with the given speed
+    EXPECT_NEAR(*at(2.0, 2), 90.0, 1e-9);
+    EXPECT_FALSE(at(1.0, 3).has_value());
+}
+
+TEST(PerimetryEngine, DetectionUsesPositionAtReactionTime) {
+    ManualClock clock;
+    PerimetryEngine engine(&clock);
+    engine.mActiveEye = 1;
+    engine.start_animation();
+    int meridian = engine.current_vector()->angle_deg;
+
+    // Irregular frame times, the press is reported late by the input poll
+    double frame_seconds[] = {0.011, 0.014, 0.02, 0.009, 0.013};
+    double seen_eccentricity = 0.0;
+    EngineClock::time_point seen_time;
+    for (int i = 0; i < 60; i++) {
+        clock.advance_seconds(frame_seconds[i % 5]);
+        engine.tick();
+        if (i == 20) {
+            seen_eccentricity = engine.current_eccentricity_deg();
+            seen_time = clock.now();
+        }
+    }
+    auto press = seen_time + std::chrono::duration_cast<EngineClock::duration>(
+            std::chrono::duration<double>(REACTION_TIME));
+    ASSERT_LE(press, clock.now());
+    auto result = engine.point_detected(press);
+
+    // The protocol starts with Size V / 4e
+    EXPECT_EQ(std::get<1>(result), MeteoroidSizeID::V);
+    EXPECT_NEAR(engine.m_goldmann_sheet.normalized_angle(1, meridian, MeteoroidSizeID::V, "4e"_stim),
+                seen_eccentricity, 1e-4);
+}
+
+TEST(MeridianTrajectory, InterpolatesBetweenSamples) {
+    // Same shape as the real path: a quarter circle on a 50 m sphere
+    auto circle = [](double theta_regler) {
+        double theta = theta_regler * M_PI / 2.0;
+        PolarPoint p{static_cast<float>(theta_regler * 90.0), 0.0f};
+        return std::make_pair(glm::vec3(50.0 * std::sin(theta), 0.0f, -50.0 * std::cos(theta)), p);
+    };
+    MeridianTrajectory trajectory(30, circle);
+    ASSERT_EQ(trajectory.samples().size(), static_cast<size_t>(MeridianTrajectory::SAMPLE_COUNT));
+
+    for (double radius : {0.0, 12.34, 45.05, 89.99, 90.0}) {
+        auto exact = circle(radius / 90.0);
+        MeridianTrajectory::Sample sample = trajectory.at(radius);
+        EXPECT_LT(glm::length(sample.position - exact.first), 1e-3f);
+        EXPECT_NEAR(sample.p.theta, exact.second.theta, 1e-3);
+    }
+}
+
+TEST(PerimetryEngine, OneTrajectoryPerMeridian) {
+    PerimetryEngine engine;
+    EXPECT_EQ(engine.trajectories().tables().size(), METEOROID_LONGITUDES_DEG.size());
+    for (auto& vec : METEOROID_LONGITUDES_DEG) {
+        EXPECT_NE(engine.trajectories().find(vec.angle_deg), nullptr);
+    }
+    EXPECT_EQ(engine.trajectories().find(17), nullptr);
+}
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+
+#include "GazeRecorder.h"
+#include "JournalWriter.h"
+#include "RecordSchema.h"
+#include "SheetExport.h"
+#include "TestUtil.h"
+
+// Counts every allocation of the test binary
+namespace {
+std::atomic<std::size_t> g_allocations{0};
+}
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+JournalRecord make_record() {
+    JournalRecord record;
+    record.eye = 1;
+    record.longitude = 30;
+    record.size = MeteoroidSizeID::I;
+    record.luminance = "3e"_stim;
+    record.p.phi = 12.5f;
+    record.p.theta = 40.25f;
+    return record;
+}
+
+GoldmannSheet make_sheet() {
+    GoldmannSheet sheet = planned_sheet(1);
+    for (const PerimetryVector& vector : METEOROID_LONGITUDES_DEG) {
+        int longitude = vector.angle_deg;
+        sheet.add_point({30.9358f, static_cast<float>(longitude)}, MeteoroidSizeID::I, longitude, 1, "2e"_stim);
+        sheet.add_point({-4.5e-05f, static_cast<float>(longitude)}, MeteoroidSizeID::V, longitude, 1, "4e"_stim);
+    }
+    return sheet;
+}
+}
+
+TEST(RecordSchema, CsvMatchesTheExistingFiles) {
+    EXPECT_EQ(csv_header<JournalRecord>(), "Longitude,SizeIndex,Luminance,Points[(PHI|THETA)]\n");
+    EXPECT_EQ(csv_header<SheetRow>(), "Longitude,SizeIndex,Intensity,Points[(PHI,THETA)],NormedValue\n");
+    EXPECT_EQ(JournalWriter::HEADER, csv_header<JournalRecord>());
+
+    FormatBuffer out(128);
+    ASSERT_TRUE(write_csv_record(out, make_record()));
+    EXPECT_EQ(out.str(), "30,Size_I,3e,[(12.5|40.25);]\n");
+
+    PolarPoint points[2];
+    points[0].phi = 1e-7f;
+    points[0].theta = -0.5f;
+    points[1].phi = 123456789.0f;
+    points[1].theta = 0.0f;
+    SheetRow row;
+    row.longitude = 345;
+    row.size = MeteoroidSizeID::III;
+    row.luminance = "1a"_stim;
+    row.points = {points, points + 2};
+    row.normalized_angle = 61.5f;
+    out.clear();
+    ASSERT_TRUE(write_csv_record(out, row));
+    // %g, as the iostreams wrote it
+    EXPECT_EQ(out.str(), "345,Size_III,1a,[(1e-07|-0.5);(1.23457e+08|0);],61.5\n");
+}
+
+TEST(RecordSchema, FormattingASheetDoesNotAllocate) {
+    GoldmannSheet sheet = make_sheet();
+    FormatBuffer out(sheet_csv_capacity(sheet, 1));
+
+    std::size_t before = g_allocations.load();
+    ASSERT_TRUE(write_sheet_csv(sheet, 1, out));
+    EXPECT_EQ(g_allocations.load(), before);
+    EXPECT_EQ(out.str(), format_sheet_csv(sheet, 1));
+    EXPECT_NE(out.str().find("0,Size_V,4e,[(0|-4.5e-05);]"), std::string::npos);
+}
+
+TEST(RecordSchema, OverflowRollsBackTheRecord) {
+    FormatBuffer out(40);
+    ASSERT_TRUE(write_csv_record(out, make_record()));
+    std::size_t size = out.size();
+    EXPECT_FALSE(write_csv_record(out, make_record()));
+    EXPECT_TRUE(out.overflowed());
+    EXPECT_EQ(out.size(), size);
+
+    FormatBuffer tiny(8);
+    EXPECT_FALSE(write_csv_header<JournalRecord>(tiny));
+    EXPECT_TRUE(tiny.empty());
+}
+
+TEST(RecordSchema, BinaryRecordsArePacked) {
+    FormatBuffer out(64);
+    ASSERT_TRUE(write_binary_record(out, make_record()));
+    // i32 longitude, u8 size, u8 stimulus, f32 phi, f32 theta
+    ASSERT_EQ(out.size(), 4u + 1u + 1u + 4u + 4u);
+    std::int32_t longitude = 0;
+    float theta = 0.0f;
+    std::memcpy(&longitude, out.data(), 4);
+    std::memcpy(&theta, out.data() + 10, 4);
+    EXPECT_EQ(longitude, 30);
+    EXPECT_EQ(static_cast<std::uint8_t>(out.data()[4]), static_cast<std::uint8_t>(MeteoroidSizeID::I));
+    EXPECT_EQ(static_cast<std::uint8_t>(out.data()[5]), "3e"_stim.index);
+    EXPECT_EQ(theta, 40.25f);
+}
+
+TEST(RecordSchema, NestedRecordsAreFlattened) {
+    std::string header = csv_header<GazeSample>();
+    EXPECT_EQ(header.rfind("time_ns,left_valid_mask,left_origin_0,left_origin_1,left_origin_2,", 0), 0u) << header;
+    EXPECT_NE(header.find(",right_pupil_position_1,fixation_angle_deg,"), std::string::npos);
+
+    GazeSample sample;
+    sample.time_ns = 123;
+    sample.right.direction = {0.0f, 0.5f, -1.0f};
+    sample.flags = GazeSample::ON_TARGET | GazeSample::ANGLE_VALID;
+    FormatBuffer out(1024);
+    ASSERT_TRUE(write_csv_record(out, sample));
+    std::string row = out.str();
+    std::size_t columns = 0;
+    for (char c : header) columns += c == ',' ? 1 : 0;
+    std::size_t values = 0;
+    for (char c : row) values += c == ',' ? 1 : 0;
+    EXPECT_EQ(values, columns);
+    EXPECT_NE(row.find(",0,0.5,-1,"), std::string::npos) << row;
+    EXPECT_EQ(row.rfind("123,0,", 0), 0u);
+}
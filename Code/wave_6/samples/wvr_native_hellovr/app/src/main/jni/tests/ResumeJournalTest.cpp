@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <string>
+
+#include "ResumeJournal.h"
+#include "TestUtil.h"
+
+namespace {
+// Two eye exam that journals like MainApplication, with a response every few seconds
+struct JournaledExam {
+    ManualClock clock;
+    PerimetryEngine engine{&clock};
+    ResumeJournal journal{nullptr}; // Writes directly
+    std::size_t vectors_logged = 0;
+    std::function<void()> on_resume_accepted;
+    ExamStateMachine exam{engine, 1, make_hooks()};
+
+    ExamHooks make_hooks() {
+        ExamHooks hooks;
+        hooks.on_eye_started = [this](int eye) {
+            vectors_logged = engine.vector_index();
+            journal.eye_started(eye, engine.order_seed(), vectors_logged);
+        };
+        hooks.on_point_detected = [this](const DetectedPoint& point, EngineClock::time_point) {
+            vectors_logged = engine.vector_index();
+            journal.response(point, engine.detected_eccentricity_deg(), vectors_logged);
+        };
+        hooks.on_eye_finished = [this](int eye) {
+            journal.eye_finished(eye);
+            if (eye != exam.first_eye()) journal.end_session();
+        };
+        hooks.on_resume_choice = [this](bool accepted) {
+            if (accepted && on_resume_accepted) on_resume_accepted();
+        };
+        return hooks;
+    }
+
+    void step(double seconds) {
+        clock.advance_seconds(seconds);
+        exam.update(clock.now());
+        engine.tick(clock.now());
+        if (exam.exam_running() && engine.vector_index() != vectors_logged) {
+            vectors_logged = engine.vector_index();
+            journal.progress(exam.active_eye(), vectors_logged);
+        }
+    }
+
+    // Runs until done(), answering every 23rd frame
+    void run(const std::function<bool()>& done) {
+        for (int i = 0; i < 200000 && !done() && exam.state() != ExamState::EndMenu; i++) {
+            if (i % 23 == 22 && exam.exam_running()) exam.post(ExamEventType::Trigger, clock.now());
+            if (exam.state() == ExamState::EyeMenu) exam.post(ExamEventType::Trigger);
+            step(0.1);
+        }
+    }
+
+    void start(const std::string& path) {
+        journal.begin_session(path, 4, exam.first_eye());
+        exam.post(ExamEventType::Trigger);
+        step(0.1);
+    }
+};
+
+void expect_same_sheet(const GoldmannSheet& a, const GoldmannSheet& b, int eye) {
+    const std::vector<SheetEntry>& ea = a.entries(eye);
+    const std::vector<SheetEntry>& eb = b.entries(eye);
+    ASSERT_EQ(ea.size(), eb.size());
+    for (std::size_t i = 0; i < ea.size(); i++) {
+        EXPECT_EQ(ea[i].point_count, eb[i].point_count) << "entry " << i;
+        EXPECT_FLOAT_EQ(ea[i].normalized_angle, eb[i].normalized_angle) << "entry " << i;
+        for (std::size_t p = 0; p < ea[i].point_count; p++) {
+            EXPECT_EQ(a.points(eye, i).first[p].phi, b.points(eye, i).first[p].phi);
+            EXPECT_EQ(a.points(eye, i).first[p].theta, b.points(eye, i).first[p].theta);
+        }
+    }
+}
+}
+
+TEST(ResumeJournal, ContinuesAnInterruptedEye) {
+    std::string path = temp_path("resume", "first_eye", "wal");
+    JournaledExam before;
+    before.start(path);
+    before.run([&before] { return before.engine.vector_index() >= 40; });
+    ASSERT_EQ(before.exam.state(), ExamState::Testing);
+    ASSERT_FALSE(before.engine.m_goldmann_sheet.get_points().empty());
+
+    // The app is killed here, nothing is closed
+    auto start = std::chrono::steady_clock::now();
+    ResumeState state = read_resume_journal(path);
+    JournaledExam after;
+    restore_sheets(after.engine.m_goldmann_sheet, state);
+    double replay_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    ASSERT_TRUE(state.resumable);
+    EXPECT_LT(replay_ms, 50.0);
+    EXPECT_EQ(state.patient_index, 4);
+    EXPECT_EQ(state.point.first_eye, 1);
+    EXPECT_EQ(state.point.active_eye, 1);
+    EXPECT_TRUE(state.point.has_order);
+    EXPECT_EQ(state.point.order_seed, before.engine.order_seed());
+    EXPECT_EQ(state.point.next_vector, before.engine.vector_index());
+    expect_same_sheet(after.engine.m_goldmann_sheet, before.engine.m_goldmann_sheet, 1);
+
+    // A/X in the start menu continues, the same vector is next
+    after.exam.offer_resume(state.point);
+    after.journal.continue_session(path);
+    after.exam.post(ExamEventType::PauseButton);
+    after.step(0.1);
+    ASSERT_EQ(after.exam.state(), ExamState::EyeMenu);
+    EXPECT_EQ(after.exam.active_eye(), 1);
+    after.exam.post(ExamEventType::Trigger);
+    after.step(0.1);
+    ASSERT_EQ(after.exam.state(), ExamState::Testing);
+    ASSERT_NE(after.engine.current_vector(), nullptr);
+    EXPECT_EQ(after.engine.vector_index(), before.engine.vector_index());
+    EXPECT_EQ(after.engine.current_vector()->angle_deg, before.engine.current_vector()->angle_deg);
+    EXPECT_EQ(after.engine.current_vector()->size, before.engine.current_vector()->size);
+    EXPECT_EQ(after.engine.current_vector()->luminance.index, before.engine.current_vector()->luminance.index);
+
+    // The continued exam ends normally and closes the journal
+    after.run([] { return false; });
+    EXPECT_EQ(after.exam.state(), ExamState::EndMenu);
+    EXPECT_FALSE(read_resume_journal(path).resumable);
+    std::remove(path.c_str());
+}
+
+TEST(ResumeJournal, SecondEyeStartsOverAfterTheFirstWasSaved) {
+    std::string path = temp_path("resume", "second_eye", "wal");
+    JournaledExam before;
+    before.start(path);
+    before.run([&before] { return before.exam.active_eye() == 2 && before.engine.vector_index() >= 5; });
+    ASSERT_EQ(before.exam.active_eye(), 2);
+
+    ResumeState state = read_resume_journal(path);
+    ASSERT_TRUE(state.resumable);
+    EXPECT_TRUE(state.first_eye_finished);
+    EXPECT_EQ(state.point.active_eye, 2);
+    EXPECT_EQ(state.point.next_vector, before.engine.vector_index());
+
+    JournaledExam after;
+    restore_sheets(after.engine.m_goldmann_sheet, state);
+    expect_same_sheet(after.engine.m_goldmann_sheet, before.engine.m_goldmann_sheet, 1);
+    expect_same_sheet(after.engine.m_goldmann_sheet, before.engine.m_goldmann_sheet, 2);
+    std::remove(path.c_str());
+}
+
+TEST(ResumeJournal, TornAndFinishedJournals) {
+    std::string path = temp_path("resume", "torn", "wal");
+    JournaledExam exam;
+    exam.start(path);
+    exam.run([&exam] { return exam.engine.vector_index() >= 10; });
+    ResumeState intact = read_resume_journal(path);
+    ASSERT_TRUE(intact.resumable);
+
+    // Half a record at the end (the crash hit the write) is ignored
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        out.write("\x04\x01\x02\x03\x04\x05\x06", 7);
+    }
+    ResumeState torn = read_resume_journal(path);
+    EXPECT_TRUE(torn.resumable);
+    EXPECT_EQ(torn.records, intact.records);
+
+    // A damaged record ends the replay, later records are not trusted
+    std::vector<std::uint8_t> image(intact.records * resume_file::RECORD_BYTES);
+    {
+        std::ifstream in(path, std::ios::binary);
+        in.read(reinterpret_cast<char*>(image.data()), static_cast<std::streamsize>(image.size()));
+    }
+    image[(intact.records - 1) * resume_file::RECORD_BYTES + 16] ^= 0x40;
+    EXPECT_EQ(replay_resume_journal(image.data(), image.size()).records, intact.records - 1);
+
+    // Declining the offer starts a fresh exam
+    JournaledExam fresh;
+    fresh.exam.offer_resume(intact.point);
+    fresh.exam.post(ExamEventType::Trigger);
+    fresh.step(0.1);
+    EXPECT_EQ(fresh.exam.state(), ExamState::EyeMenu);
+    EXPECT_FALSE(fresh.exam.resume_offered());
+    fresh.exam.post(ExamEventType::Trigger);
+    fresh.step(0.1);
+    EXPECT_EQ(fresh.engine.vector_index(), 0u);
+
+    EXPECT_FALSE(read_resume_journal(temp_path("resume", "does_not_exist", "wal")).resumable);
+    std::remove(path.c_str());
+}
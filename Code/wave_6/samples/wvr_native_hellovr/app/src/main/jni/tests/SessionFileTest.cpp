@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "ExamStateMachine.h"
+#include "FileUtil.h"
+#include "SessionRecorder.h"
+#include "SheetExport.h"
+#include "TestUtil.h"
+
+namespace {
+// Two eye exam wired like MainApplication, with a response every few seconds
+struct RecordedExam {
+    ManualClock clock;
+    PerimetryEngine engine{&clock};
+    SessionRecorder recorder;
+    std::vector<std::string> final_csv = std::vector<std::string>(3);
+    ExamStateMachine exam{engine, 1, make_hooks()};
+
+    ExamHooks make_hooks() {
+        ExamHooks hooks;
+        hooks.on_eye_finished = [this](int eye) {
+            final_csv[eye] = format_sheet_csv(engine.m_goldmann_sheet, eye);
+            recorder.on_eye_finished(engine.m_goldmann_sheet, eye);
+        };
+        hooks.on_point_detected = [this](const DetectedPoint& point, EngineClock::time_point time) {
+            recorder.on_response(point, time);
+        };
+        hooks.on_pause_changed = [this](bool paused, ExamState state, EngineClock::time_point time) {
+            if (paused) {
+                recorder.on_pause(time, state == ExamState::FixationLost ? SessionPauseReason::FixationLost
+                                                                        : SessionPauseReason::PauseMenu);
+            } else {
+                recorder.on_resume(time);
+            }
+        };
+        return hooks;
+    }
+
+    void step(double seconds) {
+        clock.advance_seconds(seconds);
+        exam.update(clock.now());
+        engine.tick(clock.now());
+        recorder.on_frame(engine, clock.now());
+        recorder.on_gaze(clock.now(), exam.state() != ExamState::FixationLost, 1.5f);
+    }
+
+    std::shared_ptr<const SessionData> run() {
+        recorder.begin(clock.now(), 1700000000000, 3, 1);
+        exam.post(ExamEventType::Trigger);
+        exam.post(ExamEventType::Trigger);
+        step(0.1);
+        exam.post(ExamEventType::GazeLost);
+        step(0.5);
+        exam.post(ExamEventType::GazeOnTarget);
+        for (int i = 0; i < 200000 && exam.state() != ExamState::EndMenu; i++) {
+            if (i % 23 == 22 && exam.exam_running()) exam.post(ExamEventType::Trigger, clock.now());
+            if (exam.state() == ExamState::EyeMenu) exam.post(ExamEventType::Trigger);
+            step(0.1);
+        }
+        return recorder.take();
+    }
+};
+}
+
+TEST(SessionFile, RoundTripThroughTheMappedFile) {
+    RecordedExam exam;
+    std::shared_ptr<const SessionData> data = exam.run();
+    ASSERT_TRUE(data);
+    ASSERT_FALSE(exam.recorder.active());
+    ASSERT_FALSE(data->responses.time_ns.empty());
+    ASSERT_EQ(data->pauses.reason.size(), 1u);
+
+    std::string path = temp_path("session", "roundtrip", "pses");
+    ASSERT_TRUE(write_file_atomic(path, serialize_session(*data)));
+
+    SessionFileView file;
+    ASSERT_TRUE(file.open(path)) << file.error();
+    EXPECT_EQ(file.header().version, session_file::VERSION);
+    EXPECT_EQ(file.header().patient_index, 3u);
+    EXPECT_EQ(file.header().first_eye, 1u);
+    EXPECT_EQ(file.header().created_unix_ms, 1700000000000);
+
+    auto stimulus_time = file.column<std::int64_t>(SessionColumn::StimulusTime);
+    auto stimulus_eye = file.column<std::uint8_t>(SessionColumn::StimulusEye);
+    ASSERT_EQ(stimulus_time.size(), data->stimuli.time_ns.size());
+    EXPECT_EQ(stimulus_time.size(), 2 * exam.engine.vector_count());
+    EXPECT_EQ(stimulus_eye[0], 1);
+    EXPECT_EQ(stimulus_eye[stimulus_eye.size() - 1], 2);
+    for (std::size_t i = 1; i < stimulus_time.size(); i++) EXPECT_GT(stimulus_time[i], stimulus_time[i - 1]);
+
+    auto phi = file.column<float>(SessionColumn::ResponsePhi);
+    ASSERT_EQ(phi.size(), data->responses.phi.size());
+    for (std::size_t i = 0; i < phi.size(); i++) EXPECT_EQ(phi[i], data->responses.phi[i]);
+
+    auto pause_start = file.column<std::int64_t>(SessionColumn::PauseStart);
+    auto pause_end = file.column<std::int64_t>(SessionColumn::PauseEnd);
+    ASSERT_EQ(pause_start.size(), 1u);
+    EXPECT_NEAR((pause_end[0] - pause_start[0]) * 1e-9, 0.1, 1e-6); // Lost at 0.6 s, back at 0.7 s
+    EXPECT_EQ(file.column<std::uint8_t>(SessionColumn::PauseReason)[0],
+              static_cast<std::uint8_t>(SessionPauseReason::FixationLost));
+    EXPECT_EQ(file.column<float>(SessionColumn::GazeAngle).size(), data->gaze.angle_deg.size());
+
+    // Wrong width or unknown column: empty view
+    EXPECT_TRUE(file.column<std::int32_t>(SessionColumn::StimulusTime).empty());
+    EXPECT_TRUE(file.column<std::uint8_t>(static_cast<SessionColumn>(0x7f00)).empty());
+
+    // The converter reproduces the CSV written at the end of each eye
+    for (int eye = 1; eye <= 2; eye++) {
+        EXPECT_EQ(session_to_legacy_csv(file, eye), exam.final_csv[eye]) << "eye " << eye;
+    }
+
+    file.close();
+    std::remove(path.c_str());
+}
+
+TEST(SessionFile, RejectsDamagedFiles) {
+    SessionData data;
+    data.responses.time_ns = {1, 2, 3};
+    data.responses.eye = {1, 1, 2};
+    std::string image = serialize_session(data);
+    std::vector<std::uint64_t> storage((image.size() + 7) / 8); // 8-byte aligned copy
+
+    auto check = [&storage](const std::string& bytes) {
+        std::memcpy(storage.data(), bytes.data(), bytes.size());
+        SessionFileView view;
+        bool ok = view.open_memory(storage.data(), bytes.size());
+        return std::make_pair(ok, view.error());
+    };
+    EXPECT_TRUE(check(image).first);
+
+    std::string bad_magic = image;
+    bad_magic[0] = 'X';
+    EXPECT_FALSE(check(bad_magic).first);
+
+    std::string future = image;
+    future[4] = static_cast<char>(session_file::VERSION + 1);
+    EXPECT_FALSE(check(future).first);
+
+    // Cut off the end, the trailing columns point past it
+    std::string truncated = image.substr(0, image.size() - 8);
+    auto result = check(truncated);
+    EXPECT_FALSE(result.first);
+    EXPECT_NE(result.second.find("out of bounds"), std::string::npos);
+
+    SessionFileView missing;
+    EXPECT_FALSE(missing.open(temp_path("session", "does_not_exist", "pses")));
+    EXPECT_FALSE(missing.error().empty());
+}
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+
+#include "SessionSimulator.h"
+
+TEST(ManualClock, OnlyMovesWhenAdvanced) {
+    ManualClock clock;
+    EngineClock::time_point start = clock.now();
+    EXPECT_EQ(clock.now(), start);
+    clock.advance_seconds(1.5);
+    EXPECT_DOUBLE_EQ(clock.elapsed_seconds(), 1.5);
+}
+
+TEST(PerimetryEngine, FirstFrameDoesNotJump) {
+    ManualClock clock;
+    clock.advance_seconds(1000.0);
+    PerimetryEngine engine(&clock);
+    engine.mActiveEye = 1;
+    engine.start_animation();
+    EXPECT_TRUE(engine.tick().stimulus.is_visible);
+    EXPECT_DOUBLE_EQ(engine.current_eccentricity_deg(), 90.0);
+
+    clock.advance_seconds(0.05);
+    EXPECT_TRUE(engine.tick().stimulus.is_visible);
+    EXPECT_LT(engine.current_eccentricity_deg(), 90.0);
+}
+
+TEST(SessionSimulator, NormativePatientFinishesBothEyes) {
+    SessionSimulator simulator(SimulatedPatient::normative());
+    SessionReport report = simulator.run({1, 2});
+
+    ASSERT_EQ(report.eyes.size(), 2u);
+    for (const EyeSimulationResult& eye : report.eyes) {
+        EXPECT_TRUE(eye.completed);
+        EXPECT_EQ(eye.detections, eye.vectors);
+        EXPECT_GT(eye.simulated_seconds, 60.0);
+        // One 72 Hz frame per step, whatever the speed of the host
+        EXPECT_NEAR(eye.simulated_seconds, eye.frames / 72.0, 1e-3);
+    }
+    EXPECT_DOUBLE_EQ(report.simulated_seconds, report.eyes[0].simulated_seconds + report.eyes[1].simulated_seconds);
+    EXPECT_NEAR(simulator.clock().elapsed_seconds(), report.simulated_seconds, 1e-6);
+    size_t per_eye = static_cast<size_t>(report.eyes[0].vectors);
+    EXPECT_EQ(simulator.engine().m_goldmann_sheet.get_points().size(), 2 * per_eye);
+}
+
+TEST(SessionSimulator, BlindPatientRunsEveryVectorToTheCenter) {
+    SimulatedPatient blind;
+    blind.isopter_deg = [](int, const PerimetryVector&) { return 0.0; };
+    SessionSimulator simulator(blind);
+    SessionReport report = simulator.run({1});
+
+    ASSERT_EQ(report.eyes.size(), 1u);
+    EXPECT_TRUE(report.eyes[0].completed);
+    EXPECT_EQ(report.eyes[0].detections, 0);
+    EXPECT_TRUE(simulator.engine().m_goldmann_sheet.get_points().empty());
+}
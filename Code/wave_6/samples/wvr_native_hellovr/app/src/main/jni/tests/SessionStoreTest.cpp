@@ -0,0 +1,279 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "FileUtil.h"
+#include "SessionStore.h"
+#include "SheetExport.h"
+#include "TestUtil.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+// One planned entry per meridian for I2e and V4e, points at radius r
+MeasurementTable make_table(float r) {
+    MeasurementTable table;
+    table.point_begin.push_back(0);
+    for (int meridian = 0; meridian < 360; meridian += 30) {
+        for (StimulusCode stimulus : {"2e"_stim, "4e"_stim}) {
+            bool small = stimulus == "2e"_stim;
+            table.longitude.push_back(static_cast<std::int16_t>(meridian));
+            table.size.push_back(static_cast<std::uint8_t>(small ? MeteoroidSizeID::I : MeteoroidSizeID::V));
+            table.luminance.push_back(stimulus.index);
+            table.normed_value.push_back(r);
+            if (meridian != 90) { // Not seen at 90
+                table.phi.push_back(r);
+                table.theta.push_back(static_cast<float>(meridian));
+            }
+            table.point_begin.push_back(static_cast<std::uint32_t>(table.phi.size()));
+        }
+    }
+    return table;
+}
+
+StoreQuery i2e_at(int meridian) {
+    StoreQuery query;
+    query.size = MeteoroidSizeID::I;
+    query.luminance = "2e"_stim.index;
+    query.meridian = meridian;
+    return query;
+}
+}
+
+TEST(SessionStore, QueriesByStimulusMeridianAndAge) {
+    std::string dir = temp_dir("store", "query");
+    SessionStore store;
+    ASSERT_TRUE(store.open(dir)) << store.error();
+    for (std::uint32_t subject = 1; subject <= 20; subject++) {
+        for (int eye = 1; eye <= 2; eye++) {
+            StoredSessionInfo info;
+            info.subject = subject;
+            info.eye = eye;
+            info.date = 20260100 + subject;
+            ASSERT_EQ(store.append(info, make_table(static_cast<float>(subject * 10 + eye))),
+                      StoreAppendResult::Stored);
+        }
+        ASSERT_TRUE(store.set_subject_age(subject, 20 + 3 * static_cast<int>(subject)));
+    }
+    EXPECT_EQ(store.session_count(), 40u);
+
+    // Subjects 11..20 are over 50
+    StoreQuery query = i2e_at(210);
+    query.min_age = 51;
+    std::vector<StoredPoint> points;
+    EXPECT_EQ(store.query(query, points), 20u);
+    ASSERT_EQ(points.size(), 20u);
+    for (const StoredPoint& p : points) {
+        EXPECT_GT(p.subject, 10u);
+        EXPECT_EQ(p.meridian, 210);
+        EXPECT_EQ(p.size, MeteoroidSizeID::I);
+        EXPECT_EQ(p.luminance, "2e"_stim);
+        EXPECT_FLOAT_EQ(p.phi, static_cast<float>(p.subject * 10 + p.eye));
+        EXPECT_FLOAT_EQ(p.theta, 210.0f);
+    }
+    // Only the points of the matching rows were read
+    EXPECT_EQ(store.point_bytes_read(), 20u * 2 * sizeof(float));
+
+    // Rows without points match, but add nothing
+    points.clear();
+    EXPECT_EQ(store.query(i2e_at(90), points), 40u);
+    EXPECT_TRUE(points.empty());
+
+    StoreQuery left_of_3;
+    left_of_3.subject = 3;
+    left_of_3.eye = 2;
+    left_of_3.date_from = 20260103;
+    left_of_3.date_to = 20260103;
+    points.clear();
+    EXPECT_EQ(store.query(left_of_3, points), 24u);
+    EXPECT_EQ(points.size(), 22u);
+}
+
+TEST(SessionStore, DeduplicatesAndSurvivesReopen) {
+    std::string dir = temp_dir("store", "reopen");
+    {
+        SessionStore store;
+        ASSERT_TRUE(store.open(dir));
+        StoredSessionInfo info;
+        info.subject = 7;
+        info.eye = 1;
+        EXPECT_EQ(store.append(info, make_table(30.0f)), StoreAppendResult::Stored);
+        EXPECT_EQ(store.append(info, make_table(30.0f)), StoreAppendResult::Duplicate);
+        info.eye = 2;
+        EXPECT_EQ(store.append(info, make_table(30.0f)), StoreAppendResult::Stored);
+        ASSERT_TRUE(store.set_subject_age(7, 64));
+    }
+
+    // From the saved index
+    SessionStore store;
+    ASSERT_TRUE(store.open(dir)) << store.error();
+    EXPECT_EQ(store.session_count(), 2u);
+    EXPECT_EQ(store.subject_age(7), 64);
+    StoredSessionInfo info;
+    info.subject = 7;
+    info.eye = 2;
+    EXPECT_EQ(store.append(info, make_table(30.0f)), StoreAppendResult::Duplicate);
+    info.subject = 8;
+    EXPECT_EQ(store.append(info, make_table(30.0f)), StoreAppendResult::Stored);
+    std::vector<StoredPoint> points;
+    EXPECT_EQ(store.query(i2e_at(0), points), 3u);
+    store.close();
+
+    // Without the index (and a torn record at the end), rebuilt from the data
+    std::remove((dir + "/" + session_store::INDEX_FILE).c_str());
+    {
+        FILE* f = std::fopen((dir + "/" + session_store::DATA_FILE).c_str(), "ab");
+        ASSERT_TRUE(f);
+        std::fwrite("\x01garbage", 1, 8, f);
+        std::fclose(f);
+    }
+    std::uintmax_t torn_size = fs::file_size(dir + "/" + session_store::DATA_FILE);
+    ASSERT_TRUE(store.open(dir)) << store.error();
+    EXPECT_EQ(store.session_count(), 3u);
+    EXPECT_EQ(store.subject_age(7), 64);
+    EXPECT_EQ(fs::file_size(dir + "/" + session_store::DATA_FILE), torn_size - 8);
+    points.clear();
+    StoreQuery query = i2e_at(0);
+    query.min_age = 60;
+    EXPECT_EQ(store.query(query, points), 2u);
+}
+
+TEST(SessionStore, SkipsABrokenRecordInTheMiddle) {
+    std::string dir = temp_dir("store", "broken");
+    std::string data_path = dir + "/" + session_store::DATA_FILE;
+    std::uintmax_t second_record = 0;
+    {
+        SessionStore store;
+        ASSERT_TRUE(store.open(dir));
+        StoredSessionInfo info;
+        info.eye = 1;
+        for (std::uint32_t subject = 1; subject <= 3; subject++) {
+            if (subject == 2) second_record = fs::file_size(data_path);
+            info.subject = subject;
+            ASSERT_EQ(store.append(info, make_table(30.0f)), StoreAppendResult::Stored);
+        }
+        ASSERT_TRUE(store.set_subject_age(3, 50));
+    }
+    std::uintmax_t size = fs::file_size(data_path);
+
+    // One flipped bit in the points of subject 2, rescanned without the index
+    std::remove((dir + "/" + session_store::INDEX_FILE).c_str());
+    {
+        FILE* f = std::fopen(data_path.c_str(), "r+b");
+        ASSERT_TRUE(f);
+        std::uintmax_t at = second_record + sizeof(StoreRecordHeader) + sizeof(StoredSessionHeader) + 1;
+        ASSERT_EQ(std::fseek(f, static_cast<long>(at), SEEK_SET), 0);
+        int byte = std::fgetc(f);
+        ASSERT_EQ(std::fseek(f, static_cast<long>(at), SEEK_SET), 0);
+        std::fputc(byte ^ 0x10, f);
+        std::fclose(f);
+    }
+    SessionStore store;
+    ASSERT_TRUE(store.open(dir)) << store.error();
+    EXPECT_EQ(store.broken_records(), 1u);
+    EXPECT_EQ(fs::file_size(data_path), size);
+    EXPECT_EQ(store.session_count(), 2u);
+    EXPECT_EQ(store.subject_age(3), 50);
+    std::vector<StoredPoint> points;
+    EXPECT_EQ(store.query(i2e_at(0), points), 2u);
+    ASSERT_EQ(points.size(), 2u);
+    EXPECT_EQ(points[0].subject, 1u);
+    EXPECT_EQ(points[1].subject, 3u);
+
+    // The lost eye can be stored again
+    StoredSessionInfo info;
+    info.subject = 2;
+    info.eye = 1;
+    EXPECT_EQ(store.append(info, make_table(30.0f)), StoreAppendResult::Stored);
+}
+
+TEST(SessionStore, KeepsTheRecordsBehindABrokenLength) {
+    std::string dir = temp_dir("store", "length");
+    std::string data_path = dir + "/" + session_store::DATA_FILE;
+    std::uintmax_t second_record = 0;
+    {
+        SessionStore store;
+        ASSERT_TRUE(store.open(dir));
+        StoredSessionInfo info;
+        info.eye = 1;
+        for (std::uint32_t subject = 1; subject <= 3; subject++) {
+            if (subject == 2) second_record = fs::file_size(data_path);
+            info.subject = subject;
+            ASSERT_EQ(store.append(info, make_table(30.0f)), StoreAppendResult::Stored);
+        }
+    }
+    std::uintmax_t size = fs::file_size(data_path);
+    std::remove((dir + "/" + session_store::INDEX_FILE).c_str());
+
+    // The length of subject 2 runs past the end, subject 3 is behind it
+    std::string data = read_file(data_path);
+    StoreRecordHeader header;
+    std::memcpy(&header, data.data() + second_record, sizeof(header));
+    header.payload_bytes = static_cast<std::uint32_t>(size);
+    std::memcpy(&data[second_record], &header, sizeof(header));
+    ASSERT_TRUE(write_file_atomic(data_path, data));
+    SessionStore store;
+    EXPECT_FALSE(store.open(dir));
+    EXPECT_NE(store.error().find(std::to_string(second_record)), std::string::npos) << store.error();
+    EXPECT_EQ(fs::file_size(data_path), size);
+
+    // A record cut off within its payload is the torn tail
+    data.resize(second_record + sizeof(header) + 10);
+    ASSERT_TRUE(write_file_atomic(data_path, data));
+    ASSERT_TRUE(store.open(dir)) << store.error();
+    EXPECT_EQ(store.session_count(), 1u);
+    EXPECT_EQ(fs::file_size(data_path), second_record);
+}
+
+TEST(SessionStore, ImportsAMeasurementsTree) {
+    std::string root = temp_dir("store", "tree");
+    std::string dir = temp_dir("store", "imported");
+    fs::create_directories(root + "/Subject1");
+    fs::create_directories(root + "/Subject12");
+
+    GoldmannSheet sheet;
+    sheet.setup_sheet(METEOROID_LONGITUDES_DEG, LUMINANCE_TO_USE, 1);
+    sheet.setup_sheet(METEOROID_LONGITUDES_DEG, LUMINANCE_TO_USE, 2);
+    sheet.add_point({0.0f, 30.0f}, MeteoroidSizeID::I, 0, 1, "2e"_stim);
+    sheet.add_point({-20.0f, 0.0f}, MeteoroidSizeID::I, 90, 2, "2e"_stim);
+    std::string right = format_sheet_csv(sheet, 1);
+    ASSERT_TRUE(write_file_atomic(root + "/Subject1/final_Right_perimetry_2026-01-30_13-54-23.csv", right));
+    ASSERT_TRUE(write_file_atomic(root + "/Subject1/Right.csv", right));
+    ASSERT_TRUE(write_file_atomic(root + "/Subject12/Left_perimetry_2026-02-01_09-00-00.csv",
+                                  format_sheet_csv(sheet, 2)));
+    ASSERT_TRUE(write_file_atomic(root + "/normal_values_group_old.csv", "Meridian_Deg,V4e\n0,90\n"));
+    ASSERT_TRUE(write_file_atomic(root + "/subjects.csv", "Subject,Age\nSubject1,34\n12,71\n"));
+
+    SessionStore store;
+    ASSERT_TRUE(store.open(dir));
+    StoreImportStats stats;
+    std::string error;
+    ASSERT_TRUE(import_measurement_tree(store, root, &stats, &error)) << error;
+    EXPECT_EQ(stats.stored, 2u);
+    EXPECT_EQ(stats.duplicates, 1u);        // Right.csv is the final file
+    EXPECT_EQ(stats.skipped, 2u);           // normal values and subjects.csv
+    EXPECT_EQ(store.subject_age(12), 71);
+
+    std::vector<StoredPoint> points;
+    StoreQuery query = i2e_at(0);
+    ASSERT_EQ(store.query(query, points), 2u); // Planned for both eyes, seen by the right one
+    ASSERT_EQ(points.size(), 1u);
+    EXPECT_EQ(points[0].subject, 1u);
+    EXPECT_EQ(points[0].eye, 1);
+    EXPECT_EQ(points[0].date, 20260130u);
+    EXPECT_EQ(points[0].time, 135423u);
+    EXPECT_FLOAT_EQ(points[0].theta, 0.0f);
+    EXPECT_FLOAT_EQ(points[0].phi, 30.0f);
+
+    points.clear();
+    query = i2e_at(90);
+    query.min_age = 70;
+    ASSERT_EQ(store.query(query, points), 1u);
+    ASSERT_EQ(points.size(), 1u);
+    EXPECT_EQ(points[0].subject, 12u);
+    EXPECT_FLOAT_EQ(points[0].theta, -20.0f);
+}
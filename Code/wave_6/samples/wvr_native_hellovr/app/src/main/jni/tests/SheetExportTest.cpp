@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "FileUtil.h"
+#include "IoWorker.h"
+#include "SheetExport.h"
+#include "TestUtil.h"
+
+namespace {
+GoldmannSheet make_sheet() {
+    GoldmannSheet sheet = planned_sheet(1);
+    sheet.setup_sheet(METEOROID_LONGITUDES_DEG, LUMINANCE_TO_USE, 2);
+    return sheet;
+}
+}
+
+TEST(SheetExport, SnapshotIsNotChangedByLaterPoints) {
+    GoldmannSheet sheet = make_sheet();
+    sheet.add_point({45.0f, 10.0f}, MeteoroidSizeID::V, 0, 1, "4e"_stim);
+
+    std::shared_ptr<const GoldmannSheet> snapshot = sheet.snapshot(1);
+    std::string before = format_sheet_csv(*snapshot, 1);
+    sheet.add_point({50.0f, 20.0f}, MeteoroidSizeID::V, 0, 1, "4e"_stim);
+
+    EXPECT_EQ(format_sheet_csv(*snapshot, 1), before);
+    EXPECT_NE(format_sheet_csv(sheet, 1), before);
+    EXPECT_NE(before.find("0,Size_V,4e,[(10|45);],"), std::string::npos);
+    EXPECT_TRUE(snapshot->entries(2).empty()); // Only the requested eye is copied
+    EXPECT_EQ(snapshot->get_points().size(), 1u);
+    EXPECT_EQ(snapshot->get_sizes().size(), 1u);
+}
+
+TEST(SheetExport, CsvHasOneLinePerPlannedEntry) {
+    GoldmannSheet sheet = make_sheet();
+    std::string csv = format_sheet_csv(sheet, 2);
+
+    int planned = 0;
+    for (const SheetEntry& entry : sheet.entries(2)) planned += entry.in_use ? 1 : 0;
+    int lines = 0;
+    for (char c : csv) lines += c == '\n' ? 1 : 0;
+    EXPECT_EQ(lines, planned + 1);
+    EXPECT_EQ(csv.rfind("Longitude,SizeIndex,Intensity,Points[(PHI,THETA)],NormedValue\n", 0), 0u);
+}
+
+TEST(SheetExport, AtomicWriteReplacesTheWholeFile) {
+    std::string path = ::testing::TempDir() + "sheet_export_" + std::to_string(::getpid()) + ".csv";
+    ASSERT_TRUE(write_file_atomic(path, "first version, longer\n"));
+    ASSERT_TRUE(write_file_atomic(path, "second\n"));
+    EXPECT_EQ(read_file(path), "second\n");
+    EXPECT_FALSE(std::ifstream(path + ".tmp").good());
+    std::remove(path.c_str());
+
+    EXPECT_FALSE(write_file_atomic("/nonexistent_dir/sheet.csv", "x"));
+}
+
+TEST(IoWorker, RunsJobsInOrderAndDrains) {
+    std::vector<int> order;
+    {
+        IoWorker worker;
+        for (int i = 0; i < 20; i++) worker.post([&order, i] { order.push_back(i); });
+        worker.drain();
+        EXPECT_EQ(order.size(), 20u);
+        EXPECT_EQ(worker.pending(), 0u);
+
+        worker.post([&order] { order.push_back(20); }); // Run by the destructor at the latest
+    }
+    ASSERT_EQ(order.size(), 21u);
+    for (int i = 0; i <= 20; i++) EXPECT_EQ(order[i], i);
+}
@@ -0,0 +1,294 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "FileUtil.h"
+#include "SheetExport.h"
+#include "StudyStatistics.h"
+#include "TestUtil.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+// Deterministic values in [-1, 1)
+std::vector<double> noise(std::size_t n, std::uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<double> out(n);
+    for (double& value : out) value = static_cast<double>(rng()) / 2147483648.0 - 1.0;
+    return out;
+}
+
+// ICC(A,1) written out as in McGraw & Wong, table 4
+double reference_icc(const std::vector<double>& a, const std::vector<double>& b) {
+    double n = static_cast<double>(a.size());
+    double grand = 0.0;
+    for (std::size_t i = 0; i < a.size(); i++) grand += (a[i] + b[i]) / (2.0 * n);
+    double mean_a = 0.0;
+    double mean_b = 0.0;
+    for (std::size_t i = 0; i < a.size(); i++) {
+        mean_a += a[i] / n;
+        mean_b += b[i] / n;
+    }
+    double rows = 0.0;
+    double error = 0.0;
+    for (std::size_t i = 0; i < a.size(); i++) {
+        double row = (a[i] + b[i]) / 2.0;
+        rows += 2.0 * (row - grand) * (row - grand);
+        double ea = a[i] - row - mean_a + grand;
+        double eb = b[i] - row - mean_b + grand;
+        error += ea * ea + eb * eb;
+    }
+    double columns = n * ((mean_a - grand) * (mean_a - grand) + (mean_b - grand) * (mean_b - grand));
+    double msr = rows / (n - 1.0);
+    double mse = error / (n - 1.0);
+    return (msr - mse) / (msr + mse + 2.0 / n * (columns - mse));
+}
+
+// Both repeats of every planned entry; repeat 2 lies retest further in
+GoldmannSheet make_sheet(int eye, double radius, double retest, std::uint32_t seed) {
+    std::vector<double> jitter = noise(METEOROID_LONGITUDES_DEG.size() * 8, seed);
+    std::size_t k = 0;
+    double first = 0.0;
+    return planned_sheet(eye, 2, [&](int, StimulusCode luminance, int repeat) {
+        if (repeat == 0) return first = radius - (19 - luminance.index) * 3.0 + jitter[k++];
+        return first - retest + 0.3 * jitter[k++];
+    });
+}
+}
+
+TEST(Statistics, BlandAltmanAndIccMatchTheAnova) {
+    std::vector<double> subjects = noise(50, 1);
+    std::vector<double> a = noise(50, 2);
+    std::vector<double> b = noise(50, 3);
+    for (std::size_t i = 0; i < a.size(); i++) {
+        a[i] = 1000.0 + 100.0 * subjects[i] + 10.0 * a[i];
+        b[i] = 1000.0 + 100.0 * subjects[i] + 10.0 * b[i] - 5.0;
+    }
+    PairMoments moments = pair_moments(a.data(), b.data(), a.size());
+    BlandAltman agreement = bland_altman(moments);
+    double bias = 0.0;
+    for (std::size_t i = 0; i < a.size(); i++) bias += (a[i] - b[i]) / a.size();
+    double variance = 0.0;
+    for (std::size_t i = 0; i < a.size(); i++) variance += (a[i] - b[i] - bias) * (a[i] - b[i] - bias) / 49.0;
+    EXPECT_EQ(agreement.n, 50u);
+    EXPECT_NEAR(agreement.bias, bias, 1e-9);
+    EXPECT_NEAR(agreement.sd, std::sqrt(variance), 1e-6);
+    EXPECT_NEAR(agreement.upper() - agreement.lower(), 2.0 * 1.96 * std::sqrt(variance), 1e-6);
+    double icc = icc_agreement(moments);
+    EXPECT_NEAR(icc, reference_icc(a, b), 1e-9);
+    EXPECT_GT(icc, 0.9);
+    EXPECT_LT(icc, 1.0);
+
+    // Identical repeats agree perfectly; a constant offset costs absolute agreement
+    PairMoments same = pair_moments(a.data(), a.data(), a.size());
+    EXPECT_NEAR(icc_agreement(same), 1.0, 1e-12);
+    EXPECT_NEAR(bland_altman(same).sd, 0.0, 1e-6);
+    std::vector<double> shifted = a;
+    for (double& value : shifted) value += 100.0;
+    EXPECT_LT(icc_agreement(pair_moments(a.data(), shifted.data(), a.size())), 0.9);
+
+    EXPECT_TRUE(std::isnan(icc_agreement(pair_moments(a.data(), b.data(), 1))));
+    EXPECT_TRUE(std::isnan(bland_altman(pair_moments(a.data(), b.data(), 1)).sd));
+}
+
+TEST(Statistics, ResamplesDependOnTheSeedOnly) {
+    std::vector<double> a = noise(200, 4);
+    std::vector<double> b = noise(200, 5);
+    for (std::size_t i = 0; i < a.size(); i++) b[i] = a[i] + 0.1 * b[i];
+    ResampleOptions options;
+    options.resamples = 20000;
+    options.seed = 7;
+    options.threads = 1;
+    std::vector<PairStatistic> statistics = {pair_mean, pair_bias, pair_lower_limit, pair_upper_limit, pair_icc};
+    std::vector<ConfidenceInterval> serial = bootstrap_pairs(a.data(), b.data(), a.size(), statistics, options);
+    options.threads = 4;
+    std::vector<ConfidenceInterval> parallel = bootstrap_pairs(a.data(), b.data(), a.size(), statistics, options);
+    ASSERT_EQ(serial.size(), statistics.size());
+    for (std::size_t s = 0; s < statistics.size(); s++) {
+        EXPECT_EQ(parallel[s].estimate, serial[s].estimate);
+        EXPECT_EQ(parallel[s].lower, serial[s].lower);
+        EXPECT_EQ(parallel[s].upper, serial[s].upper);
+        EXPECT_LT(serial[s].lower, serial[s].estimate) << s;
+        EXPECT_GT(serial[s].upper, serial[s].estimate) << s;
+    }
+    options.seed = 8;
+    EXPECT_NE(bootstrap_pairs(a.data(), b.data(), a.size(), statistics, options)[0].lower, serial[0].lower);
+
+    // The interval of a mean is about 1.96 standard errors wide each way
+    ConfidenceInterval mean = bootstrap_mean(a.data(), a.size(), options);
+    double sd = 0.0;
+    for (double value : a) sd += (value - mean.estimate) * (value - mean.estimate) / (a.size() - 1.0);
+    double standard_error = std::sqrt(sd / a.size());
+    EXPECT_NEAR(mean.upper - mean.lower, 2.0 * 1.96 * standard_error, 0.1 * 2.0 * 1.96 * standard_error);
+
+    ConfidenceInterval empty = bootstrap_mean(a.data(), 0, options);
+    EXPECT_TRUE(std::isnan(empty.estimate));
+}
+
+TEST(Statistics, PermutationTests) {
+    ResampleOptions options;
+    options.resamples = 10000;
+    options.threads = 4;
+
+    // Twelve differences of one sign: only 2 of 4096 sign patterns reach them
+    std::vector<double> a = noise(12, 6);
+    std::vector<double> b = a;
+    for (double& value : b) value -= 1.0;
+    PermutationTest paired = paired_permutation_test(a.data(), b.data(), a.size(), options);
+    EXPECT_EQ(paired.n_a, 12u);
+    EXPECT_NEAR(paired.observed, 1.0, 1e-12);
+    EXPECT_EQ(paired.resamples, 10000u);
+    EXPECT_NEAR(paired.p_value, 2.0 / 4096.0, 0.001);
+    options.threads = 1;
+    EXPECT_EQ(paired_permutation_test(a.data(), b.data(), a.size(), options).p_value, paired.p_value);
+
+    // Equal groups: any relabelling reaches the observed difference of 0
+    PermutationTest equal = group_permutation_test(a.data(), a.size(), a.data(), a.size(), options);
+    EXPECT_NEAR(equal.observed, 0.0, 1e-12);
+    EXPECT_EQ(equal.p_value, 1.0);
+
+    // Separated groups are far apart, overlapping ones are not
+    std::vector<double> c = noise(30, 7);
+    std::vector<double> d = noise(25, 8);
+    PermutationTest overlapping = group_permutation_test(c.data(), c.size(), d.data(), d.size(), options);
+    EXPECT_GT(overlapping.p_value, 0.05);
+    for (double& value : d) value += 1.5;
+    PermutationTest separated = group_permutation_test(c.data(), c.size(), d.data(), d.size(), options);
+    EXPECT_LT(separated.observed, -1.0);
+    EXPECT_EQ(separated.p_value, 1.0 / 10001.0);
+    options.threads = 4;
+    EXPECT_EQ(group_permutation_test(c.data(), c.size(), d.data(), d.size(), options).p_value,
+              separated.p_value);
+}
+
+TEST(StudyStatistics, RepeatsAndEyesOfAStudy) {
+    std::string root = temp_dir("statistics", "study");
+    const int subjects = 40;
+    std::string groups = "Subject,Group\n";
+    for (int subject = 1; subject <= subjects; subject++) {
+        std::string dir = root + "/Subject" + std::to_string(subject);
+        fs::create_directories(dir);
+        // Subjects differ by up to 10, the left eye is 3 smaller, the odd
+        // subjects 5 smaller; the retest is 0.5 further in
+        double radius = 70.0 + (subject % 11) - (subject % 2) * 5.0;
+        ASSERT_TRUE(write_file_atomic(dir + "/final_Right_perimetry.csv",
+                                      format_sheet_csv(make_sheet(1, radius, 0.5, subject), 1)));
+        ASSERT_TRUE(write_file_atomic(dir + "/final_Left_perimetry.csv",
+                                      format_sheet_csv(make_sheet(2, radius - 3.0, 0.5, 100 + subject), 2)));
+        groups += "Subject" + std::to_string(subject) + (subject % 2 ? ",odd\n" : ",even\n");
+    }
+    ASSERT_TRUE(write_file_atomic(root + "/groups.csv", groups));
+
+    std::vector<StudyEyeIsopters> eyes;
+    ASSERT_TRUE(build_study_repeats(root, eyes));
+    ASSERT_EQ(eyes.size(), 2u * subjects);
+    ASSERT_EQ(eyes[0].repeats.size(), 2u);
+    ASSERT_EQ(eyes[0].repeats[1].size(), eyes[0].isopters.size());
+    // The mean of the repeats is what build_study_isopters() fits
+    std::vector<StudyEyeIsopters> merged;
+    ASSERT_TRUE(build_study_isopters(root, merged));
+    EXPECT_TRUE(merged[0].repeats.empty());
+    EXPECT_EQ(merged[0].isopters[0].knot_radius, eyes[0].isopters[0].knot_radius);
+    EXPECT_NEAR(eyes[0].isopters[0].knot_radius[0],
+                (eyes[0].repeats[0][0].knot_radius[0] + eyes[0].repeats[1][0].knot_radius[0]) / 2.0f, 1e-4);
+
+    EXPECT_EQ(field_meridian(1, 30), 30);
+    EXPECT_EQ(field_meridian(2, 30), 150);
+    EXPECT_EQ(field_meridian(2, 270), 270);
+    std::vector<MeridianRepeatability> meridians = meridian_repeatability(eyes);
+    ASSERT_EQ(meridians.size(), eyes[0].isopters.size() * METEOROID_LONGITUDES_DEG.size());
+    for (const MeridianRepeatability& row : meridians) {
+        EXPECT_EQ(row.agreement.n, 2u * subjects);
+        // 0.5 of projected radius is 0.32° of eccentricity or more
+        EXPECT_GT(row.agreement.bias, 0.3);
+        EXPECT_LT(row.agreement.bias, 1.0);
+        EXPECT_GT(row.icc, 0.9);
+    }
+
+    ResampleOptions options;
+    options.resamples = 100000;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<IsopterRepeatability> isopters = isopter_repeatability(eyes, options);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ASSERT_EQ(isopters.size(), eyes[0].isopters.size());
+    for (const IsopterRepeatability& row : isopters) {
+        EXPECT_EQ(row.pairs, 2u * subjects);
+        EXPECT_EQ(row.eyes, 2u * subjects);
+        EXPECT_GT(row.bias.lower, 0.0);
+        EXPECT_LT(row.lower_limit.estimate, row.bias.estimate);
+        EXPECT_GT(row.upper_limit.estimate, row.bias.estimate);
+        EXPECT_GT(row.icc.lower, 0.9);
+        EXPECT_LT(row.mean_area.lower, row.mean_area.estimate);
+        EXPECT_GT(row.mean_area.upper, row.mean_area.estimate);
+    }
+    // Generous for debug builds
+    EXPECT_LT(seconds, 30.0) << seconds << " s";
+
+    options.resamples = 10000;
+    std::vector<AreaComparison> sides = compare_eyes(eyes, options);
+    ASSERT_EQ(sides.size(), eyes[0].isopters.size());
+    for (const AreaComparison& row : sides) {
+        EXPECT_EQ(row.a, "right");
+        EXPECT_EQ(row.test.n_a, static_cast<std::size_t>(subjects));
+        EXPECT_GT(row.mean_a, row.mean_b);
+        EXPECT_NEAR(row.test.observed, row.mean_a - row.mean_b, 1e-6);
+        EXPECT_LT(row.test.p_value, 0.001);
+    }
+
+    std::vector<AreaComparison> between =
+            compare_groups(eyes, read_subject_groups(root + "/groups.csv"), options);
+    ASSERT_EQ(between.size(), eyes[0].isopters.size());
+    for (const AreaComparison& row : between) {
+        EXPECT_EQ(row.a, "even");
+        EXPECT_EQ(row.b, "odd");
+        EXPECT_EQ(row.test.n_a, static_cast<std::size_t>(subjects / 2));
+        EXPECT_GT(row.test.observed, 0.0);
+        EXPECT_LT(row.test.p_value, 0.01);
+    }
+    fs::remove_all(root);
+}
+
+TEST(StudyStatistics, CopiesOfASheetCountOnce) {
+    std::string root = temp_dir("statistics", "copies");
+    const int subjects = 6;
+    for (int subject = 1; subject <= subjects; subject++) {
+        std::string dir = root + "/Subject" + std::to_string(subject);
+        fs::create_directories(dir);
+        double radius = 70.0 + subject;
+        ASSERT_TRUE(write_file_atomic(dir + "/final_Right_perimetry.csv",
+                                      format_sheet_csv(make_sheet(1, radius, 0.5, subject), 1)));
+        ASSERT_TRUE(write_file_atomic(dir + "/final_Left_perimetry.csv",
+                                      format_sheet_csv(make_sheet(2, radius - 3.0, 0.5, 100 + subject), 2)));
+    }
+    ResampleOptions options;
+    options.resamples = 1000;
+    std::vector<StudyEyeIsopters> eyes;
+    ASSERT_TRUE(build_study_repeats(root, eyes));
+    std::vector<IsopterRepeatability> before = isopter_repeatability(eyes, options);
+
+    // The copies the app and the exports leave next to a sheet
+    for (int subject = 1; subject <= subjects; subject++) {
+        std::string dir = root + "/Subject" + std::to_string(subject);
+        fs::copy_file(dir + "/final_Right_perimetry.csv", dir + "/Right.csv");
+        fs::copy_file(dir + "/final_Right_perimetry.csv", dir + "/Right_perimetry_2026-01-29_10-00-00.csv");
+    }
+    StudyIsopterStats stats;
+    ASSERT_TRUE(build_study_repeats(root, eyes, NUMBER_ITERATIONS_PER_SIZE, IsopterOptions(), 0, &stats));
+    EXPECT_EQ(eyes.size(), 2u * subjects);
+    EXPECT_EQ(stats.duplicates, 2u * subjects);
+    std::vector<IsopterRepeatability> after = isopter_repeatability(eyes, options);
+    ASSERT_EQ(after.size(), before.size());
+    for (std::size_t i = 0; i < after.size(); i++) {
+        EXPECT_EQ(after[i].pairs, 2u * subjects);
+        EXPECT_EQ(after[i].eyes, before[i].eyes);
+        // The kept copy may sort elsewhere, the sums differ by rounding only
+        EXPECT_NEAR(after[i].bias.estimate, before[i].bias.estimate, 1e-9 * std::fabs(before[i].bias.estimate));
+        EXPECT_NEAR(after[i].icc.estimate, before[i].icc.estimate, 1e-9);
+    }
+    fs::remove_all(root);
+}
@@ -0,0 +1,69 @@
+// TestUtil.h
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <unistd.h>
+
+#include "GoldmannSheet.h"
+
+// Fixtures shared by the tests. Files go below ::testing::TempDir(), named
+// after the test binary (prefix) and the process, so parallel ctest runs
+// do not collide.
+
+// Empty directory PREFIX_PID_NAME, created anew.
+inline std::string temp_dir(const char* prefix, const char* name) {
+    std::string dir = ::testing::TempDir() + prefix + "_" + std::to_string(::getpid()) + "_" + name;
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    return dir;
+}
+
+// Path PREFIX_PID_NAME.EXTENSION, not created.
+inline std::string temp_path(const char* prefix, const char* name, const char* extension) {
+    return ::testing::TempDir() + prefix + "_" + std::to_string(::getpid()) + "_" + name + "." + extension;
+}
+
+// Whole file, empty if it cannot be read.
+inline std::string read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// Point of a meridian at the given projected radius, (PHI|THETA) as x/y
+inline PolarPoint point_at(int longitude, double radius) {
+    double a = longitude * M_PI / 180.0;
+    return PolarPoint{static_cast<float>(radius * std::sin(a)), static_cast<float>(radius * std::cos(a))};
+}
+
+// Sheet of eye with the entries of the test plan, no points yet.
+inline GoldmannSheet planned_sheet(int eye) {
+    GoldmannSheet sheet;
+    sheet.setup_sheet(METEOROID_LONGITUDES_DEG, LUMINANCE_TO_USE, eye);
+    return sheet;
+}
+
+// Sheet of eye with repeats points on every planned entry, the r-th at
+// radius(longitude, luminance, r) on its meridian. Entries are visited by
+// meridian, then by size and luminance of the plan.
+template <typename Radius>
+GoldmannSheet planned_sheet(int eye, int repeats, Radius radius) {
+    GoldmannSheet sheet = planned_sheet(eye);
+    for (const PerimetryVector& vec : METEOROID_LONGITUDES_DEG) {
+        for (const auto& size : LUMINANCE_TO_USE) {
+            for (StimulusCode luminance : size.second) {
+                for (int repeat = 0; repeat < repeats; repeat++) {
+                    sheet.add_point(point_at(vec.angle_deg, radius(vec.angle_deg, luminance, repeat)), size.first,
+                                    vec.angle_deg, eye, luminance);
+                }
+            }
+        }
+    }
+    return sheet;
+}
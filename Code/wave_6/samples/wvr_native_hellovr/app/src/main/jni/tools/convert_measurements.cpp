@@ -0,0 +1,123 @@
+// convert_measurements.cpp
+//
+// Bulk converts the result CSVs under a Measurements tree into one long
+// table with a row per point, which pandas reads with its C parser and
+// without splitting the [(PHI|THETA);...] column in Python:
+//
+//   convert_measurements ROOT [OUT.csv]
+//
+// Output columns: file,eye,longitude,size,intensity,normed,phi,theta. Rows
+// without points are kept with empty phi/theta; normed is empty for
+// journals. Files with another header (e.g. normal_values_*.csv) are
+// skipped. Without OUT.csv only the statistics are printed, among them the
+// read and parse throughput (files/s, MB/s), the benchmark of the parser.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "FileUtil.h"
+#include "MeasurementCsv.h"
+#include "Settings.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+const char* eye_of(const std::string& name) {
+    if (name.find("Right") != std::string::npos) return "right";
+    if (name.find("Left") != std::string::npos) return "left";
+    return "";
+}
+
+void append_row(std::string& out, const std::string& file, const char* eye, const MeasurementTable& table,
+                std::size_t row, std::size_t point) {
+    char buffer[160];
+    StimulusCode stimulus = table.stimulus(row);
+    float normed = table.normed_value[row];
+    int n = std::snprintf(buffer, sizeof(buffer), ",%s,%d,%s,%s,", eye, table.longitude[row],
+                          size_info(table.size_id(row)).name, stimulus_info(stimulus).name);
+    out += file;
+    out.append(buffer, static_cast<std::size_t>(n));
+    if (!std::isnan(normed)) {
+        n = std::snprintf(buffer, sizeof(buffer), "%g", normed);
+        out.append(buffer, static_cast<std::size_t>(n));
+    }
+    if (point == static_cast<std::size_t>(-1)) {
+        out += ",,\n";
+    } else {
+        n = std::snprintf(buffer, sizeof(buffer), ",%g,%g\n", table.phi[point], table.theta[point]);
+        out.append(buffer, static_cast<std::size_t>(n));
+    }
+}
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        std::fprintf(stderr, "usage: %s ROOT [OUT.csv]\n", argv[0]);
+        return 2;
+    }
+    fs::path root = argv[1];
+    std::error_code ec;
+    if (!fs::is_directory(root, ec)) {
+        std::fprintf(stderr, "%s is not a directory\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<fs::path> files;
+    for (auto it = fs::recursive_directory_iterator(root, ec); !ec && it != fs::recursive_directory_iterator();
+         it.increment(ec)) {
+        if (it->is_regular_file(ec) && it->path().extension() == ".csv") files.push_back(it->path());
+    }
+    std::sort(files.begin(), files.end());
+
+    MeasurementCsvReader reader;
+    MeasurementTable table;
+    std::string out = "file,eye,longitude,size,intensity,normed,phi,theta\n";
+    const bool write = argc == 3;
+    std::size_t converted = 0, skipped = 0, rows = 0, points = 0;
+    double parse_seconds = 0.0;
+
+    for (const fs::path& path : files) {
+        auto start = std::chrono::steady_clock::now();
+        bool ok = reader.read(path.string(), table);
+        parse_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (!ok) {
+            skipped++;
+            if (reader.error().find("unknown header") == std::string::npos) {
+                std::fprintf(stderr, "skipped %s\n", reader.error().c_str());
+            }
+            continue;
+        }
+        converted++;
+        rows += table.rows();
+        points += table.points();
+        if (!write) continue;
+
+        std::string name = fs::relative(path, root, ec).generic_string();
+        const char* eye = eye_of(path.filename().string());
+        for (std::size_t row = 0; row < table.rows(); row++) {
+            std::uint32_t first = table.point_begin[row];
+            std::uint32_t last = table.point_begin[row + 1];
+            if (first == last) append_row(out, name, eye, table, row, static_cast<std::size_t>(-1));
+            for (std::uint32_t p = first; p < last; p++) append_row(out, name, eye, table, row, p);
+        }
+    }
+
+    std::printf("%zu files converted, %zu skipped: %zu rows, %zu points\n", converted, skipped, rows, points);
+    if (parse_seconds > 0.0) {
+        std::printf("read + parse: %.3f s, %.0f files/s, %.1f MB/s\n", parse_seconds,
+                    static_cast<double>(converted + skipped) / parse_seconds,
+                    static_cast<double>(reader.bytes_read()) / parse_seconds / 1e6);
+    }
+    if (write) {
+        if (!write_file_atomic(argv[2], out)) {
+            std::fprintf(stderr, "cannot write %s\n", argv[2]);
+            return 1;
+        }
+        std::printf("  -> %s\n", argv[2]);
+    }
+    return 0;
+}
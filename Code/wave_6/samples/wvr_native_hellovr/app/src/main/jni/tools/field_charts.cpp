@@ -0,0 +1,79 @@
+// field_charts.cpp
+//
+// Draws the visual field chart of every eye under a Measurements tree (result
+// sheets and .pses session files), without matplotlib, on all cores:
+//
+//   field_charts ROOT OUT_DIR [--threads N] [--size PX] [--svg-only|--png-only]
+//                [--no-normative]
+//
+// One OUT_DIR/<path>.svg and .png per eye, named after the path of its file
+// (see study_chart_name). The normative isopters are drawn at the age of
+// the subject from ROOT/subjects.csv, DEFAULT_PATIENT_AGE_YEARS otherwise.
+// Prints the fit and render times, the render time is the one to watch when
+// changing the rasterizer or the worker pool.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "IsopterStudy.h"
+
+int main(int argc, char** argv) {
+    const char* root = nullptr;
+    const char* out_dir = nullptr;
+    unsigned threads = 0;
+    StudyChartOptions options;
+    bool usage = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            options.chart.size = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--svg-only") == 0) {
+            options.png = false;
+        } else if (std::strcmp(argv[i], "--png-only") == 0) {
+            options.svg = false;
+        } else if (std::strcmp(argv[i], "--no-normative") == 0) {
+            options.chart.normative = false;
+        } else if (!root && argv[i][0] != '-') {
+            root = argv[i];
+        } else if (!out_dir && argv[i][0] != '-') {
+            out_dir = argv[i];
+        } else {
+            usage = true;
+        }
+    }
+    if (usage || !root || !out_dir || options.chart.size < 64 || (!options.svg && !options.png)) {
+        std::fprintf(stderr,
+                     "usage: %s ROOT OUT_DIR [--threads N] [--size PX] [--svg-only|--png-only] [--no-normative]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<StudyEyeIsopters> eyes;
+    StudyIsopterStats stats;
+    std::string error;
+    if (!build_study_isopters(root, eyes, IsopterOptions(), threads, &stats, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    auto fitted = std::chrono::steady_clock::now();
+    std::printf("%zu eyes, %zu copies, %zu other files: %zu isopters, %zu with a contour (%.3f s)\n",
+                stats.sheets, stats.duplicates, stats.skipped, stats.isopters, stats.contours,
+                std::chrono::duration<double>(fitted - start).count());
+
+    StudyChartStats chart_stats;
+    bool ok = render_study_charts(eyes, out_dir, options, threads, &chart_stats, &error);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - fitted).count();
+    std::printf("%zu charts, %zu files, %.1f MB in %.3f s, %u workers\n", chart_stats.charts, chart_stats.files,
+                chart_stats.bytes / 1e6, seconds, chart_stats.workers);
+    if (!ok) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    std::printf("  -> %s\n", out_dir);
+    return 0;
+}
@@ -0,0 +1,125 @@
+// gaze_benchmark.cpp
+//
+// Times the gaze sample encoder (GazeChunkEncoder) and decoder on a
+// recorded gaze file, or on a synthetic fixating eye when no file is given:
+//
+//   gaze_benchmark [GAZE.pgaz] [--minutes N] [--hz HZ]
+//
+// Prints the encoded size and the time per sample. The frame loop adds one
+// sample per frame; in a release build encoding should stay far below a
+// microsecond per sample.
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "GazeRecorder.h"
+
+namespace {
+// Fixating eye with small drift and noise, a saccade every few seconds
+std::vector<GazeSample> synthetic_stream(std::size_t count, double hz) {
+    std::mt19937 rng(7);
+    std::normal_distribution<float> noise(0.0f, 0.002f);
+    std::uniform_real_distribution<float> saccade(-0.2f, 0.2f);
+    std::vector<GazeSample> samples(count);
+    float x = 0.0f, y = 0.0f;
+    for (std::size_t i = 0; i < count; i++) {
+        GazeSample& s = samples[i];
+        s.time_ns = 5000000000LL + static_cast<std::int64_t>(static_cast<double>(i) * 1e9 / hz);
+        if (i % 300 == 299) { x = saccade(rng); y = saccade(rng); }
+        for (GazeEyeSample* eye : {&s.left, &s.right}) {
+            eye->valid_mask = 0x1f;
+            eye->origin = {0.032f, 0.0f, 0.0f};
+            eye->direction = {x + noise(rng), y + noise(rng), -1.0f};
+            eye->openness = 1.0f;
+            eye->pupil_diameter_mm = 3.5f + noise(rng);
+            eye->pupil_position = {0.5f + noise(rng), 0.5f + noise(rng)};
+        }
+        s.fixation_angle_deg = std::abs(x) * 57.3f;
+        s.flags = GazeSample::ANGLE_VALID | (s.fixation_angle_deg < 10.0f ? GazeSample::ON_TARGET : 0);
+        s.exam_state = 2;
+        s.track_id = static_cast<std::uint32_t>(1 + i / 500);
+        s.eccentricity_deg = 90.0f - static_cast<float>(i % 500) * 0.1f;
+    }
+    return samples;
+}
+}
+
+int main(int argc, char** argv) {
+    const char* path = nullptr;
+    double minutes = 20.0;
+    double hz = 72.0;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--minutes") == 0 && i + 1 < argc) {
+            minutes = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--hz") == 0 && i + 1 < argc) {
+            hz = std::atof(argv[++i]);
+        } else if (!path && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            path = nullptr;
+            minutes = 0.0;
+            break;
+        }
+    }
+    if (!(minutes > 0.0) || !(hz > 0.0)) {
+        std::fprintf(stderr, "usage: %s [GAZE.pgaz] [--minutes N] [--hz HZ]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<GazeSample> samples;
+    if (path) {
+        std::string error;
+        if (!read_gaze_file(path, samples, &error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+    } else {
+        samples = synthetic_stream(static_cast<std::size_t>(minutes * 60.0 * hz), hz);
+    }
+    if (samples.empty()) {
+        std::fprintf(stderr, "no samples\n");
+        return 1;
+    }
+
+    struct Chunk {
+        std::vector<std::uint8_t> payload;
+        std::uint32_t samples;
+    };
+    std::vector<Chunk> chunks;
+    GazeChunkEncoder encoder(GazeRecorder::CHUNK_BYTES);
+    auto start = std::chrono::steady_clock::now();
+    for (const GazeSample& sample : samples) {
+        if (!encoder.add(sample)) {
+            std::uint32_t count = encoder.sample_count();
+            chunks.push_back({encoder.take(), count});
+            encoder.add(sample);
+        }
+    }
+    std::uint32_t count = encoder.sample_count();
+    chunks.push_back({encoder.take(), count});
+    double encode_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<GazeSample> decoded;
+    decoded.reserve(samples.size());
+    std::size_t bytes = 0;
+    start = std::chrono::steady_clock::now();
+    for (const Chunk& chunk : chunks) {
+        if (!decode_gaze_chunk(chunk.payload.data(), chunk.payload.size(), chunk.samples, decoded)) {
+            std::fprintf(stderr, "chunk does not decode\n");
+            return 1;
+        }
+        bytes += chunk.payload.size();
+    }
+    double decode_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double n = static_cast<double>(samples.size());
+    std::printf("%zu samples, %zu chunks: %zu bytes, %.1f per sample\n", samples.size(), chunks.size(), bytes,
+                static_cast<double>(bytes) / n);
+    std::printf("encode %.1f ns per sample, decode %.1f ns per sample\n", encode_s / n * 1e9, decode_s / n * 1e9);
+    return 0;
+}
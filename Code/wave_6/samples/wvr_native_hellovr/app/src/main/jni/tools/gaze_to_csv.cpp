@@ -0,0 +1,53 @@
+// gaze_to_csv.cpp
+//
+// Converts a recorded gaze file (GazeRecorder) into a CSV with one row per
+// sample, columns as in RecordSchema<GazeSample>:
+//
+//   gaze_to_csv GAZE.pgaz OUT.csv
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "FileUtil.h"
+#include "GazeRecorder.h"
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::fprintf(stderr, "usage: %s GAZE.pgaz OUT.csv\n", argv[0]);
+        return 2;
+    }
+    std::vector<GazeSample> samples;
+    std::string error;
+    if (!read_gaze_file(argv[1], samples, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    int fd = ::open(argv[2], O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::fprintf(stderr, "cannot write %s: %s\n", argv[2], std::strerror(errno));
+        return 1;
+    }
+    // One buffer for the whole file, written out whenever it is full
+    FormatBuffer out(1 << 20);
+    bool ok = write_csv_header<GazeSample>(out);
+    for (const GazeSample& sample : samples) {
+        if (write_csv_record(out, sample)) continue;
+        ok = ok && write_all(fd, out.data(), out.size());
+        out.clear();
+        ok = ok && write_csv_record(out, sample);
+    }
+    ok = ok && write_all(fd, out.data(), out.size());
+    ok = ::close(fd) == 0 && ok;
+    if (!ok) {
+        std::fprintf(stderr, "cannot write %s\n", argv[2]);
+        return 1;
+    }
+    std::printf("%zu samples -> %s\n", samples.size(), argv[2]);
+    return 0;
+}
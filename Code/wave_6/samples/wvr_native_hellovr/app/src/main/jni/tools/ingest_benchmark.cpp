@@ -0,0 +1,136 @@
+// ingest_benchmark.cpp
+//
+// Times a clinic day of uploads: several headsets (SessionUploader) send
+// their sessions to one IngestServer over a Unix socket in WORK_DIR:
+//
+//   ingest_benchmark WORK_DIR [--headsets N] [--sessions N]
+//
+// WORK_DIR must be empty or missing; it keeps the store and the session
+// files of every headset. Prints the sessions per second and the group
+// commit syncs. A release build takes well under a second for 8 x 40.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FileUtil.h"
+#include "IngestServer.h"
+#include "SessionFile.h"
+#include "SessionStore.h"
+#include "SessionUploader.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+// Full sheet of both eyes: 24 meridians x 15 stimuli, two points each.
+// seed makes the content (and so the store hash) unique.
+std::string make_session_image(int seed) {
+    SessionData data;
+    data.created_unix_ms = 1769702874000 + seed * 60000;
+    data.patient_index = static_cast<std::uint32_t>(seed);
+    data.first_eye = 1;
+    for (int eye = 1; eye <= 2; eye++) {
+        for (int longitude = 0; longitude < 360; longitude += 15) {
+            for (int stimulus = 0; stimulus < 15; stimulus++) {
+                data.sheet.eye.push_back(static_cast<std::uint8_t>(eye));
+                data.sheet.longitude.push_back(static_cast<std::int16_t>(longitude));
+                data.sheet.size.push_back(static_cast<std::uint8_t>(stimulus % 5));
+                data.sheet.luminance.push_back(static_cast<std::uint8_t>(stimulus));
+                data.sheet.normalized_angle.push_back(30.0f + seed % 7);
+                data.sheet.point_count.push_back(2);
+                for (int i = 0; i < 2; i++) {
+                    data.sheet.point_phi.push_back(static_cast<float>(longitude) + 0.001f * seed);
+                    data.sheet.point_theta.push_back(30.0f + i);
+                }
+            }
+        }
+    }
+    return serialize_session(data);
+}
+}
+
+int main(int argc, char** argv) {
+    const char* work_dir = nullptr;
+    int headsets = 8;
+    int sessions = 40;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--headsets") == 0 && i + 1 < argc) {
+            headsets = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--sessions") == 0 && i + 1 < argc) {
+            sessions = std::atoi(argv[++i]);
+        } else if (!work_dir && argv[i][0] != '-') {
+            work_dir = argv[i];
+        } else {
+            work_dir = nullptr;
+            break;
+        }
+    }
+    if (!work_dir || headsets <= 0 || sessions <= 0) {
+        std::fprintf(stderr, "usage: %s WORK_DIR [--headsets N] [--sessions N]\n", argv[0]);
+        return 2;
+    }
+    std::error_code ec;
+    if (fs::exists(work_dir, ec) && !fs::is_empty(work_dir, ec)) {
+        std::fprintf(stderr, "%s is not empty\n", work_dir);
+        return 1;
+    }
+
+    std::string dir = work_dir;
+    std::vector<std::string> device_dirs;
+    for (int h = 0; h < headsets; h++) {
+        device_dirs.push_back(dir + "/device" + std::to_string(h));
+        fs::create_directories(device_dirs.back(), ec);
+        for (int s = 0; s < sessions; s++) {
+            std::string path = device_dirs.back() + "/session_" + std::to_string(100000 + h * 1000 + s) + ".pses";
+            if (!write_file_atomic(path, make_session_image(h * 1000 + s))) {
+                std::fprintf(stderr, "cannot write %s\n", path.c_str());
+                return 1;
+            }
+        }
+    }
+
+    SessionStore store;
+    if (!store.open(dir)) {
+        std::fprintf(stderr, "%s\n", store.error().c_str());
+        return 1;
+    }
+    IngestServer server(store);
+    std::string address = "unix:" + dir + "/ingest.sock";
+    if (!server.listen(address) || !server.start()) {
+        std::fprintf(stderr, "%s\n", server.error().c_str());
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::unique_ptr<SessionUploader>> uploaders;
+    for (int h = 0; h < headsets; h++) {
+        uploaders.emplace_back(new SessionUploader(address, static_cast<std::uint64_t>(h),
+                                                   "headset" + std::to_string(h)));
+        uploaders.back()->post_pending(device_dirs[h]);
+    }
+    bool idle = true;
+    for (auto& uploader : uploaders) idle = uploader->wait_idle(std::chrono::minutes(10)) && idle;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uploaders.clear();
+    server.stop();
+
+    const IngestStats& stats = server.stats();
+    std::uint64_t total = static_cast<std::uint64_t>(headsets) * static_cast<std::uint64_t>(sessions);
+    std::printf("%d headsets x %d sessions: %llu stored, %llu failed in %.3f s (%.0f sessions/s)\n", headsets,
+                sessions, static_cast<unsigned long long>(stats.stored.load()),
+                static_cast<unsigned long long>(stats.failed.load()), seconds,
+                seconds > 0.0 ? static_cast<double>(total) / seconds : 0.0);
+    std::printf("%llu syncs, %llu connections, %.1f MB received\n",
+                static_cast<unsigned long long>(stats.syncs.load()),
+                static_cast<unsigned long long>(stats.connections.load()),
+                static_cast<double>(stats.bytes.load()) / (1024.0 * 1024.0));
+    if (!idle || stats.stored.load() != total) {
+        std::fprintf(stderr, "not every session was stored\n");
+        return 1;
+    }
+    return 0;
+}
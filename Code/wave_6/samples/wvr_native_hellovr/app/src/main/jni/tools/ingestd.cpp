@@ -0,0 +1,66 @@
+// ingestd.cpp
+//
+// Ingestion service for the headsets: receives session uploads
+// (core/UploadProtocol.h) and stores them in a session store.
+//
+//   ingestd STORE_DIR ADDRESS...
+//
+// e.g. ingestd /srv/perimetry unix:/run/perimetry/ingest.sock 0.0.0.0:7420
+//
+// Runs until SIGINT or SIGTERM, then saves the store index.
+#include <csignal>
+#include <cstdio>
+
+#include <pthread.h>
+
+#include "IngestServer.h"
+#include "SessionStore.h"
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::fprintf(stderr, "usage: %s STORE_DIR ADDRESS...\n", argv[0]);
+        return 2;
+    }
+
+    // Block the signals before any thread starts, main waits for them
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    SessionStore store;
+    if (!store.open(argv[1])) {
+        std::fprintf(stderr, "%s\n", store.error().c_str());
+        return 1;
+    }
+    if (store.broken_records() != 0) {
+        std::fprintf(stderr, "%s: skipped %zu broken records\n", argv[1], store.broken_records());
+    }
+    IngestServer server(store);
+    for (int i = 2; i < argc; i++) {
+        if (!server.listen(argv[i])) {
+            std::fprintf(stderr, "%s\n", server.error().c_str());
+            return 1;
+        }
+    }
+    if (!server.start()) {
+        std::fprintf(stderr, "%s\n", server.error().c_str());
+        return 1;
+    }
+    std::fprintf(stderr, "ingestd: %zu sessions in the store, listening\n", store.session_count());
+
+    int signal = 0;
+    sigwait(&signals, &signal);
+    server.stop();
+
+    const IngestStats& s = server.stats();
+    std::fprintf(stderr,
+                 "ingestd: %llu connections, %llu sessions: %llu stored, %llu duplicates, %llu invalid, "
+                 "%llu failed; %llu protocol errors, %llu syncs\n",
+                 static_cast<unsigned long long>(s.connections), static_cast<unsigned long long>(s.sessions),
+                 static_cast<unsigned long long>(s.stored), static_cast<unsigned long long>(s.duplicates),
+                 static_cast<unsigned long long>(s.invalid), static_cast<unsigned long long>(s.failed),
+                 static_cast<unsigned long long>(s.protocol_errors), static_cast<unsigned long long>(s.syncs));
+    return store.save_index() ? 0 : 1;
+}
@@ -0,0 +1,158 @@
+// isopters.cpp
+//
+// Fits the isopters of every result sheet (and of both eyes of every .pses
+// session file) under a Measurements tree, as vis2.py draws them, on all
+// cores:
+//
+//   isopters ROOT [OUT.csv] [--areas AREAS.csv] [--threads N] [--samples N]
+//
+// Output columns: file,subject,eye, then the contour rows of IsopterSampleRow
+// (SizeIndex,Intensity,Angle,Radius,X,Y). Without OUT.csv only the
+// statistics are printed.
+//
+// AREAS.csv has one row per isopter with a contour: its solid angle in deg²
+// and sr, the normative area at the age of the subject (ROOT/subjects.csv,
+// DEFAULT_PATIENT_AGE_YEARS otherwise), the area lost against it, and the
+// area and loss per quadrant in deg². The normative columns are empty for
+// stimuli outside NormativeModel.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "FileUtil.h"
+#include "IsopterStudy.h"
+
+namespace {
+void append_area(std::string& out, double sr) {
+    char buffer[32];
+    int n = std::snprintf(buffer, sizeof(buffer), ",%.6g", sr * SQUARE_DEGREES_PER_STERADIAN);
+    out.append(buffer, static_cast<std::size_t>(n));
+}
+
+bool write_areas(const std::vector<StudyEyeIsopters>& eyes, int samples, unsigned threads, const char* path) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::vector<IsopterArea>> areas;
+    score_study_isopters(eyes, areas, samples, threads);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::string out = "file,subject,eye,age,SizeIndex,Intensity,area_deg2,area_sr,normative_deg2,lost_deg2,"
+                      "lost_fraction";
+    for (const char* column : {"area", "lost"}) {
+        for (int q = 0; q < FIELD_QUADRANT_COUNT; q++) {
+            out += std::string(",") + column + "_" + quadrant_name(static_cast<FieldQuadrant>(q)) + "_deg2";
+        }
+    }
+    out += '\n';
+    std::size_t scored = 0;
+    for (std::size_t i = 0; i < eyes.size(); i++) {
+        const StudyEyeIsopters& eye = eyes[i];
+        for (std::size_t j = 0; j < eye.isopters.size(); j++) {
+            const Isopter& isopter = eye.isopters[j];
+            const IsopterArea& area = areas[i][j];
+            if (!isopter.has_contour()) continue;
+            scored++;
+            char buffer[96];
+            int n = std::snprintf(buffer, sizeof(buffer), ",%ld,%d,%d,%s,%s", eye.subject, eye.eye, eye.age_years,
+                                  size_info(isopter.size).name, stimulus_info(isopter.luminance).name);
+            out += eye.file;
+            out.append(buffer, static_cast<std::size_t>(n));
+            append_area(out, area.area_sr);
+            n = std::snprintf(buffer, sizeof(buffer), ",%.6g", area.area_sr);
+            out.append(buffer, static_cast<std::size_t>(n));
+            if (area.has_normative()) {
+                append_area(out, area.normative_sr);
+                append_area(out, area.lost_sr);
+                n = std::snprintf(buffer, sizeof(buffer), ",%.4f", area.lost_fraction());
+                out.append(buffer, static_cast<std::size_t>(n));
+            } else {
+                out += ",,,";
+            }
+            for (double sr : area.quadrant_sr) append_area(out, sr);
+            for (double sr : area.quadrant_lost_sr) {
+                if (area.has_normative()) {
+                    append_area(out, sr);
+                } else {
+                    out += ',';
+                }
+            }
+            out += '\n';
+        }
+    }
+    std::printf("%zu areas in %.4f s\n", scored, seconds);
+    if (!write_file_atomic(path, out)) {
+        std::fprintf(stderr, "cannot write %s\n", path);
+        return false;
+    }
+    std::printf("  -> %s\n", path);
+    return true;
+}
+}
+
+int main(int argc, char** argv) {
+    const char* root = nullptr;
+    const char* out_path = nullptr;
+    const char* areas_path = nullptr;
+    unsigned threads = 0;
+    IsopterOptions options;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--areas") == 0 && i + 1 < argc) {
+            areas_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            options.samples = std::atoi(argv[++i]);
+        } else if (!root && argv[i][0] != '-') {
+            root = argv[i];
+        } else if (!out_path && argv[i][0] != '-') {
+            out_path = argv[i];
+        } else {
+            root = nullptr;
+            break;
+        }
+    }
+    if (!root || options.samples < 1) {
+        std::fprintf(stderr, "usage: %s ROOT [OUT.csv] [--areas AREAS.csv] [--threads N] [--samples N]\n", argv[0]);
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<StudyEyeIsopters> eyes;
+    StudyIsopterStats stats;
+    std::string error;
+    if (!build_study_isopters(root, eyes, options, threads, &stats, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%zu sheets, %zu copies, %zu other files: %zu isopters, %zu with a contour\n", stats.sheets,
+                stats.duplicates, stats.skipped, stats.isopters, stats.contours);
+    std::printf("%.3f s, %u workers\n", seconds, stats.workers);
+    if (areas_path && !write_areas(eyes, options.samples, threads, areas_path)) return 1;
+    if (!out_path) return 0;
+
+    std::string out = "file,subject,eye," + csv_header<IsopterSampleRow>();
+    for (const StudyEyeIsopters& eye : eyes) {
+        FormatBuffer rows(isopter_csv_capacity(eye.isopters));
+        write_isopter_rows(eye.isopters, rows);
+        char prefix[32];
+        int n = std::snprintf(prefix, sizeof(prefix), ",%ld,%d,", eye.subject, eye.eye);
+        const char* line = rows.data();
+        const char* end = rows.data() + rows.size();
+        while (line < end) {
+            const char* next = static_cast<const char*>(std::memchr(line, '\n', end - line)) + 1;
+            out += eye.file;
+            out.append(prefix, static_cast<std::size_t>(n));
+            out.append(line, next);
+            line = next;
+        }
+    }
+    if (!write_file_atomic(out_path, out)) {
+        std::fprintf(stderr, "cannot write %s\n", out_path);
+        return 1;
+    }
+    std::printf("  -> %s\n", out_path);
+    return 0;
+}
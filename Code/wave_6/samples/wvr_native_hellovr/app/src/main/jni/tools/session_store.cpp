@@ -0,0 +1,140 @@
+// session_store.cpp
+//
+// Imports Measurements trees into a session store and queries it:
+//
+//   session_store DIR import ROOT
+//   session_store DIR age SUBJECT YEARS
+//   session_store DIR query [subject=N] [eye=right|left] [stimulus=I2e]
+//                           [meridian=DEG] [from=YYYYMMDD] [to=YYYYMMDD]
+//                           [min_age=N] [max_age=N] [journals=1]
+//
+// e.g. all I2e points at meridian 210 for subjects over 50:
+//
+//   session_store store query stimulus=I2e meridian=210 min_age=51
+//
+// query prints CSV: subject,eye,date,time,meridian,size,intensity,normed,phi,theta
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "SessionStore.h"
+#include "Settings.h"
+
+namespace {
+// "I2e" .. "V4e"
+bool parse_stimulus(const std::string& text, StoreQuery& query) {
+    std::size_t roman = 0;
+    while (roman < text.size() && (text[roman] == 'I' || text[roman] == 'V')) roman++;
+    if (roman == 0 || text.size() != roman + 2 || !StimulusCode::is_valid(text[roman], text[roman + 1])) {
+        return false;
+    }
+    std::string size_name = "Size_" + text.substr(0, roman);
+    for (const GoldmannSizeInfo& size : GOLDMANN_SIZES) {
+        if (size_name == size.name && size.id != MeteoroidSizeID::None) {
+            query.size = size.id;
+            query.luminance = StimulusCode::from_chars(text[roman], text[roman + 1]).index;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parse_argument(const char* argument, StoreQuery& query) {
+    const char* equals = std::strchr(argument, '=');
+    if (!equals) return false;
+    std::string key(argument, equals);
+    std::string value(equals + 1);
+    long number = std::strtol(value.c_str(), nullptr, 10);
+    if (key == "subject") {
+        query.subject = number;
+    } else if (key == "eye") {
+        query.eye = value == "right" ? 1 : (value == "left" ? 2 : 0);
+        return query.eye != 0;
+    } else if (key == "stimulus") {
+        return parse_stimulus(value, query);
+    } else if (key == "meridian") {
+        query.meridian = static_cast<int>(number);
+    } else if (key == "from") {
+        query.date_from = static_cast<std::uint32_t>(number);
+    } else if (key == "to") {
+        query.date_to = static_cast<std::uint32_t>(number);
+    } else if (key == "min_age") {
+        query.min_age = static_cast<int>(number);
+    } else if (key == "max_age") {
+        query.max_age = static_cast<int>(number);
+    } else if (key == "journals") {
+        query.include_journals = number != 0;
+    } else {
+        return false;
+    }
+    return true;
+}
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::fprintf(stderr, "usage: %s DIR import ROOT | age SUBJECT YEARS | query [key=value...]\n", argv[0]);
+        return 2;
+    }
+    SessionStore store;
+    auto start = std::chrono::steady_clock::now();
+    if (!store.open(argv[1])) {
+        std::fprintf(stderr, "%s\n", store.error().c_str());
+        return 1;
+    }
+    if (store.broken_records() != 0) {
+        std::fprintf(stderr, "%s: skipped %zu broken records\n", argv[1], store.broken_records());
+    }
+    double open_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::string command = argv[2];
+
+    if (command == "import" && argc == 4) {
+        StoreImportStats stats;
+        std::string error;
+        if (!import_measurement_tree(store, argv[3], &stats, &error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        std::printf("%zu files: %zu stored, %zu duplicates, %zu skipped; %zu sessions, %zu rows in the store\n",
+                    stats.files, stats.stored, stats.duplicates, stats.skipped, store.session_count(),
+                    store.row_count());
+        return 0;
+    }
+    if (command == "age" && argc == 5) {
+        if (!store.set_subject_age(static_cast<std::uint32_t>(std::strtoul(argv[3], nullptr, 10)),
+                                   std::atoi(argv[4]))) {
+            std::fprintf(stderr, "%s\n", store.error().c_str());
+            return 1;
+        }
+        return store.save_index() ? 0 : 1;
+    }
+    if (command != "query") {
+        std::fprintf(stderr, "unknown command %s\n", command.c_str());
+        return 2;
+    }
+
+    StoreQuery query;
+    for (int i = 3; i < argc; i++) {
+        if (!parse_argument(argv[i], query)) {
+            std::fprintf(stderr, "bad argument %s\n", argv[i]);
+            return 2;
+        }
+    }
+    std::vector<StoredPoint> points;
+    start = std::chrono::steady_clock::now();
+    std::size_t rows = store.query(query, points);
+    double query_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("subject,eye,date,time,meridian,size,intensity,normed,phi,theta\n");
+    for (const StoredPoint& p : points) {
+        std::printf("%u,%s,%u,%06u,%d,%s,%s,%g,%g,%g\n", p.subject, p.eye == 1 ? "right" : "left", p.date, p.time,
+                    p.meridian, size_info(p.size).name, stimulus_info(p.luminance).name, p.normed_value, p.phi,
+                    p.theta);
+    }
+    std::fprintf(stderr, "%zu rows, %zu points (open %.2f ms, query %.3f ms, %llu point bytes read)\n", rows,
+                 points.size(), open_ms, query_ms, static_cast<unsigned long long>(store.point_bytes_read()));
+    return 0;
+}
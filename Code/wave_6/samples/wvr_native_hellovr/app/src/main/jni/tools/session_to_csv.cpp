@@ -0,0 +1,55 @@
+// session_to_csv.cpp
+//
+// Converts a binary session file into the legacy final CSVs read by the
+// scripts in Code/Analyisis (Measurements/SubjectN/Right.csv and Left.csv).
+//
+//   session_to_csv SESSION.pses [OUT_DIR]
+//
+// OUT_DIR defaults to the directory of the session file.
+#include <cstdio>
+#include <string>
+
+#include "FileUtil.h"
+#include "SessionFile.h"
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        std::fprintf(stderr, "usage: %s SESSION.pses [OUT_DIR]\n", argv[0]);
+        return 2;
+    }
+    std::string input = argv[1];
+    std::string out_dir;
+    if (argc == 3) {
+        out_dir = argv[2];
+    } else {
+        std::string::size_type slash = input.find_last_of('/');
+        out_dir = slash == std::string::npos ? "." : input.substr(0, slash);
+    }
+    if (out_dir.empty() || out_dir.back() != '/') out_dir += "/";
+
+    SessionFileView file;
+    if (!file.open(input)) {
+        std::fprintf(stderr, "%s\n", file.error().c_str());
+        return 1;
+    }
+
+    const SessionFileHeader& header = file.header();
+    std::printf("%s: version %u, patient %u, first eye %u\n", input.c_str(), header.version,
+                header.patient_index, header.first_eye);
+    std::printf("  %zu stimuli, %zu responses, %zu pauses, %zu gaze samples\n",
+                file.column<std::int64_t>(SessionColumn::StimulusTime).size(),
+                file.column<std::int64_t>(SessionColumn::ResponseTime).size(),
+                file.column<std::int64_t>(SessionColumn::PauseStart).size(),
+                file.column<std::int64_t>(SessionColumn::GazeTime).size());
+
+    const char* names[2] = {"Right.csv", "Left.csv"};
+    for (int eye = 1; eye <= 2; eye++) {
+        std::string path = out_dir + names[eye - 1];
+        if (!write_file_atomic(path, session_to_legacy_csv(file, eye))) {
+            std::fprintf(stderr, "cannot write %s\n", path.c_str());
+            return 1;
+        }
+        std::printf("  -> %s\n", path.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+// session_to_dicom.cpp
+//
+// Converts a binary session file into one DICOM file per examined eye
+// (see DicomExport.h), for archiving in a PACS:
+//
+//   session_to_dicom SESSION.pses [OUT_DIR] [PATIENT_ID] [PATIENT_NAME]
+//
+// OUT_DIR defaults to the directory of the session file, the patient id to
+// PERIMETRY-<patient index>. Writes Right.dcm and Left.dcm.
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include "DicomExport.h"
+#include "FileUtil.h"
+#include "SessionFile.h"
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 5) {
+        std::fprintf(stderr, "usage: %s SESSION.pses [OUT_DIR] [PATIENT_ID] [PATIENT_NAME]\n", argv[0]);
+        return 2;
+    }
+    std::string input = argv[1];
+    std::string out_dir;
+    if (argc >= 3) {
+        out_dir = argv[2];
+    } else {
+        std::string::size_type slash = input.find_last_of('/');
+        out_dir = slash == std::string::npos ? "." : input.substr(0, slash);
+    }
+    if (out_dir.empty() || out_dir.back() != '/') out_dir += "/";
+
+    SessionFileView file;
+    if (!file.open(input)) {
+        std::fprintf(stderr, "%s\n", file.error().c_str());
+        return 1;
+    }
+    DicomStudyInfo info = default_dicom_study_info(file.header());
+    if (argc >= 4) info.patient_id = argv[3];
+    if (argc >= 5) info.patient_name = argv[4];
+
+    const char* names[2] = {"Right.dcm", "Left.dcm"};
+    int written = 0;
+    for (int eye = 1; eye <= 2; eye++) {
+        FormatBuffer out(dicom_capacity(file, eye));
+        auto start = std::chrono::steady_clock::now();
+        std::string error;
+        if (!write_session_dicom(file, eye, info, out, &error)) {
+            std::fprintf(stderr, "eye %d: %s\n", eye, error.c_str());
+            continue;
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::string path = out_dir + names[eye - 1];
+        if (!write_file_atomic(path, out.str())) {
+            std::fprintf(stderr, "cannot write %s\n", path.c_str());
+            return 1;
+        }
+        std::printf("  -> %s (%zu bytes, %.3f ms)\n", path.c_str(), out.size(), ms);
+        written++;
+    }
+    if (written == 0) {
+        std::fprintf(stderr, "nothing exported from %s\n", input.c_str());
+        return 1;
+    }
+    return 0;
+}
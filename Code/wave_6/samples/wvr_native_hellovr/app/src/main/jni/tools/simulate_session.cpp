@@ -0,0 +1,64 @@
+// simulate_session.cpp
+//
+// Runs the full two-eye protocol against a simulated normative patient on a
+// ManualClock and prints how long the exam takes on the headset.
+//
+//   simulate_session [--runs N] [--fps HZ]
+//
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "SessionSimulator.h"
+
+int main(int argc, char** argv) {
+    int runs = 10;
+    double fps = 72.0;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            fps = std::atof(argv[++i]);
+        } else {
+            std::fprintf(stderr, "usage: %s [--runs N] [--fps HZ]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (runs < 1 || fps <= 0.0) {
+        std::fprintf(stderr, "--runs and --fps must be positive\n");
+        return 2;
+    }
+
+    double total_simulated = 0.0;
+    double total_wall = 0.0;
+    int vectors = 0;
+    double eye_seconds[2] = {0.0, 0.0};
+    int eye_detections[2] = {0, 0};
+    for (int run = 0; run < runs; run++) {
+        SessionSimulator simulator(SimulatedPatient::normative(), fps);
+        SessionReport report = simulator.run({1, 2});
+        for (const EyeSimulationResult& eye : report.eyes) {
+            if (!eye.completed) {
+                std::fprintf(stderr, "run %d: eye %d did not finish\n", run, eye.eye);
+                return 1;
+            }
+            vectors = eye.vectors;
+            eye_seconds[eye.eye - 1] += eye.simulated_seconds;
+            eye_detections[eye.eye - 1] += eye.detections;
+        }
+        total_simulated += report.simulated_seconds;
+        total_wall += report.wall_seconds;
+    }
+
+    std::printf("Protocol: %d vectors per eye, %d runs at %.0f fps\n", vectors, runs, fps);
+    const char* names[2] = {"right", "left"};
+    for (int i = 0; i < 2; i++) {
+        std::printf("  %-5s eye: %7.1f s (%.1f min), %.1f detections\n", names[i],
+                    eye_seconds[i] / runs, eye_seconds[i] / runs / 60.0,
+                    static_cast<double>(eye_detections[i]) / runs);
+    }
+    std::printf("  session  : %7.1f s (%.1f min)\n", total_simulated / runs, total_simulated / runs / 60.0);
+    std::printf("Simulated %.0f s in %.3f s wall time (%.0fx real time)\n",
+                total_simulated, total_wall, total_wall > 0.0 ? total_simulated / total_wall : 0.0);
+    return 0;
+}
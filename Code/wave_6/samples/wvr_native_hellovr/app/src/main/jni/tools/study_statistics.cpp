@@ -0,0 +1,189 @@
+// study_statistics.cpp
+//
+// Test-retest repeatability and eye and group comparisons of a Measurements
+// tree (result sheets and .pses session files), resampled on all cores:
+//
+//   study_statistics ROOT [OUT_DIR] [--resamples N] [--seed S] [--threads N]
+//                    [--confidence C] [--groups GROUPS.csv]
+//
+// Prints the isopter repeatability and the comparisons. With OUT_DIR also
+// writes
+//
+//   meridians.csv    per stimulus and meridian (right eye orientation):
+//                    Bland-Altman and ICC of the eccentricity of repeat 1
+//                    against repeat 2, in deg
+//   isopters.csv     per stimulus: the same for the isopter area in deg²,
+//                    with bootstrap intervals, and the mean area
+//   comparisons.csv  per stimulus: right against left eye, and every pair
+//                    of groups of GROUPS.csv (Subject,Group), with the
+//                    permutation p value of the difference of mean areas
+//
+// The results depend on --seed only, not on the thread count.
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "FileUtil.h"
+#include "StudyStatistics.h"
+
+namespace {
+// format starts with the comma; NaN (too few eyes) is an empty column
+void append(std::string& out, const char* format, double value) {
+    if (std::isnan(value)) {
+        out += ',';
+        return;
+    }
+    char buffer[32];
+    int n = std::snprintf(buffer, sizeof(buffer), format, value);
+    out.append(buffer, static_cast<std::size_t>(n));
+}
+
+void append_stimulus(std::string& out, MeteoroidSizeID size, StimulusCode luminance) {
+    out += size_info(size).name;
+    out += ',';
+    out += stimulus_info(luminance).name;
+}
+
+void append_interval(std::string& out, const ConfidenceInterval& interval, const char* format) {
+    for (double value : {interval.estimate, interval.lower, interval.upper}) append(out, format, value);
+}
+
+bool write(const std::string& path, const std::string& content) {
+    if (!write_file_atomic(path, content)) {
+        std::fprintf(stderr, "cannot write %s\n", path.c_str());
+        return false;
+    }
+    std::printf("  -> %s\n", path.c_str());
+    return true;
+}
+}
+
+int main(int argc, char** argv) {
+    const char* root = nullptr;
+    const char* out_dir = nullptr;
+    const char* groups_path = nullptr;
+    ResampleOptions options;
+    bool usage = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--resamples") == 0 && i + 1 < argc) {
+            options.resamples = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--confidence") == 0 && i + 1 < argc) {
+            options.confidence = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--groups") == 0 && i + 1 < argc) {
+            groups_path = argv[++i];
+        } else if (!root && argv[i][0] != '-') {
+            root = argv[i];
+        } else if (!out_dir && argv[i][0] != '-') {
+            out_dir = argv[i];
+        } else {
+            usage = true;
+        }
+    }
+    if (!root || usage || !(options.confidence > 0.0 && options.confidence < 1.0)) {
+        std::fprintf(stderr,
+                     "usage: %s ROOT [OUT_DIR] [--resamples N] [--seed S] [--threads N] [--confidence C] "
+                     "[--groups GROUPS.csv]\n",
+                     argv[0]);
+        return 2;
+    }
+    std::vector<SubjectGroup> groups;
+    if (groups_path) {
+        groups = read_subject_groups(groups_path);
+        if (groups.empty()) {
+            std::fprintf(stderr, "no subjects in %s\n", groups_path);
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<StudyEyeIsopters> eyes;
+    StudyIsopterStats stats;
+    std::string error;
+    if (!build_study_repeats(root, eyes, NUMBER_ITERATIONS_PER_SIZE, IsopterOptions(), options.threads, &stats,
+                             &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%zu sheets (%zu copies left out), %zu isopters in %.3f s, %u workers\n", stats.sheets,
+                stats.duplicates, stats.isopters, seconds, stats.workers);
+
+    start = std::chrono::steady_clock::now();
+    std::vector<MeridianRepeatability> meridians = meridian_repeatability(eyes);
+    std::vector<IsopterRepeatability> isopters = isopter_repeatability(eyes, options);
+    std::vector<AreaComparison> comparisons = compare_eyes(eyes, options);
+    if (groups_path) {
+        std::vector<AreaComparison> between = compare_groups(eyes, groups, options);
+        comparisons.insert(comparisons.end(), between.begin(), between.end());
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%zu resamples, seed %llu: %.3f s\n", options.resamples,
+                static_cast<unsigned long long>(options.seed), seconds);
+
+    std::printf("\nisopter area (deg2), repeat 1 - repeat 2, %.0f%% intervals\n", options.confidence * 100.0);
+    for (const IsopterRepeatability& row : isopters) {
+        std::printf("  %s%s  %3zu pairs  bias %8.1f [%8.1f, %8.1f]  LoA %8.1f .. %8.1f  ICC %.3f [%.3f, %.3f]  "
+                    "mean %8.1f [%8.1f, %8.1f]\n",
+                    size_info(row.size).name + 5, stimulus_info(row.luminance).name, row.pairs, row.bias.estimate,
+                    row.bias.lower, row.bias.upper, row.lower_limit.estimate, row.upper_limit.estimate,
+                    row.icc.estimate, row.icc.lower, row.icc.upper, row.mean_area.estimate, row.mean_area.lower,
+                    row.mean_area.upper);
+    }
+    std::printf("\nmean area (deg2), permutation test\n");
+    for (const AreaComparison& row : comparisons) {
+        std::printf("  %s%s  %s (%zu) %8.1f  %s (%zu) %8.1f  difference %8.1f  p %.4g\n", size_info(row.size).name + 5,
+                    stimulus_info(row.luminance).name, row.a.c_str(), row.test.n_a, row.mean_a, row.b.c_str(),
+                    row.test.n_b, row.mean_b, row.test.observed, row.test.p_value);
+    }
+    if (!out_dir) return 0;
+
+    std::error_code ec;
+    std::filesystem::create_directories(out_dir, ec);
+    std::string dir = std::string(out_dir) + "/";
+
+    std::string out = "SizeIndex,Intensity,meridian,n,bias_deg,sd_deg,lower_deg,upper_deg,icc\n";
+    for (const MeridianRepeatability& row : meridians) {
+        append_stimulus(out, row.size, row.luminance);
+        out += ',' + std::to_string(row.meridian) + ',' + std::to_string(row.agreement.n);
+        for (double value : {row.agreement.bias, row.agreement.sd, row.agreement.lower(), row.agreement.upper()}) {
+            append(out, ",%.4f", value);
+        }
+        append(out, ",%.4f", row.icc);
+        out += '\n';
+    }
+    if (!write(dir + "meridians.csv", out)) return 1;
+
+    out = "SizeIndex,Intensity,pairs,bias_deg2,bias_low,bias_high,lower_deg2,lower_low,lower_high,upper_deg2,"
+          "upper_low,upper_high,icc,icc_low,icc_high,eyes,mean_area_deg2,mean_area_low,mean_area_high\n";
+    for (const IsopterRepeatability& row : isopters) {
+        append_stimulus(out, row.size, row.luminance);
+        out += ',' + std::to_string(row.pairs);
+        append_interval(out, row.bias, ",%.2f");
+        append_interval(out, row.lower_limit, ",%.2f");
+        append_interval(out, row.upper_limit, ",%.2f");
+        append_interval(out, row.icc, ",%.4f");
+        out += ',' + std::to_string(row.eyes);
+        append_interval(out, row.mean_area, ",%.2f");
+        out += '\n';
+    }
+    if (!write(dir + "isopters.csv", out)) return 1;
+
+    out = "SizeIndex,Intensity,a,b,n_a,n_b,mean_a_deg2,mean_b_deg2,difference_deg2,p_value,resamples\n";
+    for (const AreaComparison& row : comparisons) {
+        append_stimulus(out, row.size, row.luminance);
+        out += ',' + row.a + ',' + row.b + ',' + std::to_string(row.test.n_a) + ',' + std::to_string(row.test.n_b);
+        for (double value : {row.mean_a, row.mean_b, row.test.observed}) append(out, ",%.2f", value);
+        append(out, ",%.6g", row.test.p_value);
+        out += ',' + std::to_string(row.test.resamples) + '\n';
+    }
+    return write(dir + "comparisons.csv", out) ? 0 : 1;
+}